@@ -410,6 +410,17 @@ public class JData {
         }
     }
 
+    /**
+     * Metodo che indica se il messaggio contiene il dato richiesto
+     *
+     * @param key Chiave del dato
+     * @return Valore boleano che indica se il dato è presente
+     */
+    public boolean containsKey(String key) {
+        //un messaggio ancora vuoto non ha l'oggetto nested
+        return values != null && values.has(key);
+    }
+
     /**
      * Metodo che ritorna la radice del messaggio Jack (formato JSON)
      *
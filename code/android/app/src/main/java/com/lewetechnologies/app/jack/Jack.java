@@ -24,6 +24,10 @@ public abstract class Jack {
     private static final String JK_MESSAGE_TYPE = "type"; //key tipo messaggio
     private static final String JK_MESSAGE_TYPE_ACK = "ack"; //tipo ack
     private static final String JK_MESSAGE_TYPE_DATA = "data"; //tipo dati
+    private static final String JK_MESSAGE_TYPE_LIVE = "live"; //tipo dati senza conferma
+    private static final String JK_MESSAGE_TYPE_PING = "ping"; //tipo verifica del collegamento
+
+    private static final long JK_LIVE_RESTART_GAP = 64; //differenza di id oltre la quale il bracciale è ripartito
 
     private static final String JK_MESSAGE_ID = "id"; //id messaggio
     /**
@@ -48,6 +52,10 @@ public abstract class Jack {
     //contenitori dei messaggi
     private HashMap<Long, String> messageBuffer; //buffer per i messaggi da inviare
 
+    //stream senza conferma
+    private boolean liveReceived = false; //indica se è stato ricevuto almeno un messaggio senza conferma
+    private long lastLiveID; //id dell'ultimo messaggio senza conferma ricevuto
+
 
     //---HANDLER USER SPECIFIED---
 
@@ -66,6 +74,18 @@ public abstract class Jack {
      */
     public abstract void onReceiveAck(long id); //handler onReceiveAck
 
+    /**
+     * Handler dell'evento di ricezione di un messaggio senza conferma (di default chiama onReceive)
+     *
+     * I messaggi senza conferma arrivano al massimo una volta e quelli più vecchi dell'ultimo ricevuto vengono scartati.
+     *
+     * @param message Contenuto del messaggio ricevuto
+     * @param id ID del messaggio ricevuto (progressivo dello stream)
+     */
+    public void onReceiveLive(JData message, long id) {
+        onReceive(message, id);
+    }
+
     /**
      * Metodo che deve restituire un ID univoco per i messaggi da inviare
      *
@@ -236,6 +256,39 @@ public abstract class Jack {
                 //chiamo la funzione di gestione degli ack
                 checkAck(id);
 
+            //se è un messaggio dati senza conferma
+            } else if (type.equals(JK_MESSAGE_TYPE_LIVE)) {
+
+                //verifico se possiede la chiave per l'id del messaggio
+                if (!root.has(JK_MESSAGE_ID)) {
+                    return; //non ha la chiave quindi il messaggio non è valido
+                }
+
+                //ottengo l'id del messaggio
+                long id = root.getLong(JK_MESSAGE_ID);
+
+                //scarto i valori più vecchi dell'ultimo ricevuto, a meno che il bracciale sia ripartito
+                if (liveReceived && id <= lastLiveID && lastLiveID - id < JK_LIVE_RESTART_GAP) {
+                    return;
+                }
+
+                liveReceived = true;
+                lastLiveID = id;
+
+                //nessun ACK: chiamo la funzione di gestione definita dall'utente
+                onReceiveLive(new JData(root), id);
+
+            //se è una verifica del collegamento (il bracciale non riceve risposte da tempo)
+            } else if (type.equals(JK_MESSAGE_TYPE_PING)) {
+
+                //verifico se possiede la chiave per l'id del messaggio
+                if (!root.has(JK_MESSAGE_ID)) {
+                    return; //non ha la chiave quindi il messaggio non è valido
+                }
+
+                //rispondo con l'ACK dell'id della verifica
+                sendAck(root.getLong(JK_MESSAGE_ID));
+
             }
 
         } catch (JSONException e) {
@@ -298,15 +351,18 @@ public abstract class Jack {
         @Override
         public void execute() {
 
-            //controllo se ci sono messaggi da ricevere
-            if (Jack.this.mmJTM.available()) {
+            //elaboro tutti i messaggi ricevuti (durante il burst il bracciale invia più messaggi tra un polling e l'altro)
+            while (Jack.this.mmJTM.available()) {
 
                 String message = Jack.this.mmJTM.receive();
 
-                if (message != null) {
-                    Jack.this.execute(message);
+                //nessun messaggio completo (quello incompleto verrà prelevato al prossimo polling)
+                if (message == null) {
+                    break;
                 }
 
+                Jack.this.execute(message);
+
             }
 
             //controllo se posso inviare i messaggi e se ce ne sono da inviare
@@ -364,57 +364,72 @@ public class BluetoothSerialService extends Service implements JTransmissionMeth
             @Override
             public void onReceive(JData message, long id) {
 
-                //inserisco il dato del DB
-
-                //---TEMPERATURE---
-                String query = "INSERT INTO " + Database.TABLE_NAME + " (" +
-                        Database.CULUMN_NAME_SENSOR_NAME + ", " +
-                        Database.CULUMN_NAME_SENSOR_VALUE + ", " +
-                        Database.CULUMN_NAME_TIMESTAMP +
-                        ") VALUES (" +
-                        "'" + Config.DATABASE_KEY_TEMPERATURE + "', " +
-                        "'" + message.getDouble(Config.JACK_TEMPERATURE) + "', " +
-                        "" + message.getLong(Config.JACK_TIMESTAMP) +
-                        ");";
+                //solo le letture (risposte fasiche, consumi e traccia del bracciale non contengono nessun sensore)
+                boolean hasTemperature = message.containsKey(Config.JACK_TEMPERATURE);
+                boolean hasGSR = message.containsKey(Config.JACK_GSR);
 
-                Intent insertTemperatureQuery = new Intent(DatabaseService.COMMAND_EXECUTE_QUERY);
-                insertTemperatureQuery.putExtra(DatabaseService.EXTRA_QUERY, query);
+                if (!hasTemperature && !hasGSR) {
+                    return;
+                }
 
-                Logger.i(TAG, query);
+                //inserisco il dato del DB
 
-                sendBroadcast(insertTemperatureQuery);
+                //---TEMPERATURE---
+                if (hasTemperature) {
+                    String query = "INSERT INTO " + Database.TABLE_NAME + " (" +
+                            Database.CULUMN_NAME_SENSOR_NAME + ", " +
+                            Database.CULUMN_NAME_SENSOR_VALUE + ", " +
+                            Database.CULUMN_NAME_TIMESTAMP +
+                            ") VALUES (" +
+                            "'" + Config.DATABASE_KEY_TEMPERATURE + "', " +
+                            "'" + message.getDouble(Config.JACK_TEMPERATURE) + "', " +
+                            "" + message.getLong(Config.JACK_TIMESTAMP) +
+                            ");";
+
+                    Intent insertTemperatureQuery = new Intent(DatabaseService.COMMAND_EXECUTE_QUERY);
+                    insertTemperatureQuery.putExtra(DatabaseService.EXTRA_QUERY, query);
+
+                    Logger.i(TAG, query);
+
+                    sendBroadcast(insertTemperatureQuery);
+                }
 
                 //---GSR---
-                query = "INSERT INTO " + Database.TABLE_NAME + " (" +
-                        Database.CULUMN_NAME_SENSOR_NAME + ", " +
-                        Database.CULUMN_NAME_SENSOR_VALUE + ", " +
-                        Database.CULUMN_NAME_TIMESTAMP +
-                        ") VALUES (" +
-                        "'" + Config.DATABASE_KEY_GSR + "', " +
-                        "'" + message.getLong(Config.JACK_GSR) + "', " +
-                        "" + message.getLong(Config.JACK_TIMESTAMP) +
-                        ");";
-
-                Intent insertGSRQuery = new Intent(DatabaseService.COMMAND_EXECUTE_QUERY);
-                insertGSRQuery.putExtra(DatabaseService.EXTRA_QUERY, query);
-
-                Logger.i(TAG, query);
-
-                sendBroadcast(insertGSRQuery);
+                if (hasGSR) {
+                    String query = "INSERT INTO " + Database.TABLE_NAME + " (" +
+                            Database.CULUMN_NAME_SENSOR_NAME + ", " +
+                            Database.CULUMN_NAME_SENSOR_VALUE + ", " +
+                            Database.CULUMN_NAME_TIMESTAMP +
+                            ") VALUES (" +
+                            "'" + Config.DATABASE_KEY_GSR + "', " +
+                            "'" + message.getLong(Config.JACK_GSR) + "', " +
+                            "" + message.getLong(Config.JACK_TIMESTAMP) +
+                            ");";
+
+                    Intent insertGSRQuery = new Intent(DatabaseService.COMMAND_EXECUTE_QUERY);
+                    insertGSRQuery.putExtra(DatabaseService.EXTRA_QUERY, query);
+
+                    Logger.i(TAG, query);
+
+                    sendBroadcast(insertGSRQuery);
+                }
 
 
                 //---AVVISO DEL RICEVIMENTO DI NUOVI DATI---
-                //preparo l'intent per avvisare l'app dei nuovi dati
-                final Intent intent = new Intent(ACTION_NEW_DATA);
+                //i grafici mostrano entrambi i sensori
+                if (hasTemperature && hasGSR) {
+                    //preparo l'intent per avvisare l'app dei nuovi dati
+                    final Intent intent = new Intent(ACTION_NEW_DATA);
 
-                intent.putExtra(Config.EXTRA_DATA_TEMPERATURE, message.getDouble(Config.JACK_TEMPERATURE));
-                intent.putExtra(Config.EXTRA_DATA_GSR, message.getLong(Config.JACK_GSR));
-                intent.putExtra(Config.EXTRA_DATA_TIMESTAMP, message.getLong(Config.JACK_TIMESTAMP));
+                    intent.putExtra(Config.EXTRA_DATA_TEMPERATURE, message.getDouble(Config.JACK_TEMPERATURE));
+                    intent.putExtra(Config.EXTRA_DATA_GSR, message.getLong(Config.JACK_GSR));
+                    intent.putExtra(Config.EXTRA_DATA_TIMESTAMP, message.getLong(Config.JACK_TIMESTAMP));
 
 
-                Logger.e(TAG, "Timestamp: " + message.getLong(Config.JACK_TIMESTAMP));
+                    Logger.e(TAG, "Timestamp: " + message.getLong(Config.JACK_TIMESTAMP));
 
-                sendBroadcast(intent);
+                    sendBroadcast(intent);
+                }
 
                 Logger.e(TAG, "onReceive()");
 
@@ -469,14 +484,16 @@ public class BluetoothSerialService extends Service implements JTransmissionMeth
         }
 
         //elimino i caratteri errati prima della sequenza di inizio
-        buffer = buffer.substring(buffer.indexOf(JTM_START_SEQUENCE) + JTM_FINISH_SEQUENCE.length());
+        buffer = buffer.substring(buffer.indexOf(JTM_START_SEQUENCE));
 
-        //se il buffer non contiene la sequenza finale
+        //se il buffer non contiene la sequenza finale il messaggio è ancora in arrivo: lo lascio nel buffer
         if (!buffer.contains(JTM_FINISH_SEQUENCE)) {
-            buffer = ""; //azzero il buffer
             return null; //non è stato prelevato nessun messaggio
         }
 
+        //elimino la sequenza di inizio
+        buffer = buffer.substring(JTM_START_SEQUENCE.length());
+
         //prelevo il messaggio
         String message = buffer.substring(0, buffer.indexOf(JTM_FINISH_SEQUENCE));
 
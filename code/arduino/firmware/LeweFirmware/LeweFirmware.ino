@@ -32,16 +32,29 @@
 //RTC
 #include <Wire.h>
 
+//EEPROM (impostazioni)
+#include <EEPROM.h>
+
 #include <RTClib.h>
 
 //FlashString
 #include <Flash.h>
 
-//Jack
+//Jack (buffer di invio ridotto: le letture in attesa aspettano nel backlog, 9 byte ciascuna invece di uno slot da
+//JK_MAX_MESSAGE_LENGTH byte; la RAM nel caso peggiore è riportata da memory-report)
+#define JK_BUFFER_SEND_SIZE 2 //messaggi non confermati
+#define JK_BURST_THRESHOLD 2 //messaggi non confermati che attivano il burst
+#define JK_BURST_WINDOW 2 //messaggi in volo durante il burst
 #include <Jack.h>
 #include <SoftwareSerialJack.h>
 #include <SoftwareSerial.h>
 
+//Lewe
+#include <LwAggregator.h>
+#include <LwPhasicDetector.h>
+#include <LwRadio.h>
+#include <LwEnergy.h>
+
 
 //---COSTANTI--
 
@@ -60,6 +73,18 @@
  * @brief Pin di lettura del sensore di temperatura (LM35DZ)
  */
 #define LM35_PIN A0 //lettura
+/**
+ * @brief Tempo di assestamento del sensore di temperatura dopo l'accensione (millisecondi)
+ */
+#define LM35_WARMUP 50 //assestamento dell'uscita
+/**
+ * @brief Periodo di campionamento del sensore di temperatura (millisecondi, 0 = intervallo delle impostazioni)
+ */
+#define LM35_PERIOD 0 //ad ogni data collect
+/**
+ * @brief Assorbimento del sensore di temperatura acceso (microampere, stima dei consumi)
+ */
+#define LM35_CURRENT 60 //datasheet LM35
 
 //GSR
 /**
@@ -78,6 +103,40 @@
  * @brief Costante indicante il rumore intrinseco del sensore GSR
  */
 #define GSR_NOISE 40 //rimozione del rumore
+/**
+ * @brief Tempo di assestamento del sensore GSR dopo l'accensione (millisecondi)
+ */
+#define GSR_WARMUP 500 //assestamento del filtro del sensore
+/**
+ * @brief Periodo di campionamento del sensore GSR (millisecondi, 0 = intervallo delle impostazioni)
+ */
+#define GSR_PERIOD 0 //ad ogni data collect
+/**
+ * @brief Intervallo tra le letture sovracampionate del sensore GSR per il rilevamento delle risposte (millisecondi)
+ */
+#define GSR_EVENT_PERIOD 250 //4 letture al secondo
+/**
+ * @brief Conversioni dell'ADC mediate per ogni lettura sovracampionata del sensore GSR
+ */
+#define GSR_OVERSAMPLE 16 //due bit di risoluzione in più
+/**
+ * @brief Assorbimento del sensore GSR acceso (microampere, stima dei consumi)
+ */
+#define GSR_CURRENT 1000 //partitore e filtro del sensore
+
+//SENSORI
+/**
+ * @brief Numero di sensori nel registro (al massimo 8)
+ */
+#define SENSOR_COUNT 2 //GSR e temperatura
+/**
+ * @brief Posizione del sensore GSR nel registro
+ */
+#define SENSOR_GSR 0
+/**
+ * @brief Posizione del sensore di temperatura nel registro
+ */
+#define SENSOR_TEMPERATURE 1
 
 //HM-10
 /**
@@ -92,24 +151,40 @@
  * @brief Baudrate di comunicazione seriale con il modulo bluetooth HM-10
  */
 #define HM10_BAUDRATE 9600 //baudrate (da verificare)
+/**
+ * @brief Sonno del modulo bluetooth compilato nel firmware (0 = modulo sempre sveglio, circa 75 byte di RAM in meno)
+ */
+#ifndef RADIO_SLEEP_SUPPORT
+#define RADIO_SLEEP_SUPPORT 1 //sonno compilato
+#endif
+/**
+ * @brief Sonno del modulo bluetooth tra le finestre di sincronizzazione (valore di default)
+ */
+#define RADIO_SLEEP 1 //sonno attivato
+/**
+ * @brief Durata minima di una finestra di sincronizzazione (millisecondi, una finestra ogni intervallo tra le letture)
+ */
+#define RADIO_WINDOW 3000 //il telefono si collega entro la finestra
 
 //DATA COLLECT
 /**
- * @brief Tempo di attesa tra letture consecutive dei sensori (millisecondi)
+ * @brief Tempo di attesa tra letture consecutive dei sensori (millisecondi, valore di default)
  */
 #define INTERVAL_BETWEEN_DATA_COLLECT 300000 //intervallo tra un data collect e un altro (5 min)
 
 //JACK
 /**
- * @brief Tempo di attesa tra invii consecutivi dei messaggi da parte della libreria Jack
+ * @brief Tempo di attesa tra invii consecutivi dei messaggi da parte della libreria Jack (valore di default)
  */
 #define TIMER_SEND_MESSAGE 5000 //intervallo tra l'invio dei messaggi
 /**
- * @brief Tempo di attesa tra polling consecutivi del mezzo di comunicazione da parte della della libreria Jack
+ * @brief Tempo di attesa tra polling consecutivi del mezzo di comunicazione da parte della della libreria Jack (valore di default)
  */
 #define TIMER_POLLING 1000 //intervallo tra un polling e l'altro del mezzo di trasmissione
 
 //CHIAVI PER IL MESSAGGIO
+//le letture (anche riassuntive) contengono almeno un sensore: risposte fasiche, consumi e traccia usano solo chiavi proprie
+//e vengono scartate dall'app e dal gateway
 /**
  * @brief Chiave per il messaggio Jack (Timespamp)
  */
@@ -122,30 +197,277 @@
  * @brief Chiave per il messaggio Jack (Temperatura)
  */
 #define TEMPERATURE_KEY "TME" //chiave per temperatura (TeMperaturE)
+/**
+ * @brief Chiave per il messaggio Jack riassuntivo (Numero di letture)
+ */
+#define COUNT_KEY "CNT" //chiave per il numero di letture riassunte (CouNT)
+/**
+ * @brief Chiave per il messaggio Jack riassuntivo (GSR minimo)
+ */
+#define GSR_MIN_KEY "GMN" //chiave per gsr minimo (Gsr MiN)
+/**
+ * @brief Chiave per il messaggio Jack riassuntivo (GSR massimo)
+ */
+#define GSR_MAX_KEY "GMX" //chiave per gsr massimo (Gsr MaX)
+/**
+ * @brief Chiave per il messaggio Jack riassuntivo (Temperatura minima)
+ */
+#define TEMPERATURE_MIN_KEY "TMN" //chiave per temperatura minima (Temperatura MiN)
+/**
+ * @brief Chiave per il messaggio Jack riassuntivo (Temperatura massima)
+ */
+#define TEMPERATURE_MAX_KEY "TMX" //chiave per temperatura massima (Temperatura MaX)
+/**
+ * @brief Chiave per il messaggio Jack della risposta fasica (Linea di base del GSR)
+ */
+#define EVENT_BASELINE_KEY "SCL" //chiave per la linea di base (Skin Conductance Level)
+/**
+ * @brief Chiave per il messaggio Jack della risposta fasica (Ampiezza della risposta)
+ */
+#define EVENT_AMPLITUDE_KEY "SCR" //chiave per l'ampiezza (Skin Conductance Response)
+/**
+ * @brief Chiave per il messaggio Jack della risposta fasica (Tempo di salita, millisecondi)
+ */
+#define EVENT_RISE_KEY "RSE" //chiave per il tempo di salita (RiSE)
+/**
+ * @brief Chiave per il messaggio Jack della risposta fasica (Tempo di recupero di metà ampiezza, millisecondi)
+ */
+#define EVENT_RECOVERY_KEY "RCV" //chiave per il tempo di recupero (ReCoVery)
+
+//BACKLOG
+/**
+ * @brief Numero massimo di letture in attesa di uno slot libero nel buffer di invio di Jack (bracciale scollegato)
+ */
+#define BACKLOG_SIZE 8 //letture in attesa (le più vecchie vengono sovrascritte)
+
+//SUMMARY
+/**
+ * @brief Riassunti delle letture compilati nel firmware (1 = circa 230 byte di RAM in più)
+ */
+#ifndef SUMMARY_SUPPORT
+#define SUMMARY_SUPPORT 0 //riassunti non compilati
+#endif
+/**
+ * @brief Letture in attesa oltre le quali le nuove letture vengono riassunte per finestre (coda di invio congestionata)
+ */
+#define SUMMARY_THRESHOLD (BACKLOG_SIZE / 2) //soglia di congestione (valore di default)
+/**
+ * @brief Durata della finestra di riassunto (secondi, valore di default)
+ */
+#define SUMMARY_WINDOW 3600 //un riassunto ogni ora
+/**
+ * @brief Numero massimo di riassunti in attesa di uno slot libero nel buffer di invio di Jack
+ */
+#define SUMMARY_BACKLOG_SIZE 6 //riassunti in attesa (i due più vecchi vengono uniti)
+
+//EVENTS
+/**
+ * @brief Rilevamento delle risposte fasiche del GSR compilato nel firmware (1 = circa 130 byte di RAM in più)
+ */
+#ifndef EVENT_SUPPORT
+#define EVENT_SUPPORT 0 //risposte non compilate
+#endif
+/**
+ * @brief Invio delle risposte fasiche del GSR al posto della serie grezza (valore di default)
+ */
+#define GSR_EVENTS 0 //risposte disattivate
+/**
+ * @brief Invio delle letture periodiche del GSR insieme alle risposte come contesto (valore di default)
+ */
+#define GSR_EVENT_CONTEXT 1 //contesto attivato
+/**
+ * @brief Numero massimo di risposte in attesa di uno slot libero nel buffer di invio di Jack
+ */
+#define EVENT_BACKLOG_SIZE 4 //risposte in attesa (le più vecchie vengono sovrascritte)
+
+
+//SETTINGS
+/**
+ * @brief Indirizzo delle impostazioni nella EEPROM
+ */
+#define SETTINGS_ADDRESS 0 //inizio della EEPROM
+/**
+ * @brief Versione del formato delle impostazioni (le impostazioni con versione diversa vengono ignorate)
+ */
+#define SETTINGS_VERSION 4 //versione delle impostazioni
+
+//CHIAVI PER IL MESSAGGIO DI CONTROLLO
+/**
+ * @brief Chiave del messaggio di controllo (versione dello schema, deve valere SETTINGS_VERSION)
+ */
+#define CONTROL_KEY "CFG" //chiave che identifica il messaggio di controllo (ConFiGuration)
+/**
+ * @brief Chiave del messaggio di controllo (Intervallo tra le letture, secondi)
+ */
+#define CONTROL_SAMPLE_INTERVAL_KEY "SMP" //intervallo tra le letture (SaMPle)
+/**
+ * @brief Chiave del messaggio di controllo (Timer di reinvio di Jack, millisecondi)
+ */
+#define CONTROL_TIMER_SEND_MESSAGE_KEY "RSD" //timer di reinvio (ReSenD)
+/**
+ * @brief Chiave del messaggio di controllo (Timer di polling di Jack, millisecondi)
+ */
+#define CONTROL_TIMER_POLLING_KEY "POL" //timer di polling (POLling)
+/**
+ * @brief Chiave del messaggio di controllo (Modalità burst di Jack, 0 o 1)
+ */
+#define CONTROL_BURST_KEY "BST" //modalità burst (BurST)
+/**
+ * @brief Chiave del messaggio di controllo (Soglia di congestione dei riassunti, letture)
+ */
+#define CONTROL_SUMMARY_THRESHOLD_KEY "SMT" //soglia dei riassunti (SuMmary Threshold)
+/**
+ * @brief Chiave del messaggio di controllo (Durata della finestra dei riassunti, secondi)
+ */
+#define CONTROL_SUMMARY_WINDOW_KEY "SMW" //finestra dei riassunti (SuMmary Window)
+/**
+ * @brief Chiave del messaggio di controllo (Invio delle risposte fasiche del GSR, 0 o 1)
+ */
+#define CONTROL_EVENTS_KEY "EVT" //risposte (EVenTs)
+/**
+ * @brief Chiave del messaggio di controllo (Letture periodiche del GSR insieme alle risposte, 0 o 1)
+ */
+#define CONTROL_EVENT_CONTEXT_KEY "EVC" //contesto delle risposte (EVent Context)
+/**
+ * @brief Chiave del messaggio di controllo (Sonno del modulo bluetooth tra le finestre di sincronizzazione, 0 o 1)
+ */
+#define CONTROL_RADIO_SLEEP_KEY "RSL" //sonno del modulo (Radio SLeep)
+
+//STIMA DEI CONSUMI (tabella dei costi della scheda in LwEnergy.h)
+/**
+ * @brief Stima dei consumi compilata nel firmware (1 = circa 120 byte di RAM in più)
+ */
+#ifndef ENERGY_SUPPORT
+#define ENERGY_SUPPORT 0 //stima non compilata
+#endif
+/**
+ * @brief Capacità della batteria (milliampere ora, durata prevista stampata con il debug)
+ */
+#define BATTERY_CAPACITY 1000
+/**
+ * @brief Chiave del messaggio che richiede la stima dei consumi (0 = invia, 1 = invia e azzera)
+ */
+#define ENERGY_KEY "NRG" //richiesta della stima (eNeRGy)
+/**
+ * @brief Chiave del messaggio della stima dei consumi (Secondi contabilizzati)
+ */
+#define ENERGY_TIME_KEY "ETM" //tempo (Energy TiMe)
+/**
+ * @brief Chiave del messaggio della stima dei consumi (Assorbimento fisso, microampere ora)
+ */
+#define ENERGY_BASE_KEY "EBS" //assorbimento fisso (Energy BaSe)
+/**
+ * @brief Chiave del messaggio della stima dei consumi (Microcontrollore, microampere ora)
+ */
+#define ENERGY_CPU_KEY "ECP" //microcontrollore (Energy CPu)
+/**
+ * @brief Chiave del messaggio della stima dei consumi (Modulo bluetooth, microampere ora)
+ */
+#define ENERGY_RADIO_KEY "ERD" //modulo bluetooth (Energy RaDio)
+/**
+ * @brief Chiave del messaggio della stima dei consumi (Sensori, microampere ora)
+ */
+#define ENERGY_SENSOR_KEY "ESN" //sensori (Energy SeNsor)
+/**
+ * @brief Chiave del messaggio della stima dei consumi (Letture del RTC, microampere ora)
+ */
+#define ENERGY_RTC_KEY "ERT" //RTC (Energy RTc)
+
+//TRACCIA DELLE FASI DEL LOOP (JK_TRACE in JTrace.h)
+/**
+ * @brief Fase della traccia (Lettura dei sensori)
+ */
+#define TRACE_SENSOR JK_TRACE_USER //lettura di GSR e temperatura
+/**
+ * @brief Fase della traccia (Lettura del RTC)
+ */
+#define TRACE_RTC (JK_TRACE_USER + 1) //lettura del timestamp
+/**
+ * @brief Chiave del messaggio che richiede la traccia (0 = invia, 1 = invia e azzera)
+ */
+#define TRACE_KEY "TRC" //richiesta della traccia (TRaCe)
+/**
+ * @brief Chiave del messaggio della traccia (Fase)
+ */
+#define TRACE_PHASE_KEY "LPH" //fase (Latency PHase)
+/**
+ * @brief Chiave del messaggio della traccia (Esecuzioni della fase)
+ */
+#define TRACE_COUNT_KEY "LCN" //esecuzioni (Latency CouNt)
+/**
+ * @brief Chiave del messaggio della traccia (Durata massima, microsecondi)
+ */
+#define TRACE_MAX_KEY "LMX" //durata massima (Latency MaX)
+/**
+ * @brief Chiave del messaggio della traccia (Mediana della durata, microsecondi)
+ */
+#define TRACE_P50_KEY "L50" //mediana
+/**
+ * @brief Chiave del messaggio della traccia (99° percentile della durata, microsecondi)
+ */
+#define TRACE_P99_KEY "L99" //99° percentile
 
 
 //costante per il debug su seriale
 /**
- * @brief Abilitazine del codice di debug (commentare per disabilitarlo)
+ * @brief Abilitazine del codice di debug (decommentare per abilitarlo)
+ * 
+ * Serial occupa 157 byte di RAM che nel caso peggiore non ci sono: il debug va usato solo per le prove al banco,
+ * togliendo altre funzioni (memory-report con -DMR_DEBUG=1 riporta la RAM mancante).
  */
-#define DEBUG 1
+//#define DEBUG 1
 
 
 //---VARIABILI---
 
+//SENSORI
+/**
+ * @brief Tipo di dati contenente la descrizione di un sensore del registro (costante, nella flash)
+ * 
+ * Il valore letto è un intero: quello inviato è il valore diviso per scale (1 = intero, 10 = un decimale).
+ * I sensori con una funzione di stream, quando le risposte sono abilitate, restano accesi e la funzione viene
+ * chiamata ogni streamPeriod millisecondi.
+ */
+typedef struct lwSensor {
+  const char *key; //chiave nel messaggio
+  uint8_t enablePin; //pin di abilitazione
+  int16_t (*read)(); //funzione di lettura
+  uint8_t scale; //divisore del valore letto
+  unsigned long period; //periodo di campionamento (millisecondi, 0 = intervallo delle impostazioni)
+  unsigned long warmup; //tempo di assestamento dopo l'accensione (millisecondi)
+  unsigned long streamPeriod; //intervallo tra le letture sovracampionate (millisecondi)
+  void (*stream)(unsigned long now); //funzione di stream (NULL = nessuna)
+};
+
+/**
+ * @brief Tipo di dati contenente lo stato dello scheduler di un sensore del registro
+ */
+typedef struct lwSensorState {
+  unsigned long lastRead; //istante dell'ultima lettura
+  unsigned long lastStream; //istante dell'ultima chiamata della funzione di stream
+  unsigned long poweredAt; //istante dell'accensione
+  uint8_t powered; //sensore acceso
+  int16_t value; //ultimo valore letto
+};
+
 /**
- * @brief Tipo di dati indicante lo stato dei sensori
+ * @brief Registro dei sensori (per aggiungere un sensore basta aggiungerlo qui e aggiornare SENSOR_COUNT)
+ * 
+ * Sta nella flash: le descrizioni vanno lette con sensorInfo().
  */
-//stato dei sensori
-typedef enum lwSensorState {
-  LW_SENSOR_SLEEP, //sensori addormentati
-  LW_SENSOR_WAKE //sensori svegli
+const lwSensor sensors[SENSOR_COUNT] PROGMEM = {
+#if EVENT_SUPPORT
+  { GSR_KEY, GSR_ENABLE_PIN, &readGSR, 1, GSR_PERIOD, GSR_WARMUP, GSR_EVENT_PERIOD, &streamGSR },
+#else
+  { GSR_KEY, GSR_ENABLE_PIN, &readGSR, 1, GSR_PERIOD, GSR_WARMUP, GSR_EVENT_PERIOD, NULL },
+#endif
+  { TEMPERATURE_KEY, LM35_ENABLE_PIN, &readTemperature, 10, LM35_PERIOD, LM35_WARMUP, 0, NULL }
 };
 
 /**
- * @brief Variabile indicante lo stato dei sensori
+ * @brief Stato dei sensori (nell'ordine del registro)
  */
-lwSensorState sensorState;
+lwSensorState sensorStates[SENSOR_COUNT];
 
 //RTC
 /**
@@ -153,11 +475,95 @@ lwSensorState sensorState;
  */
 RTC_DS1307 RTC;
 
-//DATA COLLECT
+//SETTINGS
+/**
+ * @brief Tipo di dati contenente le impostazioni modificabili a runtime (salvate nella EEPROM)
+ */
+typedef struct lwSettings {
+  uint8_t version; //versione del formato (SETTINGS_VERSION)
+  unsigned long sampleInterval; //intervallo tra le letture (millisecondi)
+  long timerSendMessage; //timer di reinvio di Jack (millisecondi)
+  long timerPolling; //timer di polling di Jack (millisecondi)
+  uint8_t burst; //modalità burst di Jack
+  uint8_t summaryThreshold; //letture in attesa oltre le quali le letture vengono riassunte
+  long summaryWindow; //durata della finestra dei riassunti (secondi)
+  uint8_t events; //invio delle risposte fasiche del GSR
+  uint8_t eventContext; //letture periodiche del GSR insieme alle risposte
+  uint8_t radioSleep; //sonno del modulo bluetooth tra le finestre di sincronizzazione
+  uint8_t checksum; //somma di controllo dei campi precedenti
+};
+
+/**
+ * @brief Impostazioni correnti
+ */
+lwSettings settings;
+
+//BACKLOG
+/**
+ * @brief Tipo di dati contenente una lettura in attesa di essere passata alla libreria Jack
+ */
+typedef struct lwReading {
+  long timestamp; //timestamp della lettura
+  uint8_t mask; //sensori letti (un bit per posizione nel registro)
+  int16_t values[SENSOR_COUNT]; //valori letti (nell'ordine del registro)
+};
+
+/**
+ * @brief Letture in attesa (buffer circolare)
+ */
+lwReading backlog[BACKLOG_SIZE];
+/**
+ * @brief Posizione della lettura più vecchia nel backlog
+ */
+uint8_t backlogHead;
+/**
+ * @brief Numero di letture nel backlog
+ */
+uint8_t backlogLength;
+
+#if SUMMARY_SUPPORT
+//SUMMARY
+/**
+ * @brief Indica se le nuove letture vengono riassunte (coda di invio congestionata) o inviate singolarmente
+ */
+uint8_t summarizing;
+/**
+ * @brief Aggregatore delle letture per finestre
+ */
+LwAggregator aggregator(SUMMARY_WINDOW);
+/**
+ * @brief Riassunti in attesa (buffer circolare)
+ */
+LwSummary summaryBacklog[SUMMARY_BACKLOG_SIZE];
+/**
+ * @brief Posizione del riassunto più vecchio
+ */
+uint8_t summaryHead;
 /**
- * @brief Data ultima lettura dei sensori
+ * @brief Numero di riassunti in attesa
  */
-long timeLastDataCollect;
+uint8_t summaryLength;
+#endif
+
+#if EVENT_SUPPORT
+//EVENTS
+/**
+ * @brief Rilevatore delle risposte fasiche del GSR
+ */
+LwPhasicDetector detector;
+/**
+ * @brief Risposte in attesa (buffer circolare, inizio della risposta convertito nel timestamp del RTC)
+ */
+LwPhasicEvent eventBacklog[EVENT_BACKLOG_SIZE];
+/**
+ * @brief Posizione della risposta più vecchia
+ */
+uint8_t eventHead;
+/**
+ * @brief Numero di risposte in attesa
+ */
+uint8_t eventLength;
+#endif
 
 //JACK
 /**
@@ -171,7 +577,29 @@ SoftwareSerialJack mmJTM(bluetooth); //Mezzo di trasmissione per Jack
 /**
  * @brief Istanza della libreria Jack
  */
-Jack jack(mmJTM, &onReceive, &onReceiveAck, &getTimestamp, TIMER_SEND_MESSAGE, TIMER_POLLING); //Jack
+BasicJack<SoftwareSerialJack> jack(mmJTM, &onReceive, &onReceiveAck, &getTimestamp, TIMER_SEND_MESSAGE, TIMER_POLLING); //Jack
+#if RADIO_SLEEP_SUPPORT
+/**
+ * @brief Gestione del sonno del modulo bluetooth (finestre di sincronizzazione allineate al RTC)
+ */
+LwRadio radio(bluetooth, INTERVAL_BETWEEN_DATA_COLLECT, RADIO_WINDOW); //sonno del modulo HM-10
+#endif
+
+#if ENERGY_SUPPORT
+//STIMA DEI CONSUMI
+/**
+ * @brief Tabella dei costi della scheda (valori di default di LwEnergy, sensori nell'ordine del registro; nella flash)
+ */
+const LwEnergyCosts energyCosts PROGMEM = {
+  LW_ENERGY_BASE_CURRENT, LW_ENERGY_CPU_CURRENT, LW_ENERGY_RADIO_AWAKE_CURRENT, LW_ENERGY_RADIO_ASLEEP_CURRENT,
+  LW_ENERGY_TX_CHARGE, LW_ENERGY_RX_CHARGE, LW_ENERGY_RTC_CHARGE,
+  { GSR_CURRENT, LM35_CURRENT }
+};
+/**
+ * @brief Stima dei consumi per componente (microcontrollore, modulo bluetooth, sensori, RTC; tabella caricata nel setup)
+ */
+LwEnergy energy; //stima dei consumi
+#endif
 
 
 
@@ -182,91 +610,399 @@ Jack jack(mmJTM, &onReceive, &onReceiveAck, &getTimestamp, TIMER_SEND_MESSAGE, T
  * @param message Messaggio ricevuto
  * @param id ID del messaggio ricevuto
  */
-void onReceive(JData &message, long id) {} //handler per messaggi dati in entrata
+void onReceive(JData &message, long id) { //handler per messaggi dati in entrata
+
+#if RADIO_SLEEP_SUPPORT
+  //il telefono è collegato: la finestra resta aperta
+  radio.traffic();
+#endif
+
+  //il bracciale riceve solo messaggi di controllo
+  if (message.get(CONTROL_KEY).success()) {
+    receiveSettings(message);
+  }
+
+#if ENERGY_SUPPORT
+  //richiesta della stima dei consumi
+  if (message.get(ENERGY_KEY).success()) {
+    sendEnergy(message.get(ENERGY_KEY).as<long>() != 0);
+  }
+#endif
+
+#if JK_TRACE
+  //richiesta della traccia delle fasi del loop
+  if (message.get(TRACE_KEY).success()) {
+    sendTrace(message.get(TRACE_KEY).as<long>() != 0);
+  }
+#endif
+}
 /**
  * @brief Handler dell'evento di ricezione della conferma di un messaggio (da passare alla libreria Jack)
  * 
  * @param id ID del messaggio confermato
  */
-void onReceiveAck(long id) {} //handler per ricezione ack
+void onReceiveAck(long id) { //handler per ricezione ack
 
+#if RADIO_SLEEP_SUPPORT
+  //il telefono è collegato: la finestra resta aperta finchè ci sono messaggi da confermare
+  radio.traffic();
+#endif
+}
 
-//---GET DATA FROM SENSORS FUNCTIONS---
 
-//legge e coverte in percentuale la lettura del sensore GSR
+//---SETTINGS FUNCTIONS---
+
+//calcola la somma di controllo delle impostazioni
 /**
- * @brief Funzione che restituisce la lettura del sensore GSR (privato del rumore intrinseco)
+ * @brief Funzione che calcola la somma di controllo delle impostazioni (campo checksum escluso)
  * 
- * @return Lettura del sensore GSR
+ * @param value Impostazioni
+ * @return Somma di controllo
  */
-uint8_t getGSR() {
+uint8_t settingsChecksum(const lwSettings &value) {
 
-  int gsr = analogRead(GSR_PIN); //prelevo la lettura dal sensore
+  const uint8_t *bytes = (const uint8_t *) &value;
+  uint8_t checksum = 0xA5;
 
-  //rimozione del rumore
-  if (gsr > GSR_NOISE) {
-    gsr -= GSR_NOISE;
-  } else {
-    gsr = 0;
+  for (uint8_t i = 0; i < offsetof(lwSettings, checksum); i++) {
+    checksum = (checksum << 1 | checksum >> 7) ^ bytes[i];
   }
 
-  int vcc = analogRead(GSR_VCC_PIN); //leggo la vcc applicata al sensore
-
-#ifdef DEBUG
-  Serial.print(F("\nGSR READ: "));
-  Serial.println(gsr);
-  Serial.print(F("\nVCC READ: "));
-  Serial.println(gsr);
-#endif
-
-  return (uint8_t) (100.0 * gsr / vcc); //ritorno la lettura in percentuale
-
+  return checksum;
 }
 
-//legge e converte in gradi C la lettura del sensore LM35
+//verifica che le impostazioni siano valide
 /**
- * @brief Funzione che restituisce la lettura del sensore di temperatura (LM35DZ)
+ * @brief Funzione che verifica che le impostazioni siano nei limiti ammessi
  * 
- * @return Lettura del sensore di temperatura (in gradi Celsius)
+ * @param value Impostazioni
+ * @return 1 se le impostazioni sono valide, 0 altrimenti
  */
-double getTemperature() {
+uint8_t validSettings(const lwSettings &value) {
+  return value.sampleInterval >= 10000UL && value.sampleInterval <= 86400000UL //da 10 secondi a un giorno
+    && value.timerSendMessage >= 100 && value.timerSendMessage <= 600000L
+    && value.timerPolling >= 50 && value.timerPolling <= 60000L
+    && value.burst <= 1
+    && value.summaryThreshold >= 1 && value.summaryThreshold <= BACKLOG_SIZE
+    && value.summaryWindow >= 60 && value.summaryWindow <= 86400L
+    && value.events <= 1
+    && value.eventContext <= 1
+    && value.radioSleep <= 1;
+}
 
-  double temp = analogRead(LM35_PIN); //prelevo la lettura dal sensore
-  temp = (temp * VREF / 1023.0) * 100.0; //converto la temperatura letta in gradi
+//carica le impostazioni dalla EEPROM
+/**
+ * @brief Funzione che carica le impostazioni dalla EEPROM (usa i valori di default se la EEPROM non contiene impostazioni valide)
+ */
+void loadSettings() {
 
-  double decimalPart = temp - floor(temp); //ricavo la parte decimale
-  temp = floor(temp) + (floor(decimalPart * 10) / 10); //sommo la parte intera e una cifra dopo la virgola
+  EEPROM.get(SETTINGS_ADDRESS, settings);
+
+  //impostazioni valide
+  if (settings.version == SETTINGS_VERSION && settings.checksum == settingsChecksum(settings) && validSettings(settings)) {
 
 #ifdef DEBUG
-  Serial.print(F("\nTEMPERATURE READ: "));
-  Serial.println(temp);
+    Serial.print(F("\nIMPOSTAZIONI CARICATE DALLA EEPROM\n"));
 #endif
 
-  return temp; //restituisco la temperatura con un decimale
+    return;
+  }
 
+  //valori di default
+  settings.version = SETTINGS_VERSION;
+  settings.sampleInterval = INTERVAL_BETWEEN_DATA_COLLECT;
+  settings.timerSendMessage = TIMER_SEND_MESSAGE;
+  settings.timerPolling = TIMER_POLLING;
+  settings.burst = 1;
+  settings.summaryThreshold = SUMMARY_THRESHOLD;
+  settings.summaryWindow = SUMMARY_WINDOW;
+  settings.events = GSR_EVENTS;
+  settings.eventContext = GSR_EVENT_CONTEXT;
+  settings.radioSleep = RADIO_SLEEP;
 }
 
-//ottiene il timestamp da RTC
+//salva le impostazioni nella EEPROM
 /**
- * @brief Funzione che legge il RTC e ne resisuisce il timestamp
- * 
- * @return Timestamp dell'ora corrente
+ * @brief Funzione che salva le impostazioni nella EEPROM (vengono riscritti solo i byte modificati)
  */
-long getTimestamp() {
-
-  long timestamp = RTC.now().unixtime();
-
-#ifdef DEBUG
-  Serial.print(F("\nTIMESTAMP: "));
-  Serial.println(timestamp);
-#endif
+void saveSettings() {
 
-  return timestamp; //get unix timestamp;
+  settings.checksum = settingsChecksum(settings);
 
+  EEPROM.put(SETTINGS_ADDRESS, settings);
 }
 
+//applica le impostazioni
+/**
+ * @brief Funzione che applica le impostazioni correnti a Jack, all'aggregatore e allo scheduler delle letture
+ */
+void applySettings() {
+
+  //jack
+  jack.setTimerSendMessage(settings.timerSendMessage);
+  jack.setTimerPolling(settings.timerPolling);
+  jack.setBurstEnabled(settings.burst);
+
+#if RADIO_SLEEP_SUPPORT
+  //finestre di sincronizzazione: una per intervallo tra le letture (allineate al RTC)
+  radio.setSchedule(settings.sampleInterval, RADIO_WINDOW);
+  radio.setEnabled(settings.radioSleep);
+
+  //con il sonno i reinvii sono già limitati alle finestre: la rilevazione del collegamento interrotto renderebbe
+  //le verifiche più rade di una finestra e il telefono collegato non riceverebbe nulla
+  jack.setLinkDetectionEnabled(!settings.radioSleep);
+#endif
+
+#if SUMMARY_SUPPORT
+  //riassunti (la nuova finestra vale dalla prossima finestra)
+  aggregator.setWindow(settings.summaryWindow);
+#endif
+
+#if EVENT_SUPPORT
+  //risposte: la linea di base riparte dalla prossima lettura sovracampionata
+  if (!settings.events) {
+    detector.reset();
+  }
+#endif
+
+  //lo scheduler dei sensori legge le impostazioni ad ogni loop
+}
+
+//aggiorna le impostazioni a partire da un messaggio di controllo
+/**
+ * @brief Funzione che aggiorna le impostazioni con i valori contenuti nel messaggio di controllo
+ * 
+ * Le chiavi sono tutte opzionali: quelle assenti mantengono il valore corrente. Se un valore è fuori dai limiti
+ * l'intero messaggio viene ignorato. Le chiavi delle funzioni non compilate vengono ignorate (il campo delle
+ * impostazioni resta, per cui il formato nella EEPROM non cambia).
+ * 
+ * @param message Messaggio di controllo
+ */
+void receiveSettings(JData &message) {
+
+  //schema del messaggio non supportato
+  if (message.get(CONTROL_KEY).as<long>() != SETTINGS_VERSION) {
+    return;
+  }
+
+  //lavoro su una copia per applicare il messaggio per intero o per niente
+  lwSettings value = settings;
+
+  JsonVariant field;
+
+  if ((field = message.get(CONTROL_SAMPLE_INTERVAL_KEY)).success()) {
+    value.sampleInterval = field.as<unsigned long>() * 1000UL;
+  }
+
+  if ((field = message.get(CONTROL_TIMER_SEND_MESSAGE_KEY)).success()) {
+    value.timerSendMessage = field.as<long>();
+  }
+
+  if ((field = message.get(CONTROL_TIMER_POLLING_KEY)).success()) {
+    value.timerPolling = field.as<long>();
+  }
+
+  if ((field = message.get(CONTROL_BURST_KEY)).success()) {
+    value.burst = field.as<long>() ? 1 : 0;
+  }
+
+#if SUMMARY_SUPPORT
+  if ((field = message.get(CONTROL_SUMMARY_THRESHOLD_KEY)).success()) {
+    long threshold = field.as<long>();
+    value.summaryThreshold = threshold >= 0 && threshold <= 255 ? threshold : 0;
+  }
+
+  if ((field = message.get(CONTROL_SUMMARY_WINDOW_KEY)).success()) {
+    value.summaryWindow = field.as<long>();
+  }
+#endif
+
+#if EVENT_SUPPORT
+  if ((field = message.get(CONTROL_EVENTS_KEY)).success()) {
+    value.events = field.as<long>() ? 1 : 0;
+  }
+
+  if ((field = message.get(CONTROL_EVENT_CONTEXT_KEY)).success()) {
+    value.eventContext = field.as<long>() ? 1 : 0;
+  }
+#endif
+
+#if RADIO_SLEEP_SUPPORT
+  if ((field = message.get(CONTROL_RADIO_SLEEP_KEY)).success()) {
+    value.radioSleep = field.as<long>() ? 1 : 0;
+  }
+#endif
+
+  //impostazioni non valide
+  if (!validSettings(value)) {
+
+#ifdef DEBUG
+    Serial.print(F("\nMESSAGGIO DI CONTROLLO NON VALIDO\n"));
+#endif
+
+    return;
+  }
+
+  settings = value;
+
+  saveSettings();
+  applySettings();
+
+#ifdef DEBUG
+  Serial.print(F("\nIMPOSTAZIONI AGGIORNATE: INTERVALLO "));
+  Serial.print(settings.sampleInterval);
+  Serial.print(F(" ms, REINVIO "));
+  Serial.print(settings.timerSendMessage);
+  Serial.print(F(" ms, POLLING "));
+  Serial.print(settings.timerPolling);
+  Serial.println(F(" ms"));
+#endif
+}
+
+
+//---GET DATA FROM SENSORS FUNCTIONS---
+
+//legge e coverte in percentuale la lettura del sensore GSR
+/**
+ * @brief Funzione che restituisce la lettura del sensore GSR (privato del rumore intrinseco)
+ * 
+ * @return Lettura del sensore GSR
+ */
+uint8_t getGSR() {
+
+  int gsr;
+  int vcc;
+
+  {
+    JK_TRACE_SCOPE(TRACE_SENSOR);
+
+    gsr = analogRead(GSR_PIN); //prelevo la lettura dal sensore
+    vcc = analogRead(GSR_VCC_PIN); //leggo la vcc applicata al sensore
+  }
+
+  //rimozione del rumore
+  if (gsr > GSR_NOISE) {
+    gsr -= GSR_NOISE;
+  } else {
+    gsr = 0;
+  }
 
-//---SETUP/SLEEP/WAKEUP SENSORS FUNCTIONS---
+#ifdef DEBUG
+  Serial.print(F("\nGSR READ: "));
+  Serial.println(gsr);
+  Serial.print(F("\nVCC READ: "));
+  Serial.println(gsr);
+#endif
+
+  return (uint8_t) (100.0 * gsr / vcc); //ritorno la lettura in percentuale
+
+}
+
+//legge il sensore GSR con più risoluzione (media di più conversioni)
+/**
+ * @brief Funzione che restituisce la lettura sovracampionata del sensore GSR (privato del rumore intrinseco)
+ * 
+ * @return Lettura del sensore GSR (decimi di punto percentuale)
+ */
+int16_t sampleGSR() {
+
+  long gsr = 0;
+  long vcc = 0;
+
+  {
+    JK_TRACE_SCOPE(TRACE_SENSOR);
+
+    for (uint8_t i = 0; i < GSR_OVERSAMPLE; i++) {
+      gsr += analogRead(GSR_PIN);
+      vcc += analogRead(GSR_VCC_PIN);
+    }
+  }
+
+  //rimozione del rumore
+  gsr = gsr > GSR_NOISE * GSR_OVERSAMPLE ? gsr - GSR_NOISE * GSR_OVERSAMPLE : 0;
+
+  return vcc ? (int16_t) (1000L * gsr / vcc) : 0;
+}
+
+//legge e converte in gradi C la lettura del sensore LM35
+/**
+ * @brief Funzione che restituisce la lettura del sensore di temperatura (LM35DZ)
+ * 
+ * @return Lettura del sensore di temperatura (in gradi Celsius)
+ */
+double getTemperature() {
+
+  double temp;
+
+  {
+    JK_TRACE_SCOPE(TRACE_SENSOR);
+
+    temp = analogRead(LM35_PIN); //prelevo la lettura dal sensore
+    temp = (temp * VREF / 1023.0) * 100.0; //converto la temperatura letta in gradi
+
+    double decimalPart = temp - floor(temp); //ricavo la parte decimale
+    temp = floor(temp) + (floor(decimalPart * 10) / 10); //sommo la parte intera e una cifra dopo la virgola
+  }
+
+#ifdef DEBUG
+  Serial.print(F("\nTEMPERATURE READ: "));
+  Serial.println(temp);
+#endif
+
+  return temp; //restituisco la temperatura con un decimale
+
+}
+
+//funzioni di lettura del registro dei sensori
+/**
+ * @brief Funzione di lettura del sensore GSR per il registro dei sensori
+ * 
+ * @return Lettura del sensore GSR (percentuale)
+ */
+int16_t readGSR() {
+  return getGSR();
+}
+
+/**
+ * @brief Funzione di lettura del sensore di temperatura per il registro dei sensori
+ * 
+ * @return Lettura del sensore di temperatura (decimi di grado)
+ */
+int16_t readTemperature() {
+  return toTenths(getTemperature());
+}
+
+//ottiene il timestamp da RTC
+/**
+ * @brief Funzione che legge il RTC e ne resisuisce il timestamp
+ * 
+ * @return Timestamp dell'ora corrente
+ */
+long getTimestamp() {
+
+  long timestamp;
+
+  {
+    JK_TRACE_SCOPE(TRACE_RTC);
+
+    timestamp = RTC.now().unixtime();
+  }
+
+#if ENERGY_SUPPORT
+  energy.rtcRead();
+#endif
+
+#ifdef DEBUG
+  Serial.print(F("\nTIMESTAMP: "));
+  Serial.println(timestamp);
+#endif
+
+  return timestamp; //get unix timestamp;
+
+}
+
+
+//---SETUP/SCHEDULER SENSORS FUNCTIONS---
 
 //setup sensor
 /**
@@ -277,12 +1013,11 @@ void setupSensor() {
 
   analogReference(INTERNAL); //imposto VREF a 1.1V
 
-  //preparo i pin di abilitazione
-  pinMode(LM35_ENABLE_PIN, OUTPUT);
-  pinMode(GSR_ENABLE_PIN, OUTPUT);
-
-  //spengo i sensori
-  sleepSensor();
+  //preparo i pin di abilitazione e spengo i sensori
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    pinMode(sensorInfo(i).enablePin, OUTPUT);
+    powerSensor(i, 0);
+  }
 
   //setup RTC
   Wire.begin(); //wire
@@ -304,52 +1039,126 @@ void setupSensor() {
 
 }
 
-//sveglia i sensori
+//legge la descrizione di un sensore
 /**
- * @brief Funzione che sveglia i sensori
+ * @brief Funzione che copia dalla flash la descrizione di un sensore del registro
+ * 
+ * @param index Posizione del sensore nel registro
+ * @return Descrizione del sensore
  */
-void wakeupSensor() {
+lwSensor sensorInfo(uint8_t index) {
 
-  //sveglio i sensori
-  digitalWrite(LM35_ENABLE_PIN, HIGH);
-  digitalWrite(GSR_ENABLE_PIN, HIGH);
+  lwSensor sensor;
 
-  //imposto lo stato dei sensori
-  sensorState = LW_SENSOR_WAKE;
-
-#ifdef DEBUG
-  Serial.print(F("\nSENSORI SVEGLIATI\n"));
-#endif
+  memcpy_P(&sensor, &sensors[index], sizeof(sensor));
 
+  return sensor;
 }
 
-//addormenta i sensori per risparmiare energia
+//accende o spegne un sensore
 /**
- * @brief Funzione che addormenta i sensori per risparmio energetico
+ * @brief Funzione che accende o spegne un sensore del registro
+ * 
+ * @param index Posizione del sensore nel registro
+ * @param on 1 per accendere il sensore, 0 per spegnerlo
  */
-void sleepSensor() {
+void powerSensor(uint8_t index, uint8_t on) {
+
+  lwSensor sensor = sensorInfo(index);
 
-  //addormento i sensori
-  digitalWrite(LM35_ENABLE_PIN, LOW);
-  digitalWrite(GSR_ENABLE_PIN, LOW);
+  digitalWrite(sensor.enablePin, on ? HIGH : LOW);
 
-  //imposto lo stato dei sensori
-  sensorState = LW_SENSOR_SLEEP;
+  sensorStates[index].powered = on;
+  sensorStates[index].poweredAt = millis();
+
+#if ENERGY_SUPPORT
+  energy.sensor(index, on);
+#endif
 
 #ifdef DEBUG
-  Serial.print(F("\nSENSORI ADDORMENTATI\n"));
+  Serial.print(on ? F("\nSENSORE ACCESO: ") : F("\nSENSORE SPENTO: "));
+  Serial.println(sensor.key);
 #endif
 
 }
 
-//ritorna lo stato corrente dei sensori (svegli, addormentati)
+//periodo di campionamento di un sensore
 /**
- * @brief Funzione che ritorna lo stato dei sensori (addormentati/svegli)
+ * @brief Funzione che restituisce il periodo di campionamento di un sensore (quello delle impostazioni se non è indicato)
  * 
- * @return Stato dei sensori
+ * @param sensor Sensore
+ * @return Periodo di campionamento (millisecondi)
  */
-lwSensorState getSensorState() {
-  return sensorState;
+unsigned long sensorPeriod(const lwSensor &sensor) {
+  return sensor.period ? sensor.period : settings.sampleInterval;
+}
+
+//indica se il sensore è in streaming
+/**
+ * @brief Funzione che indica se il sensore passa le letture sovracampionate alla sua funzione di stream
+ * 
+ * @param sensor Sensore
+ * @return 1 se il sensore è in streaming (resta acceso), 0 altrimenti
+ */
+uint8_t sensorStreaming(const lwSensor &sensor) {
+  return sensor.stream != NULL && settings.events;
+}
+
+//indica se la lettura del sensore è dovuta
+/**
+ * @brief Funzione che indica se è passato un periodo di campionamento dall'ultima lettura del sensore
+ * 
+ * @param sensor Sensore
+ * @param state Stato del sensore
+ * @param now Tempo passato dall'inizio dell'esecuzione (millisecondi)
+ * @return 1 se la lettura è dovuta, 0 altrimenti
+ */
+uint8_t sensorDue(const lwSensor &sensor, const lwSensorState &state, unsigned long now) {
+  return now - state.lastRead >= sensorPeriod(sensor);
+}
+
+//indica se il sensore si è assestato
+/**
+ * @brief Funzione che indica se il sensore è acceso da almeno il suo tempo di assestamento
+ * 
+ * @param sensor Sensore
+ * @param state Stato del sensore
+ * @param now Tempo passato dall'inizio dell'esecuzione (millisecondi)
+ * @return 1 se il sensore può essere letto, 0 altrimenti
+ */
+uint8_t sensorReady(const lwSensor &sensor, const lwSensorState &state, unsigned long now) {
+  return state.powered && now - state.poweredAt >= sensor.warmup;
+}
+
+//accende e spegne i sensori
+/**
+ * @brief Funzione che accende ogni sensore solo per il suo tempo di assestamento prima della lettura
+ * 
+ * Un sensore viene acceso quando alla lettura manca il suo tempo di assestamento e viene spento dopo la lettura
+ * (collectData()). Se la lettura è già dovuta (es. intervallo ridotto da un messaggio di controllo) il sensore
+ * viene acceso subito e letto appena si è assestato. I sensori in streaming restano accesi e, una volta assestati,
+ * passano una lettura alla funzione di stream ogni streamPeriod millisecondi.
+ * 
+ * @param now Tempo passato dall'inizio dell'esecuzione (millisecondi)
+ */
+void scheduleSensors(unsigned long now) {
+
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+
+    lwSensor sensor = sensorInfo(i);
+    lwSensorState &state = sensorStates[i];
+
+    //manca meno del tempo di assestamento alla prossima lettura (o il sensore è in streaming)
+    if (!state.powered && (sensorStreaming(sensor) || now - state.lastRead + sensor.warmup >= sensorPeriod(sensor))) {
+      powerSensor(i, 1);
+    }
+
+    //lettura sovracampionata
+    if (sensorStreaming(sensor) && sensorReady(sensor, state, now) && now - state.lastStream >= sensor.streamPeriod) {
+      sensor.stream(now);
+      state.lastStream = now;
+    }
+  }
 }
 
 
@@ -361,6 +1170,11 @@ void setupBluetooth() {
   //avvio la seriale
   bluetooth.begin(HM10_BAUDRATE);
 
+#if RADIO_SLEEP_SUPPORT
+  //configuro il modulo (prima finestra subito) e allineo le finestre al RTC
+  radio.begin();
+  radio.align(getTimestamp());
+#endif
 }
 
 
@@ -368,50 +1182,493 @@ void setupBluetooth() {
 
 //preleva i dati dai sensori e li invia
 /**
- * @brief Funzione che preleva i dati dai sensori, li incapsula e li passa alla libreria Jack
+ * @brief Funzione che legge i sensori dovuti e assestati, li incapsula in un'unica lettura e la passa alla libreria Jack
+ * 
+ * @param now Tempo passato dall'inizio dell'esecuzione (millisecondi)
  */
-void collectData() {
+void collectData(unsigned long now) {
 
-  //verifico che i sensori non siano addormentati (ovvero siano svegli)
-  if (getSensorState() == LW_SENSOR_SLEEP) {
+  lwReading reading;
 
-#ifdef DEBUG
-    Serial.println(F("\n\nIMPOSSIBILE PRELEVARE I DATI SEI SENSORI PERCHE' SONO ADDORMENTATI\n\n"));
-#endif
+  reading.mask = 0;
+
+  //leggo i sensori pronti e li spengo
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
 
-    //i sensori sono addormentati non posso prelevare i dati
+    lwSensor sensor = sensorInfo(i);
+    lwSensorState &state = sensorStates[i];
+
+    if (!sensorDue(sensor, state, now) || !sensorReady(sensor, state, now)) {
+      continue;
+    }
+
+    //sensore in streaming senza contesto: solo le risposte
+    if (sensorStreaming(sensor) && !settings.eventContext) {
+      continue;
+    }
+
+    state.value = sensor.read();
+    state.lastRead = now;
+
+    reading.values[i] = state.value;
+    reading.mask |= 1 << i;
+
+    //i sensori in streaming restano accesi
+    if (!sensorStreaming(sensor)) {
+      powerSensor(i, 0);
+    }
+  }
+
+  //nessun sensore da leggere
+  if (!reading.mask) {
     return;
   }
 
-  //prelevo i dati dai sensori insieme al timestamp
-  long timestamp = getTimestamp();
-  uint8_t gsr = getGSR();
-  double temperature = getTemperature();
+  //prelevo il timestamp
+  reading.timestamp = getTimestamp();
 
 #ifdef DEBUG
   Serial.println(F("\n\n---------LETTURE DEI SENSORI (collectData())---------\n"));
   Serial.print(F("TIMESTAMP: "));
-  Serial.print(timestamp);
-  Serial.print(F("\nTEMPERATURA: "));
-  Serial.print(temperature);
-  Serial.print(F("\nGSR: "));
-  Serial.print(gsr);
+  Serial.print(reading.timestamp);
+
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+
+    if (reading.mask & (1 << i)) {
+      Serial.print(F("\n"));
+      Serial.print(sensorInfo(i).key);
+      Serial.print(F(": "));
+      Serial.print(reading.values[i]);
+    }
+  }
+
   Serial.println(F("\n------------------\n\n"));
 #endif
 
+#if SUMMARY_SUPPORT
+  //coda di invio congestionata: riassumo le letture per finestre
+  if (!summarizing && backlogLength >= settings.summaryThreshold) {
+
+#ifdef DEBUG
+    Serial.println(F("\n\nCODA DI INVIO CONGESTIONATA: LETTURE RIASSUNTE\n\n"));
+#endif
+
+    summarizing = 1;
+  }
+
+  //accodo la lettura (o la riassumo) e la passo a Jack se c'è posto nel buffer di invio
+  if (summarizing) {
+    summarizeReading(reading.timestamp);
+  } else {
+    pushReading(reading);
+  }
+#else
+  //accodo la lettura e la passo a Jack se c'è posto nel buffer di invio
+  pushReading(reading);
+#endif
+
+  flushBacklog();
+
+}
+
+
+//---BACKLOG FUNCTIONS---
+
+//accoda una lettura nel backlog
+/**
+ * @brief Funzione che inserisce la lettura nel backlog (se il backlog è pieno la lettura più vecchia viene sovrascritta)
+ * 
+ * @param reading Lettura
+ */
+void pushReading(const lwReading &reading) {
+
+  //backlog pieno: scarto la lettura più vecchia
+  if (backlogLength == BACKLOG_SIZE) {
+
+#ifdef DEBUG
+    Serial.println(F("\n\nBACKLOG PIENO: LETTURA PIU' VECCHIA PERSA\n\n"));
+#endif
+
+    backlogHead = (backlogHead + 1) % BACKLOG_SIZE;
+    backlogLength--;
+  }
+
+  //salvo la lettura in coda
+  backlog[(backlogHead + backlogLength) % BACKLOG_SIZE] = reading;
+
+  backlogLength++;
+}
+
+//converte la temperatura in decimi di grado
+/**
+ * @brief Funzione che converte la temperatura in decimi di grado (arrotondata)
+ * 
+ * @param temperature Temperatura (in gradi Celsius)
+ * @return Temperatura in decimi di grado
+ */
+int16_t toTenths(double temperature) {
+  return (int16_t) (temperature * 10 + (temperature < 0 ? -0.5 : 0.5));
+}
+
+//passa le letture del backlog a Jack finchè c'è posto nel buffer di invio
+/**
+ * @brief Funzione che passa le letture in attesa alla libreria Jack (chiamata ad ogni loop: le conferme liberano il buffer di invio)
+ */
+void flushBacklog() {
+
+#if EVENT_SUPPORT
+  //risposte (le più importanti)
+  while (eventLength) {
+
+    //il buffer di invio è pieno: riprovo al prossimo loop
+    if (!sendEvent(eventBacklog[eventHead])) {
+      return;
+    }
+
+    //la risposta è stata presa in carico da Jack
+    eventHead = (eventHead + 1) % EVENT_BACKLOG_SIZE;
+    eventLength--;
+  }
+#endif
+
+  //letture singole (le più vecchie)
+  while (backlogLength) {
+
+    lwReading &reading = backlog[backlogHead];
+
+    //creo il contenitore del messaggio
+    JData message;
+
+    //aggiungo i dati (solo i sensori letti)
+    message.add(TIMESTAMP_KEY, reading.timestamp);
+
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+
+      if (!(reading.mask & (1 << i))) {
+        continue;
+      }
+
+      lwSensor sensor = sensorInfo(i);
+
+      if (sensor.scale == 1) {
+        message.add(sensor.key, (long) reading.values[i]);
+      } else {
+        message.add(sensor.key, (double) reading.values[i] / sensor.scale);
+      }
+    }
+
+    //il buffer di invio è pieno: riprovo al prossimo loop
+    if (!jack.send(message)) {
+      return;
+    }
+
+    //la lettura è stata presa in carico da Jack
+    backlogHead = (backlogHead + 1) % BACKLOG_SIZE;
+    backlogLength--;
+  }
+
+#if SUMMARY_SUPPORT
+  //riassunti
+  while (summarizing) {
+
+    //la coda si è svuotata: chiudo la finestra corrente e torno alle letture singole
+    if (summaryLength == 0) {
+
+      if (aggregator.flush()) {
+        pushSummary(aggregator.get());
+      } else {
+
+#ifdef DEBUG
+        Serial.println(F("\n\nCODA DI INVIO SVUOTATA: LETTURE SINGOLE\n\n"));
+#endif
+
+        summarizing = 0;
+        return;
+      }
+    }
+
+    //il buffer di invio è pieno: riprovo al prossimo loop
+    if (!sendSummary(summaryBacklog[summaryHead])) {
+      return;
+    }
+
+    //il riassunto è stato preso in carico da Jack
+    summaryHead = (summaryHead + 1) % SUMMARY_BACKLOG_SIZE;
+    summaryLength--;
+  }
+#endif
+}
+
+
+//---SUMMARY FUNCTIONS---
+
+#if SUMMARY_SUPPORT
+
+//aggiunge una lettura al riassunto della finestra corrente
+/**
+ * @brief Funzione che aggiunge la lettura alla finestra corrente e accoda il riassunto delle finestre chiuse
+ * 
+ * Il riassunto usa l'ultimo valore letto di GSR e temperatura (anche se il sensore non è stato letto in questo
+ * data collect perché ha un periodo di campionamento diverso).
+ * 
+ * @param timestamp Timestamp della lettura
+ */
+void summarizeReading(long timestamp) {
+
+  //la lettura ha chiuso la finestra precedente
+  if (aggregator.add(timestamp, sensorStates[SENSOR_GSR].value, sensorStates[SENSOR_TEMPERATURE].value)) {
+    pushSummary(aggregator.get());
+  }
+}
+
+//accoda un riassunto
+/**
+ * @brief Funzione che accoda il riassunto (se la coda è piena i due riassunti più vecchi vengono uniti)
+ * 
+ * @param summary Riassunto da accodare
+ */
+void pushSummary(const LwSummary &summary) {
+
+  //coda piena: unisco i due riassunti più vecchi (si perde risoluzione, non letture)
+  if (summaryLength == SUMMARY_BACKLOG_SIZE) {
+
+#ifdef DEBUG
+    Serial.println(F("\n\nCODA DEI RIASSUNTI PIENA: RIASSUNTI PIU' VECCHI UNITI\n\n"));
+#endif
+
+    uint8_t next = (summaryHead + 1) % SUMMARY_BACKLOG_SIZE;
+
+    LwAggregator::merge(summaryBacklog[next], summaryBacklog[summaryHead]);
+
+    summaryHead = next;
+    summaryLength--;
+  }
+
+  summaryBacklog[(summaryHead + summaryLength) % SUMMARY_BACKLOG_SIZE] = summary;
+  summaryLength++;
+}
+
+//passa un riassunto a Jack
+/**
+ * @brief Funzione che incapsula il riassunto e lo passa alla libreria Jack
+ * 
+ * Le chiavi delle letture singole contengono l'inizio della finestra e le medie, per cui i riassunti sono
+ * letti come letture singole anche da chi non conosce le chiavi aggiuntive.
+ * 
+ * @param summary Riassunto da inviare
+ * @return ID del messaggio (0 se il buffer di invio è pieno)
+ */
+long sendSummary(const LwSummary &summary) {
+
   //creo il contenitore del messaggio
   JData message;
 
   //aggiungo i dati
-  message.add(TIMESTAMP_KEY, timestamp);
-  message.add(GSR_KEY, gsr);
-  message.add(TEMPERATURE_KEY, temperature);
+  message.add(TIMESTAMP_KEY, summary.start);
+  message.add(COUNT_KEY, summary.count);
+  message.add(GSR_KEY, summary.gsrMean());
+  message.add(GSR_MIN_KEY, summary.gsrMin);
+  message.add(GSR_MAX_KEY, summary.gsrMax);
+  message.add(TEMPERATURE_KEY, summary.temperatureMean() / 10.0);
+  message.add(TEMPERATURE_MIN_KEY, summary.temperatureMin / 10.0);
+  message.add(TEMPERATURE_MAX_KEY, summary.temperatureMax / 10.0);
+
+  return jack.send(message);
+}
+#endif
+
+
+//---EVENT FUNCTIONS---
+
+#if EVENT_SUPPORT
+
+//passa una lettura sovracampionata del GSR al rilevatore delle risposte
+/**
+ * @brief Funzione di stream del sensore GSR: legge il sensore e accoda le risposte fasiche chiuse dal rilevatore
+ * 
+ * @param now Tempo passato dall'inizio dell'esecuzione (millisecondi)
+ */
+void streamGSR(unsigned long now) {
+
+  if (detector.add(now, sampleGSR())) {
+    pushEvent(detector.get(), now);
+  }
+}
+
+//accoda una risposta
+/**
+ * @brief Funzione che converte l'inizio della risposta nel timestamp del RTC e la accoda (se la coda è piena la
+ * risposta più vecchia viene sovrascritta)
+ * 
+ * @param event Risposta (inizio in millisecondi dall'inizio dell'esecuzione)
+ * @param now Tempo passato dall'inizio dell'esecuzione (millisecondi)
+ */
+void pushEvent(LwPhasicEvent event, unsigned long now) {
+
+  event.onset = getTimestamp() - (long) ((now - event.onset) / 1000);
+
+#ifdef DEBUG
+  Serial.print(F("\nRISPOSTA GSR: INIZIO "));
+  Serial.print(event.onset);
+  Serial.print(F(", AMPIEZZA "));
+  Serial.print(event.amplitude);
+  Serial.print(F(", SALITA "));
+  Serial.print(event.riseTime);
+  Serial.print(F(" ms, RECUPERO "));
+  Serial.print(event.recoveryTime);
+  Serial.println(F(" ms"));
+#endif
 
-  //invio il messaggio
-  jack.send(message);
+  //coda piena: scarto la risposta più vecchia
+  if (eventLength == EVENT_BACKLOG_SIZE) {
+    eventHead = (eventHead + 1) % EVENT_BACKLOG_SIZE;
+    eventLength--;
+  }
 
+  eventBacklog[(eventHead + eventLength) % EVENT_BACKLOG_SIZE] = event;
+  eventLength++;
 }
 
+//passa una risposta a Jack
+/**
+ * @brief Funzione che incapsula la risposta e la passa alla libreria Jack
+ * 
+ * @param event Risposta (inizio convertito nel timestamp del RTC)
+ * @return ID del messaggio (0 se il buffer di invio è pieno)
+ */
+long sendEvent(const LwPhasicEvent &event) {
+
+  //creo il contenitore del messaggio
+  JData message;
+
+  //aggiungo i dati
+  message.add(TIMESTAMP_KEY, (long) event.onset);
+  message.add(EVENT_BASELINE_KEY, event.baseline / 10.0);
+  message.add(EVENT_AMPLITUDE_KEY, event.amplitude / 10.0);
+  message.add(EVENT_RISE_KEY, event.riseTime);
+  message.add(EVENT_RECOVERY_KEY, event.recoveryTime);
+
+  return jack.send(message);
+}
+#endif
+
+
+//---ENERGY FUNCTIONS---
+
+#if ENERGY_SUPPORT
+
+//invia la stima dei consumi
+/**
+ * @brief Funzione che invia la carica consumata da ogni componente come messaggio senza conferma (JK_QOS_UNRELIABLE)
+ * 
+ * Il messaggio contiene i secondi contabilizzati e i microampere ora di ogni componente: l'assorbimento medio e la
+ * durata della batteria si ricavano dal totale. Con il debug abilitato vengono stampati anche sulla seriale.
+ * 
+ * @param reset Indica se azzerare i contatori dopo l'invio
+ */
+void sendEnergy(uint8_t reset) {
+
+  //creo il contenitore del messaggio
+  JData message;
+
+  message.add(ENERGY_TIME_KEY, energy.time() / 1000UL);
+  message.add(ENERGY_BASE_KEY, (unsigned long) (energy.charge(LW_ENERGY_BASE) + 0.5));
+  message.add(ENERGY_CPU_KEY, (unsigned long) (energy.charge(LW_ENERGY_CPU) + 0.5));
+  message.add(ENERGY_RADIO_KEY, (unsigned long) (energy.charge(LW_ENERGY_RADIO) + 0.5));
+  message.add(ENERGY_SENSOR_KEY, (unsigned long) (energy.charge(LW_ENERGY_SENSOR) + 0.5));
+  message.add(ENERGY_RTC_KEY, (unsigned long) (energy.charge(LW_ENERGY_RTC) + 0.5));
+
+  jack.send(message, JK_QOS_UNRELIABLE);
+
+#ifdef DEBUG
+  Serial.print(F("\nCONSUMI: "));
+  Serial.print(energy.charge());
+  Serial.print(F(" uAh IN "));
+  Serial.print(energy.time() / 1000UL);
+  Serial.print(F(" s, MEDIA "));
+  Serial.print(energy.averageCurrent());
+  Serial.print(F(" uA, BATTERIA "));
+  Serial.print(energy.batteryLife(BATTERY_CAPACITY));
+  Serial.println(F(" ore"));
+#endif
+
+  if (reset) {
+    energy.reset();
+  }
+}
+#endif
+
+
+//---TRACE FUNCTIONS---
+
+#if JK_TRACE
+//invia la traccia delle fasi del loop
+/**
+ * @brief Funzione che invia il riassunto di ogni fase eseguita come messaggio senza conferma (JK_QOS_UNRELIABLE)
+ * 
+ * I messaggi non occupano il buffer di invio delle letture. Con il debug abilitato il riassunto e le esecuzioni
+ * nel buffer della traccia vengono stampati anche sulla seriale.
+ * 
+ * @param reset Indica se azzerare la traccia dopo l'invio
+ */
+void sendTrace(uint8_t reset) {
+
+  for (uint8_t phase = 0; phase < JK_TRACE_PHASES; phase++) {
+
+    JTraceSummary summary;
+
+    if (!JTrace::summary(phase, summary)) {
+      continue;
+    }
+
+    //creo il contenitore del messaggio
+    JData message;
+
+    message.add(TRACE_PHASE_KEY, phase);
+    message.add(TRACE_COUNT_KEY, summary.count);
+    message.add(TRACE_MAX_KEY, summary.max);
+    message.add(TRACE_P50_KEY, summary.p50);
+    message.add(TRACE_P99_KEY, summary.p99);
+
+    jack.send(message, JK_QOS_UNRELIABLE);
+
+#ifdef DEBUG
+    Serial.print(F("\nTRACE FASE "));
+    Serial.print(phase);
+    Serial.print(F(": N "));
+    Serial.print(summary.count);
+    Serial.print(F(", MAX "));
+    Serial.print(summary.max);
+    Serial.print(F(" us, P50 "));
+    Serial.print(summary.p50);
+    Serial.print(F(" us, P90 "));
+    Serial.print(summary.p90);
+    Serial.print(F(" us, P99 "));
+    Serial.print(summary.p99);
+    Serial.println(F(" us"));
+#endif
+  }
+
+#ifdef DEBUG
+  //esecuzioni nel buffer (fase, inizio, durata)
+  for (uint8_t i = 0; i < JTrace::size(); i++) {
+
+    JTraceRecord record = JTrace::get(i);
+
+    Serial.print(record.phase);
+    Serial.print(F(","));
+    Serial.print(record.start);
+    Serial.print(F(","));
+    Serial.println(record.duration);
+  }
+#endif
+
+  if (reset) {
+    JTrace::reset();
+  }
+}
+#endif
+
 
 //---SETUP FUNCTION---
 /**
@@ -423,6 +1680,10 @@ void setup() {
   Serial.begin(9600);
 #endif
 
+  //carico le impostazioni e le applico
+  loadSettings();
+  applySettings();
+
   //inizializzo i sensori
   setupSensor();
 
@@ -432,6 +1693,12 @@ void setup() {
   //avvio jack
   jack.start();
 
+#if ENERGY_SUPPORT
+  //inizio a contare i consumi
+  energy.loadCosts(&energyCosts);
+  energy.begin();
+#endif
+
 }
 
 
@@ -441,30 +1708,38 @@ void setup() {
  */
 void loop() {
 
-  //loop jack
-  jack.loop();
-
-  //prelevo il tempo passato dall'inizio dell'esecuzione
-  long now = millis();
-
-  //se l'intervallo di data collect è stato raggiunto
-  if (now - timeLastDataCollect >= INTERVAL_BETWEEN_DATA_COLLECT) {
+#if RADIO_SLEEP_SUPPORT
+  //sveglio/addormento il modulo bluetooth: jack viene eseguito solo nelle finestre di sincronizzazione
+  if (radio.loop(jack.pending())) {
 
-    //prelevo i dati dai sensori
-    collectData();
+    //loop jack
+    jack.loop();
+  }
+#else
+  //loop jack (modulo sempre sveglio)
+  jack.loop();
+#endif
 
-    //addormento i sensori
-    sleepSensor();
+  //passo a jack le letture in attesa (dopo una riconnessione jack le invia in modalità burst)
+  flushBacklog();
 
-    //salvo il tempo passato dall'inizio dell'esecuzione all'ultimo data collect
-    timeLastDataCollect = now;
+#if ENERGY_SUPPORT
+  //aggiorno la stima dei consumi (microcontrollore sveglio, modulo bluetooth)
+  energy.loop();
+#if RADIO_SLEEP_SUPPORT
+  energy.radio(radio.onTime(), mmJTM.bytesSent(), mmJTM.bytesReceived());
+#else
+  energy.radio(millis(), mmJTM.bytesSent(), mmJTM.bytesReceived());
+#endif
+#endif
 
-    //se è stato raggiunta la metà dell'intervallo di invio
-  } else if (getSensorState() == LW_SENSOR_SLEEP && now - timeLastDataCollect >= (int) (INTERVAL_BETWEEN_DATA_COLLECT / 2)) {
+  //prelevo il tempo passato dall'inizio dell'esecuzione
+  unsigned long now = millis();
 
-    //sveglio i sensori
-    wakeupSensor();
+  //accendo i sensori la cui lettura è vicina
+  scheduleSensors(now);
 
-  }
+  //leggo i sensori dovuti e assestati
+  collectData(now);
 
 }
@@ -0,0 +1,124 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JArena.cpp
+ * @brief Pool statico dei buffer JSON condiviso da Jack e JData
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <Arduino.h>
+#include "JArena.h"
+
+
+//---VARIABILI STATICHE---
+JK_ARENA_STORAGE JArena::Block JArena::_blocks[JK_ARENA_BLOCKS];
+JK_ARENA_STORAGE uint8_t JArena::_inUse = 0;
+JK_ARENA_STORAGE uint8_t JArena::_used = 0;
+JK_ARENA_STORAGE uint8_t JArena::_highWaterMark = 0;
+JK_ARENA_STORAGE unsigned long JArena::_failures = 0;
+
+
+//---JARENA---
+
+/**
+ * @brief Metodo che preleva un blocco dal pool
+ *
+ * @return Blocco di JK_JSON_BUFFER_SIZE byte (NULL se i blocchi sono tutti in uso)
+ */
+char *JArena::borrow() {
+
+	for (uint8_t i = 0; i < JK_ARENA_BLOCKS; i++) {
+
+		if (!(_inUse & (1 << i))) {
+
+			_inUse |= 1 << i;
+			_used++;
+
+			if (_used > _highWaterMark) {
+				_highWaterMark = _used;
+			}
+
+			return _blocks[i].data;
+		}
+	}
+
+	_failures++;
+
+	return NULL;
+}
+
+/**
+ * @brief Metodo che restituisce un blocco al pool
+ *
+ * @param block Blocco ottenuto con borrow()
+ */
+void JArena::giveBack(char *block) {
+
+	for (uint8_t i = 0; i < JK_ARENA_BLOCKS; i++) {
+
+		if (_blocks[i].data == block && (_inUse & (1 << i))) {
+
+			_inUse &= ~(1 << i);
+			_used--;
+
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Metodo che restituisce il numero di blocchi in uso
+ *
+ * @return Blocchi in uso
+ */
+uint8_t JArena::used() {
+	return _used;
+}
+
+/**
+ * @brief Metodo che restituisce il massimo numero di blocchi in uso contemporaneamente
+ *
+ * @return Blocchi in uso al massimo (dall'avvio o dall'ultimo resetStatistics())
+ */
+uint8_t JArena::highWaterMark() {
+	return _highWaterMark;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di prestiti falliti per mancanza di blocchi
+ *
+ * @return Prestiti falliti (dall'avvio o dall'ultimo resetStatistics())
+ */
+unsigned long JArena::failures() {
+	return _failures;
+}
+
+/**
+ * @brief Metodo che azzera le statistiche del pool (il massimo riparte dai blocchi attualmente in uso)
+ */
+void JArena::resetStatistics() {
+	_highWaterMark = _used;
+	_failures = 0;
+}
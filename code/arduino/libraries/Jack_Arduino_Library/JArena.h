@@ -0,0 +1,145 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JArena.h
+ * @brief Pool statico dei buffer JSON condiviso da Jack e JData
+ *
+ * Il pool contiene JK_ARENA_BLOCKS blocchi da JK_JSON_BUFFER_SIZE byte allocati staticamente: Jack (per il
+ * messaggio ricevuto) e JData (per il messaggio da inviare) prendono in prestito un blocco e lo restituiscono
+ * alla distruzione. La RAM occupata dai buffer JSON è quindi fissa e nota a tempo di compilazione.
+ *
+ * Quando i blocchi sono tutti in uso il buffer resta vuoto: il messaggio ricevuto viene scartato (l'altro capo
+ * lo reinvia) e quello da inviare non viene accettato da Jack::send() (restituisce 0).
+ *
+ * Il pool non è thread-safe (come il resto di Jack). Sugli host con più thread che costruiscono messaggi
+ * (ConcurrentJack su Linux) JK_ARENA_THREAD_LOCAL dà a ogni thread il proprio pool: un JData va costruito e
+ * distrutto sullo stesso thread.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef JARENA_H
+#define JARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "JConfig.h"
+
+//JArenaBuffer deriva da una classe interna di ArduinoJson: la versione supportata è la 5.13
+#if defined(ARDUINOJSON_VERSION_MAJOR) && (ARDUINOJSON_VERSION_MAJOR != 5 || ARDUINOJSON_VERSION_MINOR != 13)
+#error "JArena richiede ArduinoJson 5.13 (ArduinoJson::Internals::StaticJsonBufferBase)"
+#endif
+
+
+//---COSTANTI---
+/**
+ * @brief Numero di blocchi del pool
+ *
+ * Ne servono due: uno per il messaggio ricevuto e uno per il messaggio che l'utente può costruire
+ * nell'handler onReceive.
+ */
+#ifndef JK_ARENA_BLOCKS
+#define JK_ARENA_BLOCKS 2 //messaggio ricevuto + messaggio in uscita
+#endif
+
+/**
+ * @brief Pool separato per ogni thread (solo host, va impostato per tutta la build con -DJK_ARENA_THREAD_LOCAL=1)
+ */
+#ifndef JK_ARENA_THREAD_LOCAL
+#define JK_ARENA_THREAD_LOCAL 0 //un solo pool
+#endif
+
+#if JK_ARENA_THREAD_LOCAL
+#define JK_ARENA_STORAGE thread_local
+#else
+#define JK_ARENA_STORAGE
+#endif
+
+static_assert(JK_ARENA_BLOCKS >= 1 && JK_ARENA_BLOCKS <= 8, "JK_ARENA_BLOCKS deve essere compreso tra 1 e 8 (blocchi in uso in un uint8_t)");
+
+
+//---JARENA---
+//pool dei blocchi (solo metodi statici)
+class JArena {
+
+	public:
+
+		static char *borrow(); //preleva un blocco (NULL se sono tutti in uso)
+		static void giveBack(char *block); //restituisce un blocco al pool
+
+		static uint8_t used(); //blocchi attualmente in uso
+		static uint8_t highWaterMark(); //massimo numero di blocchi in uso contemporaneamente
+		static unsigned long failures(); //prestiti falliti per mancanza di blocchi
+		static void resetStatistics(); //azzera massimo e prestiti falliti
+
+	private:
+
+		//blocco allineato per i nodi di ArduinoJson (la dimensione viene arrotondata all'allineamento)
+		struct Block {
+			alignas(double) char data[JK_JSON_BUFFER_SIZE];
+		};
+
+		static JK_ARENA_STORAGE Block _blocks[JK_ARENA_BLOCKS]; //blocchi del pool
+		static JK_ARENA_STORAGE uint8_t _inUse; //un bit per blocco in uso
+		static JK_ARENA_STORAGE uint8_t _used; //blocchi in uso
+		static JK_ARENA_STORAGE uint8_t _highWaterMark; //massimo dei blocchi in uso
+		static JK_ARENA_STORAGE unsigned long _failures; //prestiti falliti
+};
+
+
+//---JARENA BLOCK---
+//prestito di un blocco (restituito alla distruzione)
+class JArenaBlock {
+
+	public:
+
+		explicit JArenaBlock(uint8_t borrow) : _block(borrow ? JArena::borrow() : NULL) {}
+		~JArenaBlock() { if (_block) JArena::giveBack(_block); }
+
+	protected:
+
+		char *_block; //blocco in prestito (NULL se non è stato ottenuto)
+
+	private:
+
+		//il blocco non può essere restituito due volte
+		JArenaBlock(const JArenaBlock &);
+		JArenaBlock &operator=(const JArenaBlock &);
+};
+
+
+//---JARENA BUFFER---
+//buffer JSON che usa un blocco del pool (capacità 0 se non è stato ottenuto): la base è la stessa di
+//StaticJsonBuffer, dichiarata in ArduinoJson::Internals dalla 5.13
+class JArenaBuffer : private JArenaBlock, public ArduinoJson::Internals::StaticJsonBufferBase {
+
+	public:
+
+		explicit JArenaBuffer(uint8_t borrow = 1) : JArenaBlock(borrow), ArduinoJson::Internals::StaticJsonBufferBase(_block, _block ? JK_JSON_BUFFER_SIZE : 0) {}
+
+		uint8_t borrowed() { return _block != NULL; } //indica se il buffer ha un blocco
+};
+
+
+#endif //JARENA_H
@@ -0,0 +1,440 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JCompressAdapter.h
+ * @brief Mezzo di trasmissione che comprime i messaggi (JLzCodec) se l'altro capo sa decomprimerli
+ *
+ * Le versioni dell'applicazione che non conoscono la compressione devono continuare a ricevere JSON: la
+ * compressione viene concordata per collegamento. Finchè l'altro capo non si è dichiarato, i messaggi partono in
+ * chiaro, preceduti (al massimo JK_LZ_HELLO_ATTEMPTS volte) dalla proposta JK_LZ_HELLO, un messaggio JSON di
+ * tipo sconosciuto che Jack scarta. Chi sa decomprimere risponde con JK_LZ_HELLO_REPLY; da quel momento i
+ * messaggi che si accorciano partono compressi.
+ *
+ * I messaggi compressi vengono sempre decompressi, quelli in chiaro passano così come sono. L'accordo decade (e
+ * le proposte ripartono) se l'altro capo invia un messaggio in chiaro dopo averne inviati di compressi (è
+ * cambiato il telefono) o se non risponde a JK_LZ_MAX_SILENT messaggi compressi di fila (il nuovo telefono non li
+ * capisce e non conferma nulla).
+ *
+ * Il messaggio in uscita viene compresso sullo stack. Quello ricevuto viene prelevato dal mezzo avvolto
+ * direttamente nel buffer di Jack e decompresso sul posto da receive(), senza una seconda copia: proposte e
+ * risposte vengono gestite lì e receive() restituisce 0 se non resta un messaggio per Jack. Proposta e risposta
+ * stanno nella flash sull'AVR.
+ *
+ * L'adattatore costa circa 30 byte di RAM più il buffer di compressione sullo stack dell'invio
+ * (JK_MAX_MESSAGE_LENGTH byte): il firmware non lo usa finchè l'applicazione non concorda la compressione.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef JCOMPRESSADAPTER_H
+#define JCOMPRESSADAPTER_H
+
+#include <Arduino.h>
+#include "JConfig.h"
+#include "JLzCodec.h"
+
+//sull'AVR proposta e risposta restano nella flash
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define JLZ_COMPARE(buffer, text, length) memcmp_P(buffer, text, length)
+#define JLZ_COPY(buffer, text, length) memcpy_P(buffer, text, length)
+#else
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#define JLZ_COMPARE(buffer, text, length) memcmp(buffer, text, length)
+#define JLZ_COPY(buffer, text, length) memcpy(buffer, text, length)
+#endif
+
+
+//---COSTANTI---
+/**
+ * @brief Proposta della compressione (chi la invia sa decomprimere la versione JK_LZ_VERSION)
+ */
+#define JK_LZ_HELLO "{\"type\":\"lz\",\"v\":1}"
+/**
+ * @brief Risposta alla proposta (chi la invia sa decomprimere la versione JK_LZ_VERSION)
+ */
+#define JK_LZ_HELLO_REPLY "{\"type\":\"lz\",\"v\":1,\"r\":1}"
+/**
+ * @brief Proposte inviate prima di rinunciare (un telefono che non risponde non sa decomprimere)
+ */
+#ifndef JK_LZ_HELLO_ATTEMPTS
+#define JK_LZ_HELLO_ATTEMPTS 4
+#endif
+/**
+ * @brief Messaggi compressi inviati di fila senza ricevere nulla dopo i quali si torna in chiaro
+ */
+#ifndef JK_LZ_MAX_SILENT
+#define JK_LZ_MAX_SILENT (3 * JK_BUFFER_SEND_SIZE) //circa tre reinvii del buffer
+#endif
+
+static_assert(JK_LZ_VERSION == 1, "JK_LZ_HELLO e JK_LZ_HELLO_REPLY vanno aggiornati con la versione");
+
+//proposta e risposta (nella flash sull'AVR)
+static const char jlzHello[] PROGMEM = JK_LZ_HELLO;
+static const char jlzHelloReply[] PROGMEM = JK_LZ_HELLO_REPLY;
+
+
+//---JCOMPRESS ADAPTER---
+//mezzo di trasmissione che comprime i messaggi se l'altro capo sa decomprimerli (T è il mezzo avvolto)
+template <class T>
+class JCompressAdapter {
+
+	public:
+
+		JCompressAdapter(T &mmJTM); //costruttore
+
+		size_t receive(char *buffer, size_t size); //preleva il primo messaggio (decompresso, 0 se era una proposta)
+		void send(char *message, size_t length); //invia il messaggio (compresso se concordato)
+		size_t available(); //lunghezza del messaggio pronto sul mezzo avvolto (prima della decompressione)
+
+		void setEnabled(uint8_t enabled); //abilita/disabilita l'invio compresso (la ricezione resta sempre attiva)
+		uint8_t negotiated(); //l'altro capo sa decomprimere
+		void reset(); //dimentica l'accordo (es. nuovo collegamento)
+
+		//contatori
+		unsigned long bytesIn(); //caratteri dei messaggi inviati (prima della compressione)
+		unsigned long bytesOut(); //caratteri inviati (proposte comprese)
+		unsigned long framesCompressed(); //messaggi inviati compressi
+		unsigned long framesDecompressed(); //messaggi ricevuti compressi
+		unsigned long framesFailed(); //messaggi compressi ricevuti non validi
+
+		/**
+		 * @brief Lunghezza massima di un messaggio
+		 */
+		static const size_t MTU = JK_MAX_MESSAGE_LENGTH - 1;
+
+
+	private:
+
+		void sendRaw(const char *frame, size_t length); //invia il messaggio sul mezzo avvolto
+		void sendHello(const char *hello, size_t length); //invia la proposta o la risposta (dalla flash sull'AVR)
+
+		T *_mmJTM; //mezzo di trasmissione avvolto
+		uint8_t _enabled; //invio compresso abilitato
+
+		uint8_t _negotiated; //l'altro capo sa decomprimere
+		uint8_t _peerCompressing; //l'altro capo ha inviato messaggi compressi
+		uint8_t _hellos; //proposte inviate dall'ultimo azzeramento
+		uint8_t _silent; //messaggi compressi inviati dall'ultimo messaggio ricevuto
+
+		unsigned long _bytesIn;
+		unsigned long _bytesOut;
+		unsigned long _framesCompressed;
+		unsigned long _framesDecompressed;
+		unsigned long _framesFailed;
+
+};
+
+
+//---IMPLEMENTAZIONE---
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ *
+ * @param mmJTM Mezzo di trasmissione avvolto
+ */
+template <class T>
+JCompressAdapter<T>::JCompressAdapter(T &mmJTM) {
+
+	static_assert(JK_MAX_MESSAGE_LENGTH - 1 <= T::MTU, "un messaggio supera l'MTU del mezzo di trasmissione");
+
+	_mmJTM = &mmJTM;
+	_enabled = 1;
+
+	_bytesIn = 0;
+	_bytesOut = 0;
+	_framesCompressed = 0;
+	_framesDecompressed = 0;
+	_framesFailed = 0;
+
+	reset();
+}
+
+
+/**
+ * @brief Metodo che preleva il primo messaggio, decompresso direttamente nel buffer
+ *
+ * Il messaggio compresso viene prelevato dal mezzo avvolto nel buffer, spostato in fondo e decompresso verso
+ * l'inizio: ogni simbolo produce almeno tanti caratteri quanti ne occupa, per cui la scrittura non supera mai la
+ * lettura. Le proposte e le risposte vengono gestite qui e non arrivano a Jack; i messaggi compressi non validi
+ * vengono scartati.
+ *
+ * @param buffer Buffer in cui salvare il messaggio
+ * @param size Dimensione del buffer
+ *
+ * @return Lunghezza del messaggio (0 se non ci sono messaggi per Jack o il messaggio non sta nel buffer)
+ */
+template <class T>
+size_t JCompressAdapter<T>::receive(char *buffer, size_t size) {
+
+	if (size == 0) {
+		return 0;
+	}
+
+	//prelevo i messaggi dal mezzo avvolto finchè non ce n'è uno per Jack
+	while (_mmJTM->available()) {
+
+		size_t length = _mmJTM->receive(buffer, size);
+
+		if (length == 0) {
+			continue;
+		}
+
+		_silent = 0;
+
+		//proposta: rispondo (so decomprimere) e posso comprimere
+		if (length == sizeof(jlzHello) - 1 && JLZ_COMPARE(buffer, jlzHello, length) == 0) {
+
+			_negotiated = 1;
+			_peerCompressing = 0;
+
+			sendHello(jlzHelloReply, sizeof(jlzHelloReply) - 1);
+
+			continue;
+		}
+
+		//risposta alla proposta
+		if (length == sizeof(jlzHelloReply) - 1 && JLZ_COMPARE(buffer, jlzHelloReply, length) == 0) {
+
+			_negotiated = 1;
+
+			continue;
+		}
+
+		//messaggio compresso: l'altro capo sa decomprimere
+		if (buffer[0] == JK_LZ_MARKER) {
+
+			size_t decoded = JLzCodec::decodedLength(buffer, length);
+
+			if (decoded == 0) {
+				_framesFailed++;
+				continue;
+			}
+
+			_negotiated = 1;
+			_peerCompressing = 1;
+			_framesDecompressed++;
+
+			//il messaggio non sta nel buffer
+			if (decoded >= size) {
+				buffer[0] = 0;
+				return 0;
+			}
+
+			//sposto il messaggio compresso in fondo allo spazio del messaggio decompresso
+			size_t offset = decoded > length ? decoded - length : 0;
+
+			memmove(buffer + offset, buffer, length);
+
+			return JLzCodec::decompress(buffer + offset, length, buffer, size);
+		}
+
+		//messaggio in chiaro da chi comprimeva: è cambiato l'altro capo
+		if (_peerCompressing) {
+			reset();
+		}
+
+		return length;
+	}
+
+	buffer[0] = 0;
+
+	return 0;
+}
+
+/**
+ * @brief Metodo che invia il messaggio, compresso se l'altro capo sa decomprimerlo
+ *
+ * Finchè l'altro capo non si è dichiarato il messaggio parte in chiaro preceduto dalla proposta (al massimo
+ * JK_LZ_HELLO_ATTEMPTS volte).
+ *
+ * @param message Messaggio da inviare
+ * @param length Lunghezza del messaggio
+ */
+template <class T>
+void JCompressAdapter<T>::send(char *message, size_t length) {
+
+	_bytesIn += length;
+
+	//compressione concordata
+	if (_enabled && _negotiated) {
+
+		char frame[JK_MAX_MESSAGE_LENGTH];
+		size_t compressed = JLzCodec::compress(message, length, frame, JK_MAX_MESSAGE_LENGTH);
+
+		if (compressed) {
+
+			//l'altro capo non risponde più: torno in chiaro e ripropongo la compressione
+			if (++_silent > JK_LZ_MAX_SILENT) {
+
+				reset();
+
+			} else {
+
+				_framesCompressed++;
+
+				sendRaw(frame, compressed);
+
+				return;
+			}
+		}
+	}
+
+	//proposta della compressione
+	if (_enabled && !_negotiated && _hellos < JK_LZ_HELLO_ATTEMPTS) {
+
+		_hellos++;
+
+		sendHello(jlzHello, sizeof(jlzHello) - 1);
+	}
+
+	sendRaw(message, length);
+}
+
+/**
+ * @brief Metodo che restituisce la lunghezza del messaggio pronto sul mezzo avvolto
+ *
+ * Il messaggio può essere una proposta o una risposta (receive() restituisce 0) e la lunghezza è quella prima
+ * della decompressione.
+ *
+ * @return Lunghezza del messaggio pronto (0 se non ci sono messaggi)
+ */
+template <class T>
+size_t JCompressAdapter<T>::available() {
+	return _mmJTM->available();
+}
+
+
+/**
+ * @brief Metodo che abilita/disabilita l'invio compresso (i messaggi compressi ricevuti vengono sempre decompressi)
+ *
+ * @param enabled 1 per abilitare, 0 per disabilitare
+ */
+template <class T>
+void JCompressAdapter<T>::setEnabled(uint8_t enabled) {
+	_enabled = enabled;
+}
+
+/**
+ * @brief Metodo che indica se l'altro capo sa decomprimere
+ *
+ * @return 1 se la compressione è concordata, 0 altrimenti
+ */
+template <class T>
+uint8_t JCompressAdapter<T>::negotiated() {
+	return _negotiated;
+}
+
+/**
+ * @brief Metodo che dimentica l'accordo: i messaggi tornano in chiaro e le proposte ripartono
+ */
+template <class T>
+void JCompressAdapter<T>::reset() {
+
+	_negotiated = 0;
+	_peerCompressing = 0;
+	_hellos = 0;
+	_silent = 0;
+}
+
+
+/**
+ * @brief Metodo che restituisce i caratteri dei messaggi inviati prima della compressione
+ *
+ * @return Caratteri dei messaggi
+ */
+template <class T>
+unsigned long JCompressAdapter<T>::bytesIn() {
+	return _bytesIn;
+}
+
+/**
+ * @brief Metodo che restituisce i caratteri inviati sul mezzo avvolto (proposte e risposte comprese)
+ *
+ * @return Caratteri inviati
+ */
+template <class T>
+unsigned long JCompressAdapter<T>::bytesOut() {
+	return _bytesOut;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di messaggi inviati compressi
+ *
+ * @return Messaggi compressi
+ */
+template <class T>
+unsigned long JCompressAdapter<T>::framesCompressed() {
+	return _framesCompressed;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di messaggi ricevuti compressi
+ *
+ * @return Messaggi decompressi
+ */
+template <class T>
+unsigned long JCompressAdapter<T>::framesDecompressed() {
+	return _framesDecompressed;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di messaggi compressi ricevuti non validi (scartati)
+ *
+ * @return Messaggi scartati
+ */
+template <class T>
+unsigned long JCompressAdapter<T>::framesFailed() {
+	return _framesFailed;
+}
+
+
+//---PRIVATE---
+
+//invia il messaggio sul mezzo avvolto (il mezzo non modifica il messaggio)
+template <class T>
+void JCompressAdapter<T>::sendRaw(const char *frame, size_t length) {
+
+	_bytesOut += length;
+
+	_mmJTM->send((char *) frame, length);
+}
+
+//invia la proposta o la risposta (copiata dalla flash sullo stack sull'AVR)
+template <class T>
+void JCompressAdapter<T>::sendHello(const char *hello, size_t length) {
+
+	char frame[sizeof(jlzHelloReply)];
+
+	JLZ_COPY(frame, hello, length);
+
+	sendRaw(frame, length);
+}
+
+
+#endif //JCOMPRESSADAPTER_H
@@ -0,0 +1,94 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JConfig.h
+ * @brief Dimensioni dei buffer di Jack e JData
+ *
+ * Tutte le dimensioni derivano da JK_MAX_MESSAGE_LENGTH (e da JK_BUFFER_SEND_SIZE per il buffer di invio):
+ * per ridimensionare la memoria basta ridefinire queste due costanti prima di includere Jack.h (o con -D).
+ * Le relazioni tra le dimensioni vengono verificate a tempo di compilazione.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef JCONFIG_H
+#define JCONFIG_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+
+//---DIMENSIONI CONFIGURABILI---
+/**
+ * @brief Lunghezza massima di un messaggio (carattere di terminazione compreso)
+ */
+#ifndef JK_MAX_MESSAGE_LENGTH
+#define JK_MAX_MESSAGE_LENGTH 136 //lunghezza massima di un messaggio serializzato (riassunti compresi)
+#endif
+/**
+ * @brief Numero massimo di messaggi nel buffer di invio (in attesa di conferma)
+ */
+#ifndef JK_BUFFER_SEND_SIZE
+#define JK_BUFFER_SEND_SIZE 6 //messaggi non confermati
+#endif
+
+
+//---DIMENSIONI DERIVATE---
+/**
+ * @brief Lunghezza massima di un messaggio ACK (carattere di terminazione compreso)
+ */
+#define JK_MAX_ACK_LENGTH 48 //{"id":<long>,"type":"ack"}
+/**
+ * @brief Lunghezza del messaggio dati più corto (payload vuoto, id di una cifra, senza carattere di terminazione)
+ */
+#define JK_MIN_FRAME_LENGTH 31 //{"val":{},"id":0,"type":"data"}
+/**
+ * @brief Caratteri minimi occupati da un valore del payload (separatore compreso)
+ */
+#define JK_MIN_VALUE_LENGTH 6 //"K":0,
+/**
+ * @brief Numero massimo di valori che possono stare in un messaggio lungo JK_MAX_MESSAGE_LENGTH
+ */
+#ifndef JK_MAX_VALUES
+#define JK_MAX_VALUES ((JK_MAX_MESSAGE_LENGTH - JK_MIN_FRAME_LENGTH) / JK_MIN_VALUE_LENGTH) //valori nel payload
+#endif
+/**
+ * @brief Dimensione del buffer JSON di un messaggio (root con id, tipo e payload più i valori del payload)
+ *
+ * Il parsing avviene sul messaggio ricevuto (le stringhe non vengono copiate), per cui qualsiasi messaggio
+ * lungo al massimo JK_MAX_MESSAGE_LENGTH sta nel buffer. I valori String aggiunti a JData vengono invece
+ * copiati nel buffer: per i messaggi in uscita conviene usare chiavi e valori const char *.
+ */
+#define JK_JSON_BUFFER_SIZE (JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(JK_MAX_VALUES)) //root + payload
+
+
+//---VERIFICHE---
+static_assert(JK_MAX_MESSAGE_LENGTH > JK_MIN_FRAME_LENGTH + JK_MIN_VALUE_LENGTH, "JK_MAX_MESSAGE_LENGTH non contiene nemmeno un valore");
+static_assert(JK_MAX_MESSAGE_LENGTH - 1 <= 0xFFFF, "JK_MAX_MESSAGE_LENGTH supera la lunghezza memorizzabile in uno slot (uint16_t)");
+static_assert(JK_MAX_ACK_LENGTH <= JK_MAX_MESSAGE_LENGTH, "il buffer di ricezione (JK_MAX_MESSAGE_LENGTH) deve contenere un ACK");
+static_assert(JK_BUFFER_SEND_SIZE >= 1 && JK_BUFFER_SEND_SIZE <= 255, "JK_BUFFER_SEND_SIZE deve essere compreso tra 1 e 255 (indici uint8_t)");
+static_assert(JK_MAX_VALUES >= 1, "JK_MAX_VALUES deve essere almeno 1");
+
+
+#endif //JCONFIG_H
@@ -30,6 +30,7 @@
 
 #include <Arduino.h>
 #include "JData.h"
+#include "Jack.h"
 
 
 //---JDATA---
@@ -39,7 +40,7 @@
  */
 JData::JData() { //costruttore
 
-   //costruisco la root
+   //costruisco la root (non valida se il pool non ha blocchi liberi)
    _root = &_buffer.createObject();
 
    //indico che l'oggetto nested non è ancora stato creato
@@ -267,6 +268,18 @@ JsonVariant JData::get(const char *key) {
    return (*_values)[key];
 }
 
+/**
+ * @brief Metodo che indica se il messaggio contiene il dato indicato
+ * 
+ * @param key Chiave del dato
+ * @return true se il dato è presente
+ */
+bool JData::containsKey(const char *key) {
+
+   //un messaggio ancora vuoto non ha l'oggetto nested
+   return _nestedObjectExists && _values->containsKey(key);
+}
+
 
 //---PRIVATE---
 
@@ -283,14 +296,14 @@ void JData::createNestedObject() {
 
 //---PROTECTED---
 
-//costruttore privato che permette di costruire JData a partire da JsonObject
-JData::JData(JsonObject &root) { //costruttore
+//costruttore privato che permette di costruire JData a partire da JsonObject (non preleva blocchi dal pool)
+JData::JData(JsonObject &root): _buffer(0) { //costruttore
 
    //salvo la root
    _root = &root;
 
-   //imposto l'oggetto nested
-   _values = &_buffer.parseObject((*_root)[JK_MESSAGE_PAYLOAD].asString());
+   //imposto l'oggetto nested (il payload è un oggetto annidato nella root)
+   _values = &(*_root)[JK_MESSAGE_PAYLOAD].asObject();
 
    //indico che l'oggetto nested è stato creato
    _nestedObjectExists = 1;
@@ -33,15 +33,17 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
-#include <Jack.h>
+#include "JConfig.h"
+#include "JArena.h"
 
 
 //---JDATA---
 //classe usata come contenitore per i messaggi
 class JData {
 
-   //la classe Jack può accedere ai membri privati di JData
-   friend class Jack;
+   //Jack e la serializzazione dei messaggi possono accedere ai membri privati di JData
+   template <class T> friend class BasicJack;
+   friend class JFrame;
 
    public:
       
@@ -67,6 +69,9 @@ class JData {
       //get
       JsonVariant get(const char *key);
 
+      //indica se il messaggio contiene il dato
+      bool containsKey(const char *key);
+
 
    private:
 
@@ -76,8 +81,8 @@ class JData {
       //indica se è stato costruito l'oggetto nested
       uint8_t _nestedObjectExists;
 
-      //buffer Json
-      StaticJsonBuffer<200> _buffer;
+      //buffer Json (blocco del pool, vuoto per i messaggi ricevuti che usano il buffer di Jack)
+      JArenaBuffer _buffer;
 
       //json object
       JsonObject *_root;
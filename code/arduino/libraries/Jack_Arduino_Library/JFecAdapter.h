@@ -0,0 +1,356 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JFecAdapter.h
+ * @brief Mezzo di trasmissione che protegge i messaggi con un codice correttore (Reed-Solomon)
+ *
+ * Al limite della portata del BLE la maggior parte dei messaggi arriva con pochi byte errati: senza correzione
+ * il messaggio viene scartato (o peggio, interpretato con valori sbagliati) e Jack lo reinvia dopo il timer.
+ * JFecAdapter avvolge il mezzo di trasmissione T e aggiunge a ogni messaggio parity byte di parità
+ * Reed-Solomon, scritti in esadecimale per non introdurre i delimitatori del mezzo di trasmissione:
+ * chi riceve corregge fino a parity / 2 byte errati senza reinvio e scarta i messaggi non correggibili.
+ *
+ * Messaggio: dati parità (2 * parity cifre esadecimali). L'overhead si sceglie con la parità (0 = nessun
+ * codice); entrambi i capi del collegamento devono usare JFecAdapter con la stessa parità.
+ *
+ * Il messaggio in uscita viene codificato sullo stack (JK_FEC_FRAME_LENGTH byte). Con SoftwareSerialJack il
+ * buffer interno deve contenere i messaggi codificati: SSJ_BUFFER_SIZE va aumentato di 4 * JK_FEC_MAX_PARITY.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef JFECADAPTER_H
+#define JFECADAPTER_H
+
+#include <Arduino.h>
+#include "JConfig.h"
+#include "JReedSolomon.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Byte di parità di default (corregge fino a JK_FEC_PARITY / 2 byte per messaggio)
+ */
+#ifndef JK_FEC_PARITY
+#define JK_FEC_PARITY 8 //16 caratteri in più per messaggio
+#endif
+/**
+ * @brief Lunghezza massima di un messaggio codificato (carattere di terminazione compreso)
+ */
+#define JK_FEC_FRAME_LENGTH (JK_MAX_MESSAGE_LENGTH + 2 * JK_FEC_MAX_PARITY)
+
+static_assert(JK_FEC_PARITY % 2 == 0 && JK_FEC_PARITY <= JK_FEC_MAX_PARITY, "JK_FEC_PARITY deve essere pari e al massimo JK_FEC_MAX_PARITY");
+static_assert(JK_MAX_MESSAGE_LENGTH - 1 + JK_FEC_MAX_PARITY <= 255, "un messaggio con la parità supera il blocco Reed-Solomon (255 byte)");
+
+
+//---JFEC ADAPTER---
+//mezzo di trasmissione che aggiunge la parità Reed-Solomon ai messaggi e corregge quelli ricevuti (T è il mezzo avvolto)
+template <class T>
+class JFecAdapter {
+
+	public:
+
+		JFecAdapter(T &mmJTM); //costruttore (parità JK_FEC_PARITY)
+		JFecAdapter(T &mmJTM, uint8_t parity); //costruttore con la parità
+
+		size_t receive(char *buffer, size_t size); //preleva il primo messaggio corretto
+		void send(char *message, size_t length); //invia il messaggio con la parità
+		size_t available(); //corregge i messaggi arrivati e restituisce la lunghezza del messaggio pronto
+
+		void setParity(uint8_t parity); //imposta i byte di parità (pari, al massimo JK_FEC_MAX_PARITY)
+		uint8_t parity(); //byte di parità
+
+		//contatori
+		unsigned long framesCorrected(); //messaggi ricevuti con errori corretti
+		unsigned long framesFailed(); //messaggi scartati perchè non correggibili
+		unsigned long bytesCorrected(); //byte corretti
+
+		/**
+		 * @brief Lunghezza massima di un messaggio (prima della codifica)
+		 */
+		static const size_t MTU = JK_MAX_MESSAGE_LENGTH - 1;
+
+
+	private:
+
+		static char hexDigit(uint8_t value); //cifra esadecimale
+		static uint8_t hexValue(char digit); //valore della cifra esadecimale (0 se non valida)
+
+		T *_mmJTM; //mezzo di trasmissione avvolto
+		uint8_t _parity; //byte di parità
+
+		char _frame[JK_FEC_FRAME_LENGTH]; //ultimo messaggio prelevato dal mezzo avvolto
+		size_t _readyLength; //lunghezza del messaggio corretto in _frame (0 se non c'è)
+
+		unsigned long _framesCorrected;
+		unsigned long _framesFailed;
+		unsigned long _bytesCorrected;
+
+};
+
+
+//---IMPLEMENTAZIONE---
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ *
+ * @param mmJTM Mezzo di trasmissione avvolto
+ * @param parity Byte di parità (pari, al massimo JK_FEC_MAX_PARITY; 0 = nessun codice)
+ */
+template <class T>
+JFecAdapter<T>::JFecAdapter(T &mmJTM, uint8_t parity) {
+
+	static_assert(JK_FEC_FRAME_LENGTH - 1 <= T::MTU, "un messaggio codificato supera l'MTU del mezzo di trasmissione");
+
+	_mmJTM = &mmJTM;
+
+	setParity(parity);
+
+	_readyLength = 0;
+
+	_framesCorrected = 0;
+	_framesFailed = 0;
+	_bytesCorrected = 0;
+}
+
+/**
+ * @brief Costruttore della classe (parità JK_FEC_PARITY)
+ *
+ * @param mmJTM Mezzo di trasmissione avvolto
+ */
+template <class T>
+JFecAdapter<T>::JFecAdapter(T &mmJTM): JFecAdapter(mmJTM, JK_FEC_PARITY) {}
+
+
+/**
+ * @brief Metodo che preleva il primo messaggio corretto
+ *
+ * @param buffer Buffer in cui salvare il messaggio
+ * @param size Dimensione del buffer
+ *
+ * @return Lunghezza del messaggio (0 se non ci sono messaggi o il messaggio non sta nel buffer)
+ */
+template <class T>
+size_t JFecAdapter<T>::receive(char *buffer, size_t size) {
+
+	if (!available() || size == 0) {
+		return 0;
+	}
+
+	size_t length = _readyLength;
+
+	_readyLength = 0;
+
+	//il messaggio non sta nel buffer
+	if (length >= size) {
+		buffer[0] = 0;
+		return 0;
+	}
+
+	memcpy(buffer, _frame, length);
+	buffer[length] = 0;
+
+	return length;
+}
+
+/**
+ * @brief Metodo che invia il messaggio seguito dalla parità
+ *
+ * @param message Messaggio da inviare
+ * @param length Lunghezza del messaggio
+ */
+template <class T>
+void JFecAdapter<T>::send(char *message, size_t length) {
+
+	//nessun codice
+	if (_parity == 0) {
+		_mmJTM->send(message, length);
+		return;
+	}
+
+	//messaggio troppo lungo per il blocco
+	if (length > MTU) {
+		return;
+	}
+
+	char frame[JK_FEC_FRAME_LENGTH];
+	uint8_t parity[JK_FEC_MAX_PARITY];
+
+	JReedSolomon::encode((const uint8_t *) message, length, parity, _parity);
+
+	memcpy(frame, message, length);
+
+	for (uint8_t i = 0; i < _parity; i++) {
+		frame[length + 2 * i] = hexDigit(parity[i] >> 4);
+		frame[length + 2 * i + 1] = hexDigit(parity[i] & 0x0F);
+	}
+
+	size_t frameLength = length + 2 * _parity;
+
+	frame[frameLength] = 0;
+
+	_mmJTM->send(frame, frameLength);
+}
+
+/**
+ * @brief Metodo che corregge i messaggi arrivati e restituisce la lunghezza del messaggio pronto
+ *
+ * @return Lunghezza del messaggio pronto (0 se non ci sono messaggi)
+ */
+template <class T>
+size_t JFecAdapter<T>::available() {
+
+	//prelevo i messaggi dal mezzo avvolto finchè non ce n'è uno corretto
+	while (_readyLength == 0 && _mmJTM->available()) {
+
+		size_t length = _mmJTM->receive(_frame, JK_FEC_FRAME_LENGTH);
+
+		if (length == 0) {
+			continue;
+		}
+
+		if (_parity == 0) {
+			_readyLength = length;
+			break;
+		}
+
+		//messaggio troppo corto per contenere la parità
+		if (length <= 2 * (size_t) _parity) {
+			_framesFailed++;
+			continue;
+		}
+
+		//converto la parità in byte subito dopo i dati (il blocco è dati + parità)
+		size_t data = length - 2 * _parity;
+
+		for (uint8_t i = 0; i < _parity; i++) {
+			_frame[data + i] = (hexValue(_frame[data + 2 * i]) << 4) | hexValue(_frame[data + 2 * i + 1]);
+		}
+
+		int corrected = JReedSolomon::decode((uint8_t *) _frame, data + _parity, _parity);
+
+		//i messaggi di Jack sono testo ASCII: un carattere di controllo indica una correzione sbagliata
+		for (size_t i = 0; corrected > 0 && i < data; i++) {
+			if ((uint8_t) _frame[i] < 0x20 || (uint8_t) _frame[i] > 0x7E) {
+				corrected = -1;
+			}
+		}
+
+		if (corrected < 0) {
+			_framesFailed++;
+			continue;
+		}
+
+		if (corrected > 0) {
+			_framesCorrected++;
+			_bytesCorrected += corrected;
+		}
+
+		_frame[data] = 0;
+		_readyLength = data;
+	}
+
+	return _readyLength;
+}
+
+
+/**
+ * @brief Metodo che imposta i byte di parità (entrambi i capi devono usare la stessa parità)
+ *
+ * @param parity Byte di parità (arrotondati al numero pari inferiore e limitati a JK_FEC_MAX_PARITY; 0 = nessun codice)
+ */
+template <class T>
+void JFecAdapter<T>::setParity(uint8_t parity) {
+	_parity = (parity > JK_FEC_MAX_PARITY ? JK_FEC_MAX_PARITY : parity) & ~1;
+}
+
+/**
+ * @brief Metodo che restituisce i byte di parità
+ *
+ * @return Byte di parità
+ */
+template <class T>
+uint8_t JFecAdapter<T>::parity() {
+	return _parity;
+}
+
+
+/**
+ * @brief Metodo che restituisce il numero di messaggi ricevuti con errori corretti
+ *
+ * @return Messaggi corretti
+ */
+template <class T>
+unsigned long JFecAdapter<T>::framesCorrected() {
+	return _framesCorrected;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di messaggi scartati perchè non correggibili
+ *
+ * @return Messaggi scartati
+ */
+template <class T>
+unsigned long JFecAdapter<T>::framesFailed() {
+	return _framesFailed;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di byte corretti
+ *
+ * @return Byte corretti
+ */
+template <class T>
+unsigned long JFecAdapter<T>::bytesCorrected() {
+	return _bytesCorrected;
+}
+
+
+//---PRIVATE---
+
+//cifra esadecimale
+template <class T>
+char JFecAdapter<T>::hexDigit(uint8_t value) {
+	return value < 10 ? '0' + value : 'A' + value - 10;
+}
+
+//valore della cifra esadecimale (una cifra non valida è un errore che il codice corregge)
+template <class T>
+uint8_t JFecAdapter<T>::hexValue(char digit) {
+
+	if (digit >= '0' && digit <= '9') {
+		return digit - '0';
+	}
+
+	if (digit >= 'A' && digit <= 'F') {
+		return digit - 'A' + 10;
+	}
+
+	return 0;
+}
+
+
+#endif //JFECADAPTER_H
@@ -0,0 +1,624 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JFragmentAdapter.h
+ * @brief Mezzo di trasmissione che divide i messaggi in frammenti grandi quanto un pacchetto BLE
+ *
+ * Il modulo HM-10 trasporta circa 20 byte per pacchetto: un messaggio inviato per intero viene diviso dal modulo
+ * in modo arbitrario e basta un pacchetto perso per perdere tutto il messaggio. JFragmentAdapter avvolge il mezzo
+ * di trasmissione T e invia ogni messaggio lungo come frammenti numerati, ognuno in un solo pacchetto.
+ *
+ * Frammento: ~ etichetta indice totale dati (etichetta in 'A'..'Z', 'a'..'z', '0'..'9', '-', '_', indice e totale
+ * in 'a'..'z'). Nessun carattere dell'intestazione vale 0 o coincide con i delimitatori dei mezzi di trasmissione
+ * ('<', '>'), per cui i frammenti possono viaggiare su SoftwareSerialJack e FileDescriptorJack.
+ * Conferma dei frammenti: ! etichetta mappa (cifre esadecimali dei frammenti ricevuti).
+ *
+ * Chi riceve riassembla il messaggio e, all'arrivo dell'ultimo frammento, conferma i frammenti ricevuti. Quando
+ * Jack reinvia il messaggio (stesso contenuto) vengono trasmessi solo i frammenti non confermati e l'ultimo: se il
+ * messaggio era già completo l'ultimo frammento lo fa riconsegnare a Jack (e quindi reinviare l'ACK andato perso).
+ * I messaggi più corti di JK_FRAGMENT_MIN_LENGTH (gli ACK) non vengono divisi.
+ *
+ * Entrambi i capi del collegamento devono usare JFragmentAdapter.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef JFRAGMENTADAPTER_H
+#define JFRAGMENTADAPTER_H
+
+#include <Arduino.h>
+#include "JConfig.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Byte trasportati da un pacchetto del collegamento (delimitatori del mezzo di trasmissione compresi)
+ */
+#ifndef JK_FRAGMENT_PACKET
+#define JK_FRAGMENT_PACKET 20 //pacchetto BLE dell'HM-10
+#endif
+/**
+ * @brief Lunghezza sotto la quale i messaggi vengono inviati per intero
+ */
+#ifndef JK_FRAGMENT_MIN_LENGTH
+#define JK_FRAGMENT_MIN_LENGTH JK_MAX_ACK_LENGTH //gli ACK non vengono divisi
+#endif
+/**
+ * @brief Messaggi in riassemblaggio contemporaneamente
+ */
+#ifndef JK_FRAGMENT_SLOTS
+#define JK_FRAGMENT_SLOTS 2 //messaggi in riassemblaggio
+#endif
+/**
+ * @brief Messaggi inviati di cui vengono ricordati i frammenti confermati
+ */
+#ifndef JK_FRAGMENT_ENTRIES
+#define JK_FRAGMENT_ENTRIES JK_BUFFER_SEND_SIZE //un messaggio per slot del buffer di invio
+#endif
+
+/**
+ * @brief Carattere iniziale di un frammento
+ */
+#define JK_FRAGMENT_MARKER '~'
+/**
+ * @brief Carattere iniziale della conferma dei frammenti
+ */
+#define JK_FRAGMENT_ACK_MARKER '!'
+/**
+ * @brief Lunghezza dell'intestazione del frammento (marcatore, etichetta, indice, totale)
+ */
+#define JK_FRAGMENT_HEADER 4
+/**
+ * @brief Byte di messaggio trasportati da un frammento
+ */
+#define JK_FRAGMENT_PAYLOAD (JK_FRAGMENT_PACKET - 2 - JK_FRAGMENT_HEADER)
+/**
+ * @brief Numero massimo di frammenti di un messaggio
+ */
+#define JK_FRAGMENT_MAX_COUNT ((JK_MAX_MESSAGE_LENGTH - 1 + JK_FRAGMENT_PAYLOAD - 1) / JK_FRAGMENT_PAYLOAD)
+/**
+ * @brief Numero di etichette (un'etichetta viene riusata dopo JK_FRAGMENT_TAGS messaggi)
+ */
+#define JK_FRAGMENT_TAGS 64 //caratteri dell'alfabeto delle etichette
+
+static_assert(JK_FRAGMENT_PAYLOAD >= 1, "JK_FRAGMENT_PACKET non contiene l'intestazione del frammento");
+static_assert(JK_FRAGMENT_MAX_COUNT <= 26, "troppi frammenti per messaggio: aumentare JK_FRAGMENT_PACKET");
+static_assert(JK_FRAGMENT_ENTRIES >= 1 && JK_FRAGMENT_ENTRIES < JK_FRAGMENT_TAGS / 2, "JK_FRAGMENT_ENTRIES deve essere minore di JK_FRAGMENT_TAGS / 2");
+
+
+//---JFRAGMENT ADAPTER---
+//mezzo di trasmissione che divide i messaggi lunghi in frammenti e li riassembla (T è il mezzo avvolto, SLOTS i
+//messaggi in riassemblaggio: chi riceve i burst dovrebbe averne almeno JK_BURST_WINDOW)
+template <class T, uint8_t SLOTS = JK_FRAGMENT_SLOTS>
+class JFragmentAdapter {
+
+	static_assert(SLOTS >= 1, "JFragmentAdapter deve avere almeno uno slot di riassemblaggio");
+
+	public:
+
+		JFragmentAdapter(T &mmJTM); //costruttore
+
+		size_t receive(char *buffer, size_t size); //preleva il primo messaggio riassemblato
+		void send(char *message, size_t length); //invia il messaggio (solo i frammenti non confermati se è un reinvio)
+		size_t available(); //elabora i frammenti arrivati e restituisce la lunghezza del messaggio pronto
+
+		//contatori
+		unsigned long fragmentsSent(); //frammenti trasmessi
+		unsigned long fragmentsSkipped(); //frammenti non ritrasmessi perchè già confermati
+
+		/**
+		 * @brief Lunghezza massima di un messaggio riassemblato
+		 */
+		static const size_t MTU = JK_MAX_MESSAGE_LENGTH - 1;
+
+
+	private:
+
+		//messaggio inviato (ne viene ricordata solo l'impronta)
+		struct Outgoing {
+			uint32_t hash; //impronta del messaggio
+			uint16_t length; //lunghezza del messaggio (0 = libero)
+			uint8_t tag; //etichetta
+			uint8_t count; //numero di frammenti
+			uint32_t acked; //frammenti confermati
+			uint8_t age; //invii di altri messaggi dall'ultimo uso
+		};
+
+		//messaggio in riassemblaggio
+		struct Incoming {
+			uint8_t used; //indica se lo slot è occupato
+			uint8_t tag; //etichetta
+			uint8_t count; //numero di frammenti
+			uint8_t delivered; //indica se il messaggio è già stato consegnato
+			uint32_t received; //frammenti ricevuti
+			uint16_t length; //lunghezza del messaggio (nota all'arrivo dell'ultimo frammento)
+			uint8_t age; //frammenti di altri messaggi dall'ultimo uso
+			char message[JK_MAX_MESSAGE_LENGTH]; //messaggio riassemblato
+		};
+
+		void receiveFragment(size_t length); //elabora il frammento contenuto in _frame
+		void receiveAck(size_t length); //elabora la conferma contenuta in _frame
+		void sendFragment(char *message, size_t length, uint8_t tag, uint8_t index, uint8_t count); //trasmette un frammento
+		void sendAck(Incoming &slot); //conferma i frammenti ricevuti
+
+		static char tagCharacter(uint8_t tag); //carattere dell'etichetta
+		static uint8_t tagValue(char c); //etichetta del carattere (JK_FRAGMENT_TAGS se non valido)
+		static uint32_t hash(const char *message, size_t length); //impronta del messaggio (FNV-1a)
+		static uint32_t mask(uint8_t count); //mappa con tutti i frammenti
+
+		T *_mmJTM; //mezzo di trasmissione avvolto
+
+		Outgoing _outgoing[JK_FRAGMENT_ENTRIES]; //messaggi inviati
+		uint8_t _nextTag; //prossima etichetta
+
+		Incoming _incoming[SLOTS]; //messaggi in riassemblaggio
+		char _frame[JK_MAX_MESSAGE_LENGTH]; //ultimo messaggio prelevato dal mezzo avvolto
+
+		char *_ready; //messaggio pronto per Jack (NULL se non c'è)
+		size_t _readyLength; //lunghezza del messaggio pronto
+
+		unsigned long _fragmentsSent;
+		unsigned long _fragmentsSkipped;
+
+};
+
+
+//---IMPLEMENTAZIONE---
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ *
+ * @param mmJTM Mezzo di trasmissione avvolto
+ */
+template <class T, uint8_t SLOTS>
+JFragmentAdapter<T, SLOTS>::JFragmentAdapter(T &mmJTM) {
+
+	static_assert(JK_FRAGMENT_PACKET - 2 <= T::MTU, "JK_FRAGMENT_PACKET supera l'MTU del mezzo di trasmissione");
+	static_assert(JK_MAX_MESSAGE_LENGTH - 1 <= T::MTU, "JK_MAX_MESSAGE_LENGTH supera l'MTU del mezzo di trasmissione");
+
+	_mmJTM = &mmJTM;
+
+	for (uint8_t i = 0; i < JK_FRAGMENT_ENTRIES; i++) {
+		_outgoing[i].length = 0;
+	}
+
+	for (uint8_t i = 0; i < SLOTS; i++) {
+		_incoming[i].used = 0;
+	}
+
+	_nextTag = 0;
+
+	_ready = NULL;
+	_readyLength = 0;
+
+	_fragmentsSent = 0;
+	_fragmentsSkipped = 0;
+}
+
+
+/**
+ * @brief Metodo che preleva il primo messaggio pronto (riassemblato o ricevuto per intero)
+ *
+ * @param buffer Buffer in cui salvare il messaggio
+ * @param size Dimensione del buffer
+ *
+ * @return Lunghezza del messaggio (0 se non ci sono messaggi o il messaggio non sta nel buffer)
+ */
+template <class T, uint8_t SLOTS>
+size_t JFragmentAdapter<T, SLOTS>::receive(char *buffer, size_t size) {
+
+	if (!available() || size == 0) {
+		return 0;
+	}
+
+	size_t length = _readyLength;
+	char *message = _ready;
+
+	_ready = NULL;
+
+	//il messaggio non sta nel buffer
+	if (length >= size) {
+		buffer[0] = 0;
+		return 0;
+	}
+
+	memcpy(buffer, message, length);
+	buffer[length] = 0;
+
+	return length;
+}
+
+/**
+ * @brief Metodo che invia il messaggio
+ *
+ * I messaggi lunghi vengono divisi in frammenti. Se il messaggio è già stato inviato (reinvio di Jack) vengono
+ * trasmessi solo i frammenti non ancora confermati; se erano confermati tutti viene trasmesso l'ultimo frammento.
+ *
+ * @param message Messaggio da inviare
+ * @param length Lunghezza del messaggio
+ */
+template <class T, uint8_t SLOTS>
+void JFragmentAdapter<T, SLOTS>::send(char *message, size_t length) {
+
+	//messaggio corto: lo invio per intero
+	if (length < JK_FRAGMENT_MIN_LENGTH || length > MTU) {
+		_mmJTM->send(message, length);
+		return;
+	}
+
+	uint32_t fingerprint = hash(message, length);
+
+	//cerco il messaggio tra quelli già inviati (altrimenti uso lo slot libero o quello usato meno di recente)
+	Outgoing *entry = NULL;
+	Outgoing *oldest = &_outgoing[0];
+
+	for (uint8_t i = 0; i < JK_FRAGMENT_ENTRIES; i++) {
+
+		Outgoing &current = _outgoing[i];
+
+		if (current.length == length && current.hash == fingerprint) {
+			entry = &current;
+		}
+
+		if (current.length == 0 || (oldest->length && current.age > oldest->age)) {
+			oldest = &current;
+		}
+
+		//invecchio gli altri messaggi
+		if (current.age < 255) {
+			current.age++;
+		}
+	}
+
+	//nuovo messaggio
+	if (entry == NULL) {
+
+		entry = oldest;
+
+		entry->hash = fingerprint;
+		entry->length = length;
+		entry->tag = _nextTag;
+		entry->count = (length + JK_FRAGMENT_PAYLOAD - 1) / JK_FRAGMENT_PAYLOAD;
+		entry->acked = 0;
+
+		_nextTag = (_nextTag + 1) % JK_FRAGMENT_TAGS;
+	}
+
+	entry->age = 0;
+
+	uint32_t all = mask(entry->count);
+
+	//il messaggio è già stato ricevuto: l'ultimo frammento basta per farlo riconsegnare a Jack
+	if ((entry->acked & all) == all) {
+
+		sendFragment(message, length, entry->tag, entry->count - 1, entry->count);
+
+		_fragmentsSkipped += entry->count - 1;
+		return;
+	}
+
+	//trasmetto i frammenti non confermati (l'ultimo sempre: chi riceve risponde con i frammenti che ha, anche se
+	//nel frattempo ha scartato il messaggio)
+	for (uint8_t i = 0; i < entry->count; i++) {
+
+		if ((entry->acked & ((uint32_t) 1 << i)) && i < entry->count - 1) {
+			_fragmentsSkipped++;
+		} else {
+			sendFragment(message, length, entry->tag, i, entry->count);
+		}
+	}
+}
+
+/**
+ * @brief Metodo che elabora i frammenti arrivati e restituisce la lunghezza del messaggio pronto
+ *
+ * @return Lunghezza del messaggio pronto (0 se non ci sono messaggi completi)
+ */
+template <class T, uint8_t SLOTS>
+size_t JFragmentAdapter<T, SLOTS>::available() {
+
+	//prelevo i messaggi dal mezzo avvolto finchè non c'è un messaggio pronto per Jack
+	while (_ready == NULL && _mmJTM->available()) {
+
+		size_t length = _mmJTM->receive(_frame, JK_MAX_MESSAGE_LENGTH);
+
+		if (length == 0) {
+			continue;
+		}
+
+		if (_frame[0] == JK_FRAGMENT_MARKER) {
+			receiveFragment(length);
+		} else if (_frame[0] == JK_FRAGMENT_ACK_MARKER) {
+			receiveAck(length);
+		} else {
+
+			//messaggio non diviso
+			_ready = _frame;
+			_readyLength = length;
+		}
+	}
+
+	return _ready ? _readyLength : 0;
+}
+
+
+/**
+ * @brief Metodo che restituisce il numero di frammenti trasmessi
+ *
+ * @return Frammenti trasmessi
+ */
+template <class T, uint8_t SLOTS>
+unsigned long JFragmentAdapter<T, SLOTS>::fragmentsSent() {
+	return _fragmentsSent;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di frammenti non ritrasmessi perchè già confermati
+ *
+ * @return Frammenti non ritrasmessi
+ */
+template <class T, uint8_t SLOTS>
+unsigned long JFragmentAdapter<T, SLOTS>::fragmentsSkipped() {
+	return _fragmentsSkipped;
+}
+
+
+//---PRIVATE---
+
+//elabora il frammento contenuto in _frame
+template <class T, uint8_t SLOTS>
+void JFragmentAdapter<T, SLOTS>::receiveFragment(size_t length) {
+
+	//intestazione non valida
+	if (length <= JK_FRAGMENT_HEADER) {
+		return;
+	}
+
+	uint8_t tag = tagValue(_frame[1]);
+	uint8_t index = _frame[2] - 'a';
+	uint8_t count = _frame[3] - 'a';
+	size_t payload = length - JK_FRAGMENT_HEADER;
+
+	//solo l'ultimo frammento può essere più corto
+	if (tag >= JK_FRAGMENT_TAGS || count == 0 || count > JK_FRAGMENT_MAX_COUNT || index >= count
+		|| payload > JK_FRAGMENT_PAYLOAD || (index < count - 1 && payload != JK_FRAGMENT_PAYLOAD)) {
+		return;
+	}
+
+	//cerco il messaggio (altrimenti uso lo slot libero o quello usato meno di recente)
+	Incoming *slot = NULL;
+	Incoming *oldest = &_incoming[0];
+
+	for (uint8_t i = 0; i < SLOTS; i++) {
+
+		Incoming &current = _incoming[i];
+
+		if (current.used && current.tag == tag && current.count == count) {
+			slot = &current;
+		}
+
+		if (!current.used || (oldest->used && current.age > oldest->age)) {
+			oldest = &current;
+		}
+
+		if (current.age < 255) {
+			current.age++;
+		}
+	}
+
+	//nuovo messaggio
+	if (slot == NULL) {
+
+		slot = oldest;
+
+		slot->used = 1;
+		slot->tag = tag;
+		slot->count = count;
+		slot->delivered = 0;
+		slot->received = 0;
+		slot->length = 0;
+	}
+
+	slot->age = 0;
+
+	//messaggio già consegnato: la conferma dei frammenti è andata persa (la ripeto), l'ultimo frammento indica
+	//che è andato perso l'ACK di Jack (riconsegno il messaggio)
+	if (slot->delivered) {
+
+		if (index == count - 1) {
+			_ready = slot->message;
+			_readyLength = slot->length;
+		}
+
+		sendAck(*slot);
+
+		return;
+	}
+
+	//salvo il frammento
+	memcpy(slot->message + index * JK_FRAGMENT_PAYLOAD, _frame + JK_FRAGMENT_HEADER, payload);
+
+	slot->received |= (uint32_t) 1 << index;
+
+	if (index == count - 1) {
+		slot->length = index * JK_FRAGMENT_PAYLOAD + payload;
+	}
+
+	//messaggio completo: lo consegno a Jack
+	if (slot->received == mask(count)) {
+
+		slot->message[slot->length] = 0;
+		slot->delivered = 1;
+
+		_ready = slot->message;
+		_readyLength = slot->length;
+
+		sendAck(*slot);
+
+	//ultimo frammento di un messaggio incompleto: indico quali frammenti mancano
+	} else if (index == count - 1) {
+		sendAck(*slot);
+	}
+}
+
+//elabora la conferma contenuta in _frame
+template <class T, uint8_t SLOTS>
+void JFragmentAdapter<T, SLOTS>::receiveAck(size_t length) {
+
+	//intestazione non valida
+	if (length < 3) {
+		return;
+	}
+
+	uint8_t tag = tagValue(_frame[1]);
+
+	if (tag >= JK_FRAGMENT_TAGS) {
+		return;
+	}
+
+	//mappa dei frammenti ricevuti (cifre esadecimali)
+	uint32_t received = 0;
+
+	for (size_t i = 2; i < length && i < 2 + 8; i++) {
+
+		char c = _frame[i];
+
+		if (c >= '0' && c <= '9') {
+			received = received << 4 | (c - '0');
+		} else if (c >= 'a' && c <= 'f') {
+			received = received << 4 | (c - 'a' + 10);
+		} else {
+			return;
+		}
+	}
+
+	for (uint8_t i = 0; i < JK_FRAGMENT_ENTRIES; i++) {
+
+		//la mappa è lo stato corrente di chi riceve (che può aver scartato un messaggio incompleto)
+		if (_outgoing[i].length && _outgoing[i].tag == tag) {
+			_outgoing[i].acked = received & mask(_outgoing[i].count);
+			return;
+		}
+	}
+}
+
+//trasmette un frammento
+template <class T, uint8_t SLOTS>
+void JFragmentAdapter<T, SLOTS>::sendFragment(char *message, size_t length, uint8_t tag, uint8_t index, uint8_t count) {
+
+	char fragment[JK_FRAGMENT_HEADER + JK_FRAGMENT_PAYLOAD];
+
+	size_t offset = (size_t) index * JK_FRAGMENT_PAYLOAD;
+	size_t payload = length - offset < JK_FRAGMENT_PAYLOAD ? length - offset : JK_FRAGMENT_PAYLOAD;
+
+	fragment[0] = JK_FRAGMENT_MARKER;
+	fragment[1] = tagCharacter(tag);
+	fragment[2] = 'a' + index;
+	fragment[3] = 'a' + count;
+
+	memcpy(fragment + JK_FRAGMENT_HEADER, message + offset, payload);
+
+	_mmJTM->send(fragment, JK_FRAGMENT_HEADER + payload);
+
+	_fragmentsSent++;
+}
+
+//conferma i frammenti ricevuti
+template <class T, uint8_t SLOTS>
+void JFragmentAdapter<T, SLOTS>::sendAck(Incoming &slot) {
+
+	static const char digits[] = "0123456789abcdef";
+
+	char ack[2 + 8];
+	uint8_t length = 0;
+
+	ack[length++] = JK_FRAGMENT_ACK_MARKER;
+	ack[length++] = tagCharacter(slot.tag);
+
+	//cifre esadecimali strettamente necessarie per il numero di frammenti
+	for (int8_t shift = ((slot.count + 3) / 4 - 1) * 4; shift >= 0; shift -= 4) {
+		ack[length++] = digits[(slot.received >> shift) & 0x0F];
+	}
+
+	_mmJTM->send(ack, length);
+}
+
+
+//carattere dell'etichetta (alfabeto base64url: nessun delimitatore dei mezzi di trasmissione)
+template <class T, uint8_t SLOTS>
+char JFragmentAdapter<T, SLOTS>::tagCharacter(uint8_t tag) {
+
+	if (tag < 26) {
+		return 'A' + tag;
+	} else if (tag < 52) {
+		return 'a' + tag - 26;
+	} else if (tag < 62) {
+		return '0' + tag - 52;
+	}
+
+	return tag == 62 ? '-' : '_';
+}
+
+//etichetta del carattere (JK_FRAGMENT_TAGS se il carattere non è un'etichetta)
+template <class T, uint8_t SLOTS>
+uint8_t JFragmentAdapter<T, SLOTS>::tagValue(char c) {
+
+	if (c >= 'A' && c <= 'Z') {
+		return c - 'A';
+	} else if (c >= 'a' && c <= 'z') {
+		return c - 'a' + 26;
+	} else if (c >= '0' && c <= '9') {
+		return c - '0' + 52;
+	} else if (c == '-') {
+		return 62;
+	} else if (c == '_') {
+		return 63;
+	}
+
+	return JK_FRAGMENT_TAGS;
+}
+
+//impronta del messaggio (FNV-1a a 32 bit)
+template <class T, uint8_t SLOTS>
+uint32_t JFragmentAdapter<T, SLOTS>::hash(const char *message, size_t length) {
+
+	uint32_t value = 2166136261UL;
+
+	for (size_t i = 0; i < length; i++) {
+		value = (value ^ (uint8_t) message[i]) * 16777619UL;
+	}
+
+	return value;
+}
+
+//mappa con tutti i frammenti
+template <class T, uint8_t SLOTS>
+uint32_t JFragmentAdapter<T, SLOTS>::mask(uint8_t count) {
+	return count >= 32 ? 0xFFFFFFFFUL : ((uint32_t) 1 << count) - 1;
+}
+
+
+#endif //JFRAGMENTADAPTER_H
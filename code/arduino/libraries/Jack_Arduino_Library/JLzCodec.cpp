@@ -0,0 +1,283 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JLzCodec.cpp
+ * @brief Compressione LZ dei messaggi Jack con un dizionario statico condiviso (usata da JCompressAdapter)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <Arduino.h>
+#include "JLzCodec.h"
+
+//sull'AVR il dizionario resta nella flash
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define JLZ_READ(address) pgm_read_byte(address)
+#else
+#define PROGMEM
+#define JLZ_READ(address) (*(address))
+#endif
+
+
+//---DIZIONARIO---
+//frammenti dei messaggi del bracciale e del telefono: i più frequenti in fondo (ogni riferimento costa 2 byte)
+static const char dictionary[] PROGMEM =
+	",\"SMP\":,\"RSD\":,\"POL\":,\"BST\":,\"SMT\":,\"SMW\":,\"EVT\":,\"EVC\":,\"RSL\":{\"CFG\":" //controllo
+	",\"LPH\":,\"LCN\":,\"LMX\":,\"L50\":,\"L99\":{\"TRC\":" //traccia
+	",\"SCL\":,\"SCR\":,\"RSE\":,\"RCV\":" //risposte fasiche
+	",\"CNT\":,\"GMN\":,\"GMX\":,\"TMN\":,\"TMX\":" //riassunti
+	",\"type\":\"ping\"},\"type\":\"live\"}{\"id\":-" //verifiche e stream
+	"{\"id\":,\"type\":\"ack\"}" //ACK
+	"},\"id\":,\"type\":\"data\"},\"TME\":,\"GSR\":{\"val\":{\"TMP\":"; //letture
+
+#define JLZ_DICTIONARY_LENGTH (sizeof(dictionary) - 1)
+
+static_assert(JLZ_DICTIONARY_LENGTH < JK_LZ_MAX_DISTANCE, "il dizionario supera la distanza massima dei riferimenti");
+
+
+//---JLZCODEC---
+
+/**
+ * @brief Metodo che comprime il messaggio
+ *
+ * Ad ogni posizione viene scelto il riferimento più lungo nella storia (dizionario seguito dai caratteri
+ * precedenti del messaggio, al massimo JK_LZ_MAX_DISTANCE caratteri indietro); senza riferimenti di almeno
+ * JK_LZ_MIN_MATCH caratteri viene scritto il carattere.
+ *
+ * @param message Messaggio da comprimere
+ * @param length Lunghezza del messaggio
+ * @param frame Buffer in cui scrivere il messaggio compresso (terminato da 0)
+ * @param size Dimensione del buffer
+ *
+ * @return Lunghezza del messaggio compresso (0 se il messaggio contiene caratteri non ASCII, se non diventa più
+ *         corto o se non sta nel buffer)
+ */
+size_t JLzCodec::compress(const char *message, size_t length, char *frame, size_t size) {
+
+	//il messaggio compresso deve essere più corto dell'originale (terminazione compresa)
+	size_t limit = length < size ? length : size - 1;
+
+	if (size < 2 || limit < 2) {
+		return 0;
+	}
+
+	size_t out = 0;
+	size_t i = 0;
+
+	frame[out++] = JK_LZ_MARKER;
+
+	while (i < length) {
+
+		uint8_t c = message[i];
+
+		//carattere non ASCII: il messaggio non può essere compresso
+		if (c == 0 || c > 0x7F) {
+			return 0;
+		}
+
+		//storia: dizionario (0 ... JLZ_DICTIONARY_LENGTH - 1) seguito dai caratteri già codificati
+		size_t position = JLZ_DICTIONARY_LENGTH + i;
+		size_t first = position > JK_LZ_MAX_DISTANCE ? position - JK_LZ_MAX_DISTANCE : 0;
+		size_t maxMatch = length - i < JK_LZ_MAX_MATCH ? length - i : JK_LZ_MAX_MATCH;
+		size_t bestLength = 0;
+		size_t bestDistance = 0;
+
+		for (size_t j = first; j < position && bestLength < maxMatch; j++) {
+
+			//confronto il primo carattere prima di scorrere il riferimento
+			if ((j < JLZ_DICTIONARY_LENGTH ? dictionaryAt(j) : (uint8_t) message[j - JLZ_DICTIONARY_LENGTH]) != c) {
+				continue;
+			}
+
+			size_t k = 1;
+
+			//il riferimento può sovrapporsi ai caratteri che sta codificando
+			while (k < maxMatch && (j + k < JLZ_DICTIONARY_LENGTH ? dictionaryAt(j + k) : (uint8_t) message[j + k - JLZ_DICTIONARY_LENGTH]) == (uint8_t) message[i + k]) {
+				k++;
+			}
+
+			//a parità di lunghezza tengo il più vicino (ultimo trovato)
+			if (k >= bestLength) {
+				bestLength = k;
+				bestDistance = position - j;
+			}
+		}
+
+		//riferimento
+		if (bestLength >= JK_LZ_MIN_MATCH) {
+
+			if (out + 2 > limit) {
+				return 0;
+			}
+
+			frame[out++] = (char) (0x80 | (bestLength - JK_LZ_MIN_MATCH) << 2 | (bestDistance - 1) >> 7);
+			frame[out++] = (char) (0x80 | ((bestDistance - 1) & 0x7F));
+
+			i += bestLength;
+
+		//letterale
+		} else {
+
+			if (out + 1 > limit) {
+				return 0;
+			}
+
+			frame[out++] = c;
+
+			i++;
+		}
+	}
+
+	//non conviene
+	if (out >= limit) {
+		return 0;
+	}
+
+	frame[out] = 0;
+
+	return out;
+}
+
+/**
+ * @brief Metodo che calcola la lunghezza del messaggio decompresso verificando il messaggio compresso
+ *
+ * Un messaggio compresso è valido se inizia con JK_LZ_MARKER e ogni riferimento è completo e cade nella storia.
+ *
+ * @param frame Messaggio compresso
+ * @param length Lunghezza del messaggio compresso
+ *
+ * @return Lunghezza del messaggio decompresso (0 se il messaggio compresso non è valido)
+ */
+size_t JLzCodec::decodedLength(const char *frame, size_t length) {
+
+	if (length < 2 || frame[0] != JK_LZ_MARKER) {
+		return 0;
+	}
+
+	size_t decoded = 0;
+
+	for (size_t i = 1; i < length; i++) {
+
+		uint8_t c = frame[i];
+
+		//letterale
+		if (c < 0x80) {
+
+			if (c == 0) {
+				return 0;
+			}
+
+			decoded++;
+			continue;
+		}
+
+		//riferimento incompleto
+		if (i + 1 >= length || (uint8_t) frame[i + 1] < 0x80) {
+			return 0;
+		}
+
+		size_t distance = ((size_t) (c & 0x03) << 7 | ((uint8_t) frame[++i] & 0x7F)) + 1;
+
+		//riferimento prima dell'inizio della storia
+		if (distance > JLZ_DICTIONARY_LENGTH + decoded) {
+			return 0;
+		}
+
+		decoded += ((c >> 2) & 0x1F) + JK_LZ_MIN_MATCH;
+	}
+
+	return decoded;
+}
+
+/**
+ * @brief Metodo che decomprime il messaggio
+ *
+ * Il messaggio compresso può stare nello stesso buffer, spostato in avanti di (lunghezza decompressa - lunghezza
+ * compressa) caratteri: i simboli vengono letti prima di essere sovrascritti.
+ *
+ * @param frame Messaggio compresso
+ * @param length Lunghezza del messaggio compresso
+ * @param message Buffer in cui scrivere il messaggio (terminato da 0)
+ * @param size Dimensione del buffer
+ *
+ * @return Lunghezza del messaggio (0 se il messaggio compresso non è valido o il messaggio non sta nel buffer)
+ */
+size_t JLzCodec::decompress(const char *frame, size_t length, char *message, size_t size) {
+
+	size_t decoded = decodedLength(frame, length);
+
+	if (decoded == 0 || decoded >= size) {
+		return 0;
+	}
+
+	size_t out = 0;
+
+	for (size_t i = 1; i < length; i++) {
+
+		uint8_t c = frame[i];
+
+		//letterale
+		if (c < 0x80) {
+			message[out++] = c;
+			continue;
+		}
+
+		size_t distance = ((size_t) (c & 0x03) << 7 | ((uint8_t) frame[++i] & 0x7F)) + 1;
+		size_t count = ((c >> 2) & 0x1F) + JK_LZ_MIN_MATCH;
+		size_t j = JLZ_DICTIONARY_LENGTH + out - distance;
+
+		//parte nel dizionario
+		while (count && j < JLZ_DICTIONARY_LENGTH) {
+			message[out++] = dictionaryAt(j++);
+			count--;
+		}
+
+		//parte nel messaggio (anche sovrapposta ai caratteri che sta scrivendo)
+		while (count--) {
+			message[out++] = message[j++ - JLZ_DICTIONARY_LENGTH];
+		}
+	}
+
+	message[out] = 0;
+
+	return out;
+}
+
+/**
+ * @brief Metodo che restituisce la lunghezza del dizionario
+ *
+ * @return Caratteri del dizionario
+ */
+size_t JLzCodec::dictionaryLength() {
+	return JLZ_DICTIONARY_LENGTH;
+}
+
+
+//---PRIVATE---
+
+//carattere del dizionario (dalla flash sull'AVR)
+uint8_t JLzCodec::dictionaryAt(size_t position) {
+	return JLZ_READ(dictionary + position);
+}
@@ -0,0 +1,93 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JLzCodec.h
+ * @brief Compressione LZ dei messaggi Jack con un dizionario statico condiviso (usata da JCompressAdapter)
+ *
+ * Le chiavi dei messaggi ("val", "id", "type", "data", "TMP", "GSR", "TME", ...) occupano più di metà di ogni
+ * messaggio: il codificatore cerca le ripetizioni più lunghe nel dizionario statico seguito dalla parte del
+ * messaggio già codificata (LZ77 con il dizionario come storia iniziale) e le sostituisce con un riferimento.
+ *
+ * Messaggio compresso: JK_LZ_MARKER seguito da simboli:
+ * - letterale: un carattere ASCII (0x01 - 0x7F), copiato così com'è
+ * - riferimento: due byte con il bit più alto a 1, 1LLLLLDD 1DDDDDDD (L = lunghezza - JK_LZ_MIN_MATCH,
+ *   D = distanza - 1 nella storia: dizionario seguito dai caratteri già decodificati)
+ * Nessun byte del messaggio compresso vale 0 o coincide con i delimitatori dei mezzi di trasmissione ('<', '>'),
+ * che sono ASCII. I messaggi con caratteri non ASCII non vengono compressi.
+ *
+ * Il codificatore non usa RAM oltre allo stack (ricerca esaustiva sulla storia, limitata a JK_LZ_MAX_DISTANCE);
+ * il decodificatore scrive direttamente nel buffer di destinazione. Il dizionario sta nella flash sull'AVR.
+ * Il dizionario è condiviso tra i due capi: cambiarlo richiede una nuova JK_LZ_VERSION.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef JLZCODEC_H
+#define JLZCODEC_H
+
+#include <Arduino.h>
+
+
+//---COSTANTI---
+/**
+ * @brief Versione del formato e del dizionario (concordata dai due capi)
+ */
+#define JK_LZ_VERSION 1
+/**
+ * @brief Primo carattere di un messaggio compresso (i messaggi JSON iniziano con '{')
+ */
+#define JK_LZ_MARKER '~'
+/**
+ * @brief Lunghezza minima di un riferimento (più corto di 3 caratteri non conviene)
+ */
+#define JK_LZ_MIN_MATCH 3
+/**
+ * @brief Lunghezza massima di un riferimento
+ */
+#define JK_LZ_MAX_MATCH (JK_LZ_MIN_MATCH + 31) //5 bit di lunghezza
+/**
+ * @brief Distanza massima di un riferimento (caratteri della storia)
+ */
+#define JK_LZ_MAX_DISTANCE 512 //9 bit di distanza
+
+
+//---JLZCODEC---
+//compressione LZ con dizionario statico (solo metodi statici)
+class JLzCodec {
+
+	public:
+
+		static size_t compress(const char *message, size_t length, char *frame, size_t size); //comprime il messaggio (0 se non conviene o non sta nel buffer)
+		static size_t decodedLength(const char *frame, size_t length); //lunghezza del messaggio decompresso (0 se il messaggio compresso non è valido)
+		static size_t decompress(const char *frame, size_t length, char *message, size_t size); //decomprime il messaggio (0 se non è valido o non sta nel buffer)
+
+		static size_t dictionaryLength(); //lunghezza del dizionario
+
+	private:
+
+		static uint8_t dictionaryAt(size_t position); //carattere del dizionario
+};
+
+
+#endif //JLZCODEC_H
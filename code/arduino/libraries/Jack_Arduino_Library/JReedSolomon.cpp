@@ -0,0 +1,287 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JReedSolomon.cpp
+ * @brief Codice Reed-Solomon sistematico su GF(256) usato da JFecAdapter
+ *
+ * Campo generato da x^8 + x^4 + x^3 + x^2 + 1 (0x11D), elemento primitivo α = 2, radici del generatore
+ * α^0 ... α^(parity - 1). Il byte i del blocco lungo n è il coefficiente di x^(n - 1 - i).
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <Arduino.h>
+#include "JReedSolomon.h"
+
+
+//---COSTANTI INTERNE---
+#define JRS_PRIMITIVE 0x1D //x^8 + x^4 + x^3 + x^2 + 1 (senza x^8)
+#define JRS_ALPHA 0x02 //elemento primitivo
+#define JRS_ALPHA_INVERSE 0x8E //inverso dell'elemento primitivo
+
+
+//---JREEDSOLOMON---
+
+/**
+ * @brief Metodo che calcola i byte di parità dei dati
+ *
+ * @param data Dati
+ * @param length Lunghezza dei dati (length + paritySize <= 255)
+ * @param parity Buffer in cui scrivere la parità (paritySize byte)
+ * @param paritySize Byte di parità (al massimo JK_FEC_MAX_PARITY)
+ */
+void JReedSolomon::encode(const uint8_t *data, size_t length, uint8_t *parity, uint8_t paritySize) {
+
+	//generatore: (x - α^0)(x - α^1)...(x - α^(paritySize - 1)), coefficienti dal grado più alto
+	uint8_t generator[JK_FEC_MAX_PARITY + 1];
+	uint8_t root = 1;
+
+	generator[0] = 1;
+
+	for (uint8_t i = 0; i < paritySize; i++) {
+
+		generator[i + 1] = 0;
+
+		for (uint8_t j = i + 1; j > 0; j--) {
+			generator[j] ^= multiply(generator[j - 1], root);
+		}
+
+		root = multiply(root, JRS_ALPHA);
+	}
+
+	//resto della divisione di dati * x^paritySize per il generatore
+	memset(parity, 0, paritySize);
+
+	for (size_t i = 0; i < length; i++) {
+
+		uint8_t feedback = data[i] ^ parity[0];
+
+		memmove(parity, parity + 1, paritySize - 1);
+		parity[paritySize - 1] = 0;
+
+		if (feedback) {
+			for (uint8_t j = 0; j < paritySize; j++) {
+				parity[j] ^= multiply(generator[j + 1], feedback);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Metodo che corregge il blocco (dati seguiti dalla parità)
+ *
+ * @param codeword Blocco da correggere (corretto sul posto)
+ * @param length Lunghezza del blocco, parità compresa (al massimo 255)
+ * @param paritySize Byte di parità in coda al blocco
+ *
+ * @return Byte corretti (0 se il blocco è integro, -1 se gli errori sono più di paritySize / 2)
+ */
+int JReedSolomon::decode(uint8_t *codeword, size_t length, uint8_t paritySize) {
+
+	//sindromi: S_i = c(α^i)
+	uint8_t syndromes[JK_FEC_MAX_PARITY];
+	uint8_t errors = 0;
+	uint8_t root = 1;
+
+	for (uint8_t i = 0; i < paritySize; i++) {
+
+		uint8_t value = 0;
+
+		for (size_t j = 0; j < length; j++) {
+			value = multiply(value, root) ^ codeword[j];
+		}
+
+		syndromes[i] = value;
+		errors |= value;
+
+		root = multiply(root, JRS_ALPHA);
+	}
+
+	//blocco integro
+	if (!errors) {
+		return 0;
+	}
+
+	//polinomio locatore degli errori (Berlekamp-Massey, coefficienti dal grado 0)
+	uint8_t locator[JK_FEC_MAX_PARITY + 1];
+	uint8_t previous[JK_FEC_MAX_PARITY + 1];
+	uint8_t saved[JK_FEC_MAX_PARITY + 1];
+
+	memset(locator, 0, sizeof(locator));
+	memset(previous, 0, sizeof(previous));
+
+	locator[0] = 1;
+	previous[0] = 1;
+
+	uint8_t degree = 0; //grado del locatore (numero di errori)
+	uint8_t shift = 1; //passi dall'ultimo aggiornamento di previous
+	uint8_t lastDiscrepancy = 1;
+
+	for (uint8_t r = 0; r < paritySize; r++) {
+
+		//discrepanza
+		uint8_t discrepancy = syndromes[r];
+
+		for (uint8_t i = 1; i <= degree; i++) {
+			discrepancy ^= multiply(locator[i], syndromes[r - i]);
+		}
+
+		if (discrepancy == 0) {
+			shift++;
+			continue;
+		}
+
+		uint8_t factor = multiply(discrepancy, inverse(lastDiscrepancy));
+
+		if (2 * degree <= r) {
+
+			memcpy(saved, locator, sizeof(locator));
+
+			for (uint8_t i = 0; i + shift <= paritySize; i++) {
+				locator[i + shift] ^= multiply(factor, previous[i]);
+			}
+
+			degree = r + 1 - degree;
+			memcpy(previous, saved, sizeof(previous));
+			lastDiscrepancy = discrepancy;
+			shift = 1;
+
+		} else {
+
+			for (uint8_t i = 0; i + shift <= paritySize; i++) {
+				locator[i + shift] ^= multiply(factor, previous[i]);
+			}
+
+			shift++;
+		}
+	}
+
+	//troppi errori (o sindromi non nulle senza locatore)
+	if (degree == 0 || 2 * degree > paritySize) {
+		return -1;
+	}
+
+	//valutatore degli errori: Ω(x) = S(x) Λ(x) mod x^paritySize
+	uint8_t evaluator[JK_FEC_MAX_PARITY];
+
+	for (uint8_t i = 0; i < paritySize; i++) {
+
+		evaluator[i] = 0;
+
+		for (uint8_t j = 0; j <= i && j <= degree; j++) {
+			evaluator[i] ^= multiply(locator[j], syndromes[i - j]);
+		}
+	}
+
+	//derivata formale del locatore (solo i termini di grado dispari)
+	uint8_t derivative[JK_FEC_MAX_PARITY];
+
+	for (uint8_t i = 0; i < degree; i++) {
+		derivative[i] = (i % 2 == 0) ? locator[i + 1] : 0;
+	}
+
+	//ricerca delle radici (Chien) e valore degli errori (Forney): il byte i ha locatore X = α^(length - 1 - i)
+	uint8_t found = 0;
+	uint8_t position = 1; //X
+	uint8_t positionInverse = 1; //X^-1
+
+	for (size_t k = 0; k < length; k++) {
+
+		size_t i = length - 1 - k;
+
+		if (evaluate(locator, degree, positionInverse) == 0) {
+
+			uint8_t denominator = evaluate(derivative, degree - 1, positionInverse);
+
+			if (denominator == 0) {
+				return -1;
+			}
+
+			codeword[i] ^= multiply(multiply(position, evaluate(evaluator, paritySize - 1, positionInverse)), inverse(denominator));
+			found++;
+		}
+
+		position = multiply(position, JRS_ALPHA);
+		positionInverse = multiply(positionInverse, JRS_ALPHA_INVERSE);
+	}
+
+	//le radici devono essere tutte nel blocco
+	if (found != degree) {
+		return -1;
+	}
+
+	return found;
+}
+
+
+//---PRIVATE---
+
+//prodotto in GF(256) (moltiplicazione con riduzione modulo il polinomio primitivo)
+uint8_t JReedSolomon::multiply(uint8_t a, uint8_t b) {
+
+	uint8_t result = 0;
+
+	while (b) {
+
+		if (b & 1) {
+			result ^= a;
+		}
+
+		a = (uint8_t) (a << 1) ^ ((a & 0x80) ? JRS_PRIMITIVE : 0);
+		b >>= 1;
+	}
+
+	return result;
+}
+
+//inverso in GF(256): a^254
+uint8_t JReedSolomon::inverse(uint8_t a) {
+
+	uint8_t result = 1;
+	uint8_t exponent = 254;
+
+	while (exponent) {
+
+		if (exponent & 1) {
+			result = multiply(result, a);
+		}
+
+		a = multiply(a, a);
+		exponent >>= 1;
+	}
+
+	return result;
+}
+
+//valore del polinomio in x (coefficienti dal grado 0, schema di Horner)
+uint8_t JReedSolomon::evaluate(const uint8_t *polynomial, uint8_t degree, uint8_t x) {
+
+	uint8_t result = 0;
+
+	for (int i = degree; i >= 0; i--) {
+		result = multiply(result, x) ^ polynomial[i];
+	}
+
+	return result;
+}
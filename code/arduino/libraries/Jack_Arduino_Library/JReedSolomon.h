@@ -0,0 +1,70 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JReedSolomon.h
+ * @brief Codice Reed-Solomon sistematico su GF(256) usato da JFecAdapter
+ *
+ * Il codice aggiunge parity byte di parità a un blocco di al massimo 255 - parity byte e corregge fino a
+ * parity / 2 byte errati (dati o parità). Le operazioni sul campo sono calcolate senza tabelle (nessun byte di
+ * RAM oltre allo stack): la decodifica di un messaggio di lunghezza massima richiede pochi millisecondi
+ * sull'ATmega ed è eseguita solo se il blocco contiene errori.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef JREEDSOLOMON_H
+#define JREEDSOLOMON_H
+
+#include <Arduino.h>
+
+
+//---COSTANTI---
+/**
+ * @brief Numero massimo di byte di parità (dimensiona i polinomi sullo stack)
+ */
+#ifndef JK_FEC_MAX_PARITY
+#define JK_FEC_MAX_PARITY 16 //corregge fino a 8 byte
+#endif
+
+static_assert(JK_FEC_MAX_PARITY >= 2 && JK_FEC_MAX_PARITY <= 64, "JK_FEC_MAX_PARITY deve essere compreso tra 2 e 64");
+
+
+//---JREEDSOLOMON---
+//codice Reed-Solomon (solo metodi statici)
+class JReedSolomon {
+
+	public:
+
+		static void encode(const uint8_t *data, size_t length, uint8_t *parity, uint8_t paritySize); //calcola la parità dei dati
+		static int decode(uint8_t *codeword, size_t length, uint8_t paritySize); //corregge il blocco (byte corretti, -1 se non correggibile)
+
+	private:
+
+		static uint8_t multiply(uint8_t a, uint8_t b); //prodotto in GF(256)
+		static uint8_t inverse(uint8_t a); //inverso in GF(256)
+		static uint8_t evaluate(const uint8_t *polynomial, uint8_t degree, uint8_t x); //valore del polinomio (coefficienti dal grado 0)
+};
+
+
+#endif //JREEDSOLOMON_H
@@ -0,0 +1,175 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JTrace.cpp
+ * @brief Traccia delle durate delle fasi del loop (ricezione, parsing, invio e fasi dell'utente)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <Arduino.h>
+#include "JTrace.h"
+
+#if JK_TRACE
+
+
+//---VARIABILI STATICHE---
+JTraceRecord JTrace::_records[JK_TRACE_SIZE];
+uint8_t JTrace::_next = 0;
+uint8_t JTrace::_size = 0;
+unsigned long JTrace::_count[JK_TRACE_PHASES];
+unsigned long JTrace::_max[JK_TRACE_PHASES];
+
+
+//---JTRACE---
+
+/**
+ * @brief Metodo che registra l'esecuzione di una fase (sovrascrive la più vecchia se il buffer è pieno)
+ *
+ * @param phase Fase (minore di JK_TRACE_PHASES)
+ * @param start Inizio dell'esecuzione (micros())
+ */
+void JTrace::record(uint8_t phase, unsigned long start) {
+
+	if (phase >= JK_TRACE_PHASES) {
+		return;
+	}
+
+	unsigned long duration = micros() - start;
+
+	_records[_next].start = start;
+	_records[_next].duration = duration;
+	_records[_next].phase = phase;
+
+	_next = (_next + 1) % JK_TRACE_SIZE;
+
+	if (_size < JK_TRACE_SIZE) {
+		_size++;
+	}
+
+	_count[phase]++;
+
+	if (duration > _max[phase]) {
+		_max[phase] = duration;
+	}
+}
+
+/**
+ * @brief Metodo che riassume le durate di una fase
+ *
+ * I percentili (nearest rank) sono calcolati sulle esecuzioni della fase ancora presenti nel buffer: il calcolo
+ * ordina una copia delle durate sullo stack (JK_TRACE_SIZE * sizeof(unsigned long) byte) e va eseguito solo
+ * quando la traccia viene letta.
+ *
+ * @param phase Fase
+ * @param summary Riassunto da riempire
+ *
+ * @return 1 se la fase è stata eseguita dall'ultimo azzeramento, 0 altrimenti
+ */
+uint8_t JTrace::summary(uint8_t phase, JTraceSummary &summary) {
+
+	memset(&summary, 0, sizeof(summary));
+
+	if (phase >= JK_TRACE_PHASES || _count[phase] == 0) {
+		return 0;
+	}
+
+	summary.count = _count[phase];
+	summary.max = _max[phase];
+
+	//durate della fase nel buffer (ordinamento per inserimento: al massimo JK_TRACE_SIZE elementi)
+	unsigned long durations[JK_TRACE_SIZE];
+	uint8_t samples = 0;
+
+	for (uint8_t i = 0; i < _size; i++) {
+
+		if (_records[i].phase != phase) {
+			continue;
+		}
+
+		unsigned long duration = _records[i].duration;
+		uint8_t j = samples;
+
+		for (; j > 0 && durations[j - 1] > duration; j--) {
+			durations[j] = durations[j - 1];
+		}
+
+		durations[j] = duration;
+		samples++;
+	}
+
+	summary.samples = samples;
+
+	if (samples) {
+		summary.p50 = durations[((unsigned int) samples * 50 + 99) / 100 - 1];
+		summary.p90 = durations[((unsigned int) samples * 90 + 99) / 100 - 1];
+		summary.p99 = durations[((unsigned int) samples * 99 + 99) / 100 - 1];
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di esecuzioni nel buffer
+ *
+ * @return Esecuzioni nel buffer (al massimo JK_TRACE_SIZE)
+ */
+uint8_t JTrace::size() {
+	return _size;
+}
+
+/**
+ * @brief Metodo che restituisce un'esecuzione del buffer
+ *
+ * @param index Indice dell'esecuzione (0 = la più vecchia, minore di size())
+ *
+ * @return Esecuzione (fase JK_TRACE_PHASES se l'indice non è valido)
+ */
+JTraceRecord JTrace::get(uint8_t index) {
+
+	JTraceRecord record = {0, 0, JK_TRACE_PHASES};
+
+	if (index < _size) {
+		record = _records[(_next + JK_TRACE_SIZE - _size + index) % JK_TRACE_SIZE];
+	}
+
+	return record;
+}
+
+/**
+ * @brief Metodo che svuota il buffer e azzera contatori e massimi
+ */
+void JTrace::reset() {
+
+	_next = 0;
+	_size = 0;
+
+	for (uint8_t i = 0; i < JK_TRACE_PHASES; i++) {
+		_count[i] = 0;
+		_max[i] = 0;
+	}
+}
+
+
+#endif //JK_TRACE
@@ -0,0 +1,163 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JTrace.h
+ * @brief Traccia delle durate delle fasi del loop (ricezione, parsing, invio e fasi dell'utente)
+ *
+ * Ogni fase racchiusa in JK_TRACE_SCOPE(fase) registra inizio e durata (micros()) in un buffer circolare di
+ * JK_TRACE_SIZE elementi; per ogni fase vengono inoltre tenuti il numero di esecuzioni e la durata massima
+ * dall'ultimo azzeramento. summary() calcola i percentili sulle esecuzioni ancora presenti nel buffer.
+ *
+ * La traccia è disattivata di default (JK_TRACE 0): la classe non viene compilata e JK_TRACE_SCOPE non genera
+ * codice. Jack viene istanziato anche in Jack.cpp, per cui JK_TRACE va impostato qui o con -DJK_TRACE=1 per
+ * tutta la build (non con un #define prima di #include <Jack.h>).
+ *
+ * Le fasi da 0 a JK_TRACE_USER - 1 sono di Jack, le successive (fino a JK_TRACE_PHASES - 1) dell'utente.
+ * La traccia non è thread-safe (come il resto di Jack).
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef JTRACE_H
+#define JTRACE_H
+
+#include <Arduino.h>
+
+
+//---COSTANTI---
+/**
+ * @brief Abilitazione della traccia (0 = nessun codice e nessuna RAM)
+ */
+#ifndef JK_TRACE
+#define JK_TRACE 0 //traccia disattivata
+#endif
+/**
+ * @brief Numero di esecuzioni memorizzate nel buffer circolare
+ */
+#ifndef JK_TRACE_SIZE
+#define JK_TRACE_SIZE 16 //9 byte ciascuna sull'ATmega
+#endif
+/**
+ * @brief Numero di fasi (quelle di Jack più quelle dell'utente)
+ */
+#ifndef JK_TRACE_PHASES
+#define JK_TRACE_PHASES 8 //fasi
+#endif
+
+//FASI DI JACK
+/**
+ * @brief Fase di ricezione (prelievo del messaggio dal mezzo di trasmissione)
+ */
+#define JK_TRACE_RECEIVE 0
+/**
+ * @brief Fase di parsing (parsing del messaggio ricevuto, handler e ACK)
+ */
+#define JK_TRACE_PARSE 1
+/**
+ * @brief Fase di invio (ogni messaggio passato al mezzo di trasmissione: dati, live, ACK e verifiche)
+ */
+#define JK_TRACE_TRANSMIT 2
+/**
+ * @brief Prima fase libera per l'utente
+ */
+#define JK_TRACE_USER 3
+
+static_assert(JK_TRACE_SIZE >= 1 && JK_TRACE_SIZE <= 255, "JK_TRACE_SIZE deve essere compreso tra 1 e 255 (indici uint8_t)");
+static_assert(JK_TRACE_PHASES > JK_TRACE_USER && JK_TRACE_PHASES <= 255, "JK_TRACE_PHASES deve lasciare almeno una fase all'utente");
+
+
+#if JK_TRACE
+
+//---JTRACE RECORD---
+//esecuzione di una fase
+struct JTraceRecord {
+	unsigned long start; //inizio (micros())
+	unsigned long duration; //durata (microsecondi)
+	uint8_t phase; //fase
+};
+
+
+//---JTRACE SUMMARY---
+//riassunto delle durate di una fase (microsecondi)
+struct JTraceSummary {
+	unsigned long count; //esecuzioni dall'ultimo azzeramento
+	unsigned long max; //durata massima dall'ultimo azzeramento
+	uint8_t samples; //esecuzioni nel buffer (su cui sono calcolati i percentili)
+	unsigned long p50; //mediana
+	unsigned long p90; //90° percentile
+	unsigned long p99; //99° percentile
+};
+
+
+//---JTRACE---
+//traccia delle fasi (solo metodi statici)
+class JTrace {
+
+	public:
+
+		static void record(uint8_t phase, unsigned long start); //registra l'esecuzione iniziata a start e finita ora
+
+		static uint8_t summary(uint8_t phase, JTraceSummary &summary); //riassunto della fase (0 se non è mai stata eseguita)
+		static uint8_t size(); //esecuzioni nel buffer
+		static JTraceRecord get(uint8_t index); //esecuzione del buffer (0 = la più vecchia)
+		static void reset(); //svuota il buffer e azzera contatori e massimi
+
+	private:
+
+		static JTraceRecord _records[JK_TRACE_SIZE]; //buffer circolare
+		static uint8_t _next; //prossimo elemento da scrivere
+		static uint8_t _size; //esecuzioni nel buffer
+		static unsigned long _count[JK_TRACE_PHASES]; //esecuzioni per fase
+		static unsigned long _max[JK_TRACE_PHASES]; //durata massima per fase
+};
+
+
+//---JTRACE SCOPE---
+//registra la durata del blocco in cui è dichiarato
+class JTraceScope {
+
+	public:
+
+		explicit JTraceScope(uint8_t phase) : _start(micros()), _phase(phase) {}
+		~JTraceScope() { JTrace::record(_phase, _start); }
+
+	private:
+
+		unsigned long _start; //inizio della fase
+		uint8_t _phase; //fase
+};
+
+/**
+ * @brief Registra la durata del blocco corrente come esecuzione della fase
+ */
+#define JK_TRACE_SCOPE(phase) JTraceScope _jkTraceScope(phase)
+
+#else
+
+#define JK_TRACE_SCOPE(phase)
+
+#endif //JK_TRACE
+
+
+#endif //JTRACE_H
@@ -21,6 +21,9 @@
  * @file JTransmissionMethod.h
  * @brief Classe astratta (interfaccia) contenente i metodi da implementare per poter utilizzare il mezzo di comunicazione
  * 
+ * I mezzi di trasmissione vengono passati a BasicJack come parametro del template (senza funzioni virtuali).
+ * L'interfaccia serve per scegliere il mezzo a run-time: JTransmissionAdapter la implementa per qualsiasi mezzo.
+ * 
  * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
  * @version 1.0
  * 
@@ -36,6 +39,11 @@
 class JTransmissionMethod {
 
 	public:
+
+      /**
+       * @brief Distruttore virtuale (permette di eliminare il mezzo di trasmissione tramite l'interfaccia)
+       */
+		virtual ~JTransmissionMethod() {}
 		
       /**
        * @brief Metodo usato per prelevare il primo messaggio disponibile
@@ -45,20 +53,58 @@ class JTransmissionMethod {
        * 
        * @return Lunghezza del messaggio
        */
-		virtual size_t receive(char *buffer, size_t size); //deve restituire il messaggio da passare a Jack
+		virtual size_t receive(char *buffer, size_t size) = 0; //deve restituire il messaggio da passare a Jack
       /**
        * @brief Metodo usato per inviare un messaggio nel mezzo di comunicazione
        * 
        * @param message Il messaggio da inviare
        * @param length La lunghezza del messaggio
        */
-		virtual void send(char *message, size_t length); //invia il messaggio
+		virtual void send(char *message, size_t length) = 0; //invia il messaggio
 
       /**
        * @brief Metodo che ritorna il numero di caratteri disponibili e pronti per essere prelevati
        * @return Il numero di caratteri disponibili
        */
-		virtual size_t available(); //restituisce true se ci sono dati da ricevere nel buffer
+		virtual size_t available() = 0; //restituisce true se ci sono dati da ricevere nel buffer
+
+      /**
+       * @brief Lunghezza massima di un messaggio ricevuto tramite l'interfaccia (come SoftwareSerialJack con il buffer di default)
+       */
+		static const size_t MTU = 253;
+
+};
+
+
+//---JTRANSMISSION ADAPTER---
+//adatta un mezzo di trasmissione usato come parametro del template all'interfaccia JTransmissionMethod
+template <class T>
+class JTransmissionAdapter : public JTransmissionMethod {
+
+	public:
+
+      /**
+       * @brief Costruttore della classe
+       * 
+       * @param mmJTM Mezzo di trasmissione da adattare
+       */
+		JTransmissionAdapter(T &mmJTM) {
+			_mmJTM = &mmJTM;
+		}
+
+		size_t receive(char *buffer, size_t size) { return _mmJTM->receive(buffer, size); } //preleva il messaggio
+		void send(char *message, size_t length) { _mmJTM->send(message, length); } //invia il messaggio
+		size_t available() { return _mmJTM->available(); } //caratteri disponibili
+
+      /**
+       * @brief Lunghezza massima di un messaggio del mezzo adattato
+       */
+		static const size_t MTU = T::MTU;
+
+
+	private:
+
+		T *_mmJTM; //mezzo di trasmissione adattato
 
 };
 
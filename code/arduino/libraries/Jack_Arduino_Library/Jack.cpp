@@ -31,272 +31,120 @@
 #include <Arduino.h>
 #include "Jack.h"
 
-//---JACK---
-
-//---PUBLIC---
+//---JFRAME---
 
+//serializzazione
 /**
- * @brief Costruttore della classe
+ * @brief Metodo che serializza il messaggio dati nel buffer in un solo passaggio (senza misurarlo e senza allocazioni)
  * 
- * @param mmJTM Istanza della classe che controlla il mezzo di comunicazione
- * @param onReceive Handler evento di ricezione di un nuovo messaggio
- * @param onReceiveAck Handler evento di ricezione della conferma di un messaggio inviato
- * @param getMessageID Funzione che deve restituire un long univoco
- * @param timerSendMessage Timer che controlla l'invio dei messaggi (millisecondi)
- * @param timerPolling Timer che controlla il polling del mezzo di comunicazione (millisecondi)
- */
-Jack::Jack(JTransmissionMethod &mmJTM, void (*onReceive)(JData &, long), void (*onReceiveAck)(long), long (*getMessageID)(), long timerSendMessage, long timerPolling) { //tempo per il reinvio
-	
-	//salvo il mezzo di trasmissione
-	_mmJTM = &mmJTM;
-
-	//imposto i valori dei timer
-	_timerSendMessage = timerSendMessage;
-	_timerPolling = timerPolling;
-
-	//salvo i puntatori a funzioni
-	_onReceive = onReceive;
-	_onReceiveAck = onReceiveAck;
-	_getMessageID = getMessageID;
-
-	//inizializzo le variabili
-	_timeLastPolling = 0;
-	_timeLastSend = 0;
-
-
-	//costruisco i contenitori
-	_messageBuffer = new HashMap<long, char *>();
-	
-}
-
-/**
- * @brief Costruttore della classe (ridotto)
+ * @param messageJData Messaggio da serializzare
+ * @param id ID del messaggio
+ * @param buffer Buffer in cui scrivere il messaggio
+ * @param size Dimensione del buffer
+ * @param type Tipologia del messaggio (JK_MESSAGE_TYPE_DATA o JK_MESSAGE_TYPE_LIVE)
  * 
- * @param mmJTM Istanza della classe che controlla il mezzo di comunicazione
- * @param onReceive Handler evento di ricezione di un nuovo messaggio
- * @param onReceiveAck Handler evento di ricezione della conferma di un messaggio inviato
- * @param getMessageID Funzione che deve restituire un long univoco
- */
-Jack::Jack(JTransmissionMethod &mmJTM, void (*onReceive)(JData &, long), void (*onReceiveAck)(long), long (*getMessageID)()): Jack(mmJTM, onReceive, onReceiveAck, getMessageID, JK_TIMER_RESEND_MESSAGE, JK_TIMER_POLLING) {} //costruttore con mmJTM, funzione onReceive e getMessageID
-
-
-//distruttore
-/**
- * @brief Distruttore della classe
+ * @return Lunghezza del messaggio (0 se non sta nel buffer o se il messaggio non ha ottenuto un blocco dal pool)
  */
-Jack::~Jack() {
+size_t JFrame::printData(JData &messageJData, long id, char *buffer, size_t size, const char *type) {
 
-	//elimino i buffer
-	delete _messageBuffer; //buffer per i messaggi da inviare
-}
+	//prelevo la root del messaggio
+	JsonObject *root = messageJData.getRoot();
 
-//metodi per abilitare/disabilitare il polling
-/**
- * @brief Metodo che avvia il polling del mezzo di comunicazione
- */
-void Jack::start() { //avvia il polling
-	_pollingEnabled = 1;
-}
+	//il messaggio non ha un buffer (pool esaurito)
+	if (!root->success()) {
+		return 0;
+	}
 
-/**
- * @brief Metodo che ferma il polling del mezzo di comunicazione
- */
-void Jack::stop() { //stoppa il polling
-	_pollingEnabled = 0;
-}
-		
+	//aggiungo id e la tipologia del messaggio
+	(*root)[JK_MESSAGE_ID] = id; //id del messaggio da confermare
+	(*root)[JK_MESSAGE_TYPE] = type; //messaggio dati (con o senza conferma)
 
-//svuota il buffer di invio
-/**
- * @brief Metodo che svuota il buffer contenente i messaggi ancora da inviare o non confermati
- */
-void Jack::flushBufferSend() { //cancella i buffer contenente i messaggi da inviare
+	//scrivo il messaggio (viene troncato se il buffer  troppo piccolo)
+	size_t length = (*root).printTo(buffer, size);
 
-	//elimino buffer
-	delete _messageBuffer;
+	//se il messaggio riempie il buffer potrebbe essere stato troncato
+	if (length + 1 >= size) {
+		return 0;
+	}
 
-	//creo il nuovo buffer
-	_messageBuffer = new HashMap<long, char *>();
+	return length;
 }
 
-
-//loop function
 /**
- * @brief Funzione che simula un thread per la gestione dei timer
+ * @brief Metodo che serializza il messaggio ACK nel buffer in un solo passaggio (senza ArduinoJson)
+ * 
+ * @param id ID del messaggio da confermare
+ * @param buffer Buffer in cui scrivere il messaggio
+ * @param size Dimensione del buffer
+ * 
+ * @return Lunghezza del messaggio (0 se non sta nel buffer)
  */
-void Jack::loop() { //luppa per simulare il thread
-
-	//se il polling  abilitato 
-
-	if (_pollingEnabled && millis() - _timeLastPolling >= _timerPolling) {
-
-		//ultimo polling
-		_timeLastPolling = millis();
-
-		//prelevo la lunghezza del messaggio
-		int length = _mmJTM->available();
-
-		//verifico se ci sono messaggi disponibili e ne salvo la lunghezza
-		if (length) {
+size_t JFrame::printAck(long id, char *buffer, size_t size) {
 
-			//creo il buffer che conterr il messaggio ricevuto da mmJTM
-			char message[length +1];
-
-			//recupero il messaggio e verifico se non  nullo
-			if (_mmJTM->receive(message, length +1)) {
-
-				//il messaggio  valido
-				execute(message);
-			}
-
-		}
-	
-		//se ci sono messaggi da inviare ed  passato il tempo di pausa tra un invio e l'altro
-		if (millis() - _timeLastSend >= _timerSendMessage && _messageBuffer->moveToFirst()) { //invio messaggi
-
-			//ultimo invio
-			_timeLastSend = millis();
-			
-			//scorro tutti i messaggi e li invio
-			do {
-
-				//prelevo il messaggio da inviare
-				char *message = _messageBuffer->value();
-
-				//invio il messaggio
-				_mmJTM->send(message, strlen(message));
-			
-			} while (_messageBuffer->moveToNext());
-		
-		}
-	}
+	static const char tail[] = ",\"" JK_MESSAGE_TYPE "\":\"" JK_MESSAGE_TYPE_ACK "\"}";
 
+	return printControl(id, tail, sizeof(tail) - 1, buffer, size);
 }
 
-
-//metodo che invia il messaggio
 /**
- * @brief Metodo che inserice il nuovo messaggio nel buffer di invio
+ * @brief Metodo che serializza il messaggio di verifica del collegamento (l'altro capo risponde con un ACK)
  * 
- * @param messageJData messaggio da inviare
- * @return ID del messaggio inserito nel buffer
+ * @param id ID della verifica
+ * @param buffer Buffer in cui scrivere il messaggio
+ * @param size Dimensione del buffer
+ * 
+ * @return Lunghezza del messaggio (0 se non sta nel buffer)
  */
-long Jack::send(JData &messageJData) { //invia il messaggio
-
-	//prelevo la root del messaggio
-	JsonObject *root = messageJData.getRoot();
-
-	//ottengo l'id del messaggio
-	long id = (*_getMessageID)();
-
-	//aggiungo id e la tipologia del messaggio
-	(*root)[JK_MESSAGE_ID] = id; //id del messaggio da confermare
-	(*root)[JK_MESSAGE_TYPE] = JK_MESSAGE_TYPE_DATA; //il messaggio  un ACK
-
-	//verifico la dimensione del messaggio pi il carattere di terminazione
-	size_t length = (*root).measureLength() +1;
-
-	//creo buffer per contenere il messaggio malloc
-	char *message = (char *) malloc(length * sizeof(char));
-
-	//ottengo il messaggio in JSON
-	(*root).printTo(message, length);
+size_t JFrame::printPing(long id, char *buffer, size_t size) {
 
-	//inserisco il messaggio nel buffer di invio
-	_messageBuffer->put(id, message);
+	static const char tail[] = ",\"" JK_MESSAGE_TYPE "\":\"" JK_MESSAGE_TYPE_PING "\"}";
 
-	//ritorno l'id del messaggio inserito nel buffer
-	return id;
-	
+	return printControl(id, tail, sizeof(tail) - 1, buffer, size);
 }
 
+//serializza il messaggio di controllo {"id":<id><tail> (ACK e verifica del collegamento)
+size_t JFrame::printControl(long id, const char *tail, size_t tailLength, char *buffer, size_t size) {
 
-//---PRIVATE---
+	static const char head[] = "{\"" JK_MESSAGE_ID "\":";
 
-void Jack::execute(char *json) { //funzione che gestisce il protocollo
+	//cifre dell'id (al contrario)
+	char digits[20];
+	uint8_t count = 0;
 
-	//creo memory pool
-	StaticJsonBuffer<200> jsonBuffer;
+	unsigned long value = id < 0 ? 0UL - (unsigned long) id : (unsigned long) id;
 
-	//creo la root a partire dal messaggio JSON
-	JsonObject& root = jsonBuffer.parseObject(json);
+	do {
+		digits[count++] = '0' + value % 10;
+		value /= 10;
+	} while (value);
 
-	//verifo se il messaggio  un messaggio valido
-	if (root.success()) {
-
-		//ottengo il tipo del messaggio
-		const char *type = root[JK_MESSAGE_TYPE];
-
-		//tipo dati
-		if (strcmp(type, JK_MESSAGE_TYPE_DATA) == 0) {
-
-			//costruisco il messaggio JData
-			JData message(root);
-
-			//ottengo l'id del messaggio
-			long id = root[JK_MESSAGE_ID];
-
-			//confermo il messaggio
-			sendAck(id);
-
-			//chiamo la funzione di gestione definita dall'utenye
-			(*_onReceive)(message, id);
-
-		//tipo ACK
-		} else if (strcmp(type, JK_MESSAGE_TYPE_ACK) == 0) {
-
-			//ottengo l'id del messaggio
-			long id = root[JK_MESSAGE_ID];
-
-			//chiamo la funzione di gestione degli ack
-			checkAck(id);
-		}
+	//verifico che il messaggio stia nel buffer (carattere di terminazione compreso)
+	size_t length = sizeof(head) - 1 + (id < 0) + count + tailLength;
 
+	if (length + 1 > size) {
+		return 0;
 	}
-}
 
+	//scrivo il messaggio
+	char *p = buffer;
 
-//invio ACK di conferma
-void Jack::sendAck(long id) { //invia l'ack di conferma
-	
-	//creo memory pool
-	StaticJsonBuffer<100> jsonBuffer;
+	memcpy(p, head, sizeof(head) - 1);
+	p += sizeof(head) - 1;
 
-	//creo root del messaggio
-	JsonObject& root = jsonBuffer.createObject();
-
-	//inserisco i dati
-	root[JK_MESSAGE_ID] = id; //id del messaggio da confermare
-	root[JK_MESSAGE_TYPE] = JK_MESSAGE_TYPE_ACK; //il messaggio  un ACK
-
-	//verifico la dimensione del messaggio pi il carattere di terminazione
-	size_t length = root.measureLength() +1;
-
-	//creo buffer per contenere il messaggio
-	char message[length];
+	if (id < 0) {
+		*p++ = '-';
+	}
 
-	//ottengo il messaggio in JSON
-	root.printTo(message, length);
+	while (count) {
+		*p++ = digits[--count];
+	}
 
-	//invio il messaggio
-	_mmJTM->send(message, strlen(message));
+	memcpy(p, tail, tailLength + 1); //copio anche il carattere di terminazione
 
+	return length;
 }
 
-//metodo che elimina il messaggio confermato dal buffer di invio
-void Jack::checkAck(long id) { //controlla l'ack
-	
-	//se il buffer dei messaggi da inviare contiene il messaggio appena confermato lo elimino
-	if (_messageBuffer->containsKey(id)) {
 
-		//libero la memoria allocata per il messaggio stringa
-		free(_messageBuffer->valueFor(id));
-
-		//rimuovo il messaggio dal buffer di invio
-		_messageBuffer->remove(id);
-
-		//il messaggio  stato confermato, chiamo la funzione dell'utente
-		(*_onReceiveAck)(id);
-	}
-		
-}
\ No newline at end of file
+//---JACK---
+//istanza di Jack con mezzo di trasmissione scelto a run-time
+template class BasicJack<JTransmissionMethod>;
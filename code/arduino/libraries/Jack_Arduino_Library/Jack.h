@@ -34,9 +34,10 @@
 
 
 #include <Arduino.h>
-#include <HashMap.h>
+#include "JConfig.h"
 #include "JData.h"
 #include "JTransmissionMethod.h"
+#include "JTrace.h"
 #include <ArduinoJson.h>
 
 
@@ -55,6 +56,14 @@
  * @brief Tipologia del messaggio DATA
  */ 
 #define JK_MESSAGE_TYPE_DATA "data" //tipo dati
+/**
+ * @brief Tipologia del messaggio dati senza conferma (stream live)
+ */
+#define JK_MESSAGE_TYPE_LIVE "live" //tipo dati senza conferma
+/**
+ * @brief Tipologia del messaggio di verifica del collegamento (l'altro capo risponde con un ACK)
+ */
+#define JK_MESSAGE_TYPE_PING "ping" //tipo verifica del collegamento
 
 /**
  * @brief Chiave dell'ID del messaggio
@@ -74,6 +83,118 @@
  */
 #define JK_TIMER_POLLING 500 //tempo (ms) da attendere tra un polling e un altro del mezzo di strasmissione
 
+//qualit del servizio
+/**
+ * @brief Consegna affidabile: il messaggio resta nel buffer di invio finch non viene confermato (almeno una volta)
+ */
+#define JK_QOS_RELIABLE 0 //at-least-once
+/**
+ * @brief Consegna senza conferma: il messaggio viene inviato subito, una sola volta (nessun buffer di invio e nessun ACK)
+ */
+#define JK_QOS_UNRELIABLE 1 //fire-and-forget
+/**
+ * @brief Consegna senza conferma dell'ultimo valore: il messaggio sostituisce quello non ancora inviato dello stream
+ */
+#define JK_QOS_LATEST 2 //latest-value-wins
+/**
+ * @brief Tempo minimo tra due invii dello stream JK_QOS_LATEST (millisecondi, 0 = ad ogni loop)
+ */
+#ifndef JK_TIMER_LIVE
+#define JK_TIMER_LIVE 0 //tempo (ms) tra due invii dell'ultimo valore
+#endif
+/**
+ * @brief Slot dell'ultimo valore dello stream (0 = nessuno slot, JK_QOS_LATEST viene inviato subito come JK_QOS_UNRELIABLE)
+ *
+ * Disattivato di default: lo slot occupa circa JK_MAX_MESSAGE_LENGTH byte di RAM, che sull'ATmega328 non ci sono.
+ */
+#ifndef JK_LIVE_SLOT
+#define JK_LIVE_SLOT 0 //1 = JK_MAX_MESSAGE_LENGTH byte di RAM in pi
+#endif
+/**
+ * @brief Differenza di id oltre la quale un messaggio live pi vecchio dell'ultimo indica il riavvio dell'altro capo
+ */
+#define JK_LIVE_RESTART_GAP 64 //messaggi live
+
+//scadenza
+/**
+ * @brief Scadenza dei messaggi nel buffer di invio (0 = i messaggi non scadono e la durata viene ignorata)
+ *
+ * Disattivata di default: la scadenza di ogni slot e l'ordine di scadenza occupano circa 45 byte di RAM, che
+ * sull'ATmega328 non ci sono.
+ */
+#ifndef JK_TTL
+#define JK_TTL 0 //1 = circa 45 byte di RAM in pi
+#endif
+/**
+ * @brief Durata di default dei messaggi nel buffer di invio (millisecondi, 0 = il messaggio non scade, solo con JK_TTL)
+ */
+#ifndef JK_MESSAGE_TTL
+#define JK_MESSAGE_TTL 0 //i messaggi restano nel buffer finch non vengono confermati
+#endif
+
+//stato del collegamento
+/**
+ * @brief Collegamento attivo: l'altro capo ha risposto di recente
+ */
+#define JK_LINK_CONNECTED 0 //reinvio di tutti i messaggi
+/**
+ * @brief Collegamento incerto: l'altro capo non risponde da JK_LINK_SUSPECT_ROUNDS reinvii
+ */
+#define JK_LINK_SUSPECT 1 //reinvio di un messaggio alla volta (a turno)
+/**
+ * @brief Collegamento interrotto: l'altro capo non risponde da JK_LINK_DOWN_ROUNDS reinvii
+ */
+#define JK_LINK_DOWN 2 //nessun reinvio, solo verifiche (al massimo ogni timerProbe)
+/**
+ * @brief Reinvii senza risposta dopo i quali il collegamento  incerto
+ */
+#ifndef JK_LINK_SUSPECT_ROUNDS
+#define JK_LINK_SUSPECT_ROUNDS 2 //reinvii senza risposta
+#endif
+/**
+ * @brief Reinvii senza risposta dopo i quali il collegamento  interrotto
+ */
+#ifndef JK_LINK_DOWN_ROUNDS
+#define JK_LINK_DOWN_ROUNDS 6 //reinvii senza risposta (30 s con il timer del firmware)
+#endif
+/**
+ * @brief Tempo massimo tra due verifiche del collegamento interrotto (millisecondi)
+ *
+ * La prima verifica parte dopo timerSendMessage, le successive raddoppiano l'attesa fino a JK_TIMER_PROBE: un
+ * collegamento creduto interrotto per qualche perdita di troppo torna attivo in pochi secondi.
+ */
+#ifndef JK_TIMER_PROBE
+#define JK_TIMER_PROBE 60000 //tempo (ms) massimo tra due verifiche del collegamento
+#endif
+
+static_assert(JK_LINK_SUSPECT_ROUNDS >= 1 && JK_LINK_SUSPECT_ROUNDS < JK_LINK_DOWN_ROUNDS, "JK_LINK_SUSPECT_ROUNDS deve essere compreso tra 1 e JK_LINK_DOWN_ROUNDS - 1");
+
+/**
+ * @brief Numero massimo di messaggi elaborati ad ogni polling del mezzo di trasmissione
+ */
+#define JK_MAX_MESSAGES_PER_POLLING 8 //messaggi ricevuti elaborati ad ogni polling
+
+//burst
+/**
+ * @brief Messaggi in attesa di conferma che attivano la modalit burst (se l'altro capo risponde)
+ */
+#ifndef JK_BURST_THRESHOLD
+#define JK_BURST_THRESHOLD 4 //messaggi non confermati che attivano il burst
+#endif
+/**
+ * @brief Finestra della modalit burst: messaggi inviati e non ancora confermati
+ */
+#ifndef JK_BURST_WINDOW
+#define JK_BURST_WINDOW 4 //messaggi in volo durante il burst
+#endif
+/**
+ * @brief Tempo dopo il quale un messaggio inviato in modalit burst viene reinviato (millisecondi)
+ */
+#define JK_BURST_TIMEOUT 2000 //tempo (ms) di attesa della conferma durante il burst
+
+static_assert(JK_BURST_THRESHOLD <= JK_BUFFER_SEND_SIZE, "JK_BURST_THRESHOLD supera JK_BUFFER_SEND_SIZE (il burst non si attiverebbe mai)");
+static_assert(JK_BURST_WINDOW >= 1 && JK_BURST_WINDOW <= JK_BUFFER_SEND_SIZE, "JK_BURST_WINDOW deve essere compreso tra 1 e JK_BUFFER_SEND_SIZE");
+
 //---DEBUG---
 /**
  * @brief Costante usata per abilitare il codice di debug
@@ -83,18 +204,49 @@
 //indico l'esistenza di JData
 class JData;
 
+//---TIPI---
+/**
+ * @brief Slot del buffer di invio: contiene il messaggio gi serializzato
+ */
+struct JMessageSlot {
+	long id; //id del messaggio
+	uint16_t length; //lunghezza del messaggio (0 = slot libero)
+	uint8_t sent; //indica se il messaggio  gi stato inviato
+	unsigned long timeLastSend; //ultimo invio del messaggio (millisecondi)
+#if JK_TTL
+	unsigned long expiresAt; //scadenza del messaggio (millisecondi, solo se il messaggio ha una durata)
+#endif
+	char message[JK_MAX_MESSAGE_LENGTH]; //messaggio serializzato
+};
+
+//---JFRAME---
+//serializzazione dei messaggi (in un solo passaggio, senza allocazioni), comune a tutte le varianti di Jack
+class JFrame {
+
+	public:
+
+		static size_t printData(JData &message, long id, char *buffer, size_t size, const char *type = JK_MESSAGE_TYPE_DATA); //serializza il messaggio dati (0 se non sta nel buffer)
+		static size_t printAck(long id, char *buffer, size_t size); //serializza il messaggio ACK (0 se non sta nel buffer)
+		static size_t printPing(long id, char *buffer, size_t size); //serializza la verifica del collegamento (0 se non sta nel buffer)
+
+	protected:
+
+		static size_t printControl(long id, const char *tail, size_t tailLength, char *buffer, size_t size); //messaggio {"id":<id><tail>
+
+};
+
+
 //---JACK---
-//classe Jack per il protocollo
-class Jack {
+//classe Jack per il protocollo: il mezzo di trasmissione T  un parametro del template (le chiamate vengono risolte
+//a tempo di compilazione). T deve fornire receive(), send(), available() e la costante MTU.
+template <class T>
+class BasicJack : public JFrame {
 		
 	public:
 	
 		//construttori
-		Jack(JTransmissionMethod &mmJTM, void (*onReceive)(JData &, long), void (*onReceiveAck)(long), long (*getMessageID)()); //costruttore con mmJTM e funzione onRceive e OnReceiveAck
-		Jack(JTransmissionMethod &mmJTM, void (*onReceive)(JData &, long), void (*onReceiveAck)(long), long (*getMessageID)(), long timerSendMessage, long timerPolling); //tempo per il reinvio
-		
-		//distruttore
-		~Jack(); //distruttore
+		BasicJack(T &mmJTM, void (*onReceive)(JData &, long), void (*onReceiveAck)(long), long (*getMessageID)()); //costruttore con mmJTM e funzione onRceive e OnReceiveAck
+		BasicJack(T &mmJTM, void (*onReceive)(JData &, long), void (*onReceiveAck)(long), long (*getMessageID)(), long timerSendMessage, long timerPolling); //tempo per il reinvio
 		
 		//funzioni per attivare il polling del mezzo di trasmissione
 		void start(); //avvia il polling
@@ -102,13 +254,50 @@ class Jack {
 		
 		//controlla il buffer di invio
 		void flushBufferSend(); //cancella i buffer contenente i messaggi da inviare
+		uint8_t pending(); //messaggi nel buffer di invio (non ancora confermati)
 		
 		//invio messaggi
-		long send(JData &message); //invia il messaggio
+		long send(JData &message); //invia il messaggio (0 se il buffer di invio  pieno, il messaggio  troppo lungo o senza blocco del pool)
+		long send(JData &message, uint8_t qos); //invia il messaggio con la qualit del servizio indicata (JK_QOS_*)
+		long send(JData &message, uint8_t qos, unsigned long ttl); //invia il messaggio con la durata indicata (solo JK_QOS_RELIABLE)
+		long sendFrame(long id, const char *frame, size_t length, unsigned long ttl); //inserisce nel buffer di invio un messaggio gi serializzato con printData()
+
+		//scadenza dei messaggi nel buffer di invio
+		void setMessageTTL(unsigned long ttl); //imposta la durata di default dei messaggi (0 = non scadono)
+		unsigned long messageTTL(); //durata di default dei messaggi
+		void setOnExpire(void (*onExpire)(long)); //handler dei messaggi scaduti prima della conferma
+		unsigned long messagesExpired(); //messaggi scaduti
+		unsigned long bytesExpired(); //byte dei messaggi scaduti
+
+		//stream senza conferma (JK_QOS_UNRELIABLE e JK_QOS_LATEST)
+		void setOnReceiveLive(void (*onReceiveLive)(JData &, long)); //handler dei messaggi senza conferma (di default onReceive)
+		void setTimerLive(long timerLive); //imposta il tempo minimo tra due invii dell'ultimo valore
+		long timerLive(); //tempo minimo tra due invii dell'ultimo valore
+		unsigned long liveCoalesced(); //valori sostituiti da uno pi recente prima dell'invio
 		
 		//loop
 		void loop(); //luppa per simulare il thread ed esegue le funzioni di polling su mmJTM
 
+		//modalit burst (invio del backlog a piena velocit dopo una riconnessione)
+		void setBurstEnabled(uint8_t enabled); //abilita/disabilita la modalit burst (abilitata di default)
+		uint8_t burst(); //indica se la modalit burst  attiva
+
+		//timer (modificabili a runtime)
+		void setTimerSendMessage(long timerSendMessage); //imposta il tempo di reinvio dei messaggi non confermati
+		void setTimerPolling(long timerPolling); //imposta il tempo tra due polling del mezzo di trasmissione
+		long timerSendMessage(); //tempo di reinvio dei messaggi non confermati
+		long timerPolling(); //tempo tra due polling del mezzo di trasmissione
+
+		//stato del collegamento (dalle risposte dell'altro capo)
+		void setLinkDetectionEnabled(uint8_t enabled); //abilita/disabilita la rilevazione del collegamento interrotto (abilitata di default)
+		uint8_t linkState(); //stato del collegamento (JK_LINK_*)
+		void setTimerProbe(long timerProbe); //imposta il tempo massimo tra due verifiche del collegamento interrotto
+		long timerProbe(); //tempo massimo tra due verifiche del collegamento interrotto
+		unsigned long probesSent(); //verifiche del collegamento inviate
+
+		//messaggi ricevuti
+		unsigned long framesRejected(); //messaggi ricevuti scartati (JSON non valido, senza tipo o di tipo sconosciuto)
+
 
 	private:		
 
@@ -119,6 +308,25 @@ class Jack {
 		void sendAck(long id); //invia l'ack di conferma
 		void checkAck(long id); //controlla l'ack
 
+		//invio dei messaggi
+		void sendMessage(JMessageSlot &slot); //invia il messaggio contenuto nello slot
+		void sendBurst(); //invia i messaggi non in volo entro la finestra del burst
+		void updateBurst(); //attiva/disattiva la modalit burst
+		void sendLive(); //invia l'ultimo valore dello stream se  passato il timer
+
+		//buffer di invio
+		uint8_t freeSlot(); //primo slot libero (JK_BUFFER_SEND_SIZE se il buffer  pieno)
+		void occupySlot(uint8_t index, long id, size_t length, unsigned long ttl); //occupa lo slot con il messaggio serializzato
+
+		//scadenza
+		void expire(); //elimina i messaggi scaduti (in ordine di scadenza)
+		void removeExpiry(uint8_t slot); //toglie lo slot dall'ordine di scadenza
+
+		//stato del collegamento
+		void heard(); //l'altro capo ha risposto (il collegamento torna attivo)
+		void updateLink(); //aggiorna lo stato del collegamento alla fine di un reinvio
+		void sendPing(); //invia la verifica del collegamento
+
 		//timer
 		long _timerSendMessage; //tempo (ms) da attendere prima di reinviare i messaggi non confermati
 		long _timerPolling; //tempo (ms) da attendere tra un polling e un altro del mezzo di strasmissione
@@ -128,20 +336,1216 @@ class Jack {
 		long _timeLastSend;
 
 		//mezzo di trasmissione
-		JTransmissionMethod *_mmJTM; //contiene il metodo di trasmissione da usare
+		T *_mmJTM; //contiene il metodo di trasmissione da usare
 
 		//contenitori dei dati
-		HashMap<long, char *> *_messageBuffer; //buffer per i messaggi da inviare
+		JMessageSlot _messageBuffer[JK_BUFFER_SEND_SIZE]; //buffer per i messaggi da inviare (gi serializzati)
 		
 		//indica se il polling  fermo o meno
 		uint8_t _pollingEnabled; //indica se il polling  fermo (non si ricevono messaggi)
 
+		//burst
+		uint8_t _burstEnabled; //indica se la modalit burst pu essere attivata
+		uint8_t _burst; //indica se la modalit burst  attiva
+		uint8_t _ackReceived; //indica se  stato ricevuto almeno un ACK
+		unsigned long _timeLastAck; //ricezione dell'ultimo ACK (l'altro capo risponde)
+
+		//stream senza conferma
+		long _liveID; //id dell'ultimo messaggio senza conferma inviato
+		long _lastLiveID; //id dell'ultimo messaggio senza conferma ricevuto
+		uint8_t _liveReceived; //indica se  stato ricevuto almeno un messaggio senza conferma
+#if JK_LIVE_SLOT
+		long _timerLive; //tempo (ms) minimo tra due invii dell'ultimo valore
+		unsigned long _timeLastLive; //ultimo invio dell'ultimo valore
+		unsigned long _liveCoalesced; //valori sostituiti prima dell'invio
+		JMessageSlot _liveSlot; //ultimo valore dello stream (length 0 = nessun valore da inviare)
+#endif
+
+#if JK_TTL
+		//scadenza
+		unsigned long _messageTTL; //durata di default dei messaggi (ms, 0 = non scadono)
+		uint8_t _expiryOrder[JK_BUFFER_SEND_SIZE]; //slot dei messaggi con durata, dal primo che scade
+		uint8_t _expiring; //messaggi con durata nel buffer
+		unsigned long _messagesExpired; //messaggi scaduti
+		unsigned long _bytesExpired; //byte dei messaggi scaduti
+		void (*_onExpire)(long); //puntatore a funzione per i messaggi scaduti (NULL = nessuna notifica)
+#endif
+
+		//stato del collegamento
+		uint8_t _linkDetectionEnabled; //indica se il collegamento pu diventare incerto o interrotto
+		uint8_t _linkState; //stato del collegamento (JK_LINK_*)
+		uint8_t _silentRounds; //reinvii consecutivi senza risposte
+		uint8_t _heard; //indica se l'altro capo ha risposto dall'ultimo reinvio
+		uint8_t _resendSlot; //slot da cui riprendere il reinvio con il collegamento incerto
+		long _timerProbe; //tempo (ms) tra due verifiche del collegamento interrotto
+		unsigned long _probeWait; //attesa (ms) prima della prossima verifica (raddoppia fino a _timerProbe)
+		long _probeID; //id dell'ultima verifica inviata (negativo)
+		unsigned long _probesSent; //verifiche inviate
+
+		//messaggi ricevuti
+		unsigned long _framesRejected; //messaggi ricevuti scartati
+
 		//puntatori a funzioni esterne
 		void (*_onReceive)(JData &, long); //puntatore a funzione OnReceive
 		void (*_onReceiveAck)(long); //puntatore a funzione OnReceive
 		long (*_getMessageID)(); //puntatore a funzione per ottenere il timestamp in long
+		void (*_onReceiveLive)(JData &, long); //puntatore a funzione per i messaggi senza conferma (NULL = _onReceive)
 		
 };
 
 
+/**
+ * @brief Jack con mezzo di trasmissione scelto a run-time (tramite l'interfaccia JTransmissionMethod)
+ */
+typedef BasicJack<JTransmissionMethod> Jack;
+
+//istanziata in Jack.cpp
+extern template class BasicJack<JTransmissionMethod>;
+
+
+//---IMPLEMENTAZIONE---
+//le definizioni dei metodi di BasicJack sono nell'header perch il mezzo di trasmissione  un parametro del template
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ * 
+ * @param mmJTM Istanza della classe che controlla il mezzo di comunicazione
+ * @param onReceive Handler evento di ricezione di un nuovo messaggio
+ * @param onReceiveAck Handler evento di ricezione della conferma di un messaggio inviato
+ * @param getMessageID Funzione che deve restituire un long univoco
+ * @param timerSendMessage Timer che controlla l'invio dei messaggi (millisecondi)
+ * @param timerPolling Timer che controlla il polling del mezzo di comunicazione (millisecondi)
+ */
+template <class T>
+BasicJack<T>::BasicJack(T &mmJTM, void (*onReceive)(JData &, long), void (*onReceiveAck)(long), long (*getMessageID)(), long timerSendMessage, long timerPolling) { //tempo per il reinvio
+	
+	//i messaggi dati devono poter essere trasportati dal mezzo di trasmissione
+	static_assert(JK_MAX_MESSAGE_LENGTH -1 <= T::MTU, "JK_MAX_MESSAGE_LENGTH supera l'MTU del mezzo di trasmissione");
+
+	//salvo il mezzo di trasmissione
+	_mmJTM = &mmJTM;
+
+	//imposto i valori dei timer
+	_timerSendMessage = timerSendMessage;
+	_timerPolling = timerPolling;
+
+	//salvo i puntatori a funzioni
+	_onReceive = onReceive;
+	_onReceiveAck = onReceiveAck;
+	_getMessageID = getMessageID;
+
+	//inizializzo le variabili
+	_timeLastPolling = 0;
+	_timeLastSend = 0;
+
+	//burst
+	_burstEnabled = 1;
+	_burst = 0;
+	_ackReceived = 0;
+	_timeLastAck = 0;
+
+	//stream senza conferma
+	_onReceiveLive = NULL;
+	_liveID = 0;
+	_lastLiveID = 0;
+	_liveReceived = 0;
+#if JK_LIVE_SLOT
+	_timerLive = JK_TIMER_LIVE;
+	_timeLastLive = 0;
+	_liveCoalesced = 0;
+#endif
+
+#if JK_TTL
+	//scadenza
+	_onExpire = NULL;
+	_messageTTL = JK_MESSAGE_TTL;
+	_messagesExpired = 0;
+	_bytesExpired = 0;
+#endif
+
+	//stato del collegamento (attivo finch l'altro capo non smette di rispondere)
+	_linkDetectionEnabled = 1;
+	_linkState = JK_LINK_CONNECTED;
+	_silentRounds = 0;
+	_heard = 0;
+	_resendSlot = 0;
+	_timerProbe = JK_TIMER_PROBE;
+	_probeWait = 0;
+	_probeID = 0;
+	_probesSent = 0;
+
+	//messaggi ricevuti
+	_framesRejected = 0;
+
+	//svuoto il buffer di invio
+	flushBufferSend();
+	
+}
+
+/**
+ * @brief Costruttore della classe (ridotto)
+ * 
+ * @param mmJTM Istanza della classe che controlla il mezzo di comunicazione
+ * @param onReceive Handler evento di ricezione di un nuovo messaggio
+ * @param onReceiveAck Handler evento di ricezione della conferma di un messaggio inviato
+ * @param getMessageID Funzione che deve restituire un long univoco
+ */
+template <class T>
+BasicJack<T>::BasicJack(T &mmJTM, void (*onReceive)(JData &, long), void (*onReceiveAck)(long), long (*getMessageID)()): BasicJack(mmJTM, onReceive, onReceiveAck, getMessageID, JK_TIMER_RESEND_MESSAGE, JK_TIMER_POLLING) {} //costruttore con mmJTM, funzione onReceive e getMessageID
+
+
+//metodi per abilitare/disabilitare il polling
+/**
+ * @brief Metodo che avvia il polling del mezzo di comunicazione
+ */
+template <class T>
+void BasicJack<T>::start() { //avvia il polling
+	_pollingEnabled = 1;
+}
+
+/**
+ * @brief Metodo che ferma il polling del mezzo di comunicazione
+ */
+template <class T>
+void BasicJack<T>::stop() { //stoppa il polling
+	_pollingEnabled = 0;
+}
+		
+
+//svuota il buffer di invio
+/**
+ * @brief Metodo che svuota il buffer contenente i messaggi ancora da inviare o non confermati
+ */
+template <class T>
+void BasicJack<T>::flushBufferSend() { //cancella i buffer contenente i messaggi da inviare
+
+	//libero tutti gli slot
+	for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE; i++) {
+		_messageBuffer[i].length = 0;
+	}
+
+#if JK_TTL
+	//nessun messaggio in scadenza
+	_expiring = 0;
+#endif
+
+#if JK_LIVE_SLOT
+	//scarto l'ultimo valore dello stream
+	_liveSlot.length = 0;
+#endif
+}
+
+/**
+ * @brief Metodo che restituisce i messaggi nel buffer di invio (da inviare o non ancora confermati)
+ * 
+ * @return Numero di messaggi (compreso l'ultimo valore dello stream non ancora inviato)
+ */
+template <class T>
+uint8_t BasicJack<T>::pending() {
+
+	uint8_t count = 0;
+
+	for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE; i++) {
+		if (_messageBuffer[i].length) {
+			count++;
+		}
+	}
+
+#if JK_LIVE_SLOT
+	if (_liveSlot.length) {
+		count++;
+	}
+#endif
+
+	return count;
+}
+
+
+//loop function
+/**
+ * @brief Funzione che simula un thread per la gestione dei timer
+ */
+template <class T>
+void BasicJack<T>::loop() { //luppa per simulare il thread
+
+	//elimino i messaggi scaduti (controllo solo il primo in ordine di scadenza)
+	expire();
+
+	//l'ultimo valore dello stream viene inviato appena passa il suo timer (indipendente dal polling)
+	if (_pollingEnabled) {
+		sendLive();
+	}
+
+	//se il polling  abilitato (durante il burst il mezzo di trasmissione viene controllato ad ogni iterazione)
+	if (_pollingEnabled && (_burst || millis() - _timeLastPolling >= (unsigned long) _timerPolling)) {
+
+		//ultimo polling
+		_timeLastPolling = millis();
+
+		//elaboro i messaggi disponibili (al massimo JK_MAX_MESSAGES_PER_POLLING)
+		for (uint8_t i = 0; i < JK_MAX_MESSAGES_PER_POLLING && _mmJTM->available(); i++) {
+
+			//buffer di dimensione fissa (i messaggi pi lunghi di JK_MAX_MESSAGE_LENGTH vengono scartati dal mezzo di trasmissione)
+			char message[JK_MAX_MESSAGE_LENGTH];
+			size_t length;
+
+			//recupero il messaggio
+			{
+				JK_TRACE_SCOPE(JK_TRACE_RECEIVE);
+
+				length = _mmJTM->receive(message, JK_MAX_MESSAGE_LENGTH);
+			}
+
+			//verifico se il messaggio non  nullo
+			if (length) {
+
+				JK_TRACE_SCOPE(JK_TRACE_PARSE);
+
+				//il messaggio  valido
+				execute(message);
+			}
+
+		}
+	
+		//attivo/disattivo il burst in base ai messaggi in attesa e alle risposte dell'altro capo
+		updateBurst();
+
+		//burst: i messaggi vengono inviati uno dopo l'altro entro la finestra
+		if (_burst) {
+
+			sendBurst();
+
+		//collegamento interrotto: nessun reinvio, solo la verifica ogni timerProbe (se ci sono messaggi da inviare)
+		} else if (_linkState == JK_LINK_DOWN) {
+
+			sendPing();
+
+		//se  passato il tempo di pausa tra un invio e l'altro (il tempo riparte solo se ci sono messaggi da inviare)
+		} else if (millis() - _timeLastSend >= (unsigned long) _timerSendMessage) { //invio messaggi
+
+			uint8_t sent = 0;
+
+			//se il collegamento  incerto parto dallo slot successivo all'ultimo reinviato (i messaggi vengono reinviati a turno)
+			uint8_t first = _linkState == JK_LINK_SUSPECT ? _resendSlot : 0;
+
+			//scorro tutti gli slot e invio i messaggi non ancora confermati (uno solo se il collegamento  incerto)
+			for (uint8_t n = 0; n < JK_BUFFER_SEND_SIZE && !(sent && _linkState == JK_LINK_SUSPECT); n++) {
+
+				uint8_t i = (first + n) % JK_BUFFER_SEND_SIZE;
+
+				if (_messageBuffer[i].length) {
+
+					//ultimo invio
+					_timeLastSend = millis();
+
+					sendMessage(_messageBuffer[i]);
+
+					sent = 1;
+					_resendSlot = (i + 1) % JK_BUFFER_SEND_SIZE;
+				}
+			}
+
+			//un reinvio senza risposte dal precedente rende il collegamento incerto e poi interrotto
+			if (sent) {
+				updateLink();
+			}
+		
+		}
+	}
+
+}
+
+
+//metodo che invia il messaggio
+/**
+ * @brief Metodo che inserice il nuovo messaggio nel buffer di invio
+ * 
+ * Il messaggio viene serializzato direttamente nello slot libero del buffer di invio e scade dopo messageTTL.
+ * 
+ * @param messageJData messaggio da inviare
+ * @return ID del messaggio inserito nel buffer (0 se il buffer  pieno, il messaggio supera JK_MAX_MESSAGE_LENGTH o
+ *         non ha ottenuto un blocco dal pool JArena)
+ */
+template <class T>
+long BasicJack<T>::send(JData &messageJData) { //invia il messaggio
+	return send(messageJData, JK_QOS_RELIABLE, messageTTL());
+}
+
+/**
+ * @brief Metodo che inserice il nuovo messaggio nel buffer di invio con la durata indicata
+ * 
+ * Il messaggio non confermato entro la durata viene eliminato dal buffer di invio (non viene pi reinviato) e
+ * notificato all'handler onExpire. La durata vale solo per JK_QOS_RELIABLE: gli altri messaggi non restano nel buffer.
+ * Senza JK_TTL la durata viene ignorata e il messaggio resta nel buffer finch non viene confermato.
+ * 
+ * @param messageJData messaggio da inviare
+ * @param qos Qualit del servizio (JK_QOS_RELIABLE, JK_QOS_UNRELIABLE o JK_QOS_LATEST)
+ * @param ttl Durata del messaggio (millisecondi, 0 = il messaggio non scade)
+ * @return ID del messaggio (0 se non  stato inserito nel buffer o inviato)
+ */
+template <class T>
+long BasicJack<T>::send(JData &messageJData, uint8_t qos, unsigned long ttl) {
+
+	//messaggi senza conferma
+	if (qos != JK_QOS_RELIABLE) {
+		return send(messageJData, qos);
+	}
+
+	//i messaggi scaduti liberano il loro slot
+	expire();
+
+	//cerco uno slot libero
+	uint8_t index = freeSlot();
+
+	//il buffer di invio  pieno
+	if (index == JK_BUFFER_SEND_SIZE) {
+		return 0;
+	}
+
+	//ottengo l'id del messaggio
+	long id = (*_getMessageID)();
+
+	//serializzo il messaggio nello slot
+	size_t length = printData(messageJData, id, _messageBuffer[index].message, JK_MAX_MESSAGE_LENGTH);
+
+	//il messaggio non sta nello slot
+	if (length == 0) {
+		return 0;
+	}
+
+	//occupo lo slot
+	occupySlot(index, id, length, ttl);
+
+	//ritorno l'id del messaggio inserito nel buffer
+	return id;
+	
+}
+
+/**
+ * @brief Metodo che inserisce nel buffer di invio un messaggio gi serializzato
+ * 
+ * Serve a chi serializza il messaggio fuori dal loop di Jack (es. i thread produttori di ConcurrentJack su Linux):
+ * il messaggio deve essere stato prodotto da printData() con lo stesso id e viene solo copiato nello slot.
+ * 
+ * @param id ID del messaggio (quello passato a printData())
+ * @param frame Messaggio serializzato
+ * @param length Lunghezza del messaggio (senza carattere di terminazione)
+ * @param ttl Durata del messaggio (millisecondi, 0 = il messaggio non scade)
+ * @return ID del messaggio (0 se il buffer di invio  pieno o il messaggio supera JK_MAX_MESSAGE_LENGTH)
+ */
+template <class T>
+long BasicJack<T>::sendFrame(long id, const char *frame, size_t length, unsigned long ttl) {
+
+	//il messaggio non sta in uno slot
+	if (length == 0 || length >= JK_MAX_MESSAGE_LENGTH) {
+		return 0;
+	}
+
+	//i messaggi scaduti liberano il loro slot
+	expire();
+
+	uint8_t index = freeSlot();
+
+	//il buffer di invio  pieno
+	if (index == JK_BUFFER_SEND_SIZE) {
+		return 0;
+	}
+
+	memcpy(_messageBuffer[index].message, frame, length);
+	_messageBuffer[index].message[length] = 0;
+
+	occupySlot(index, id, length, ttl);
+
+	return id;
+}
+
+/**
+ * @brief Metodo che invia il messaggio con la qualit del servizio indicata
+ * 
+ * JK_QOS_RELIABLE equivale a send(message). I messaggi JK_QOS_UNRELIABLE vengono inviati subito e una sola volta;
+ * il messaggio JK_QOS_LATEST sostituisce quello dello stream non ancora inviato e parte al prossimo loop (al massimo
+ * uno ogni timerLive). I messaggi senza conferma non occupano il buffer di invio, non vengono confermati e hanno id
+ * progressivi propri (getMessageID non viene chiamata).
+ * 
+ * Il messaggio JK_QOS_UNRELIABLE viene serializzato in uno slot libero del buffer di invio, che resta libero dopo
+ * l'invio: con il buffer di invio pieno il messaggio non viene inviato.
+ * 
+ * @param messageJData Messaggio da inviare
+ * @param qos Qualit del servizio (JK_QOS_RELIABLE, JK_QOS_UNRELIABLE o JK_QOS_LATEST)
+ * @return ID del messaggio (0 se non  stato inviato)
+ */
+template <class T>
+long BasicJack<T>::send(JData &messageJData, uint8_t qos) {
+
+	//consegna affidabile
+	if (qos == JK_QOS_RELIABLE) {
+		return send(messageJData, qos, messageTTL());
+	}
+
+	//id progressivo dei messaggi senza conferma (sempre positivo)
+	long id = _liveID < 0x7FFFFFFFL ? _liveID + 1 : 1;
+
+#if JK_LIVE_SLOT
+	//ultimo valore: serializzo nello slot dello stream (il valore precedente non ancora inviato viene sostituito)
+	if (qos == JK_QOS_LATEST) {
+
+		uint8_t pending = _liveSlot.length != 0;
+
+		size_t length = printData(messageJData, id, _liveSlot.message, JK_MAX_MESSAGE_LENGTH, JK_MESSAGE_TYPE_LIVE);
+
+		_liveSlot.length = length;
+
+		if (length == 0) {
+			return 0;
+		}
+
+		if (pending) {
+			_liveCoalesced++;
+		}
+
+		_liveSlot.id = id;
+		_liveID = id;
+
+		return id;
+	}
+#endif
+
+	//invio immediato: serializzo in uno slot libero del buffer di invio, che resta libero (nessun buffer sullo stack,
+	//il messaggio pu essere inviato dall'handler onReceive con il messaggio ricevuto ancora sullo stack)
+	expire();
+
+	uint8_t index = freeSlot();
+
+	//il buffer di invio  pieno
+	if (index == JK_BUFFER_SEND_SIZE) {
+		return 0;
+	}
+
+	char *message = _messageBuffer[index].message;
+
+	size_t length = printData(messageJData, id, message, JK_MAX_MESSAGE_LENGTH, JK_MESSAGE_TYPE_LIVE);
+
+	if (length == 0) {
+		return 0;
+	}
+
+	_liveID = id;
+
+	JK_TRACE_SCOPE(JK_TRACE_TRANSMIT);
+
+	_mmJTM->send(message, length);
+
+	return id;
+}
+
+
+//modalit burst
+/**
+ * @brief Metodo che abilita o disabilita la modalit burst
+ * 
+ * Quando nel buffer di invio ci sono almeno JK_BURST_THRESHOLD messaggi e l'altro capo conferma i messaggi,
+ * i messaggi vengono inviati uno dopo l'altro (al massimo JK_BURST_WINDOW in attesa di conferma) invece
+ * che ogni timerSendMessage. Il burst termina quando il buffer si svuota o l'altro capo smette di rispondere.
+ * 
+ * @param enabled 1 per abilitare la modalit burst, 0 per disabilitarla
+ */
+template <class T>
+void BasicJack<T>::setBurstEnabled(uint8_t enabled) {
+
+	_burstEnabled = enabled;
+
+	//se disabilitata termino il burst in corso
+	if (!enabled) {
+		_burst = 0;
+	}
+}
+
+/**
+ * @brief Metodo che indica se la modalit burst  attiva
+ * 
+ * @return 1 se il burst  in corso, 0 altrimenti
+ */
+template <class T>
+uint8_t BasicJack<T>::burst() {
+	return _burst;
+}
+
+
+//stream senza conferma
+/**
+ * @brief Metodo che imposta l'handler dei messaggi senza conferma
+ * 
+ * @param onReceiveLive Handler dei messaggi JK_QOS_UNRELIABLE e JK_QOS_LATEST ricevuti (NULL = onReceive)
+ */
+template <class T>
+void BasicJack<T>::setOnReceiveLive(void (*onReceiveLive)(JData &, long)) {
+	_onReceiveLive = onReceiveLive;
+}
+
+/**
+ * @brief Metodo che imposta il tempo minimo tra due invii dell'ultimo valore dello stream (JK_QOS_LATEST)
+ * 
+ * Su un collegamento lento il timer va impostato al tempo di trasmissione di un messaggio: i valori prodotti
+ * nel frattempo vengono sostituiti e il collegamento trasporta sempre il pi recente. Senza JK_LIVE_SLOT non ha
+ * effetto (ogni valore viene inviato subito).
+ * 
+ * @param timerLive Tempo minimo tra due invii (millisecondi, 0 = ad ogni loop)
+ */
+template <class T>
+void BasicJack<T>::setTimerLive(long timerLive) {
+#if JK_LIVE_SLOT
+	_timerLive = timerLive;
+#else
+	(void) timerLive;
+#endif
+}
+
+/**
+ * @brief Metodo che restituisce il tempo minimo tra due invii dell'ultimo valore dello stream
+ * 
+ * @return Tempo minimo tra due invii (millisecondi, 0 senza JK_LIVE_SLOT)
+ */
+template <class T>
+long BasicJack<T>::timerLive() {
+#if JK_LIVE_SLOT
+	return _timerLive;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @brief Metodo che restituisce il numero di valori dello stream sostituiti da uno pi recente prima dell'invio
+ * 
+ * @return Valori sostituiti
+ */
+template <class T>
+unsigned long BasicJack<T>::liveCoalesced() {
+#if JK_LIVE_SLOT
+	return _liveCoalesced;
+#else
+	return 0;
+#endif
+}
+
+
+//scadenza
+/**
+ * @brief Metodo che imposta la durata di default dei messaggi inseriti nel buffer di invio
+ * 
+ * Vale per i messaggi inseriti dopo la chiamata: un messaggio non confermato entro la durata viene eliminato.
+ * Senza JK_TTL non ha effetto (i messaggi non scadono).
+ * 
+ * @param ttl Durata dei messaggi (millisecondi, 0 = i messaggi non scadono)
+ */
+template <class T>
+void BasicJack<T>::setMessageTTL(unsigned long ttl) {
+#if JK_TTL
+	_messageTTL = ttl;
+#else
+	(void) ttl;
+#endif
+}
+
+/**
+ * @brief Metodo che restituisce la durata di default dei messaggi
+ * 
+ * @return Durata dei messaggi (millisecondi, 0 = i messaggi non scadono)
+ */
+template <class T>
+unsigned long BasicJack<T>::messageTTL() {
+#if JK_TTL
+	return _messageTTL;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @brief Metodo che imposta l'handler dei messaggi scaduti prima della conferma
+ * 
+ * L'handler viene chiamato dopo aver liberato lo slot: pu inserire un nuovo messaggio.
+ * 
+ * @param onExpire Handler dei messaggi scaduti (riceve l'id del messaggio, NULL = nessuna notifica)
+ */
+template <class T>
+void BasicJack<T>::setOnExpire(void (*onExpire)(long)) {
+#if JK_TTL
+	_onExpire = onExpire;
+#else
+	(void) onExpire;
+#endif
+}
+
+/**
+ * @brief Metodo che restituisce il numero di messaggi scaduti prima della conferma
+ * 
+ * @return Messaggi scaduti
+ */
+template <class T>
+unsigned long BasicJack<T>::messagesExpired() {
+#if JK_TTL
+	return _messagesExpired;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @brief Metodo che restituisce i byte dei messaggi scaduti prima della conferma
+ * 
+ * @return Byte dei messaggi scaduti (messaggi serializzati)
+ */
+template <class T>
+unsigned long BasicJack<T>::bytesExpired() {
+#if JK_TTL
+	return _bytesExpired;
+#else
+	return 0;
+#endif
+}
+
+
+//stato del collegamento
+/**
+ * @brief Metodo che abilita/disabilita la rilevazione del collegamento interrotto
+ * 
+ * Con la rilevazione disabilitata il collegamento resta attivo e i messaggi vengono reinviati ogni timerSendMessage.
+ * 
+ * @param enabled 1 per abilitare la rilevazione, 0 per disabilitarla
+ */
+template <class T>
+void BasicJack<T>::setLinkDetectionEnabled(uint8_t enabled) {
+
+	_linkDetectionEnabled = enabled;
+
+	//disabilitando la rilevazione il collegamento torna attivo
+	if (!enabled) {
+		_linkState = JK_LINK_CONNECTED;
+		_silentRounds = 0;
+	}
+}
+
+/**
+ * @brief Metodo che restituisce lo stato del collegamento
+ * 
+ * Il collegamento diventa incerto dopo JK_LINK_SUSPECT_ROUNDS reinvii consecutivi senza alcuna risposta dall'altro
+ * capo (viene reinviato un solo messaggio alla volta, a turno tra quelli non confermati) e interrotto dopo JK_LINK_DOWN_ROUNDS (nessun reinvio, solo
+ * verifiche sempre pi rade, fino a una ogni timerProbe). Qualsiasi messaggio ricevuto lo riporta attivo e i reinvii
+ * riprendono subito.
+ * 
+ * @return Stato del collegamento (JK_LINK_CONNECTED, JK_LINK_SUSPECT o JK_LINK_DOWN)
+ */
+template <class T>
+uint8_t BasicJack<T>::linkState() {
+	return _linkState;
+}
+
+/**
+ * @brief Metodo che imposta il tempo massimo tra due verifiche del collegamento interrotto
+ * 
+ * @param timerProbe Tempo massimo tra due verifiche (millisecondi)
+ */
+template <class T>
+void BasicJack<T>::setTimerProbe(long timerProbe) {
+	_timerProbe = timerProbe;
+}
+
+/**
+ * @brief Metodo che restituisce il tempo massimo tra due verifiche del collegamento interrotto
+ * 
+ * @return Tempo massimo tra due verifiche (millisecondi)
+ */
+template <class T>
+long BasicJack<T>::timerProbe() {
+	return _timerProbe;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di verifiche del collegamento inviate
+ * 
+ * @return Verifiche inviate
+ */
+template <class T>
+unsigned long BasicJack<T>::probesSent() {
+	return _probesSent;
+}
+
+
+//messaggi ricevuti
+/**
+ * @brief Metodo che restituisce il numero di messaggi ricevuti e scartati da execute()
+ * 
+ * Un messaggio viene scartato se il JSON non  valido (o non c' un blocco libero nel pool JArena), se non ha il
+ * tipo o se il tipo  sconosciuto. I messaggi troncati o troppo lunghi vengono scartati prima dal mezzo di trasmissione.
+ * 
+ * @return Messaggi scartati
+ */
+template <class T>
+unsigned long BasicJack<T>::framesRejected() {
+	return _framesRejected;
+}
+
+
+//timer
+/**
+ * @brief Metodo che imposta il tempo di attesa prima di reinviare i messaggi non confermati
+ * 
+ * Il nuovo valore vale dal prossimo controllo del loop (i messaggi nel buffer di invio non vengono modificati).
+ * 
+ * @param timerSendMessage Timer che controlla l'invio dei messaggi (millisecondi)
+ */
+template <class T>
+void BasicJack<T>::setTimerSendMessage(long timerSendMessage) {
+	_timerSendMessage = timerSendMessage;
+}
+
+/**
+ * @brief Metodo che imposta il tempo di attesa tra due polling del mezzo di comunicazione
+ * 
+ * @param timerPolling Timer che controlla il polling del mezzo di comunicazione (millisecondi)
+ */
+template <class T>
+void BasicJack<T>::setTimerPolling(long timerPolling) {
+	_timerPolling = timerPolling;
+}
+
+/**
+ * @brief Metodo che restituisce il tempo di attesa prima di reinviare i messaggi non confermati
+ * 
+ * @return Timer che controlla l'invio dei messaggi (millisecondi)
+ */
+template <class T>
+long BasicJack<T>::timerSendMessage() {
+	return _timerSendMessage;
+}
+
+/**
+ * @brief Metodo che restituisce il tempo di attesa tra due polling del mezzo di comunicazione
+ * 
+ * @return Timer che controlla il polling del mezzo di comunicazione (millisecondi)
+ */
+template <class T>
+long BasicJack<T>::timerPolling() {
+	return _timerPolling;
+}
+
+
+//---PRIVATE---
+
+//primo slot libero del buffer di invio
+template <class T>
+uint8_t BasicJack<T>::freeSlot() {
+
+	for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE; i++) {
+
+		if (_messageBuffer[i].length == 0) {
+			return i;
+		}
+	}
+
+	return JK_BUFFER_SEND_SIZE;
+}
+
+//occupa lo slot con il messaggio gi serializzato e lo inserisce nell'ordine di scadenza
+template <class T>
+void BasicJack<T>::occupySlot(uint8_t index, long id, size_t length, unsigned long ttl) {
+
+	JMessageSlot *slot = &_messageBuffer[index];
+
+	slot->id = id;
+	slot->length = length;
+	slot->sent = 0;
+
+#if JK_TTL
+	//inserisco lo slot nell'ordine di scadenza (scorrendo dal fondo: di solito la durata  la stessa per tutti)
+	if (ttl) {
+
+		slot->expiresAt = millis() + ttl;
+
+		uint8_t position = _expiring;
+
+		while (position > 0 && (long) (_messageBuffer[_expiryOrder[position - 1]].expiresAt - slot->expiresAt) > 0) {
+			_expiryOrder[position] = _expiryOrder[position - 1];
+			position--;
+		}
+
+		_expiryOrder[position] = index;
+		_expiring++;
+	}
+#else
+	//senza JK_TTL i messaggi non scadono
+	(void) ttl;
+#endif
+}
+
+template <class T>
+void BasicJack<T>::execute(char *json) { //funzione che gestisce il protocollo
+
+	//prendo un blocco dal pool (contiene qualsiasi messaggio lungo al massimo JK_MAX_MESSAGE_LENGTH, se non ci
+	//sono blocchi liberi il parsing fallisce e il messaggio verr reinviato)
+	JArenaBuffer jsonBuffer;
+
+	//creo la root a partire dal messaggio JSON
+	JsonObject& root = jsonBuffer.parseObject(json);
+
+	//verifo se il messaggio  un messaggio valido
+	if (root.success()) {
+
+		//ottengo il tipo del messaggio
+		const char *type = root[JK_MESSAGE_TYPE];
+
+		//il messaggio non ha il tipo
+		if (type == NULL) {
+			_framesRejected++;
+			return;
+		}
+
+		//l'altro capo  raggiungibile
+		heard();
+
+		//tipo dati
+		if (strcmp(type, JK_MESSAGE_TYPE_DATA) == 0) {
+
+			//costruisco il messaggio JData
+			JData message(root);
+
+			//ottengo l'id del messaggio
+			long id = root[JK_MESSAGE_ID];
+
+			//confermo il messaggio
+			sendAck(id);
+
+			//chiamo la funzione di gestione definita dall'utenye
+			(*_onReceive)(message, id);
+
+		//tipo ACK
+		} else if (strcmp(type, JK_MESSAGE_TYPE_ACK) == 0) {
+
+			//ottengo l'id del messaggio
+			long id = root[JK_MESSAGE_ID];
+
+			//l'altro capo risponde
+			_ackReceived = 1;
+			_timeLastAck = millis();
+
+			//chiamo la funzione di gestione degli ack
+			checkAck(id);
+
+		//tipo dati senza conferma
+		} else if (strcmp(type, JK_MESSAGE_TYPE_LIVE) == 0) {
+
+			//costruisco il messaggio JData
+			JData message(root);
+
+			//ottengo l'id del messaggio
+			long id = root[JK_MESSAGE_ID];
+
+			//scarto i valori pi vecchi dell'ultimo ricevuto (riordinati dal collegamento), a meno che l'altro capo sia ripartito
+			if (_liveReceived && id <= _lastLiveID && _lastLiveID - id < JK_LIVE_RESTART_GAP) {
+				return;
+			}
+
+			_liveReceived = 1;
+			_lastLiveID = id;
+
+			//nessun ACK: chiamo la funzione di gestione definita dall'utente
+			(*(_onReceiveLive ? _onReceiveLive : _onReceive))(message, id);
+
+		//verifica del collegamento
+		} else if (strcmp(type, JK_MESSAGE_TYPE_PING) == 0) {
+
+			//ottengo l'id della verifica
+			long id = root[JK_MESSAGE_ID];
+
+			//rispondo con l'ACK (non corrisponde a nessun messaggio dell'altro capo)
+			sendAck(id);
+
+		//tipo sconosciuto
+		} else {
+			_framesRejected++;
+		}
+
+	//JSON non valido
+	} else {
+		_framesRejected++;
+	}
+}
+
+
+//invia il messaggio contenuto nello slot
+template <class T>
+void BasicJack<T>::sendMessage(JMessageSlot &slot) {
+
+	JK_TRACE_SCOPE(JK_TRACE_TRANSMIT);
+
+	slot.sent = 1;
+	slot.timeLastSend = millis();
+
+	_mmJTM->send(slot.message, slot.length);
+}
+
+//invia i messaggi non ancora inviati o scaduti finch la finestra lo permette
+template <class T>
+void BasicJack<T>::sendBurst() {
+
+	uint8_t inFlight = 0;
+
+	//conto i messaggi in volo (inviati e non ancora scaduti)
+	for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE; i++) {
+
+		if (_messageBuffer[i].length && _messageBuffer[i].sent && millis() - _messageBuffer[i].timeLastSend < JK_BURST_TIMEOUT) {
+			inFlight++;
+		}
+	}
+
+	//invio gli altri messaggi entro la finestra
+	for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE && inFlight < JK_BURST_WINDOW; i++) {
+
+		JMessageSlot &slot = _messageBuffer[i];
+
+		if (slot.length && (!slot.sent || millis() - slot.timeLastSend >= JK_BURST_TIMEOUT)) {
+
+			sendMessage(slot);
+
+			inFlight++;
+		}
+	}
+
+	//al termine del burst il reinvio riprende dopo timerSendMessage
+	_timeLastSend = millis();
+}
+
+//attiva il burst se ci sono molti messaggi in attesa e l'altro capo risponde, lo termina se il buffer  vuoto o l'altro capo non risponde
+template <class T>
+void BasicJack<T>::updateBurst() {
+
+	uint8_t pending = 0;
+
+	//conto i messaggi in attesa di conferma
+	for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE; i++) {
+
+		if (_messageBuffer[i].length) {
+			pending++;
+		}
+	}
+
+	//l'altro capo ha confermato un messaggio di recente
+	uint8_t peerAnswers = _ackReceived && millis() - _timeLastAck < (unsigned long) _timerSendMessage;
+
+	if (!_burst) {
+
+		//attivo il burst
+		if (_burstEnabled && pending >= JK_BURST_THRESHOLD && peerAnswers) {
+			_burst = 1;
+		}
+
+	//termino il burst (si torna al reinvio ogni timerSendMessage)
+	} else if (pending == 0 || !peerAnswers) {
+		_burst = 0;
+	}
+}
+
+
+//invia l'ultimo valore dello stream se  passato il timer
+template <class T>
+void BasicJack<T>::sendLive() {
+
+#if JK_LIVE_SLOT
+	if (_liveSlot.length && millis() - _timeLastLive >= (unsigned long) _timerLive) {
+
+		JK_TRACE_SCOPE(JK_TRACE_TRANSMIT);
+
+		_timeLastLive = millis();
+
+		_mmJTM->send(_liveSlot.message, _liveSlot.length);
+
+		//il valore viene inviato una sola volta
+		_liveSlot.length = 0;
+	}
+#endif
+}
+
+
+//elimina i messaggi scaduti: gli slot sono in ordine di scadenza, per cui basta controllare il primo
+template <class T>
+void BasicJack<T>::expire() {
+
+#if JK_TTL
+	while (_expiring && (long) (millis() - _messageBuffer[_expiryOrder[0]].expiresAt) >= 0) {
+
+		JMessageSlot &slot = _messageBuffer[_expiryOrder[0]];
+
+		long id = slot.id;
+
+		_messagesExpired++;
+		_bytesExpired += slot.length;
+
+		//libero lo slot e lo tolgo dall'ordine di scadenza
+		slot.length = 0;
+
+		_expiring--;
+		memmove(_expiryOrder, _expiryOrder + 1, _expiring);
+
+		//notifico l'utente
+		if (_onExpire) {
+			(*_onExpire)(id);
+		}
+	}
+#endif
+}
+
+//toglie lo slot confermato dall'ordine di scadenza (se ha una durata)
+template <class T>
+void BasicJack<T>::removeExpiry(uint8_t slot) {
+
+#if JK_TTL
+	for (uint8_t i = 0; i < _expiring; i++) {
+
+		if (_expiryOrder[i] == slot) {
+
+			_expiring--;
+			memmove(_expiryOrder + i, _expiryOrder + i + 1, _expiring - i);
+
+			return;
+		}
+	}
+#else
+	(void) slot;
+#endif
+}
+
+
+//l'altro capo ha risposto: il collegamento torna attivo e, se era interrotto, i messaggi vengono reinviati subito
+template <class T>
+void BasicJack<T>::heard() {
+
+	_heard = 1;
+	_silentRounds = 0;
+
+	if (_linkState != JK_LINK_CONNECTED) {
+
+		_linkState = JK_LINK_CONNECTED;
+
+		//il prossimo loop reinvia tutti i messaggi non confermati
+		_timeLastSend = millis() - _timerSendMessage;
+	}
+}
+
+//conta i reinvii consecutivi senza risposte e aggiorna lo stato del collegamento
+template <class T>
+void BasicJack<T>::updateLink() {
+
+	if (_heard || !_linkDetectionEnabled) {
+
+		_heard = 0;
+		_silentRounds = 0;
+
+		return;
+	}
+
+	if (_silentRounds < JK_LINK_DOWN_ROUNDS) {
+		_silentRounds++;
+	}
+
+	if (_silentRounds >= JK_LINK_DOWN_ROUNDS) {
+
+		_linkState = JK_LINK_DOWN;
+
+		//la prima verifica parte dopo timerSendMessage (con il collegamento interrotto non ci sono reinvii: il tempo
+		//dell'ultimo invio diventa quello dell'ultima verifica)
+		_timeLastSend = millis();
+		_probeWait = _timerSendMessage;
+
+	} else if (_silentRounds >= JK_LINK_SUSPECT_ROUNDS) {
+		_linkState = JK_LINK_SUSPECT;
+	}
+}
+
+//invia la verifica del collegamento interrotto con attesa crescente fino a timerProbe (solo se ci sono messaggi da inviare)
+template <class T>
+void BasicJack<T>::sendPing() {
+
+	if (millis() - _timeLastSend < _probeWait) {
+		return;
+	}
+
+	uint8_t pending = 0;
+
+	for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE && !pending; i++) {
+		pending = _messageBuffer[i].length != 0;
+	}
+
+	if (!pending) {
+		return;
+	}
+
+	_timeLastSend = millis();
+
+	//raddoppio l'attesa della prossima verifica
+	_probeWait = _probeWait * 2 < (unsigned long) _timerProbe ? _probeWait * 2 : _timerProbe;
+
+	char message[JK_MAX_ACK_LENGTH];
+
+	//id negativi: l'ACK della verifica non deve confermare un messaggio del buffer (gli id di getMessageID sono positivi)
+	_probeID = _probeID > -0x7FFFFFFFL ? _probeID - 1 : -1;
+
+	size_t length = printPing(_probeID, message, JK_MAX_ACK_LENGTH);
+
+	if (length) {
+
+		JK_TRACE_SCOPE(JK_TRACE_TRANSMIT);
+
+		_mmJTM->send(message, length);
+
+		_probesSent++;
+	}
+}
+
+
+//invio ACK di conferma
+template <class T>
+void BasicJack<T>::sendAck(long id) { //invia l'ack di conferma
+	
+	//creo il buffer del messaggio
+	char message[JK_MAX_ACK_LENGTH];
+
+	//serializzo il messaggio
+	size_t length = printAck(id, message, JK_MAX_ACK_LENGTH);
+
+	//invio il messaggio
+	if (length) {
+
+		JK_TRACE_SCOPE(JK_TRACE_TRANSMIT);
+
+		_mmJTM->send(message, length);
+	}
+
+}
+
+//metodo che elimina il messaggio confermato dal buffer di invio
+template <class T>
+void BasicJack<T>::checkAck(long id) { //controlla l'ack
+	
+	//se il buffer dei messaggi da inviare contiene il messaggio appena confermato lo elimino
+	for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE; i++) {
+
+		if (_messageBuffer[i].length && _messageBuffer[i].id == id) {
+
+			//libero lo slot
+			_messageBuffer[i].length = 0;
+			removeExpiry(i);
+
+			//il messaggio  stato confermato, chiamo la funzione dell'utente
+			(*_onReceiveAck)(id);
+
+			return;
+		}
+	}
+		
+}
+
+
 #endif //JACK_H
\ No newline at end of file
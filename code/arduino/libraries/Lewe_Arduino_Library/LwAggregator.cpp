@@ -0,0 +1,301 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LwAggregator.cpp
+ * @brief Riassunto delle letture per finestre temporali (minimo, massimo, media e numero di letture di GSR e temperatura)
+ * 
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ * 
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <Arduino.h>
+#include "LwAggregator.h"
+
+
+//---LW SUMMARY---
+
+/**
+ * @brief Metodo che restituisce il GSR medio della finestra
+ * 
+ * @return GSR medio (arrotondato)
+ */
+uint8_t LwSummary::gsrMean() const {
+
+	if (count == 0) {
+		return 0;
+	}
+
+	return (uint8_t) ((gsrSum + count / 2) / count);
+}
+
+/**
+ * @brief Metodo che restituisce la temperatura media della finestra
+ * 
+ * @return Temperatura media in decimi di grado (arrotondata)
+ */
+int16_t LwSummary::temperatureMean() const {
+
+	if (count == 0) {
+		return 0;
+	}
+
+	//arrotondo verso il valore più vicino anche per le temperature negative
+	if (temperatureSum < 0) {
+		return (int16_t) ((temperatureSum - (int32_t) count / 2) / (int32_t) count);
+	}
+
+	return (int16_t) ((temperatureSum + (int32_t) count / 2) / (int32_t) count);
+}
+
+
+//---LW AGGREGATOR---
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ * 
+ * @param window Durata della finestra (secondi)
+ */
+LwAggregator::LwAggregator(long window) {
+
+	//la finestra deve durare almeno un secondo
+	_window = window > 0 ? window : 1;
+
+	reset();
+}
+
+/**
+ * @brief Costruttore della classe (ridotto)
+ */
+LwAggregator::LwAggregator(): LwAggregator(LW_AGGREGATOR_WINDOW) {}
+
+
+/**
+ * @brief Metodo che aggiunge una lettura alla finestra corrente
+ * 
+ * Se la lettura appartiene a una finestra successiva, la finestra corrente viene chiusa e il suo riassunto
+ * diventa disponibile (sovrascrive quello precedente se non è stato prelevato).
+ * 
+ * @param timestamp Timestamp della lettura
+ * @param gsr Lettura del sensore GSR
+ * @param temperature Temperatura (decimi di grado)
+ * 
+ * @return 1 se è stata chiusa la finestra precedente, 0 altrimenti
+ */
+uint8_t LwAggregator::add(long timestamp, uint8_t gsr, int16_t temperature) {
+
+	uint8_t closed = 0;
+
+	//la lettura appartiene a un'altra finestra: chiudo quella corrente
+	if (_current.count && (timestamp < _windowStart || timestamp - _windowStart >= _window)) {
+		closed = flush();
+	}
+
+	//apro la finestra
+	if (_current.count == 0) {
+		begin(timestamp);
+	}
+
+	//aggiorno il riassunto
+	LwSummary single;
+
+	single.start = timestamp;
+	single.end = timestamp;
+	single.count = 1;
+	single.gsrMin = gsr;
+	single.gsrMax = gsr;
+	single.gsrSum = gsr;
+	single.temperatureMin = temperature;
+	single.temperatureMax = temperature;
+	single.temperatureSum = temperature;
+
+	merge(_current, single);
+
+	return closed;
+}
+
+/**
+ * @brief Metodo che chiude la finestra corrente e ne rende disponibile il riassunto
+ * 
+ * @return 1 se la finestra conteneva letture, 0 altrimenti
+ */
+uint8_t LwAggregator::flush() {
+
+	//finestra vuota
+	if (_current.count == 0) {
+		return 0;
+	}
+
+	_completed = _current;
+	_completedAvailable = 1;
+
+	_current.count = 0;
+
+	return 1;
+}
+
+
+/**
+ * @brief Metodo che indica se c'è un riassunto completo da prelevare
+ * 
+ * @return 1 se c'è un riassunto, 0 altrimenti
+ */
+uint8_t LwAggregator::available() {
+	return _completedAvailable;
+}
+
+/**
+ * @brief Metodo che preleva il riassunto completo
+ * 
+ * @return Riassunto dell'ultima finestra chiusa
+ */
+LwSummary LwAggregator::get() {
+
+	_completedAvailable = 0;
+
+	return _completed;
+}
+
+
+/**
+ * @brief Metodo che restituisce il numero di letture nella finestra corrente
+ * 
+ * @return Numero di letture
+ */
+uint16_t LwAggregator::count() {
+	return _current.count;
+}
+
+/**
+ * @brief Metodo che imposta la durata della finestra
+ * 
+ * La finestra corrente mantiene il suo inizio e viene chiusa quando una lettura supera la nuova durata.
+ * 
+ * @param window Durata della finestra (secondi)
+ */
+void LwAggregator::setWindow(long window) {
+	_window = window > 0 ? window : 1;
+}
+
+/**
+ * @brief Metodo che restituisce la durata della finestra
+ * 
+ * @return Durata della finestra (secondi)
+ */
+long LwAggregator::window() {
+	return _window;
+}
+
+/**
+ * @brief Metodo che scarta la finestra corrente e il riassunto non ancora prelevato
+ */
+void LwAggregator::reset() {
+
+	_windowStart = 0;
+
+	_current.count = 0;
+	_completedAvailable = 0;
+}
+
+
+/**
+ * @brief Metodo che unisce due riassunti (usato per ridurre la fedeltà quando la memoria è esaurita)
+ * 
+ * Il numero di letture satura a 0xFFFF: oltre, le somme vengono ridotte in proporzione e le medie restano corrette.
+ * 
+ * @param into Riassunto in cui unire le letture
+ * @param from Riassunto da unire
+ */
+void LwAggregator::merge(LwSummary &into, const LwSummary &from) {
+
+	//riassunto vuoto
+	if (from.count == 0) {
+		return;
+	}
+
+	if (into.count == 0) {
+		into = from;
+		return;
+	}
+
+	//estremi temporali
+	if (from.start < into.start) {
+		into.start = from.start;
+	}
+
+	if (from.end > into.end) {
+		into.end = from.end;
+	}
+
+	//minimi e massimi
+	if (from.gsrMin < into.gsrMin) {
+		into.gsrMin = from.gsrMin;
+	}
+
+	if (from.gsrMax > into.gsrMax) {
+		into.gsrMax = from.gsrMax;
+	}
+
+	if (from.temperatureMin < into.temperatureMin) {
+		into.temperatureMin = from.temperatureMin;
+	}
+
+	if (from.temperatureMax > into.temperatureMax) {
+		into.temperatureMax = from.temperatureMax;
+	}
+
+	//somme e numero di letture
+	uint32_t count = (uint32_t) into.count + from.count;
+	uint32_t gsrSum = into.gsrSum + from.gsrSum;
+	int64_t temperatureSum = (int64_t) into.temperatureSum + from.temperatureSum;
+
+	//oltre 0xFFFF letture il numero satura: riporto le somme a 0xFFFF letture con la stessa media
+	if (count > 0xFFFF) {
+
+		gsrSum = (uint32_t) ((uint64_t) gsrSum * 0xFFFF / count);
+		temperatureSum = temperatureSum * 0xFFFF / (int64_t) count;
+
+		count = 0xFFFF;
+	}
+
+	into.count = count;
+	into.gsrSum = gsrSum;
+	into.temperatureSum = (int32_t) temperatureSum;
+}
+
+
+//---PRIVATE---
+
+//apre la finestra che contiene il timestamp (allineata ai multipli della durata)
+void LwAggregator::begin(long timestamp) {
+
+	long offset = timestamp % _window;
+
+	//il resto di un timestamp negativo è negativo
+	if (offset < 0) {
+		offset += _window;
+	}
+
+	_windowStart = timestamp - offset;
+}
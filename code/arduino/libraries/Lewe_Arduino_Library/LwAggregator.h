@@ -0,0 +1,107 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LwAggregator.h
+ * @brief Riassunto delle letture per finestre temporali (minimo, massimo, media e numero di letture di GSR e temperatura)
+ * 
+ * Le finestre sono allineate ai multipli della loro durata (calcolata sui timestamp delle letture), per cui i
+ * riassunti di finestre consecutive sono contigui. La classe non dipende dall'hardware e si compila anche su Linux.
+ * 
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ * 
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef LWAGGREGATOR_H
+#define LWAGGREGATOR_H
+
+#include <Arduino.h>
+
+
+//---COSTANTI---
+/**
+ * @brief Durata di default della finestra (secondi)
+ */
+#define LW_AGGREGATOR_WINDOW 3600 //un riassunto ogni ora
+
+
+//---TIPI---
+/**
+ * @brief Riassunto delle letture di una finestra (temperature in decimi di grado)
+ */
+struct LwSummary {
+	long start; //timestamp della prima lettura
+	long end; //timestamp dell'ultima lettura
+	uint16_t count; //numero di letture
+	uint8_t gsrMin; //GSR minimo
+	uint8_t gsrMax; //GSR massimo
+	uint32_t gsrSum; //somma delle letture GSR
+	int16_t temperatureMin; //temperatura minima
+	int16_t temperatureMax; //temperatura massima
+	int32_t temperatureSum; //somma delle temperature
+
+	uint8_t gsrMean() const; //GSR medio
+	int16_t temperatureMean() const; //temperatura media (arrotondata)
+};
+
+
+//---LW AGGREGATOR---
+class LwAggregator {
+
+	public:
+
+		//costruttori
+		LwAggregator(long window); //costruttore con la durata della finestra
+		LwAggregator(); //costruttore
+
+		//letture
+		uint8_t add(long timestamp, uint8_t gsr, int16_t temperature); //aggiunge la lettura (1 se ha chiuso la finestra precedente)
+		uint8_t flush(); //chiude la finestra corrente (1 se conteneva letture)
+
+		//riassunti
+		uint8_t available(); //indica se c'è un riassunto completo da prelevare
+		LwSummary get(); //preleva il riassunto completo
+
+		uint16_t count(); //letture nella finestra corrente
+
+		void setWindow(long window); //imposta la durata della finestra (dalla prossima finestra)
+		long window(); //durata della finestra
+		void reset(); //scarta la finestra corrente e il riassunto non prelevato
+
+		static void merge(LwSummary &into, const LwSummary &from); //unisce due riassunti (la fedeltà diminuisce, la memoria no)
+
+
+	private:
+
+		void begin(long timestamp); //apre la finestra che contiene il timestamp
+
+		long _window; //durata della finestra (secondi)
+		long _windowStart; //inizio della finestra corrente
+
+		LwSummary _current; //finestra corrente
+		LwSummary _completed; //ultimo riassunto completo
+		uint8_t _completedAvailable; //indica se il riassunto completo non è ancora stato prelevato
+
+};
+
+
+#endif //LWAGGREGATOR_H
@@ -0,0 +1,321 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LwEnergy.cpp
+ * @brief Stima dei consumi del bracciale per componente a partire dagli eventi misurati
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <Arduino.h>
+#include "LwEnergy.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Millisecondi in un'ora (conversione da microampere per millisecondo a microampere ora)
+ */
+#define LW_ENERGY_HOUR 3600000.0
+
+
+//---STATIC---
+const LwEnergyCosts LwEnergy::DEFAULT_COSTS PROGMEM = {
+	LW_ENERGY_BASE_CURRENT, LW_ENERGY_CPU_CURRENT, LW_ENERGY_RADIO_AWAKE_CURRENT, LW_ENERGY_RADIO_ASLEEP_CURRENT,
+	LW_ENERGY_TX_CHARGE, LW_ENERGY_RX_CHARGE, LW_ENERGY_RTC_CHARGE, { 0 }
+};
+
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ *
+ * @param costs Tabella dei costi della scheda
+ */
+LwEnergy::LwEnergy(const LwEnergyCosts &costs) {
+
+	_costs = costs;
+
+	_sensorPowered = 0;
+	_lastLoop = 0;
+
+	_radioOnTime = 0;
+	_sent = 0;
+	_received = 0;
+
+	reset();
+}
+
+/**
+ * @brief Costruttore della classe (ridotto)
+ */
+LwEnergy::LwEnergy(): LwEnergy(LwEnergyCosts()) {
+
+	loadCosts(&DEFAULT_COSTS);
+}
+
+
+/**
+ * @brief Metodo che inizia la contabilizzazione (da chiamare nel setup, il tempo precedente non viene contato)
+ */
+void LwEnergy::begin() {
+
+	_lastLoop = millis();
+}
+
+/**
+ * @brief Metodo che conta il tempo passato dalla chiamata precedente come tempo con il microcontrollore sveglio
+ *
+ * Va chiamato ad ogni loop del firmware.
+ */
+void LwEnergy::loop() {
+
+	unsigned long now = millis();
+
+	_time += now - _lastLoop;
+	_lastLoop = now;
+}
+
+/**
+ * @brief Metodo che segnala l'accensione o lo spegnimento di un sensore
+ *
+ * @param index Posizione del sensore nella tabella dei costi (i sensori oltre LW_ENERGY_SENSORS vengono ignorati)
+ * @param on 1 se il sensore è stato acceso, 0 se è stato spento
+ */
+void LwEnergy::sensor(uint8_t index, uint8_t on) {
+
+	if (index >= LW_ENERGY_SENSORS) {
+		return;
+	}
+
+	uint8_t bit = 1 << index;
+
+	//accensione (ignoro le accensioni ripetute)
+	if (on && !(_sensorPowered & bit)) {
+
+		_sensorOn[index] = millis();
+		_sensorPowered |= bit;
+
+	//spegnimento
+	} else if (!on && (_sensorPowered & bit)) {
+
+		_sensorTime[index] += millis() - _sensorOn[index];
+		_sensorPowered &= ~bit;
+	}
+}
+
+/**
+ * @brief Metodo che segnala una lettura del RTC
+ */
+void LwEnergy::rtcRead() {
+
+	_rtcReads++;
+}
+
+/**
+ * @brief Metodo che aggiorna i totali del modulo bluetooth
+ *
+ * I totali sono quelli contati dalle librerie dall'avvio (LwRadio::onTime(), SoftwareSerialJack::bytesSent() e
+ * SoftwareSerialJack::bytesReceived()): la classe sottrae quelli dell'ultimo azzeramento.
+ *
+ * @param onTime Millisecondi con il modulo sveglio
+ * @param sent Caratteri inviati al modulo
+ * @param received Caratteri ricevuti dal modulo
+ */
+void LwEnergy::radio(unsigned long onTime, unsigned long sent, unsigned long received) {
+
+	_radioOnTime = onTime;
+	_sent = sent;
+	_received = received;
+}
+
+/**
+ * @brief Metodo che restituisce la carica consumata da un componente
+ *
+ * @param component Componente (LW_ENERGY_*)
+ *
+ * @return Carica consumata (microampere ora)
+ */
+double LwEnergy::charge(uint8_t component) {
+
+	//microampere per millisecondo
+	double charge = 0;
+
+	if (component == LW_ENERGY_BASE) {
+
+		charge = (double) _costs.base * _time;
+
+	} else if (component == LW_ENERGY_CPU) {
+
+		charge = (double) _costs.cpu * _time;
+
+	} else if (component == LW_ENERGY_RADIO) {
+
+		unsigned long awake = _radioOnTime - _radioOnTimeBase;
+
+		//il modulo può essere contato fino a un loop più avanti del microcontrollore
+		if (awake > _time) {
+			awake = _time;
+		}
+
+		charge = (double) _costs.radioAwake * awake + (double) _costs.radioAsleep * (_time - awake)
+			+ (double) _costs.tx * (_sent - _sentBase) + (double) _costs.rx * (_received - _receivedBase);
+
+	} else if (component == LW_ENERGY_SENSOR) {
+
+		for (uint8_t i = 0; i < LW_ENERGY_SENSORS; i++) {
+			charge += (double) _costs.sensor[i] * sensorTime(i);
+		}
+
+	} else if (component == LW_ENERGY_RTC) {
+
+		charge = (double) _costs.rtc * _rtcReads;
+	}
+
+	return charge / LW_ENERGY_HOUR;
+}
+
+/**
+ * @brief Metodo che restituisce la carica consumata in totale
+ *
+ * @return Carica consumata (microampere ora)
+ */
+double LwEnergy::charge() {
+
+	double total = 0;
+
+	for (uint8_t i = 0; i < LW_ENERGY_COMPONENTS; i++) {
+		total += charge(i);
+	}
+
+	return total;
+}
+
+/**
+ * @brief Metodo che restituisce l'assorbimento medio dall'inizio della contabilizzazione
+ *
+ * @return Assorbimento medio (microampere, 0 se non è ancora stato contato tempo)
+ */
+double LwEnergy::averageCurrent() {
+
+	if (_time == 0) {
+		return 0;
+	}
+
+	return charge() * LW_ENERGY_HOUR / _time;
+}
+
+/**
+ * @brief Metodo che restituisce la durata prevista di una batteria con l'assorbimento medio misurato
+ *
+ * @param capacity Capacità della batteria (milliampere ora)
+ *
+ * @return Durata prevista (ore, 0 se non è ancora stato contato tempo)
+ */
+double LwEnergy::batteryLife(double capacity) {
+
+	double current = averageCurrent();
+
+	if (current <= 0) {
+		return 0;
+	}
+
+	return capacity * 1000.0 / current;
+}
+
+/**
+ * @brief Metodo che restituisce il tempo contabilizzato
+ *
+ * @return Millisecondi contabilizzati dall'ultimo azzeramento
+ */
+unsigned long LwEnergy::time() {
+
+	return _time;
+}
+
+/**
+ * @brief Metodo che imposta la tabella dei costi (la stima viene ricalcolata sui contatori già misurati)
+ *
+ * @param costs Tabella dei costi della scheda
+ */
+void LwEnergy::setCosts(const LwEnergyCosts &costs) {
+
+	_costs = costs;
+}
+
+/**
+ * @brief Metodo che imposta una tabella dei costi costante (PROGMEM: sull'ATmega non occupa RAM oltre alla copia interna)
+ *
+ * @param costs Tabella dei costi della scheda nella memoria programma
+ */
+void LwEnergy::loadCosts(const LwEnergyCosts *costs) {
+
+	LW_ENERGY_COPY(&_costs, costs);
+}
+
+/**
+ * @brief Metodo che restituisce la tabella dei costi
+ *
+ * @return Tabella dei costi della scheda
+ */
+const LwEnergyCosts &LwEnergy::costs() {
+
+	return _costs;
+}
+
+/**
+ * @brief Metodo che azzera i contatori
+ *
+ * I sensori accesi restano accesi e vengono contati dall'azzeramento; i totali del modulo bluetooth correnti
+ * diventano lo zero dei successivi.
+ */
+void LwEnergy::reset() {
+
+	unsigned long now = millis();
+
+	_time = 0;
+	_rtcReads = 0;
+
+	for (uint8_t i = 0; i < LW_ENERGY_SENSORS; i++) {
+		_sensorTime[i] = 0;
+		_sensorOn[i] = now;
+	}
+
+	_radioOnTimeBase = _radioOnTime;
+	_sentBase = _sent;
+	_receivedBase = _received;
+}
+
+
+//---PRIVATE---
+
+//millisecondi con il sensore acceso (accensione corrente compresa)
+unsigned long LwEnergy::sensorTime(uint8_t index) {
+
+	if (_sensorPowered & (1 << index)) {
+		return _sensorTime[index] + (millis() - _sensorOn[index]);
+	}
+
+	return _sensorTime[index];
+}
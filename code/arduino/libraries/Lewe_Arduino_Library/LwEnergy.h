@@ -0,0 +1,212 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LwEnergy.h
+ * @brief Stima dei consumi del bracciale per componente a partire dagli eventi misurati
+ *
+ * La classe conta gli eventi (tempo con il microcontrollore sveglio, tempo da sveglio del modulo bluetooth e
+ * caratteri scambiati, tempo con ogni sensore acceso, letture del RTC) e li converte in carica con una tabella dei
+ * costi della scheda (LwEnergyCosts). I contatori sono interi: la carica viene calcolata solo quando viene richiesta,
+ * per cui la tabella può essere cambiata senza perdere le misure.
+ *
+ * Il microcontrollore non dorme: il tempo tra due chiamate di loop() è tempo da sveglio. La classe non dipende
+ * dall'hardware e si compila anche su Linux.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef LWENERGY_H
+#define LWENERGY_H
+
+#include <Arduino.h>
+
+//sull'AVR le tabelle dei costi costanti restano nella flash (vanno lette con loadCosts())
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define LW_ENERGY_COPY(costs, table) memcpy_P(costs, table, sizeof(LwEnergyCosts))
+#else
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#define LW_ENERGY_COPY(costs, table) memcpy(costs, table, sizeof(LwEnergyCosts))
+#endif
+
+
+//---COSTANTI---
+/**
+ * @brief Numero massimo di sensori contabilizzati
+ */
+#ifndef LW_ENERGY_SENSORS
+#define LW_ENERGY_SENSORS 4
+#endif
+
+static_assert(LW_ENERGY_SENSORS <= 8, "LW_ENERGY_SENSORS deve essere al massimo 8 (un bit per sensore acceso)");
+
+//tabella di default: ATmega328P a 16 MHz, HM-10 e DS1307 (valori indicativi dei datasheet, da sostituire con
+//quelli misurati sulla scheda)
+/**
+ * @brief Assorbimento fisso della scheda: regolatore, RTC a riposo (microampere)
+ */
+#ifndef LW_ENERGY_BASE_CURRENT
+#define LW_ENERGY_BASE_CURRENT 500
+#endif
+/**
+ * @brief Assorbimento del microcontrollore sveglio (microampere)
+ */
+#ifndef LW_ENERGY_CPU_CURRENT
+#define LW_ENERGY_CPU_CURRENT 12000
+#endif
+/**
+ * @brief Assorbimento del modulo bluetooth sveglio (microampere)
+ */
+#ifndef LW_ENERGY_RADIO_AWAKE_CURRENT
+#define LW_ENERGY_RADIO_AWAKE_CURRENT 8500
+#endif
+/**
+ * @brief Assorbimento del modulo bluetooth addormentato (microampere)
+ */
+#ifndef LW_ENERGY_RADIO_ASLEEP_CURRENT
+#define LW_ENERGY_RADIO_ASLEEP_CURRENT 400
+#endif
+/**
+ * @brief Carica in più per ogni carattere inviato dal modulo (microampere per millisecondo)
+ */
+#ifndef LW_ENERGY_TX_CHARGE
+#define LW_ENERGY_TX_CHARGE 4000 //circa 4 mA per la durata di un carattere a 9600 baud
+#endif
+/**
+ * @brief Carica in più per ogni carattere ricevuto dal modulo (microampere per millisecondo)
+ */
+#ifndef LW_ENERGY_RX_CHARGE
+#define LW_ENERGY_RX_CHARGE 2000
+#endif
+/**
+ * @brief Carica in più per ogni lettura del RTC (microampere per millisecondo)
+ */
+#ifndef LW_ENERGY_RTC_CHARGE
+#define LW_ENERGY_RTC_CHARGE 1500 //DS1307 attivo durante la lettura I2C (circa 1 ms a 100 kHz)
+#endif
+
+//componenti
+/**
+ * @brief Assorbimento fisso
+ */
+#define LW_ENERGY_BASE 0
+/**
+ * @brief Microcontrollore
+ */
+#define LW_ENERGY_CPU 1
+/**
+ * @brief Modulo bluetooth (sveglio, addormentato e caratteri scambiati)
+ */
+#define LW_ENERGY_RADIO 2
+/**
+ * @brief Sensori
+ */
+#define LW_ENERGY_SENSOR 3
+/**
+ * @brief Letture del RTC
+ */
+#define LW_ENERGY_RTC 4
+/**
+ * @brief Numero di componenti
+ */
+#define LW_ENERGY_COMPONENTS 5
+
+
+//---TIPI---
+/**
+ * @brief Tabella dei costi di una scheda (correnti in microampere, cariche per evento in microampere per millisecondo)
+ */
+struct LwEnergyCosts {
+	uint16_t base; //assorbimento fisso
+	uint16_t cpu; //microcontrollore sveglio
+	uint16_t radioAwake; //modulo sveglio
+	uint16_t radioAsleep; //modulo addormentato
+	uint16_t tx; //carica per carattere inviato
+	uint16_t rx; //carica per carattere ricevuto
+	uint16_t rtc; //carica per lettura del RTC
+	uint16_t sensor[LW_ENERGY_SENSORS]; //sensori accesi (nell'ordine del registro del firmware)
+};
+
+
+//---LW ENERGY---
+class LwEnergy {
+
+	public:
+
+		//costruttori
+		LwEnergy(const LwEnergyCosts &costs); //costruttore con la tabella dei costi
+		LwEnergy(); //costruttore (tabella di default, sensori senza assorbimento)
+
+		//eventi
+		void begin(); //inizia la contabilizzazione
+		void loop(); //conta il tempo da sveglio del microcontrollore
+		void sensor(uint8_t index, uint8_t on); //accensione/spegnimento di un sensore
+		void rtcRead(); //lettura del RTC
+		void radio(unsigned long onTime, unsigned long sent, unsigned long received); //totali del modulo bluetooth
+
+		//stima
+		double charge(uint8_t component); //carica consumata dal componente (microampere ora)
+		double charge(); //carica consumata in totale (microampere ora)
+		double averageCurrent(); //assorbimento medio (microampere)
+		double batteryLife(double capacity); //durata prevista della batteria (ore, capacità in milliampere ora)
+		unsigned long time(); //millisecondi contabilizzati
+
+		//tabella dei costi
+		void setCosts(const LwEnergyCosts &costs); //imposta la tabella dei costi
+		void loadCosts(const LwEnergyCosts *costs); //imposta la tabella dei costi dalla memoria programma (PROGMEM)
+		const LwEnergyCosts &costs(); //tabella dei costi
+
+		void reset(); //azzera i contatori (i sensori accesi restano accesi)
+
+		static const LwEnergyCosts DEFAULT_COSTS; //tabella di default (PROGMEM)
+
+
+	private:
+
+		unsigned long sensorTime(uint8_t index); //millisecondi con il sensore acceso (accensione corrente compresa)
+
+		LwEnergyCosts _costs; //tabella dei costi
+
+		unsigned long _lastLoop; //ultima chiamata di loop()
+		unsigned long _time; //millisecondi contabilizzati (microcontrollore sveglio)
+
+		unsigned long _sensorTime[LW_ENERGY_SENSORS]; //millisecondi con il sensore acceso (accensioni concluse)
+		unsigned long _sensorOn[LW_ENERGY_SENSORS]; //istante dell'accensione
+		uint8_t _sensorPowered; //sensori accesi (un bit per sensore)
+
+		unsigned long _rtcReads; //letture del RTC
+
+		unsigned long _radioOnTime; //millisecondi con il modulo sveglio
+		unsigned long _sent; //caratteri inviati
+		unsigned long _received; //caratteri ricevuti
+		unsigned long _radioOnTimeBase; //millisecondi con il modulo sveglio all'ultimo azzeramento
+		unsigned long _sentBase; //caratteri inviati all'ultimo azzeramento
+		unsigned long _receivedBase; //caratteri ricevuti all'ultimo azzeramento
+
+};
+
+
+#endif //LWENERGY_H
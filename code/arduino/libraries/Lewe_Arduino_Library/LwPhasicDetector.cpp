@@ -0,0 +1,279 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LwPhasicDetector.cpp
+ * @brief Rilevamento in streaming delle risposte fasiche del GSR (inizio, ampiezza, salita e recupero)
+ * 
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ * 
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <Arduino.h>
+#include "LwPhasicDetector.h"
+
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ * 
+ * @param threshold Salita minima di una risposta (unità delle letture)
+ * @param noise Discesa dal picco oltre la quale il picco è confermato (unità delle letture)
+ */
+LwPhasicDetector::LwPhasicDetector(int16_t threshold, int16_t noise) {
+
+	setThreshold(threshold, noise);
+
+	reset();
+}
+
+/**
+ * @brief Costruttore della classe (ridotto)
+ */
+LwPhasicDetector::LwPhasicDetector(): LwPhasicDetector(LW_PHASIC_THRESHOLD, LW_PHASIC_NOISE) {}
+
+
+/**
+ * @brief Metodo che aggiunge una lettura
+ * 
+ * Le letture vanno aggiunte in ordine di tempo, a intervalli regolari (le costanti di tempo delle medie mobili
+ * sono espresse in letture). Se una risposta viene chiusa diventa disponibile (sovrascrive quella precedente se
+ * non è stata prelevata).
+ * 
+ * @param time Istante della lettura (millisecondi)
+ * @param value Lettura
+ * 
+ * @return 1 se è stata chiusa una risposta, 0 altrimenti
+ */
+uint8_t LwPhasicDetector::add(unsigned long time, int16_t value) {
+
+	int32_t level = (int32_t) value << LW_PHASIC_FRACTION_BITS;
+
+	//prima lettura: le medie partono dal valore letto
+	if (!_started) {
+
+		_started = 1;
+		_smooth = level;
+		_baseline = level;
+		_trough = level;
+		_troughTime = time;
+
+		return 0;
+	}
+
+	_smooth += (level - _smooth) >> LW_PHASIC_SMOOTH_SHIFT;
+
+	uint8_t closed = 0;
+
+	switch (_state) {
+
+		case LW_PHASIC_IDLE:
+
+			//la linea di base segue solo la componente tonica
+			_baseline += (_smooth - _baseline) >> LW_PHASIC_BASELINE_SHIFT;
+
+			//nuovo minimo (il minimo più vecchio della salita massima non può essere l'inizio di una risposta)
+			if (_smooth <= _trough || time - _troughTime > LW_PHASIC_MAX_RISE) {
+				_trough = _smooth;
+				_troughTime = time;
+
+			} else if (_smooth - _trough >= _threshold) {
+				begin(_troughTime, _trough, time);
+
+				//letture ancora nel rumore del minimo: la salita non è ancora iniziata
+			} else if (_smooth - _trough < _noise) {
+				_troughTime = time;
+			}
+
+			break;
+
+		case LW_PHASIC_RISING:
+
+			if (_smooth > _peak) {
+				_peak = _smooth;
+				_peakTime = time;
+
+				//picco confermato: il minimo riparte dalla lettura corrente per le risposte sovrapposte
+			} else if (_peak - _smooth >= _noise) {
+				_state = LW_PHASIC_RECOVERING;
+				_trough = _smooth;
+				_troughTime = time;
+			}
+
+			break;
+
+		case LW_PHASIC_RECOVERING:
+
+			//recupero di metà dell'ampiezza
+			if (_smooth <= _peak - (_peak - _onsetLevel) / 2) {
+
+				uint32_t recovery = time - _peakTime;
+
+				complete(recovery < 0xFFFF ? recovery : 0xFFFF);
+				closed = 1;
+
+				_trough = _smooth;
+				_troughTime = time;
+
+			} else if (_smooth <= _trough) {
+				_trough = _smooth;
+				_troughTime = time;
+
+				//nuova risposta prima del recupero
+			} else if (_smooth - _trough >= _threshold) {
+
+				complete(0);
+				closed = 1;
+
+				begin(_troughTime, _trough, time);
+
+			} else if (_smooth - _trough < _noise) {
+				_troughTime = time;
+			}
+
+			break;
+	}
+
+	//risposta senza picco o senza recupero
+	if (_state != LW_PHASIC_IDLE && time - _peakTime > LW_PHASIC_MAX_RECOVERY) {
+
+		complete(0);
+		closed = 1;
+
+		_trough = _smooth;
+		_troughTime = time;
+	}
+
+	return closed;
+}
+
+/**
+ * @brief Metodo che indica se c'è una risposta chiusa non ancora prelevata
+ * 
+ * @return 1 se c'è una risposta, 0 altrimenti
+ */
+uint8_t LwPhasicDetector::available() {
+	return _completedAvailable;
+}
+
+/**
+ * @brief Metodo che preleva l'ultima risposta chiusa
+ * 
+ * @return Risposta
+ */
+LwPhasicEvent LwPhasicDetector::get() {
+
+	_completedAvailable = 0;
+
+	return _completed;
+}
+
+/**
+ * @brief Metodo che restituisce lo stato del rilevatore
+ * 
+ * @return LW_PHASIC_IDLE, LW_PHASIC_RISING o LW_PHASIC_RECOVERING
+ */
+uint8_t LwPhasicDetector::state() {
+	return _state;
+}
+
+/**
+ * @brief Metodo che restituisce la linea di base corrente
+ * 
+ * @return Linea di base (unità delle letture, arrotondata)
+ */
+int16_t LwPhasicDetector::baseline() {
+	return (int16_t) ((_baseline + (1 << (LW_PHASIC_FRACTION_BITS - 1))) >> LW_PHASIC_FRACTION_BITS);
+}
+
+/**
+ * @brief Metodo che imposta la soglia e il rumore (dalla prossima lettura)
+ * 
+ * @param threshold Salita minima di una risposta (unità delle letture)
+ * @param noise Discesa dal picco oltre la quale il picco è confermato (unità delle letture)
+ */
+void LwPhasicDetector::setThreshold(int16_t threshold, int16_t noise) {
+
+	//la soglia deve essere positiva
+	_threshold = (int32_t) (threshold > 0 ? threshold : 1) << LW_PHASIC_FRACTION_BITS;
+	_noise = (int32_t) (noise > 0 ? noise : 1) << LW_PHASIC_FRACTION_BITS;
+}
+
+/**
+ * @brief Metodo che scarta lo stato (le medie ripartono dalla prossima lettura) e la risposta non prelevata
+ */
+void LwPhasicDetector::reset() {
+
+	_started = 0;
+	_state = LW_PHASIC_IDLE;
+	_smooth = 0;
+	_baseline = 0;
+	_trough = 0;
+	_troughTime = 0;
+	_onset = 0;
+	_onsetLevel = 0;
+	_onsetBaseline = 0;
+	_peak = 0;
+	_peakTime = 0;
+
+	_completedAvailable = 0;
+}
+
+
+//---PRIVATE---
+
+/**
+ * @brief Metodo che apre una risposta (il picco parte dalla lettura corrente)
+ * 
+ * @param onset Istante di inizio
+ * @param level Livello all'inizio (con la parte frazionaria)
+ * @param time Istante della lettura corrente
+ */
+void LwPhasicDetector::begin(unsigned long onset, int32_t level, unsigned long time) {
+
+	_state = LW_PHASIC_RISING;
+	_onset = onset;
+	_onsetLevel = level;
+	_onsetBaseline = _baseline;
+	_peak = _smooth;
+	_peakTime = time;
+}
+
+/**
+ * @brief Metodo che chiude la risposta in corso e la rende disponibile
+ * 
+ * @param recoveryTime Tempo tra il picco e il recupero di metà dell'ampiezza (0 = non recuperata)
+ */
+void LwPhasicDetector::complete(uint16_t recoveryTime) {
+
+	unsigned long rise = _peakTime - _onset;
+
+	_completed.onset = _onset;
+	_completed.baseline = (int16_t) ((_onsetBaseline + (1 << (LW_PHASIC_FRACTION_BITS - 1))) >> LW_PHASIC_FRACTION_BITS);
+	_completed.amplitude = (int16_t) ((_peak - _onsetLevel + (1 << (LW_PHASIC_FRACTION_BITS - 1))) >> LW_PHASIC_FRACTION_BITS);
+	_completed.riseTime = rise < 0xFFFF ? rise : 0xFFFF;
+	_completed.recoveryTime = recoveryTime;
+	_completedAvailable = 1;
+
+	_state = LW_PHASIC_IDLE;
+}
@@ -0,0 +1,164 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LwPhasicDetector.h
+ * @brief Rilevamento in streaming delle risposte fasiche del GSR (inizio, ampiezza, salita e recupero)
+ * 
+ * Il rilevatore riceve le letture sovracampionate del GSR una alla volta e usa memoria costante: una media mobile
+ * esponenziale breve per il rumore, una lenta per la linea di base (aggiornata solo fuori dalle risposte) e lo
+ * stato della risposta in corso.
+ * 
+ * Una risposta inizia dal minimo delle letture recenti (al massimo LW_PHASIC_MAX_RISE millisecondi prima) quando
+ * le letture salgono di almeno la soglia; il picco è confermato quando le letture scendono di più del rumore. La
+ * risposta si chiude al recupero di metà dell'ampiezza, all'inizio di una nuova risposta sovrapposta o dopo
+ * LW_PHASIC_MAX_RECOVERY millisecondi dal picco (tempo di recupero 0). La classe non dipende dall'hardware e si
+ * compila anche su Linux.
+ * 
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ * 
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef LWPHASICDETECTOR_H
+#define LWPHASICDETECTOR_H
+
+#include <Arduino.h>
+
+
+//---COSTANTI---
+/**
+ * @brief Salita minima di una risposta (unità delle letture, valore di default)
+ */
+#define LW_PHASIC_THRESHOLD 5
+/**
+ * @brief Discesa dal picco oltre la quale il picco è confermato (unità delle letture, valore di default)
+ */
+#define LW_PHASIC_NOISE 2
+/**
+ * @brief Durata massima della salita (millisecondi)
+ */
+#ifndef LW_PHASIC_MAX_RISE
+#define LW_PHASIC_MAX_RISE 5000
+#endif
+/**
+ * @brief Tempo massimo tra il picco e il recupero di metà dell'ampiezza (millisecondi, al massimo 65535)
+ */
+#ifndef LW_PHASIC_MAX_RECOVERY
+#define LW_PHASIC_MAX_RECOVERY 30000
+#endif
+/**
+ * @brief Costante di tempo della media mobile del rumore (2^n letture)
+ */
+#ifndef LW_PHASIC_SMOOTH_SHIFT
+#define LW_PHASIC_SMOOTH_SHIFT 1
+#endif
+/**
+ * @brief Costante di tempo della linea di base (2^n letture)
+ */
+#ifndef LW_PHASIC_BASELINE_SHIFT
+#define LW_PHASIC_BASELINE_SHIFT 7
+#endif
+/**
+ * @brief Bit della parte frazionaria delle medie mobili
+ */
+#define LW_PHASIC_FRACTION_BITS 4
+
+//stato del rilevatore
+/**
+ * @brief Nessuna risposta in corso
+ */
+#define LW_PHASIC_IDLE 0
+/**
+ * @brief Risposta in salita
+ */
+#define LW_PHASIC_RISING 1
+/**
+ * @brief Risposta in recupero
+ */
+#define LW_PHASIC_RECOVERING 2
+
+
+//---TIPI---
+/**
+ * @brief Risposta fasica rilevata (valori nelle unità delle letture, tempi in millisecondi)
+ */
+struct LwPhasicEvent {
+	unsigned long onset; //istante di inizio della risposta
+	int16_t baseline; //linea di base all'inizio della risposta
+	int16_t amplitude; //ampiezza (picco meno livello all'inizio)
+	uint16_t riseTime; //tempo tra l'inizio e il picco
+	uint16_t recoveryTime; //tempo tra il picco e il recupero di metà dell'ampiezza (0 = non recuperata)
+};
+
+
+//---LW PHASIC DETECTOR---
+class LwPhasicDetector {
+
+	public:
+
+		//costruttori
+		LwPhasicDetector(int16_t threshold, int16_t noise); //costruttore con soglia e rumore
+		LwPhasicDetector(); //costruttore
+
+		//letture
+		uint8_t add(unsigned long time, int16_t value); //aggiunge una lettura (1 se ha chiuso una risposta)
+
+		//risposte
+		uint8_t available(); //indica se c'è una risposta da prelevare
+		LwPhasicEvent get(); //preleva la risposta
+
+		uint8_t state(); //stato del rilevatore
+		int16_t baseline(); //linea di base corrente
+
+		void setThreshold(int16_t threshold, int16_t noise); //imposta soglia e rumore
+		void reset(); //scarta lo stato e la risposta non prelevata
+
+
+	private:
+
+		void begin(unsigned long onset, int32_t level, unsigned long time); //apre una risposta
+		void complete(uint16_t recoveryTime); //chiude la risposta in corso
+
+		int32_t _threshold; //salita minima (con la parte frazionaria)
+		int32_t _noise; //discesa che conferma il picco (con la parte frazionaria)
+
+		uint8_t _started; //indica se è stata ricevuta almeno una lettura
+		uint8_t _state; //stato del rilevatore
+		int32_t _smooth; //media mobile delle letture
+		int32_t _baseline; //linea di base
+
+		int32_t _trough; //minimo recente (inizio della prossima risposta)
+		unsigned long _troughTime; //istante del minimo recente
+
+		unsigned long _onset; //inizio della risposta in corso
+		int32_t _onsetLevel; //livello all'inizio della risposta in corso
+		int32_t _onsetBaseline; //linea di base all'inizio della risposta in corso
+		int32_t _peak; //picco della risposta in corso
+		unsigned long _peakTime; //istante del picco
+
+		LwPhasicEvent _completed; //ultima risposta chiusa
+		uint8_t _completedAvailable; //indica se la risposta chiusa non è ancora stata prelevata
+
+};
+
+
+#endif //LWPHASICDETECTOR_H
@@ -0,0 +1,377 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LwRadio.cpp
+ * @brief Gestione dell'alimentazione del modulo bluetooth HM-10: sonno tra finestre di sincronizzazione prevedibili
+ * 
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ * 
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <Arduino.h>
+#include "LwRadio.h"
+
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ * 
+ * @param serial Seriale del modulo (la stessa usata da SoftwareSerialJack)
+ * @param period Periodo delle finestre (millisecondi)
+ * @param window Durata minima delle finestre (millisecondi)
+ */
+LwRadio::LwRadio(Stream &serial, unsigned long period, unsigned long window) {
+
+	_serial = &serial;
+
+	_period = period;
+	_window = window;
+	_clock = 0;
+	_clockMillis = 0;
+	_enabled = 1;
+
+	_state = LW_RADIO_AWAKE;
+	_command = 0;
+	_timeCommand = 0;
+	_windowStart = 0;
+	_periodStart = 0;
+	_timeLastTraffic = 0;
+	_heard = 0;
+
+	_onTime = 0;
+	_wakeups = 0;
+	_trafficWakeups = 0;
+}
+
+/**
+ * @brief Costruttore della classe (ridotto)
+ * 
+ * @param serial Seriale del modulo (la stessa usata da SoftwareSerialJack)
+ */
+LwRadio::LwRadio(Stream &serial): LwRadio(serial, LW_RADIO_PERIOD, LW_RADIO_WINDOW) {}
+
+
+/**
+ * @brief Metodo che configura il modulo
+ * 
+ * Abilita la notifica del collegamento (AT+NOTI1: il modulo addormentato si sveglia e invia OK+CONN quando il
+ * telefono si collega) e apre la prima finestra: all'avvio il telefono può sincronizzarsi subito.
+ */
+void LwRadio::begin() {
+
+	unsigned long now = millis();
+
+	_serial->print("AT+NOTI1");
+
+	_state = LW_RADIO_AWAKE;
+	_windowStart = now;
+	_timeLastTraffic = now;
+	_periodStart = now - phase(now);
+	_heard = 0;
+
+	_wakeups++;
+}
+
+/**
+ * @brief Metodo che gestisce le finestre e il sonno del modulo (da chiamare ad ogni loop)
+ * 
+ * Il modulo addormentato viene svegliato all'inizio di ogni finestra o quando ci sono caratteri in arrivo (il
+ * telefono si è collegato). La finestra si chiude dopo la durata minima se non ci sono messaggi da confermare e
+ * non c'è traffico da LW_RADIO_LINGER millisecondi; i messaggi da confermare la prolungano solo se il telefono ha
+ * risposto (altrimenti vengono reinviati alla finestra successiva), in ogni caso al massimo fino a
+ * LW_RADIO_MAX_WINDOW.
+ * 
+ * @param pending Messaggi da inviare o da confermare (BasicJack::pending())
+ * 
+ * @return 1 se il loop di Jack può essere eseguito, 0 altrimenti
+ */
+uint8_t LwRadio::loop(uint8_t pending) {
+
+	unsigned long now = millis();
+
+	//il riferimento dell'orologio resta vicino a millis()
+	if (now - _clockMillis >= LW_RADIO_CLOCK_REFRESH) {
+		refreshClock(now);
+	}
+
+	//modulo addormentato: lo sveglio se il telefono si è collegato o se inizia una finestra
+	if (_state == LW_RADIO_ASLEEP) {
+
+		if (_serial->available()) {
+			wake(1);
+		} else if (!_enabled || now - _periodStart >= _period) {
+			wake(0);
+		}
+
+	//comandi AT per il sonno: un comando ogni LW_RADIO_COMMAND_DELAY millisecondi
+	} else if (_state == LW_RADIO_SLEEPING) {
+
+		if (now - _timeCommand >= LW_RADIO_COMMAND_DELAY) {
+
+			_timeCommand = now;
+
+			if (_command == 1) {
+
+				_serial->print("AT+SLEEP");
+				_command = 2;
+
+				//il modulo dorme dopo AT+SLEEP
+				_onTime += now - _windowStart;
+
+			} else {
+
+				//scarto le risposte ai comandi (OK, OK+LOST, OK+SLEEP)
+				skipResponses();
+
+				//i messaggi del telefono arrivati durante i comandi restano per SoftwareSerialJack: riapro la finestra
+				//(il modulo dorme già, serve la stringa di sveglia) e Jack parte subito
+				if (_serial->available()) {
+					wake(0);
+					_heard = 1;
+				} else {
+					_state = LW_RADIO_ASLEEP;
+				}
+			}
+		}
+
+	//modulo sveglio: chiudo la finestra se non serve più
+	} else if (_enabled) {
+
+		unsigned long elapsed = now - _windowStart;
+
+		if (elapsed >= LW_RADIO_MAX_WINDOW ||
+			(elapsed >= _window && now - _timeLastTraffic >= LW_RADIO_LINGER && (!pending || !_heard))) {
+			sleep();
+		}
+	}
+
+	return ready();
+}
+
+/**
+ * @brief Metodo che indica se il loop di Jack può essere eseguito
+ * 
+ * Nelle finestre previste Jack parte dopo LW_RADIO_SETTLE millisecondi (il tempo di collegamento del telefono) o
+ * appena il telefono risponde, così i messaggi accodati vengono inviati tutti insieme al telefono già collegato;
+ * nelle finestre aperte dal traffico parte subito.
+ * 
+ * @return 1 se il modulo è sveglio e pronto, 0 altrimenti
+ */
+uint8_t LwRadio::ready() {
+	return _state == LW_RADIO_AWAKE && (_heard || !_enabled || millis() - _windowStart >= LW_RADIO_SETTLE);
+}
+
+/**
+ * @brief Metodo che segnala traffico con il telefono (da chiamare negli handler di Jack)
+ * 
+ * Il traffico prolunga la finestra di LW_RADIO_LINGER millisecondi e le permette di restare aperta finchè ci sono
+ * messaggi da confermare.
+ */
+void LwRadio::traffic() {
+
+	_timeLastTraffic = millis();
+	_heard = 1;
+}
+
+
+/**
+ * @brief Metodo che imposta periodo e durata minima delle finestre
+ * 
+ * @param period Periodo delle finestre (millisecondi, maggiore di 0)
+ * @param window Durata minima delle finestre (millisecondi)
+ */
+void LwRadio::setSchedule(unsigned long period, unsigned long window) {
+
+	_period = period > 0 ? period : LW_RADIO_PERIOD;
+	_window = window;
+
+	//la finestra corrente resta quella in corso (la prossima parte al prossimo multiplo del nuovo periodo)
+	unsigned long now = millis();
+
+	_periodStart = now - phase(now);
+}
+
+/**
+ * @brief Metodo che allinea le finestre all'orologio indicato
+ * 
+ * Le finestre iniziano quando il timestamp è multiplo del periodo (es. ogni 5 minuti esatti dell'orologio): il
+ * telefono, che conosce il periodo, sa quando collegarsi. Va chiamato quando cambia l'orologio (all'avvio o
+ * quando viene impostato); setSchedule() mantiene l'allineamento.
+ * 
+ * @param timestamp Istante corrente dell'orologio (secondi)
+ */
+void LwRadio::align(long timestamp) {
+
+	_clock = timestamp;
+	_clockMillis = millis();
+
+	//la finestra corrente resta quella in corso
+	_periodStart = _clockMillis - phase(_clockMillis);
+}
+
+/**
+ * @brief Metodo che restituisce il tempo che manca all'inizio della prossima finestra
+ * 
+ * @return Millisecondi all'inizio della prossima finestra
+ */
+unsigned long LwRadio::nextWindow() {
+	return _period - phase(millis());
+}
+
+/**
+ * @brief Metodo che abilita/disabilita il sonno del modulo
+ * 
+ * Con il sonno disabilitato il modulo viene svegliato (se dorme) e resta sveglio, e Jack viene eseguito sempre.
+ * 
+ * @param enabled 1 per abilitare il sonno, 0 per disabilitarlo
+ */
+void LwRadio::setEnabled(uint8_t enabled) {
+	_enabled = enabled;
+}
+
+
+/**
+ * @brief Metodo che restituisce lo stato del modulo
+ * 
+ * @return Stato (LW_RADIO_AWAKE, LW_RADIO_SLEEPING o LW_RADIO_ASLEEP)
+ */
+uint8_t LwRadio::state() {
+	return _state;
+}
+
+/**
+ * @brief Metodo che restituisce il tempo passato con il modulo sveglio
+ * 
+ * Comprende l'invio dei comandi per il sonno fino a AT+SLEEP.
+ * 
+ * @return Millisecondi con il modulo sveglio
+ */
+unsigned long LwRadio::onTime() {
+
+	//finestra aperta o sonno non ancora richiesto
+	if (_state == LW_RADIO_AWAKE || (_state == LW_RADIO_SLEEPING && _command == 1)) {
+		return _onTime + (millis() - _windowStart);
+	}
+
+	return _onTime;
+}
+
+/**
+ * @brief Metodo che restituisce le finestre aperte
+ * 
+ * @return Numero di finestre (comprese quelle aperte dal traffico)
+ */
+unsigned long LwRadio::wakeups() {
+	return _wakeups;
+}
+
+/**
+ * @brief Metodo che restituisce le finestre aperte dal traffico del telefono
+ * 
+ * @return Numero di finestre aperte dal traffico
+ */
+unsigned long LwRadio::trafficWakeups() {
+	return _trafficWakeups;
+}
+
+
+//---PRIVATE---
+
+//apre una finestra (byTraffic: il telefono è già collegato, il modulo si è svegliato da solo)
+void LwRadio::wake(uint8_t byTraffic) {
+
+	unsigned long now = millis();
+
+	//stringa di sveglia (più di 80 caratteri, fuori dai delimitatori dei messaggi)
+	if (!byTraffic) {
+		for (uint8_t i = 0; i < LW_RADIO_WAKE_LENGTH; i++) {
+			_serial->print('W');
+		}
+	}
+
+	_state = LW_RADIO_AWAKE;
+	_windowStart = now;
+	_timeLastTraffic = now;
+	_periodStart = now - phase(now);
+	_heard = byTraffic;
+
+	_wakeups++;
+
+	if (byTraffic) {
+		_trafficWakeups++;
+	}
+}
+
+//avvia i comandi AT per il sonno (AT chiude la connessione se c'è, AT+SLEEP viene inviato al prossimo passo)
+void LwRadio::sleep() {
+
+	_serial->print("AT");
+
+	_state = LW_RADIO_SLEEPING;
+	_command = 1;
+	_timeCommand = millis();
+}
+
+//scarta le risposte ai comandi AT in testa alla seriale (OK seguito da + e lettere maiuscole): i messaggi Jack
+//iniziano con il delimitatore e restano sulla seriale
+void LwRadio::skipResponses() {
+
+	while (_serial->available() && _serial->peek() == 'O') {
+
+		_serial->read();
+
+		while (_serial->available()) {
+
+			int c = _serial->peek();
+
+			if (c != '+' && (c < 'A' || c > 'Z')) {
+				break;
+			}
+
+			_serial->read();
+		}
+	}
+}
+
+//sposta il riferimento dell'orologio a pochi millisecondi da now e porta l'inizio dell'ultima finestra servita al
+//massimo un periodo indietro (tutti i confronti usano differenze di millis(), corrette anche quando millis() riparte
+//da 0 dopo circa 49,7 giorni, purchè restino sotto quel limite)
+void LwRadio::refreshClock(unsigned long now) {
+
+	unsigned long seconds = (now - _clockMillis) / 1000;
+
+	_clock += seconds;
+	_clockMillis += seconds * 1000;
+
+	unsigned long periods = (now - _periodStart) / _period;
+
+	if (periods > 1) {
+		_periodStart += (periods - 1) * _period;
+	}
+}
+
+//millisecondi trascorsi dall'ultimo inizio di finestra (multiplo del periodo sull'orologio)
+unsigned long LwRadio::phase(unsigned long now) {
+	return (unsigned long) ((((uint64_t) _clock * 1000) + (now - _clockMillis)) % _period);
+}
@@ -0,0 +1,166 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+   
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LwRadio.h
+ * @brief Gestione dell'alimentazione del modulo bluetooth HM-10: sonno tra finestre di sincronizzazione prevedibili
+ * 
+ * Il modulo viene addormentato con i comandi AT (AT seguito da AT+SLEEP: il primo chiude la connessione se c'è) e
+ * svegliato con una stringa di più di 80 caratteri. Le finestre iniziano ai multipli del periodo sull'orologio
+ * indicato con align() (es. ogni 5 minuti del RTC), per cui il telefono sa quando collegarsi. Una finestra resta
+ * aperta almeno per la sua durata e finchè ci sono messaggi da confermare o traffico recente, al massimo per
+ * LW_RADIO_MAX_WINDOW millisecondi.
+ * 
+ * Nel sonno il modulo resta visibile e si sveglia quando il telefono si collega (con AT+NOTI1 segnala OK+CONN):
+ * i caratteri ricevuti mentre il modulo dorme aprono subito una finestra. Le risposte ai comandi AT e i caratteri
+ * della stringa di sveglia sono fuori dai delimitatori dei messaggi Jack e vengono ignorati da SoftwareSerialJack;
+ * prima del sonno vengono scartate solo le risposte ai comandi AT, i messaggi del telefono arrivati nel frattempo
+ * restano sulla seriale e riaprono la finestra.
+ * 
+ * Il loop di Jack va eseguito solo quando ready() restituisce 1: i messaggi accodati, gli ACK e i reinvii vengono
+ * così raggruppati nelle finestre. La classe non dipende dall'hardware e si compila anche su Linux.
+ * 
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ * 
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef LWRADIO_H
+#define LWRADIO_H
+
+#include <Arduino.h>
+
+
+//---COSTANTI---
+/**
+ * @brief Periodo di default delle finestre di sincronizzazione (millisecondi)
+ */
+#define LW_RADIO_PERIOD 300000 //una finestra ogni 5 minuti
+/**
+ * @brief Durata minima di default di una finestra (millisecondi)
+ */
+#define LW_RADIO_WINDOW 3000
+/**
+ * @brief Durata massima di una finestra (millisecondi)
+ */
+#ifndef LW_RADIO_MAX_WINDOW
+#define LW_RADIO_MAX_WINDOW 30000
+#endif
+/**
+ * @brief Tempo senza traffico dopo il quale la finestra può chiudersi (millisecondi)
+ */
+#ifndef LW_RADIO_LINGER
+#define LW_RADIO_LINGER 1000
+#endif
+/**
+ * @brief Attesa del collegamento del telefono dopo l'apertura di una finestra prima di eseguire Jack (millisecondi)
+ */
+#ifndef LW_RADIO_SETTLE
+#define LW_RADIO_SETTLE 1000
+#endif
+/**
+ * @brief Attesa tra due comandi AT (millisecondi)
+ */
+#define LW_RADIO_COMMAND_DELAY 200
+/**
+ * @brief Lunghezza della stringa che sveglia il modulo (più di 80 caratteri)
+ */
+#define LW_RADIO_WAKE_LENGTH 81
+/**
+ * @brief Intervallo tra due aggiornamenti del riferimento dell'orologio delle finestre (millisecondi)
+ */
+#define LW_RADIO_CLOCK_REFRESH 3600000 //le differenze di millis() restano piccole anche dopo che millis() riparte da 0
+
+//stato del modulo
+/**
+ * @brief Modulo sveglio (finestra aperta)
+ */
+#define LW_RADIO_AWAKE 0
+/**
+ * @brief Comandi AT per il sonno in corso
+ */
+#define LW_RADIO_SLEEPING 1
+/**
+ * @brief Modulo addormentato
+ */
+#define LW_RADIO_ASLEEP 2
+
+
+//---LW RADIO---
+class LwRadio {
+
+	public:
+
+		//costruttori
+		LwRadio(Stream &serial, unsigned long period, unsigned long window); //costruttore con periodo e durata delle finestre
+		LwRadio(Stream &serial); //costruttore
+
+		//loop
+		void begin(); //configura il modulo e lo addormenta fino alla prima finestra
+		uint8_t loop(uint8_t pending); //gestisce finestre e sonno (pending: messaggi da confermare), restituisce ready()
+		uint8_t ready(); //indica se il loop di Jack può essere eseguito
+		void traffic(); //segnala traffico con il telefono (prolunga la finestra)
+
+		//finestre
+		void setSchedule(unsigned long period, unsigned long window); //imposta periodo e durata minima delle finestre
+		void align(long timestamp); //allinea le finestre ai multipli del periodo dell'orologio (timestamp in secondi)
+		unsigned long nextWindow(); //millisecondi all'inizio della prossima finestra
+		void setEnabled(uint8_t enabled); //abilita/disabilita il sonno (disabilitato il modulo resta sveglio)
+
+		//stato e contatori
+		uint8_t state(); //stato del modulo (LW_RADIO_*)
+		unsigned long onTime(); //millisecondi con il modulo sveglio
+		unsigned long wakeups(); //finestre aperte
+		unsigned long trafficWakeups(); //finestre aperte dal traffico del telefono
+
+
+	private:
+
+		void wake(uint8_t byTraffic); //apre una finestra
+		void sleep(); //avvia i comandi AT per il sonno
+		void skipResponses(); //scarta le risposte ai comandi AT (lascia sulla seriale i messaggi Jack)
+		void refreshClock(unsigned long now); //avvicina il riferimento dell'orologio a millis()
+		unsigned long phase(unsigned long now); //millisecondi trascorsi dall'ultimo inizio di finestra dell'orologio
+
+		Stream *_serial; //seriale del modulo
+
+		unsigned long _period; //periodo delle finestre (millisecondi)
+		unsigned long _window; //durata minima delle finestre (millisecondi)
+		long _clock; //timestamp del riferimento dell'orologio (secondi)
+		unsigned long _clockMillis; //millis() del riferimento dell'orologio
+		uint8_t _enabled; //sonno abilitato
+
+		uint8_t _state; //stato del modulo
+		uint8_t _command; //prossimo comando AT da inviare
+		unsigned long _timeCommand; //invio dell'ultimo comando AT
+		unsigned long _windowStart; //apertura della finestra corrente
+		unsigned long _periodStart; //millis() dell'inizio dell'ultima finestra prevista già servita
+		unsigned long _timeLastTraffic; //ultimo traffico con il telefono
+		uint8_t _heard; //il telefono ha comunicato nella finestra corrente
+
+		unsigned long _onTime; //millisecondi con il modulo sveglio (finestre chiuse)
+		unsigned long _wakeups; //finestre aperte
+		unsigned long _trafficWakeups; //finestre aperte dal traffico
+
+};
+
+
+#endif //LWRADIO_H
@@ -125,6 +125,8 @@ void SoftwareSerialJack::send(char *message, size_t length) { //invia il messagg
 
 	//invio il carattere di fine messaggio
 	_serial->print(SSJ_MESSAGE_FINISH_CHARACTER);
+
+	_bytesSent += length + 2;
 	
 }
 
@@ -133,17 +135,27 @@ void SoftwareSerialJack::send(char *message, size_t length) { //invia il messagg
 /**
  * @brief Metodo che ritorna i caratteri ricevuti
  * 
- * @return Ritorna il numero di caratteri ricevuti
+ * I caratteri vengono segnalati solo quando il buffer contiene almeno un messaggio completo, in modo che
+ * un messaggio ancora in arrivo non venga prelevato (e scartato) da receive().
+ * 
+ * @return Ritorna il numero di caratteri ricevuti (0 se non ci sono messaggi completi)
  */
 size_t SoftwareSerialJack::available() { //restituisce true se ci sono dati da elaborare
 
+	//se il buffer è pieno e non contiene messaggi completi i dati non sono validi: li scarto
+	if (bufferAvailable() == 0 && _frames == 0) {
+		_position = 0;
+		_length = 0;
+	}
+
 	//finchè ci sono caratteri in entrata e posizioni libere nel buffer
     while (_serial->available() && bufferAvailable() ) {
 		bufferPut(_serial->read());
+		_bytesReceived++;
     }
 
  	//restituisco la dimensione del buffer
- 	return bufferLength();
+ 	return _frames ? bufferLength() : 0;
 
 }
 
@@ -194,7 +206,31 @@ size_t SoftwareSerialJack::receive(char *buffer, size_t size) {
 
 
 	}
-	
+
+	//nessun messaggio nel buffer (carattere di fine senza carattere di inizio)
+	buffer[0] = 0;
+
+	return 0;
+}
+
+
+//contatori
+/**
+ * @brief Metodo che restituisce i caratteri inviati dalla creazione
+ * 
+ * @return Caratteri inviati (delimitatori compresi)
+ */
+unsigned long SoftwareSerialJack::bytesSent() {
+	return _bytesSent;
+}
+
+/**
+ * @brief Metodo che restituisce i caratteri ricevuti dalla creazione
+ * 
+ * @return Caratteri ricevuti (compresi quelli fuori dai messaggi, es. le risposte ai comandi AT)
+ */
+unsigned long SoftwareSerialJack::bytesReceived() {
+	return _bytesReceived;
 }
 
 
@@ -215,6 +251,12 @@ void SoftwareSerialJack::bufferInitialize(size_t size) {
 	_position = 0;
 	//numero di elementi
 	_length = 0;
+	//numero di messaggi completi
+	_frames = 0;
+
+	//contatori
+	_bytesSent = 0;
+	_bytesReceived = 0;
 
 }
 
@@ -224,6 +266,11 @@ void SoftwareSerialJack::bufferPut(char c) {
 	//se il buffer ha spazio disponibile
 	if (_length < _size) {
 		_buffer[(_position + _length++) % _size] = c; //salvo il dato
+
+		//conto i messaggi completi
+		if (c == SSJ_MESSAGE_FINISH_CHARACTER) {
+			_frames++;
+		}
 	}
 
 }
@@ -240,6 +287,11 @@ char SoftwareSerialJack::bufferGet() {
 		_position = ++_position % _size;
 		_length--;
 
+		//il messaggio completo è stato prelevato (o scartato)
+		if (c == SSJ_MESSAGE_FINISH_CHARACTER) {
+			_frames--;
+		}
+
 		return c; //ritorno il dato salvato
 	}
 
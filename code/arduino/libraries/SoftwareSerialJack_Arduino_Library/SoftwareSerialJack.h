@@ -33,7 +33,7 @@
 
 #include <Arduino.h>
 #include <SoftwareSerial.h>
-#include <JTransmissionMethod.h>
+#include <JConfig.h>
 
 //---COSTANTI---
 /**
@@ -46,12 +46,18 @@
 #define SSJ_MESSAGE_FINISH_CHARACTER '>' //carattere di fine messaggio
 
 /**
- * @brief Dimensione del buffer interno
+ * @brief Dimensione del buffer interno (un messaggio di lunghezza massima e un ACK, delimitatori compresi)
  */
-#define SSJ_BUFFER_SIZE 255
+#ifndef SSJ_BUFFER_SIZE
+#define SSJ_BUFFER_SIZE ((JK_MAX_MESSAGE_LENGTH + 1) + (JK_MAX_ACK_LENGTH + 1))
+#endif
 
+static_assert(SSJ_BUFFER_SIZE >= JK_MAX_MESSAGE_LENGTH + 1, "SSJ_BUFFER_SIZE deve contenere un messaggio di lunghezza JK_MAX_MESSAGE_LENGTH con i delimitatori");
 
-class SoftwareSerialJack : public JTransmissionMethod {
+
+//mezzo di trasmissione di Jack: va passato come parametro del template a BasicJack (oppure avvolto in
+//JTransmissionAdapter per usarlo tramite l'interfaccia JTransmissionMethod)
+class SoftwareSerialJack {
 
 	public:
 	
@@ -64,7 +70,15 @@ class SoftwareSerialJack : public JTransmissionMethod {
 		size_t receive(char *buffer, size_t size); //metodo che inserisce il messaggio in un buffer e restituisce la dimensione del messaggio
 		void send(char *message, size_t length); //invia il messaggio
 		
-		size_t available(); //restituisce la dimensione del buffer (>0 se ci sono messagi)
+		size_t available(); //restituisce la dimensione del buffer (>0 se ci sono messagi completi)
+
+		//contatori (usati per la stima dei consumi del modulo)
+		unsigned long bytesSent(); //caratteri inviati (delimitatori compresi)
+		unsigned long bytesReceived(); //caratteri ricevuti
+
+		//costanti note a tempo di compilazione (usate da BasicJack)
+		static const size_t BUFFER_SIZE = SSJ_BUFFER_SIZE; //dimensione di default del buffer interno
+		static const size_t MTU = SSJ_BUFFER_SIZE - 2; //lunghezza massima di un messaggio con il buffer di default (delimitatori esclusi)
 
 
 	private:
@@ -84,6 +98,11 @@ class SoftwareSerialJack : public JTransmissionMethod {
 		int _size; //dimensione del buffer
 		int _position; //posizione di testa del buffer
 		int _length; //quantità di dati memorizzati nel buffer
+		int _frames; //numero di caratteri di fine messaggio presenti nel buffer
+
+		//contatori
+		unsigned long _bytesSent; //caratteri inviati
+		unsigned long _bytesReceived; //caratteri ricevuti
 
 };
 
@@ -0,0 +1,113 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file AckingJack.h
+ * @brief Mezzo di trasmissione dei benchmark che risponde subito a ogni messaggio dati con il suo ACK
+ *
+ * Gli id dei messaggi inviati vengono tenuti in una coda circolare di dimensione fissa (nessuna allocazione):
+ * oltre BENCH_ACK_PENDING ACK non ancora letti i più vecchi vengono persi (Jack reinvia il messaggio).
+ * Va usato da un solo thread.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef ACKINGJACK_H
+#define ACKINGJACK_H
+
+#include <string.h>
+#include <stdlib.h>
+#include <Jack.h>
+
+//---COSTANTI---
+/**
+ * @brief ACK in attesa di essere letti
+ */
+#define BENCH_ACK_PENDING 256
+
+
+//---MEZZO DI TRASMISSIONE---
+//risponde a ogni messaggio dati con il suo ACK
+class AckingJack {
+
+	public:
+
+		size_t receive(char *buffer, size_t size) {
+
+			size_t length = available();
+
+			if (length == 0 || length >= size) {
+				return 0;
+			}
+
+			memcpy(buffer, _ack, length + 1);
+
+			_head = (_head + 1) % BENCH_ACK_PENDING;
+			_count--;
+			_ackLength = 0;
+
+			return length;
+		}
+
+		void send(char *message, size_t) {
+
+			const char *id = strstr(message, "\"" JK_MESSAGE_ID "\":");
+
+			if (id == NULL) {
+				return;
+			}
+
+			//coda piena: perdo l'ACK più vecchio
+			if (_count == BENCH_ACK_PENDING) {
+				_head = (_head + 1) % BENCH_ACK_PENDING;
+				_count--;
+				_ackLength = 0;
+			}
+
+			_ids[(_head + _count) % BENCH_ACK_PENDING] = strtol(id + sizeof(JK_MESSAGE_ID) + 2, NULL, 10);
+			_count++;
+		}
+
+		size_t available() {
+
+			if (_ackLength == 0 && _count) {
+				_ackLength = JFrame::printAck(_ids[_head], _ack, JK_MAX_ACK_LENGTH);
+			}
+
+			return _ackLength;
+		}
+
+		static const size_t MTU = JK_MAX_MESSAGE_LENGTH - 1;
+
+	private:
+
+		long _ids[BENCH_ACK_PENDING]; //messaggi da confermare
+		size_t _head = 0;
+		size_t _count = 0;
+
+		char _ack[JK_MAX_ACK_LENGTH]; //ACK pronto
+		size_t _ackLength = 0;
+};
+
+
+#endif //ACKINGJACK_H
@@ -0,0 +1,295 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file AggregatorTest.cpp
+ * @brief Verifica del riassunto delle letture per finestre (LwAggregator)
+ *
+ * Controlla l'allineamento delle finestre con timestamp negativi e fuori ordine, la chiusura delle finestre e la
+ * sovrascrittura del riassunto non prelevato, l'arrotondamento delle medie (anche per le temperature negative) e
+ * l'unione dei riassunti (compresa la saturazione del numero di letture).
+ *
+ * Stampa i controlli falliti e termina con codice 1 se almeno uno fallisce.
+ *
+ * Uso: aggregator-test
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <LwAggregator.h>
+
+
+//---CONTROLLI---
+
+//controlli eseguiti e falliti
+static unsigned long checks = 0;
+static unsigned long failures = 0;
+
+//registra il controllo e stampa quelli falliti
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+static void check(bool passed, const char *condition, int line) {
+
+	checks++;
+
+	if (!passed) {
+		failures++;
+		printf("  FALLITO (riga %d): %s\n", line, condition);
+	}
+}
+
+//riassunto con i valori indicati
+static LwSummary summary(long start, long end, uint16_t count, uint8_t gsrMin, uint8_t gsrMax, uint32_t gsrSum,
+	int16_t temperatureMin, int16_t temperatureMax, int32_t temperatureSum) {
+
+	LwSummary s;
+
+	s.start = start;
+	s.end = end;
+	s.count = count;
+	s.gsrMin = gsrMin;
+	s.gsrMax = gsrMax;
+	s.gsrSum = gsrSum;
+	s.temperatureMin = temperatureMin;
+	s.temperatureMax = temperatureMax;
+	s.temperatureSum = temperatureSum;
+
+	return s;
+}
+
+
+//---CASI---
+
+//finestre allineate ai multipli della durata anche per i timestamp negativi
+static void testNegativeTimestamps() {
+
+	printf("timestamp negativi\n");
+
+	LwAggregator aggregator(3600);
+
+	//-3600 e -1 stanno nella finestra [-3600, 0)
+	CHECK(aggregator.add(-3600, 10, 100) == 0);
+	CHECK(aggregator.add(-1, 20, 200) == 0);
+	CHECK(aggregator.count() == 2);
+
+	//0 apre la finestra successiva
+	CHECK(aggregator.add(0, 30, 300) == 1);
+	CHECK(aggregator.available());
+
+	LwSummary s = aggregator.get();
+
+	CHECK(s.start == -3600 && s.end == -1);
+	CHECK(s.count == 2);
+	CHECK(s.gsrMin == 10 && s.gsrMax == 20 && s.gsrSum == 30);
+	CHECK(s.temperatureMin == 100 && s.temperatureMax == 200 && s.temperatureSum == 300);
+
+	//-3601 appartiene alla finestra [-7200, -3600): chiude [0, 3600)
+	CHECK(aggregator.add(-3601, 40, 400) == 1);
+	CHECK(aggregator.get().start == 0);
+	CHECK(aggregator.add(-7200, 50, 500) == 0);
+	CHECK(aggregator.count() == 2);
+
+	//-7201 è fuori dalla finestra
+	CHECK(aggregator.add(-7201, 60, 600) == 1);
+
+	s = aggregator.get();
+
+	CHECK(s.start == -7200 && s.end == -3601 && s.count == 2);
+}
+
+//letture fuori ordine nella stessa finestra e in una finestra precedente
+static void testOutOfOrder() {
+
+	printf("timestamp fuori ordine\n");
+
+	LwAggregator aggregator(60);
+
+	CHECK(aggregator.add(150, 10, 0) == 0);
+
+	//più vecchia ma nella stessa finestra [120, 180): resta nella finestra e ne sposta l'inizio
+	CHECK(aggregator.add(125, 20, 0) == 0);
+	CHECK(aggregator.add(179, 30, 0) == 0);
+	CHECK(aggregator.count() == 3);
+
+	//finestra precedente: chiude quella corrente e apre [60, 120)
+	CHECK(aggregator.add(119, 40, 0) == 1);
+
+	LwSummary s = aggregator.get();
+
+	CHECK(s.start == 125 && s.end == 179 && s.count == 3);
+	CHECK(s.gsrMin == 10 && s.gsrMax == 30);
+
+	//di nuovo la finestra successiva
+	CHECK(aggregator.add(120, 50, 0) == 1);
+
+	s = aggregator.get();
+
+	CHECK(s.start == 119 && s.end == 119 && s.count == 1 && s.gsrSum == 40);
+}
+
+//chiusura della finestra e riassunto non prelevato
+static void testFlush() {
+
+	printf("chiusura e sovrascrittura\n");
+
+	LwAggregator aggregator(100);
+
+	//finestra vuota
+	CHECK(aggregator.flush() == 0);
+	CHECK(!aggregator.available());
+
+	CHECK(aggregator.add(10, 1, 10) == 0);
+	CHECK(aggregator.flush() == 1);
+	CHECK(aggregator.available());
+	CHECK(aggregator.count() == 0);
+
+	//dopo la chiusura la lettura apre una nuova finestra (anche se è la stessa finestra temporale)
+	CHECK(aggregator.add(20, 2, 20) == 0);
+	CHECK(aggregator.count() == 1);
+
+	//il riassunto non prelevato viene sovrascritto dalla finestra chiusa successiva
+	CHECK(aggregator.add(250, 3, 30) == 1);
+
+	LwSummary s = aggregator.get();
+
+	CHECK(s.start == 20 && s.count == 1 && s.gsrSum == 2);
+	CHECK(!aggregator.available());
+
+	//il riassunto della finestra di 250, non prelevato, viene sovrascritto da quello della finestra di 300
+	CHECK(aggregator.flush() == 1);
+	CHECK(aggregator.add(300, 4, 40) == 0);
+	CHECK(aggregator.flush() == 1);
+
+	s = aggregator.get();
+
+	CHECK(s.start == 300 && s.count == 1 && s.gsrSum == 4);
+
+	//reset scarta finestra e riassunto
+	CHECK(aggregator.add(400, 5, 50) == 0);
+	CHECK(aggregator.flush() == 1);
+	CHECK(aggregator.add(500, 6, 60) == 0);
+
+	aggregator.reset();
+
+	CHECK(!aggregator.available());
+	CHECK(aggregator.count() == 0);
+	CHECK(aggregator.flush() == 0);
+}
+
+//medie arrotondate al valore più vicino (lontano da zero a metà)
+static void testMeans() {
+
+	printf("medie\n");
+
+	LwSummary empty = summary(0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+	CHECK(empty.gsrMean() == 0);
+	CHECK(empty.temperatureMean() == 0);
+
+	CHECK(summary(0, 0, 2, 0, 0, 3, 0, 0, 15).gsrMean() == 2);
+	CHECK(summary(0, 0, 3, 0, 0, 4, 0, 0, 15).gsrMean() == 1);
+
+	CHECK(summary(0, 0, 2, 0, 0, 0, 0, 0, 15).temperatureMean() == 8);
+	CHECK(summary(0, 0, 2, 0, 0, 0, 0, 0, -15).temperatureMean() == -8);
+	CHECK(summary(0, 0, 4, 0, 0, 0, 0, 0, -13).temperatureMean() == -3);
+	CHECK(summary(0, 0, 4, 0, 0, 0, 0, 0, -14).temperatureMean() == -4);
+	CHECK(summary(0, 0, 4, 0, 0, 0, 0, 0, -15).temperatureMean() == -4);
+	CHECK(summary(0, 0, 3, 0, 0, 0, 0, 0, -1).temperatureMean() == 0);
+	CHECK(summary(0, 0, 3, 0, 0, 0, 0, 0, -2).temperatureMean() == -1);
+
+	//le letture della finestra
+	LwAggregator aggregator(60);
+
+	aggregator.add(0, 0, -25);
+	aggregator.add(1, 0, -30);
+	aggregator.flush();
+
+	CHECK(aggregator.get().temperatureMean() == -28);
+}
+
+//unione dei riassunti
+static void testMerge() {
+
+	printf("unione\n");
+
+	LwSummary into = summary(100, 200, 2, 10, 20, 30, -50, 50, 0);
+
+	//riassunto vuoto: nulla cambia
+	LwAggregator::merge(into, summary(0, 0, 0, 0, 0, 0, 0, 0, 0));
+
+	CHECK(into.start == 100 && into.end == 200 && into.count == 2 && into.gsrSum == 30);
+
+	//unione in un riassunto vuoto: copia
+	LwSummary empty = summary(0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+	LwAggregator::merge(empty, into);
+
+	CHECK(empty.start == 100 && empty.end == 200 && empty.count == 2 && empty.temperatureMin == -50);
+
+	//estremi, minimi, massimi e somme
+	LwAggregator::merge(into, summary(50, 150, 3, 5, 15, 30, -60, 40, -90));
+
+	CHECK(into.start == 50 && into.end == 200);
+	CHECK(into.count == 5);
+	CHECK(into.gsrMin == 5 && into.gsrMax == 20 && into.gsrSum == 60);
+	CHECK(into.temperatureMin == -60 && into.temperatureMax == 50 && into.temperatureSum == -90);
+	CHECK(into.gsrMean() == 12 && into.temperatureMean() == -18);
+
+	LwAggregator::merge(into, summary(300, 400, 1, 30, 30, 30, 60, 60, 60));
+
+	CHECK(into.start == 50 && into.end == 400 && into.gsrMax == 30 && into.temperatureMax == 60);
+
+	//saturazione: il numero di letture resta 0xFFFF e le medie sono quelle dell'unione
+	LwSummary large = summary(0, 0, 60000, 0, 255, 60000UL * 100, -300, 0, -150L * 60000);
+
+	LwAggregator::merge(large, summary(0, 0, 30000, 0, 255, 30000UL * 40, -300, 0, -60L * 30000));
+
+	CHECK(large.count == 0xFFFF);
+	CHECK(large.gsrMean() == 80);
+	CHECK(large.temperatureMean() == -120);
+
+	//unione di due riassunti saturi con le temperature estreme (la somma non deve traboccare)
+	LwSummary hot = summary(0, 0, 0xFFFF, 0, 255, 0xFFFFUL * 255, 32767, 32767, 32767L * 0xFFFF);
+
+	LwAggregator::merge(hot, hot);
+
+	CHECK(hot.count == 0xFFFF);
+	CHECK(hot.gsrMean() == 255);
+	CHECK(hot.temperatureMean() == 32767);
+}
+
+
+//---MAIN---
+int main() {
+
+	testNegativeTimestamps();
+	testOutOfOrder();
+	testFlush();
+	testMeans();
+	testMerge();
+
+	printf("\n%lu controlli, %lu falliti\n", checks, failures);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,260 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file AsyncBench.cpp
+ * @brief Benchmark dell'invio con attesa della conferma: costo per messaggio di AsyncJack (coroutine) rispetto
+ *        all'handler onReceiveAck
+ *
+ * Ogni misura invia le letture tenendo pieno il buffer di invio di Jack su un mezzo di trasmissione che conferma
+ * subito ogni messaggio, e riporta nanosecondi e allocazioni sullo heap per messaggio confermato:
+ * - callback: BasicJack e handler onReceiveAck che conta le conferme (nessuno stato per messaggio)
+ * - callback + mappa: come sopra, con lo stato del messaggio in una std::unordered_map indicizzata per id
+ * - coroutine: una JTask per messaggio che attende AsyncJack::sendAsync() (frame da JFramePool)
+ *
+ * Uso: async-bench [messaggi]
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unordered_map>
+#include "../gateway/AsyncJack.h"
+#include "AckingJack.h"
+#include "BenchUtils.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Numero di default di messaggi per ogni misura
+ */
+#define BENCH_MESSAGES 200000UL
+/**
+ * @brief Ripetizioni di ogni misura (viene riportata la mediana)
+ */
+#define BENCH_ROUNDS 5
+
+
+//---ALLOCAZIONI---
+static unsigned long allocations = 0;
+
+void *operator new(size_t size) {
+
+	allocations++;
+
+	void *block = malloc(size ? size : 1);
+
+	if (block == NULL) {
+		throw std::bad_alloc();
+	}
+
+	return block;
+}
+
+void operator delete(void *block) noexcept {
+	free(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+	free(block);
+}
+
+
+//---STATO---
+//stato dell'applicazione per un messaggio inviato
+struct BenchRequest {
+	long reading; //lettura inviata
+	uint64_t sentAt; //istante di invio
+};
+
+static unsigned long acked = 0;
+static unsigned long failed = 0;
+static long nextID = 1480000000L;
+static std::unordered_map<long, BenchRequest> requests;
+
+
+//---HANDLER---
+static void onReceive(JData &, long) {}
+static void onReceiveAck(long) { acked++; }
+static long getMessageID() { return nextID++; }
+
+//conferma con la ricerca dello stato del messaggio
+static void onReceiveAckMap(long id) {
+
+	std::unordered_map<long, BenchRequest>::iterator request = requests.find(id);
+
+	if (request != requests.end()) {
+		benchKeep(request->second.reading);
+		requests.erase(request);
+		acked++;
+	}
+}
+
+
+//---MESSAGGIO---
+static void buildReading(JData &message, long reading) {
+	message.add("TMP", 1480000000L + reading);
+	message.add("GSR", (uint8_t) 42);
+	message.add("TME", 36.5);
+}
+
+
+//---MISURE---
+struct BenchResult {
+	double nanos; //nanosecondi per messaggio
+	double allocations; //allocazioni per messaggio
+};
+
+//BasicJack con handler onReceiveAck (con o senza mappa dello stato)
+static BenchResult benchCallback(unsigned long messages, uint8_t map) {
+
+	AckingJack mmJTM;
+	BasicJack<AckingJack> jack(mmJTM, &onReceive, map ? &onReceiveAckMap : &onReceiveAck, &getMessageID, 0, 0);
+
+	jack.start();
+
+	acked = 0;
+	requests.clear();
+	requests.reserve(2 * JK_BUFFER_SEND_SIZE);
+
+	unsigned long sent = 0;
+	unsigned long allocationsStart = allocations;
+	uint64_t start = benchNanos();
+
+	while (acked < messages) {
+
+		//riempio il buffer di invio
+		while (sent < messages) {
+
+			JData message;
+
+			buildReading(message, sent);
+
+			long id = jack.send(message);
+
+			if (id == 0) {
+				break;
+			}
+
+			if (map) {
+				BenchRequest request = {(long) sent, start};
+				requests.emplace(id, request);
+			}
+
+			sent++;
+		}
+
+		jack.loop();
+	}
+
+	BenchResult result;
+
+	result.nanos = (double) (benchNanos() - start) / messages;
+	result.allocations = (double) (allocations - allocationsStart) / messages;
+
+	return result;
+}
+
+//coroutine: invia la lettura e attende la conferma
+static JTask sendReading(AsyncJack<AckingJack> &jack, long reading) {
+
+	uint8_t result = co_await jack.sendAsync([reading](JData &message) { buildReading(message, reading); });
+
+	if (result == AJ_ACKED) {
+		acked++;
+	} else {
+		failed++;
+	}
+}
+
+//AsyncJack con una coroutine per messaggio
+static BenchResult benchCoroutine(unsigned long messages) {
+
+	AckingJack mmJTM;
+	AsyncJack<AckingJack> jack(mmJTM, &onReceive, 0, 0);
+
+	jack.start();
+
+	acked = 0;
+	failed = 0;
+
+	unsigned long started = 0;
+	unsigned long allocationsStart = allocations;
+	uint64_t start = benchNanos();
+
+	while (acked + failed < messages) {
+
+		//una coroutine per ogni slot libero del buffer di invio
+		while (started < messages && jack.waiting() < JK_BUFFER_SEND_SIZE) {
+			sendReading(jack, started++);
+		}
+
+		jack.loop();
+	}
+
+	BenchResult result;
+
+	result.nanos = (double) (benchNanos() - start) / messages;
+	result.allocations = (double) (allocations - allocationsStart) / messages;
+
+	return result;
+}
+
+//stampa la mediana delle ripetizioni
+static void report(const char *name, std::vector<BenchResult> &results) {
+
+	std::vector<double> nanos;
+
+	for (size_t i = 0; i < results.size(); i++) {
+		nanos.push_back(results[i].nanos);
+	}
+
+	printf("%-20s %12.1f %16.3f\n", name, benchPercentile(nanos, 50), results.back().allocations);
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	unsigned long messages = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_MESSAGES;
+
+	std::vector<BenchResult> callback, callbackMap, coroutine;
+
+	for (int r = 0; r < BENCH_ROUNDS; r++) {
+		callback.push_back(benchCallback(messages, 0));
+		callbackMap.push_back(benchCallback(messages, 1));
+		coroutine.push_back(benchCoroutine(messages));
+	}
+
+	printf("messaggi: %lu, JK_BUFFER_SEND_SIZE=%d, AJ_FRAME_SIZE=%d\n\n", messages, JK_BUFFER_SEND_SIZE, AJ_FRAME_SIZE);
+	printf("%-20s %12s %16s\n", "", "ns/messaggio", "allocazioni/msg");
+
+	report("callback", callback);
+	report("callback + mappa", callbackMap);
+	report("coroutine", coroutine);
+
+	printf("\nframe sullo heap: %lu, messaggi non confermati: %lu\n", JFramePool::fallbacks(), failed);
+
+	return 0;
+}
@@ -0,0 +1,101 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file BenchUtils.h
+ * @brief Funzioni di supporto comuni ai benchmark Linux (misura del tempo e percentili)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef BENCHUTILS_H
+#define BENCHUTILS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+//---TEMPO---
+
+/**
+ * @brief Restituisce i nanosecondi del clock monotono
+ */
+static inline uint64_t benchNanos() {
+
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * @brief Restituisce il contatore dei cicli della CPU (nanosecondi sulle architetture senza TSC)
+ */
+static inline uint64_t benchCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return benchNanos();
+#endif
+}
+
+
+//---STATISTICHE---
+
+/**
+ * @brief Restituisce il percentile richiesto (0-100) dei campioni (i campioni vengono ordinati)
+ *
+ * @param samples Campioni
+ * @param percentile Percentile richiesto
+ */
+template <typename T>
+static T benchPercentile(std::vector<T> &samples, double percentile) {
+
+	if (samples.empty()) {
+		return T();
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	size_t index = (size_t) (percentile / 100.0 * (samples.size() - 1) + 0.5);
+
+	return samples[index];
+}
+
+/**
+ * @brief Impedisce al compilatore di eliminare il calcolo del valore passato
+ */
+template <typename T>
+static inline void benchKeep(const T &value) {
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+
+#endif //BENCHUTILS_H
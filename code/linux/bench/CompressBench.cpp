@@ -0,0 +1,426 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file CompressBench.cpp
+ * @brief Compressione dei messaggi Jack con dizionario statico (JLzCodec, JCompressAdapter): rapporto e cicli
+ *
+ * Messaggi: quelli di una cattura (WireCapture, entrambe le direzioni) o, senza cattura, quelli prodotti dal
+ * firmware e dal telefono serializzati con printData()/printAck(): letture (TMP, GSR, TME ogni 5 minuti con
+ * l'id uguale al timestamp, come nel firmware), riassunti, risposte fasiche del GSR e ACK del telefono.
+ * Per ogni tipo di messaggio riporta lunghezza media prima e dopo la compressione, rapporto e mediana dei cicli
+ * della CPU di compressione e decompressione (cicli dell'host: sull'ATmega vanno moltiplicati per il rapporto
+ * tra le frequenze e per la differenza di architettura). Ogni messaggio compresso deve tornare uguale.
+ *
+ * Infine collega un bracciale con JCompressAdapter a un telefono con e senza JCompressAdapter (HM-10 simulato,
+ * orologio virtuale) e riporta i caratteri trasmessi per 24 ore di letture: con il telefono che non conosce la
+ * compressione i messaggi restano JSON (più JK_LZ_HELLO_ATTEMPTS proposte).
+ *
+ * Uso: compress-bench [-n messaggi] [cattura]
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <Jack.h>
+#include <JCompressAdapter.h>
+#include <SoftwareSerialJack.h>
+#include "../gateway/WireCapture.h"
+#include "../sim/MockHM10.h"
+#include "../sim/VirtualClock.h"
+#include "BenchUtils.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Messaggi sintetici di default
+ */
+#define BENCH_FRAMES 100000
+/**
+ * @brief Timestamp della prima lettura sintetica
+ */
+#define BENCH_START_TIMESTAMP 1480000000L
+/**
+ * @brief Durata dello scenario di collegamento (microsecondi virtuali)
+ */
+#define BENCH_LINK_DURATION (24ULL * 3600 * 1000000)
+
+
+//---MESSAGGI---
+struct BenchFrame {
+	std::string type; //tipo del messaggio (per il rapporto)
+	std::string text; //messaggio
+};
+
+//messaggi del bracciale e del telefono come li produce il firmware
+static void generateFrames(size_t count, std::vector<BenchFrame> &frames) {
+
+	long timestamp = BENCH_START_TIMESTAMP;
+	int gsr = 40;
+	int temperature = 365;
+
+	srand(1105);
+
+	while (frames.size() < count) {
+
+		JData message;
+		char buffer[JK_MAX_MESSAGE_LENGTH];
+		const char *type;
+		int kind = rand() % 100;
+
+		timestamp += 300;
+		gsr += rand() % 3 - 1;
+		gsr = gsr < 0 ? 0 : (gsr > 100 ? 100 : gsr);
+		temperature += rand() % 3 - 1;
+
+		//lettura
+		if (kind < 85) {
+
+			type = "lettura";
+
+			message.add("TMP", timestamp);
+			message.add("GSR", (long) gsr);
+			message.add("TME", temperature / 10.0);
+
+		//riassunto di un'ora
+		} else if (kind < 92) {
+
+			type = "riassunto";
+
+			message.add("TMP", timestamp);
+			message.add("CNT", 12L);
+			message.add("GSR", (long) gsr);
+			message.add("GMN", (long) (gsr > 5 ? gsr - 5 : 0));
+			message.add("GMX", (long) (gsr + 7));
+			message.add("TME", temperature / 10.0);
+			message.add("TMN", (temperature - 3) / 10.0);
+			message.add("TMX", (temperature + 2) / 10.0);
+
+		//risposta fasica
+		} else {
+
+			type = "risposta";
+
+			message.add("TMP", timestamp - rand() % 300);
+			message.add("SCL", (gsr * 10 + rand() % 10) / 10.0);
+			message.add("SCR", (20 + rand() % 80) / 10.0);
+			message.add("RSE", (long) (1000 + rand() % 3000));
+			message.add("RCV", (long) (2000 + rand() % 20000));
+		}
+
+		size_t length = JFrame::printData(message, timestamp, buffer, JK_MAX_MESSAGE_LENGTH);
+
+		if (length) {
+			frames.push_back({ type, std::string(buffer, length) });
+		}
+
+		//conferma del telefono
+		length = JFrame::printAck(timestamp, buffer, JK_MAX_MESSAGE_LENGTH);
+
+		if (length && frames.size() < count) {
+			frames.push_back({ "ack", std::string(buffer, length) });
+		}
+	}
+}
+
+//messaggi di una cattura (caratteri tra '<' e '>' in entrambe le direzioni)
+static bool captureFrames(const char *path, std::vector<BenchFrame> &frames) {
+
+	WireCaptureReader reader(path);
+
+	if (!reader.open()) {
+		return false;
+	}
+
+	WCRecord record;
+	std::string pending[2];
+	uint8_t inFrame[2] = { 0, 0 };
+
+	while (reader.next(record)) {
+
+		int direction = record.direction == WC_SENT ? 1 : 0;
+
+		for (size_t i = 0; i < record.length; i++) {
+
+			char c = record.data[i];
+
+			if (c == '<') {
+				pending[direction].clear();
+				inFrame[direction] = 1;
+			} else if (c == '>' && inFrame[direction]) {
+				frames.push_back({ direction ? "inviati" : "ricevuti", pending[direction] });
+				inFrame[direction] = 0;
+			} else if (inFrame[direction]) {
+				pending[direction] += c;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+//---CODIFICA---
+struct BenchStats {
+	size_t frames; //messaggi
+	size_t incompressible; //messaggi non compressi (non ASCII o non più corti)
+	uint64_t plainBytes; //caratteri prima della compressione
+	uint64_t wireBytes; //caratteri inviati (i messaggi non compressi restano in chiaro)
+	std::vector<double> encodeCycles; //cicli di compressione
+	std::vector<double> decodeCycles; //cicli di decompressione (solo messaggi compressi)
+	uint64_t encodeNanos; //tempo di compressione
+	uint64_t decodeNanos; //tempo di decompressione
+};
+
+//comprime e decomprime ogni messaggio (restituisce false se un messaggio non torna uguale)
+static bool benchCodec(const std::vector<BenchFrame> &frames, std::map<std::string, BenchStats> &stats) {
+
+	bool consistent = true;
+
+	for (size_t i = 0; i < frames.size(); i++) {
+
+		const std::string &text = frames[i].text;
+		BenchStats &s = stats[frames[i].type];
+		char compressed[JK_MAX_MESSAGE_LENGTH];
+		char decoded[JK_MAX_MESSAGE_LENGTH];
+
+		if (text.size() >= JK_MAX_MESSAGE_LENGTH) {
+			continue;
+		}
+
+		uint64_t startNanos = benchNanos();
+		uint64_t start = benchCycles();
+
+		size_t length = JLzCodec::compress(text.data(), text.size(), compressed, JK_MAX_MESSAGE_LENGTH);
+
+		s.encodeCycles.push_back((double) (benchCycles() - start));
+		s.encodeNanos += benchNanos() - startNanos;
+
+		s.frames++;
+		s.plainBytes += text.size();
+
+		if (length == 0) {
+			s.incompressible++;
+			s.wireBytes += text.size();
+			continue;
+		}
+
+		s.wireBytes += length;
+
+		startNanos = benchNanos();
+		start = benchCycles();
+
+		size_t decodedLength = JLzCodec::decompress(compressed, length, decoded, JK_MAX_MESSAGE_LENGTH);
+
+		s.decodeCycles.push_back((double) (benchCycles() - start));
+		s.decodeNanos += benchNanos() - startNanos;
+
+		consistent &= decodedLength == text.size() && memcmp(decoded, text.data(), decodedLength) == 0;
+	}
+
+	return consistent;
+}
+
+//stampa una riga del rapporto
+static void report(const char *name, BenchStats &s) {
+
+	printf("%-12s %9zu %9zu %9.1f %9.1f %8.1f%% %10.0f %10.0f %9.1f %9.1f\n", name, s.frames, s.incompressible,
+		s.frames ? (double) s.plainBytes / s.frames : 0.0, s.frames ? (double) s.wireBytes / s.frames : 0.0,
+		s.plainBytes ? 100.0 * s.wireBytes / s.plainBytes : 0.0,
+		s.encodeCycles.empty() ? 0.0 : benchPercentile(s.encodeCycles, 50),
+		s.decodeCycles.empty() ? 0.0 : benchPercentile(s.decodeCycles, 50),
+		s.frames ? (double) s.encodeNanos / s.frames : 0.0,
+		s.decodeCycles.empty() ? 0.0 : (double) s.decodeNanos / s.decodeCycles.size());
+}
+
+
+//---COLLEGAMENTO---
+static unsigned long delivered = 0;
+
+static void onReceive(JData &, long) { delivered++; }
+static void onReceiveAck(long) {}
+static long bandMessageID = 0;
+static long getBandMessageID() { return BENCH_START_TIMESTAMP + 300 * ++bandMessageID; }
+static long getPhoneMessageID() { return 0; }
+
+struct LinkResult {
+	unsigned long delivered; //letture consegnate
+	unsigned long uplink; //caratteri inviati dal bracciale
+	unsigned long downlink; //caratteri inviati dal telefono
+	unsigned long compressed; //messaggi inviati compressi dal bracciale
+	uint8_t negotiated; //compressione concordata dal bracciale
+};
+
+//24 ore di letture dal bracciale al telefono (phoneCompression: il telefono usa JCompressAdapter)
+static void runLink(LinkResult &result, uint8_t phoneCompression) {
+
+	VirtualClock::install();
+
+	delivered = 0;
+	bandMessageID = 0;
+
+	//i mezzi di trasmissione eliminano gli stream nel distruttore
+	MockHM10 *module = new MockHM10();
+	MockHM10Phone *phoneStream = new MockHM10Phone(*module);
+
+	SoftwareSerialJack bandSerial(*module);
+	SoftwareSerialJack phoneSerial(*phoneStream);
+
+	JCompressAdapter<SoftwareSerialJack> bandTM(bandSerial);
+	JCompressAdapter<SoftwareSerialJack> phoneTM(phoneSerial);
+
+	phoneTM.setEnabled(phoneCompression);
+
+	BasicJack<JCompressAdapter<SoftwareSerialJack> > band(bandTM, &onReceive, &onReceiveAck, &getBandMessageID, 5000, 0);
+	BasicJack<JCompressAdapter<SoftwareSerialJack> > phoneNew(phoneTM, &onReceive, &onReceiveAck, &getPhoneMessageID, 5000, 0);
+	BasicJack<SoftwareSerialJack> phoneOld(phoneSerial, &onReceive, &onReceiveAck, &getPhoneMessageID, 5000, 0);
+
+	module->connect();
+
+	band.start();
+	phoneNew.start();
+	phoneOld.start();
+
+	uint64_t nextReading = 0;
+	unsigned long phoneBytes = 0;
+
+	while (VirtualClock::now() < BENCH_LINK_DURATION) {
+
+		if (VirtualClock::now() >= nextReading) {
+
+			JData message;
+
+			message.add("TMP", BENCH_START_TIMESTAMP + (long) (VirtualClock::now() / 1000000));
+			message.add("GSR", (long) (40 + bandMessageID % 7));
+			message.add("TME", 36.5);
+
+			band.send(message);
+
+			nextReading += 300ULL * 1000000;
+		}
+
+		band.loop();
+		module->update();
+
+		//il telefono senza JCompressAdapter usa direttamente SoftwareSerialJack
+		unsigned long before = module->available();
+
+		if (phoneCompression) {
+			phoneNew.loop();
+		} else {
+			phoneOld.loop();
+		}
+
+		phoneBytes += module->available() - before;
+
+		module->update();
+
+		VirtualClock::advance(10000);
+	}
+
+	result.delivered = delivered;
+	result.uplink = bandTM.bytesOut();
+	result.downlink = phoneBytes;
+	result.compressed = bandTM.framesCompressed();
+	result.negotiated = bandTM.negotiated();
+
+	VirtualClock::uninstall();
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	size_t count = BENCH_FRAMES;
+	int opt;
+
+	//leggo le opzioni
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+
+		if (opt == 'n') {
+			count = strtoul(optarg, NULL, 10);
+		} else {
+			fprintf(stderr, "uso: %s [-n messaggi] [cattura]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<BenchFrame> frames;
+
+	if (optind < argc) {
+
+		if (!captureFrames(argv[optind], frames)) {
+			fprintf(stderr, "%s: cattura non valida\n", argv[optind]);
+			return 1;
+		}
+
+	} else {
+		generateFrames(count, frames);
+	}
+
+	std::map<std::string, BenchStats> stats;
+
+	bool consistent = benchCodec(frames, stats);
+
+	BenchStats total = BenchStats();
+
+	printf("messaggi: %zu%s, dizionario: %zu caratteri, JK_MAX_MESSAGE_LENGTH=%d\n\n", frames.size(),
+		optind < argc ? " (cattura)" : " (sintetici)", JLzCodec::dictionaryLength(), JK_MAX_MESSAGE_LENGTH);
+	printf("%-12s %9s %9s %9s %9s %9s %10s %10s %9s %9s\n", "tipo", "messaggi", "in chiaro", "B prima", "B dopo", "rapporto", "cicli comp", "cicli dec", "ns comp", "ns dec");
+
+	for (std::map<std::string, BenchStats>::iterator it = stats.begin(); it != stats.end(); it++) {
+
+		report(it->first.c_str(), it->second);
+
+		total.frames += it->second.frames;
+		total.incompressible += it->second.incompressible;
+		total.plainBytes += it->second.plainBytes;
+		total.wireBytes += it->second.wireBytes;
+		total.encodeNanos += it->second.encodeNanos;
+		total.decodeNanos += it->second.decodeNanos;
+		total.encodeCycles.insert(total.encodeCycles.end(), it->second.encodeCycles.begin(), it->second.encodeCycles.end());
+		total.decodeCycles.insert(total.decodeCycles.end(), it->second.decodeCycles.begin(), it->second.decodeCycles.end());
+	}
+
+	report("totale", total);
+
+	printf("\nmessaggi decompressi uguali agli originali: %s\n", consistent ? "sì" : "NO");
+
+	//collegamento con un telefono che conosce la compressione e con uno che non la conosce
+	LinkResult withCompression, withoutCompression;
+
+	runLink(withCompression, 1);
+	runLink(withoutCompression, 0);
+
+	printf("\n%-22s %11s %11s %11s %11s %9s\n", "collegamento 24 ore", "consegnate", "B bracciale", "B telefono", "compressi", "accordo");
+	printf("%-22s %11lu %11lu %11lu %11lu %9s\n", "telefono con lz", withCompression.delivered, withCompression.uplink,
+		withCompression.downlink, withCompression.compressed, withCompression.negotiated ? "sì" : "no");
+	printf("%-22s %11lu %11lu %11lu %11lu %9s\n", "telefono senza lz", withoutCompression.delivered, withoutCompression.uplink,
+		withoutCompression.downlink, withoutCompression.compressed, withoutCompression.negotiated ? "sì" : "no");
+
+	return consistent ? 0 : 1;
+}
@@ -0,0 +1,275 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file ConcurrencyBench.cpp
+ * @brief Benchmark dell'invio da più thread su un'unica istanza di Jack: messaggi confermati al secondo e
+ *        latenza di send() da 1 a 16 produttori
+ *
+ * Confronta BasicJack protetto da un mutex (send() dei produttori e loop() del thread di I/O si contendono il
+ * lock) con ConcurrentJack (coda senza lock, thread di I/O proprietario di Jack, conferme su un thread separato).
+ * Il mezzo di trasmissione risponde subito con l'ACK di ogni messaggio: la misura riguarda solo Jack.
+ * Quando il messaggio non viene accettato (buffer di invio o coda pieni) il produttore cede il processore e riprova.
+ *
+ * Uso: concurrency-bench [messaggi]
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../gateway/ConcurrentJack.h"
+#include "AckingJack.h"
+#include "BenchUtils.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Numero di default di messaggi per ogni misura
+ */
+#define BENCH_MESSAGES 200000UL
+/**
+ * @brief Numero massimo di produttori
+ */
+#define BENCH_MAX_PRODUCERS 16
+/**
+ * @brief Un invio ogni BENCH_SAMPLE_STRIDE viene cronometrato
+ */
+#define BENCH_SAMPLE_STRIDE 16
+/**
+ * @brief Tempo massimo di attesa delle conferme (millisecondi)
+ */
+#define BENCH_TIMEOUT 60000
+
+
+//---VARIABILI---
+static std::atomic<unsigned long> acks(0);
+static std::atomic<long> nextID(1480000000L);
+
+
+//---HANDLER---
+static void onReceive(JData &, long) {}
+static void onReceiveAck(long) { acks.fetch_add(1, std::memory_order_relaxed); }
+static long getMessageID() { return nextID.fetch_add(1, std::memory_order_relaxed); }
+
+
+//---RISULTATI---
+struct BenchResult {
+	double throughput; //messaggi confermati al secondo
+	double sendP50; //latenza di send() (nanosecondi, tentativi ripetuti compresi)
+	double sendP99;
+	unsigned long retries; //invii non accettati e ripetuti
+};
+
+
+//---PRODUTTORE---
+//invia count letture con la funzione di invio passata e cronometra un invio ogni BENCH_SAMPLE_STRIDE
+template <class F>
+static void produce(unsigned long count, F send, std::vector<double> &samples, std::atomic<unsigned long> &retries) {
+
+	unsigned long retried = 0;
+
+	for (unsigned long i = 0; i < count; i++) {
+
+		uint64_t start = benchNanos();
+
+		//il JData usa il pool JArena del produttore
+		JData message;
+
+		message.add("TMP", 1480000000L + (long) i);
+		message.add("GSR", (uint8_t) 42);
+		message.add("TME", 36.5);
+
+		while (!send(message)) {
+			retried++;
+			std::this_thread::yield();
+		}
+
+		if (i % BENCH_SAMPLE_STRIDE == 0) {
+			samples.push_back((double) (benchNanos() - start));
+		}
+	}
+
+	retries.fetch_add(retried);
+}
+
+//attende le conferme di tutti i messaggi
+static uint8_t waitAcks(unsigned long messages) {
+
+	uint64_t deadline = benchNanos() + (uint64_t) BENCH_TIMEOUT * 1000000ULL;
+
+	while (acks.load() < messages) {
+
+		if (benchNanos() > deadline) {
+			return 0;
+		}
+
+		std::this_thread::yield();
+	}
+
+	return 1;
+}
+
+//riassume i campioni dei produttori
+static void summarize(BenchResult &result, std::vector<std::vector<double> > &samples, uint64_t elapsed, unsigned long messages) {
+
+	std::vector<double> all;
+
+	for (size_t i = 0; i < samples.size(); i++) {
+		all.insert(all.end(), samples[i].begin(), samples[i].end());
+	}
+
+	result.throughput = messages / (elapsed / 1e9);
+	result.sendP50 = benchPercentile(all, 50);
+	result.sendP99 = benchPercentile(all, 99);
+}
+
+
+//---MISURE---
+
+//BasicJack condiviso con un mutex
+static uint8_t benchMutex(int producers, unsigned long messages, BenchResult &result) {
+
+	AckingJack mmJTM;
+	BasicJack<AckingJack> jack(mmJTM, &onReceive, &onReceiveAck, &getMessageID, 0, 0);
+	std::mutex mutex;
+	std::atomic<uint8_t> running(1);
+	std::atomic<unsigned long> retries(0);
+
+	acks.store(0);
+	jack.start();
+
+	//thread di I/O
+	std::thread io([&]() {
+		while (running.load(std::memory_order_relaxed)) {
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				jack.loop();
+			}
+
+			//lascio il lock ai produttori
+			std::this_thread::yield();
+		}
+	});
+
+	std::vector<std::vector<double> > samples(producers);
+	std::vector<std::thread> threads;
+
+	uint64_t start = benchNanos();
+
+	for (int p = 0; p < producers; p++) {
+		threads.push_back(std::thread([&, p]() {
+			produce(messages / producers, [&](JData &message) {
+				std::lock_guard<std::mutex> lock(mutex);
+				return jack.send(message);
+			}, samples[p], retries);
+		}));
+	}
+
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+
+	uint8_t completed = waitAcks(messages / producers * producers);
+
+	uint64_t elapsed = benchNanos() - start;
+
+	running.store(0);
+	io.join();
+
+	summarize(result, samples, elapsed, messages / producers * producers);
+	result.retries = retries.load();
+
+	return completed;
+}
+
+//ConcurrentJack
+static uint8_t benchConcurrent(int producers, unsigned long messages, BenchResult &result) {
+
+	AckingJack mmJTM;
+	ConcurrentJack<AckingJack> jack(mmJTM, &onReceive, &onReceiveAck, 0, 0);
+	std::atomic<unsigned long> retries(0);
+
+	acks.store(0);
+	jack.start();
+
+	std::vector<std::vector<double> > samples(producers);
+	std::vector<std::thread> threads;
+
+	uint64_t start = benchNanos();
+
+	for (int p = 0; p < producers; p++) {
+		threads.push_back(std::thread([&, p]() {
+			produce(messages / producers, [&](JData &message) {
+				return jack.send(message);
+			}, samples[p], retries);
+		}));
+	}
+
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+
+	uint8_t completed = waitAcks(messages / producers * producers);
+
+	uint64_t elapsed = benchNanos() - start;
+
+	jack.stop();
+
+	summarize(result, samples, elapsed, messages / producers * producers);
+	result.retries = retries.load();
+
+	return completed;
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	unsigned long messages = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_MESSAGES;
+
+	printf("messaggi: %lu, JK_BUFFER_SEND_SIZE=%d, SQ_CAPACITY=%d, core: %u\n\n", messages, JK_BUFFER_SEND_SIZE, SQ_CAPACITY, std::thread::hardware_concurrency());
+
+	printf("%-10s | %-38s | %-38s\n", "", "BasicJack + mutex", "ConcurrentJack");
+	printf("%-10s | %10s %9s %9s %7s | %10s %9s %9s %7s\n", "produttori", "msg/s", "p50 ns", "p99 ns", "riprove", "msg/s", "p50 ns", "p99 ns", "riprove");
+
+	for (int producers = 1; producers <= BENCH_MAX_PRODUCERS; producers *= 2) {
+
+		BenchResult locked, concurrent;
+
+		uint8_t lockedCompleted = benchMutex(producers, messages, locked);
+		uint8_t concurrentCompleted = benchConcurrent(producers, messages, concurrent);
+
+		printf("%-10d | %10.0f %9.0f %9.0f %7.1f | %10.0f %9.0f %9.0f %7.1f%s\n", producers,
+			locked.throughput, locked.sendP50, locked.sendP99, (double) locked.retries / messages,
+			concurrent.throughput, concurrent.sendP50, concurrent.sendP99, (double) concurrent.retries / messages,
+			lockedCompleted && concurrentCompleted ? "" : " (timeout)");
+	}
+
+	return 0;
+}
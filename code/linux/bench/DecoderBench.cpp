@@ -0,0 +1,272 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file DecoderBench.cpp
+ * @brief Benchmark della decodifica in blocco dei log: GB/s di BulkDecoder al crescere dei thread
+ *
+ * Senza file viene generato un log sintetico (BENCH_MEGABYTES MB, nella cartella temporanea) con il traffico
+ * ricevuto da un gateway: messaggi dati, ACK, messaggi troncati, messaggi con le chiavi in un altro ordine e
+ * caratteri spuri tra un messaggio e l'altro. Misure:
+ * - SoftwareSerialJack + BasicJack: un carattere alla volta dal framing e parsing con ArduinoJson (parte del log)
+ * - BulkDecoder con il solo parser ArduinoJson (1 thread)
+ * - BulkDecoder con il parser specializzato da 1 thread al doppio dei core (almeno 4)
+ * Ogni configurazione di BulkDecoder deve restituire le stesse letture (numero e somma dei timestamp).
+ *
+ * Uso: decoder-bench [megabyte] [log...]
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <thread>
+#include <Jack.h>
+#include <SoftwareSerialJack.h>
+#include "../store/BulkDecoder.h"
+#include "BenchUtils.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Dimensione di default del log sintetico (MB)
+ */
+#define BENCH_MEGABYTES 256
+/**
+ * @brief Caratteri del log decodificati da SoftwareSerialJack + BasicJack
+ */
+#define BENCH_BASELINE_BYTES (16 * 1024 * 1024)
+/**
+ * @brief Ripetizioni di ogni misura di BulkDecoder (viene riportata la mediana)
+ */
+#define BENCH_ROUNDS 3
+
+
+//---LOG SINTETICO---
+//scrive nel file il traffico ricevuto da un gateway fino alla dimensione indicata
+static bool generateLog(const char *path, uint64_t size) {
+
+	FILE *file = fopen(path, "wb");
+
+	if (file == NULL) {
+		return false;
+	}
+
+	uint64_t written = 0;
+	long id = 1480000000L;
+
+	srand(1105);
+
+	while (written < size) {
+
+		char frame[256];
+		int length;
+		int kind = rand() % 100;
+		long timestamp = 1480000000L + (id - 1480000000L) * 300;
+
+		if (kind < 88) {
+			length = snprintf(frame, sizeof(frame), "<{\"val\":{\"TMP\":%ld,\"GSR\":%d,\"TME\":%d.%02d},\"id\":%ld,\"type\":\"data\"}>", timestamp, rand() % 101, 30 + rand() % 10, rand() % 100, id);
+		} else if (kind < 96) {
+			length = snprintf(frame, sizeof(frame), "<{\"id\":%ld,\"type\":\"ack\"}>", id);
+		} else if (kind < 98) {
+			length = snprintf(frame, sizeof(frame), "<{\"type\":\"data\",\"id\":%ld,\"val\":{\"TME\":%d.5,\"TMP\":%ld,\"GSR\":%d}}>", id, 30 + rand() % 10, timestamp, rand() % 101);
+		} else if (kind < 99) {
+			length = snprintf(frame, sizeof(frame), "<{\"val\":{\"TMP\":%ld,\"GS", timestamp);
+		} else {
+			length = snprintf(frame, sizeof(frame), "\r\n+CONN\r\n");
+		}
+
+		fwrite(frame, 1, length, file);
+
+		written += length;
+		id++;
+	}
+
+	return fclose(file) == 0;
+}
+
+
+//---SOFTWARESERIALJACK + BASICJACK---
+//restituisce i caratteri del log e scarta quelli scritti
+class LogStream : public Stream {
+
+	public:
+
+		LogStream(const char *data, size_t length) : _data(data), _length(length), _position(0) {}
+
+		int available() { return _length - _position; }
+		int read() { return _position < _length ? (uint8_t) _data[_position++] : -1; }
+		int peek() { return _position < _length ? (uint8_t) _data[_position] : -1; }
+		size_t write(uint8_t) { return 1; }
+
+	private:
+
+		const char *_data;
+		size_t _length;
+		size_t _position;
+
+};
+
+static uint64_t baselineReadings = 0;
+
+static void onReceive(JData &, long) { baselineReadings++; }
+static void onReceiveAck(long) {}
+static long getMessageID() { return 0; }
+
+//decodifica l'inizio del log un carattere alla volta (secondi impiegati)
+static double benchBaseline(const char *path, uint64_t &bytes) {
+
+	FILE *file = fopen(path, "rb");
+	std::vector<char> data(BENCH_BASELINE_BYTES);
+
+	bytes = fread(data.data(), 1, data.size(), file);
+	fclose(file);
+
+	//il mezzo di trasmissione elimina lo stream nel distruttore
+	LogStream *stream = new LogStream(data.data(), bytes);
+	SoftwareSerialJack mmJTM(*stream);
+	BasicJack<SoftwareSerialJack> jack(mmJTM, &onReceive, &onReceiveAck, &getMessageID, JK_TIMER_RESEND_MESSAGE, 0);
+
+	jack.start();
+	baselineReadings = 0;
+
+	uint64_t start = benchNanos();
+
+	while (stream->available() || mmJTM.available()) {
+		jack.loop();
+	}
+
+	return (benchNanos() - start) / 1e9;
+}
+
+
+//---BULKDECODER---
+struct BenchChecksum {
+	uint64_t readings; //letture
+	uint64_t timestamps; //somma dei timestamp
+};
+
+static void onReading(const RSReading &reading, void *context) {
+
+	BenchChecksum *checksum = (BenchChecksum *) context;
+
+	checksum->readings++;
+	checksum->timestamps += reading.timestamp;
+}
+
+//decodifica i log con la configurazione indicata (mediana dei secondi impiegati)
+static double benchDecoder(std::vector<const char *> &paths, int threads, uint8_t fastPath, BDStats &stats, BenchChecksum &checksum) {
+
+	std::vector<double> seconds;
+
+	for (int r = 0; r < BENCH_ROUNDS; r++) {
+
+		BulkDecoder decoder(threads);
+
+		decoder.setFastPath(fastPath);
+
+		for (size_t i = 0; i < paths.size(); i++) {
+			decoder.addFile(paths[i], i);
+		}
+
+		checksum.readings = 0;
+		checksum.timestamps = 0;
+
+		uint64_t start = benchNanos();
+
+		stats = decoder.decode(&onReading, &checksum);
+
+		seconds.push_back((benchNanos() - start) / 1e9);
+	}
+
+	return benchPercentile(seconds, 50);
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	uint64_t megabytes = argc > 1 ? strtoull(argv[1], NULL, 10) : BENCH_MEGABYTES;
+	std::vector<const char *> paths;
+	char generated[] = "/tmp/decoder-bench-XXXXXX";
+
+	for (int i = 2; i < argc; i++) {
+		paths.push_back(argv[i]);
+	}
+
+	//log sintetico
+	if (paths.empty()) {
+
+		int fd = mkstemp(generated);
+
+		if (fd < 0 || !generateLog(generated, megabytes * 1024 * 1024)) {
+			perror(generated);
+			return 1;
+		}
+
+		close(fd);
+		paths.push_back(generated);
+	}
+
+	unsigned int cores = std::thread::hardware_concurrency();
+	int maxThreads = cores * 2 > 4 ? cores * 2 : 4;
+
+	//riferimento: un carattere alla volta
+	uint64_t baselineBytes;
+	double baselineSeconds = benchBaseline(paths[0], baselineBytes);
+
+	printf("log: %zu file, core: %u, BD_CHUNK_SIZE=%d\n\n", paths.size(), cores, BD_CHUNK_SIZE);
+	printf("%-34s %8s %10s %12s %10s\n", "", "thread", "GB/s", "letture/s", "veloce");
+
+	printf("%-34s %8d %10.3f %12.0f %10s\n", "SoftwareSerialJack + BasicJack", 1, baselineBytes / baselineSeconds / 1e9, baselineReadings / baselineSeconds, "-");
+
+	BDStats stats;
+	BenchChecksum reference, checksum;
+
+	double seconds = benchDecoder(paths, 1, 0, stats, reference);
+
+	printf("%-34s %8d %10.3f %12.0f %9.1f%%\n", "BulkDecoder (solo ArduinoJson)", 1, stats.bytes / seconds / 1e9, stats.readings / seconds, 0.0);
+
+	uint8_t consistent = 1;
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+
+		seconds = benchDecoder(paths, threads, 1, stats, checksum);
+
+		consistent &= checksum.readings == reference.readings && checksum.timestamps == reference.timestamps;
+
+		printf("%-34s %8d %10.3f %12.0f %9.1f%%\n", "BulkDecoder", threads, stats.bytes / seconds / 1e9, stats.readings / seconds, 100.0 * stats.fastPath / stats.readings);
+	}
+
+	printf("\n%.1f MB, messaggi: %llu, letture: %llu, controllo: %llu, senza lettura: %llu, non validi: %llu, troppo lunghi: %llu, troncati: %llu\n", stats.bytes / 1048576.0,
+		(unsigned long long) stats.frames, (unsigned long long) stats.readings, (unsigned long long) stats.control,
+		(unsigned long long) stats.skipped, (unsigned long long) stats.rejected, (unsigned long long) stats.oversized, (unsigned long long) stats.truncated);
+	printf("letture uguali in tutte le configurazioni: %s\n", consistent ? "sì" : "NO");
+
+	if (paths[0] == generated) {
+		unlink(generated);
+	}
+
+	return consistent ? 0 : 1;
+}
@@ -0,0 +1,518 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file EnergyBench.cpp
+ * @brief Simulazione dei consumi del bracciale (LwEnergy): carica per componente e durata prevista della batteria
+ *
+ * Il bracciale (BasicJack con SoftwareSerialJack, LwRadio, LwEnergy) e il telefono sono collegati
+ * attraverso un HM-10 simulato (MockHM10) con l'orologio virtuale, come in radio-bench. Il bracciale segue il
+ * firmware: lettura di GSR e temperatura ogni intervallo (sensori accesi solo per il loro tempo di assestamento,
+ * GSR sempre acceso con le risposte abilitate), una lettura del RTC per lettura e per id di messaggio, finestre di
+ * sincronizzazione con il sonno abilitato. Gli eventi vengono passati a LwEnergy con gli stessi hook del firmware e
+ * convertiti in carica con la tabella di default (LwEnergy.h) e gli assorbimenti dei sensori del firmware.
+ *
+ * Il profilo del collegamento è dato dalla perdita (ogni messaggio, in entrambe le direzioni, viene perso con la
+ * probabilità indicata) e dalle ore al giorno in cui il telefono è assente (a partire dalla seconda ora del
+ * giorno). Il bracciale non ha una coda di letture: quelle che non entrano nel buffer di invio vengono perse.
+ *
+ * Riporta la carica di ogni componente riportata a un giorno, l'assorbimento medio e la durata prevista della
+ * batteria. Il tempo contato da LwEnergy deve coincidere con quello simulato e il tempo da sveglio del modulo con
+ * quello misurato da MockHM10.
+ *
+ * Uso: energy-bench [-s campionamento] [-r reinvio] [-p polling] [-w sonno] [-e risposte] [-l perdita] [-a assenza]
+ *      [-z] [-c capacità] [-d durata]
+ *
+ * -s secondi tra le letture, -r e -p millisecondi, -w e -e 0 o 1, -l probabilità (0-1), -a ore al giorno,
+ * -z bracciale e telefono con JCompressAdapter (non usato dal firmware), -c milliampere ora, -d ore simulate.
+ * I valori di default sono quelli del firmware.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <deque>
+#include <set>
+#include <Jack.h>
+#include <JCompressAdapter.h>
+#include <SoftwareSerialJack.h>
+#include <LwRadio.h>
+#include <LwEnergy.h>
+#include "../sim/MockHM10.h"
+#include "../sim/VirtualClock.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Passo della simulazione (microsecondi)
+ */
+#define ENERGY_STEP 10000
+/**
+ * @brief Durata minima delle finestre (millisecondi, RADIO_WINDOW del firmware)
+ */
+#define ENERGY_WINDOW 3000
+/**
+ * @brief Latenza di collegamento del telefono (millisecondi)
+ */
+#define ENERGY_CONNECT_LATENCY 400
+/**
+ * @brief Inizio dell'assenza del telefono in ogni giorno (ore)
+ */
+#define ENERGY_OUTAGE_START 2
+/**
+ * @brief Timestamp del RTC all'avvio (secondi, non allineato al periodo)
+ */
+#define ENERGY_START_TIMESTAMP 1480000123L
+/**
+ * @brief Seme del generatore pseudocasuale (perdita dei messaggi)
+ */
+#define ENERGY_SEED 1105
+
+//sensori del firmware (nell'ordine del registro)
+/**
+ * @brief Numero di sensori
+ */
+#define ENERGY_SENSORS 2
+/**
+ * @brief Posizione del sensore GSR
+ */
+#define ENERGY_GSR 0
+/**
+ * @brief Tempi di assestamento dei sensori (millisecondi, GSR_WARMUP e LM35_WARMUP del firmware)
+ */
+static const unsigned long SENSOR_WARMUP[ENERGY_SENSORS] = { 500, 50 };
+/**
+ * @brief Assorbimento dei sensori accesi (microampere, GSR_CURRENT e LM35_CURRENT del firmware)
+ */
+static const uint16_t SENSOR_CURRENT[ENERGY_SENSORS] = { 1000, 60 };
+
+
+//---CONFIGURAZIONE---
+struct EnergyConfig {
+	unsigned long sampleInterval; //intervallo tra le letture (millisecondi)
+	long timerSendMessage; //timer di reinvio (millisecondi)
+	long timerPolling; //timer di polling (millisecondi)
+	uint8_t sleep; //sonno del modulo bluetooth
+	uint8_t events; //risposte fasiche del GSR (sensore sempre acceso)
+	double loss; //probabilità di perdere ogni messaggio
+	double outage; //ore al giorno in cui il telefono è assente
+	uint8_t compression; //bracciale e telefono con JCompressAdapter
+	double capacity; //capacità della batteria (milliampere ora)
+	double hours; //ore simulate
+};
+
+struct EnergyResult {
+	double charge[LW_ENERGY_COMPONENTS]; //carica per componente (microampere ora)
+	double total; //carica totale (microampere ora)
+	double averageCurrent; //assorbimento medio (microampere)
+	double batteryLife; //durata prevista della batteria (ore)
+	unsigned long time; //millisecondi contati da LwEnergy
+	unsigned long radioOnTime; //millisecondi da sveglio (LwRadio)
+	uint64_t awake; //microsecondi da sveglio (MockHM10)
+	unsigned long sent; //caratteri inviati al modulo
+	unsigned long received; //caratteri ricevuti dal modulo
+	unsigned long rtcReads; //letture del RTC
+	unsigned long readings; //letture prodotte
+	std::set<long> delivered; //letture consegnate al telefono (timestamp, senza i duplicati dei reinvii)
+};
+
+
+//---TELEFONO CON PERDITA---
+//Stream del telefono che perde i messaggi interi (dal delimitatore di inizio a quello di fine) in entrambe le
+//direzioni (può essere eliminato da SoftwareSerialJack, non elimina il modulo)
+class LossyPhone : public Stream {
+
+	public:
+
+		LossyPhone(MockHM10 &module, double loss) : _phone(module), _loss(loss), _dropIn(0), _dropOut(0) {}
+
+		int available() {
+
+			//prelevo i caratteri dal modulo scartando i messaggi persi
+			while (_phone.available()) {
+
+				int c = _phone.read();
+
+				if (c == SSJ_MESSAGE_START_CHARACTER) {
+					_dropIn = lost();
+				}
+
+				if (!_dropIn) {
+					_in.push_back(c);
+				}
+
+				if (c == SSJ_MESSAGE_FINISH_CHARACTER) {
+					_dropIn = 0;
+				}
+			}
+
+			return _in.size();
+		}
+
+		int read() {
+
+			if (!available()) {
+				return -1;
+			}
+
+			int c = _in.front();
+
+			_in.pop_front();
+
+			return c;
+		}
+
+		int peek() {
+
+			if (!available()) {
+				return -1;
+			}
+
+			return _in.front();
+		}
+
+		size_t write(uint8_t c) {
+
+			if (c == SSJ_MESSAGE_START_CHARACTER) {
+				_dropOut = lost();
+			}
+
+			uint8_t drop = _dropOut;
+
+			if (c == SSJ_MESSAGE_FINISH_CHARACTER) {
+				_dropOut = 0;
+			}
+
+			return drop ? 1 : _phone.write(c);
+		}
+
+
+	private:
+
+		//decide se il messaggio che inizia viene perso
+		uint8_t lost() { return _loss > 0 && rand() < _loss * RAND_MAX; }
+
+		MockHM10Phone _phone; //caratteri del telefono
+		double _loss; //probabilità di perdere ogni messaggio
+		uint8_t _dropIn; //messaggio in arrivo perso
+		uint8_t _dropOut; //messaggio in partenza perso
+		std::deque<uint8_t> _in; //caratteri ricevuti e non persi
+
+};
+
+
+//---HANDLER---
+static LwRadio *radio = NULL;
+static LwEnergy *energy = NULL;
+static EnergyResult *current = NULL;
+static long bandMessageID = 0;
+static long phoneMessageID = 0;
+
+//bracciale: conferma di una lettura (traffico); l'id del messaggio è il timestamp del RTC nel firmware
+static void bandOnReceive(JData &, long) { radio->traffic(); }
+static void bandOnReceiveAck(long) { radio->traffic(); }
+
+static long bandGetMessageID() {
+
+	energy->rtcRead();
+	current->rtcReads++;
+
+	return ++bandMessageID;
+}
+
+//telefono: lettura
+static void phoneOnReceive(JData &message, long) { current->delivered.insert(message.get("TMP").as<long>()); }
+static void phoneOnReceiveAck(long) {}
+static long phoneGetMessageID() { return ++phoneMessageID; }
+
+
+//---SIMULAZIONE---
+//istante (microsecondi virtuali) in cui inizia la prima finestra dopo l'istante indicato secondo il RTC
+static uint64_t nextWindow(const EnergyConfig &config, uint64_t now) {
+
+	uint64_t period = config.sampleInterval * 1000ULL;
+	uint64_t clock = ENERGY_START_TIMESTAMP * 1000000ULL + now;
+
+	return now + (period - clock % period);
+}
+
+//esegue la simulazione
+static void run(const EnergyConfig &config, EnergyResult &result) {
+
+	VirtualClock::install();
+	srand(ENERGY_SEED);
+
+	current = &result;
+	bandMessageID = 0;
+	phoneMessageID = 0;
+
+	uint64_t duration = (uint64_t) (config.hours * 3600 * 1000000);
+	uint64_t day = 24ULL * 3600 * 1000000;
+	uint64_t outageStart = ENERGY_OUTAGE_START * 3600ULL * 1000000;
+	uint64_t outageLength = (uint64_t) (config.outage * 3600 * 1000000);
+
+	//i mezzi di trasmissione eliminano gli stream nel distruttore
+	MockHM10 *module = new MockHM10();
+	LossyPhone *phoneStream = new LossyPhone(*module, config.loss);
+
+	SoftwareSerialJack bandSerial(*module);
+	SoftwareSerialJack phoneSerial(*phoneStream);
+
+	JCompressAdapter<SoftwareSerialJack> bandTM(bandSerial);
+	JCompressAdapter<SoftwareSerialJack> phoneTM(phoneSerial);
+
+	//senza compressione l'adattatore del bracciale passa i messaggi così come sono (come il firmware)
+	bandTM.setEnabled(config.compression);
+
+	BasicJack<JCompressAdapter<SoftwareSerialJack> > band(bandTM, &bandOnReceive, &bandOnReceiveAck, &bandGetMessageID, config.timerSendMessage, config.timerPolling);
+	BasicJack<JCompressAdapter<SoftwareSerialJack> > phoneNew(phoneTM, &phoneOnReceive, &phoneOnReceiveAck, &phoneGetMessageID, config.timerSendMessage, 0);
+	BasicJack<SoftwareSerialJack> phoneOld(phoneSerial, &phoneOnReceive, &phoneOnReceiveAck, &phoneGetMessageID, config.timerSendMessage, 0);
+
+	LwRadio bandRadio(*module, config.sampleInterval, ENERGY_WINDOW);
+
+	//tabella di default con gli assorbimenti dei sensori del firmware
+	LwEnergyCosts costs;
+
+	LW_ENERGY_COPY(&costs, &LwEnergy::DEFAULT_COSTS);
+
+	for (uint8_t i = 0; i < ENERGY_SENSORS; i++) {
+		costs.sensor[i] = SENSOR_CURRENT[i];
+	}
+
+	LwEnergy bandEnergy(costs);
+
+	radio = &bandRadio;
+	energy = &bandEnergy;
+
+	//impostazioni del firmware (applySettings())
+	band.setBurstEnabled(1);
+	band.setLinkDetectionEnabled(!config.sleep);
+	phoneNew.setLinkDetectionEnabled(0);
+	phoneOld.setLinkDetectionEnabled(0);
+
+	bandRadio.setEnabled(config.sleep);
+	bandRadio.begin();
+	bandRadio.align(ENERGY_START_TIMESTAMP);
+
+	band.start();
+	phoneNew.start();
+	phoneOld.start();
+
+	bandEnergy.begin();
+
+	//prima lettura a metà tra due finestre
+	uint64_t nextReading = nextWindow(config, 0) + config.sampleInterval * 500ULL;
+	uint64_t nextConnect = config.sleep ? nextWindow(config, 0) + ENERGY_CONNECT_LATENCY * 1000ULL : 0;
+	uint8_t powered[ENERGY_SENSORS] = { 0 };
+
+	while (VirtualClock::now() < duration) {
+
+		uint64_t now = VirtualClock::now();
+		uint8_t absent = outageLength && now % day >= outageStart && now % day < outageStart + outageLength;
+
+		//accendo i sensori la cui lettura è vicina (il GSR resta acceso con le risposte)
+		for (uint8_t i = 0; i < ENERGY_SENSORS; i++) {
+
+			if (!powered[i] && ((i == ENERGY_GSR && config.events) || now + SENSOR_WARMUP[i] * 1000ULL >= nextReading)) {
+				powered[i] = 1;
+				bandEnergy.sensor(i, 1);
+			}
+		}
+
+		//lettura (timestamp dal RTC) e spegnimento dei sensori
+		if (now >= nextReading) {
+
+			JData message;
+
+			bandEnergy.rtcRead();
+			result.rtcReads++;
+
+			message.add("TMP", ENERGY_START_TIMESTAMP + (long) (now / 1000000));
+			message.add("GSR", (long) (40 + result.readings % 7));
+			message.add("TME", 36.5);
+
+			band.send(message);
+
+			for (uint8_t i = 0; i < ENERGY_SENSORS; i++) {
+
+				if (!(i == ENERGY_GSR && config.events)) {
+					powered[i] = 0;
+					bandEnergy.sensor(i, 0);
+				}
+			}
+
+			result.readings++;
+			nextReading += config.sampleInterval * 1000ULL;
+		}
+
+		//il telefono si collega alla finestra prevista (o resta collegato con il sonno disabilitato)
+		if (absent && module->connected()) {
+			module->disconnect();
+		}
+
+		if (now >= nextConnect) {
+
+			if (!absent) {
+				module->connect();
+			}
+
+			nextConnect = config.sleep ? nextWindow(config, now) + ENERGY_CONNECT_LATENCY * 1000ULL : now;
+		}
+
+		//il loop di Jack solo con il modulo sveglio
+		if (bandRadio.loop(band.pending())) {
+			band.loop();
+		}
+
+		//contabilizzazione (come nel loop del firmware)
+		bandEnergy.loop();
+		bandEnergy.radio(bandRadio.onTime(), bandSerial.bytesSent(), bandSerial.bytesReceived());
+
+		module->update();
+
+		//il telefono scollegato non trasmette
+		if (module->connected()) {
+
+			if (config.compression) {
+				phoneNew.loop();
+			} else {
+				phoneOld.loop();
+			}
+		}
+
+		module->update();
+
+		VirtualClock::advance(ENERGY_STEP);
+	}
+
+	//conto anche l'ultimo passo
+	bandEnergy.loop();
+	bandEnergy.radio(bandRadio.onTime(), bandSerial.bytesSent(), bandSerial.bytesReceived());
+
+	for (uint8_t i = 0; i < LW_ENERGY_COMPONENTS; i++) {
+		result.charge[i] = bandEnergy.charge(i);
+	}
+
+	result.total = bandEnergy.charge();
+	result.averageCurrent = bandEnergy.averageCurrent();
+	result.batteryLife = bandEnergy.batteryLife(config.capacity);
+	result.time = bandEnergy.time();
+	result.radioOnTime = bandRadio.onTime();
+	result.awake = module->awakeTime();
+	result.sent = bandSerial.bytesSent();
+	result.received = bandSerial.bytesReceived();
+
+	radio = NULL;
+	energy = NULL;
+	current = NULL;
+
+	VirtualClock::uninstall();
+}
+
+
+//---MAIN---
+static void usage(const char *name) {
+	fprintf(stderr, "uso: %s [-s campionamento] [-r reinvio] [-p polling] [-w sonno] [-e risposte] [-l perdita] [-a assenza] [-z] [-c capacità] [-d durata]\n", name);
+}
+
+int main(int argc, char **argv) {
+
+	//impostazioni di default del firmware
+	EnergyConfig config = { 300000, 5000, 1000, 1, 0, 0, 0, 0, 1000, 24 };
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:r:p:w:e:l:a:zc:d:")) != -1) {
+
+		if (opt == 's') {
+			config.sampleInterval = strtoul(optarg, NULL, 10) * 1000UL;
+		} else if (opt == 'r') {
+			config.timerSendMessage = atol(optarg);
+		} else if (opt == 'p') {
+			config.timerPolling = atol(optarg);
+		} else if (opt == 'w') {
+			config.sleep = atoi(optarg) != 0;
+		} else if (opt == 'e') {
+			config.events = atoi(optarg) != 0;
+		} else if (opt == 'l') {
+			config.loss = atof(optarg);
+		} else if (opt == 'a') {
+			config.outage = atof(optarg);
+		} else if (opt == 'z') {
+			config.compression = 1;
+		} else if (opt == 'c') {
+			config.capacity = atof(optarg);
+		} else if (opt == 'd') {
+			config.hours = atof(optarg);
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	//stessi limiti del messaggio di controllo del firmware (validSettings())
+	if (config.sampleInterval < 10000UL || config.sampleInterval > 86400000UL || config.timerSendMessage < 100 ||
+		config.timerPolling < 50 || config.loss < 0 || config.loss > 1 || config.outage < 0 || config.outage > 24 - ENERGY_OUTAGE_START ||
+		config.capacity <= 0 || config.hours <= 0) {
+
+		usage(argv[0]);
+		return 1;
+	}
+
+	EnergyResult result = EnergyResult();
+
+	run(config, result);
+
+	//carica riportata a un giorno
+	double perDay = 24.0 / config.hours;
+
+	const char *names[LW_ENERGY_COMPONENTS] = { "assorbimento fisso", "microcontrollore", "modulo bluetooth", "sensori", "RTC" };
+
+	printf("campionamento %lu s, reinvio %ld ms, polling %ld ms, sonno %s, risposte %s, compressione %s\n",
+		config.sampleInterval / 1000, config.timerSendMessage, config.timerPolling, config.sleep ? "sì" : "no",
+		config.events ? "sì" : "no", config.compression ? "sì" : "no");
+	printf("perdita %.1f%%, telefono assente %.1f h al giorno, batteria %.0f mAh, %.1f ore simulate\n\n",
+		100.0 * config.loss, config.outage, config.capacity, config.hours);
+
+	printf("%-20s %12s %8s\n", "componente", "uAh/giorno", "%");
+
+	for (uint8_t i = 0; i < LW_ENERGY_COMPONENTS; i++) {
+		printf("%-20s %12.1f %7.1f%%\n", names[i], result.charge[i] * perDay, result.total > 0 ? 100.0 * result.charge[i] / result.total : 0.0);
+	}
+
+	printf("%-20s %12.1f\n\n", "totale", result.total * perDay);
+
+	printf("modulo sveglio %.2f%% (%.0f s), caratteri inviati %lu, ricevuti %lu, letture del RTC %lu\n",
+		100.0 * result.radioOnTime / (config.hours * 3600 * 1000), result.radioOnTime / 1000.0, result.sent,
+		result.received, result.rtcReads);
+	printf("letture consegnate %zu/%lu\n", result.delivered.size(), result.readings);
+	printf("assorbimento medio %.0f uA, durata prevista della batteria %.1f giorni\n\n", result.averageCurrent, result.batteryLife / 24);
+
+	//il tempo contato da LwEnergy deve coincidere con quello simulato, quello del modulo con MockHM10
+	uint8_t consistent = result.time == (unsigned long) (config.hours * 3600 * 1000) && result.radioOnTime == result.awake / 1000;
+
+	printf("tempi di LwEnergy e LwRadio uguali a quelli simulati: %s\n", consistent ? "sì" : "NO");
+
+	return consistent ? 0 : 1;
+}
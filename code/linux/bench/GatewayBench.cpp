@@ -0,0 +1,235 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file GatewayBench.cpp
+ * @brief Benchmark del gateway Jack: messaggi/secondo e latenza (invio -> ACK) al crescere dei dispositivi
+ *
+ * Ogni dispositivo è simulato da un capo di una socketpair: un thread separato invia i messaggi dati
+ * (con al massimo BENCH_WINDOW messaggi non confermati per dispositivo) e misura il tempo di arrivo dell'ACK.
+ *
+ * Uso: gateway-bench [durata_ms] [max_dispositivi]
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../gateway/JackGateway.h"
+#include "BenchUtils.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Numero massimo di messaggi non confermati per dispositivo
+ */
+#define BENCH_WINDOW 8
+/**
+ * @brief Durata di default di ogni misura (millisecondi)
+ */
+#define BENCH_DURATION 2000
+/**
+ * @brief Numero massimo di default di dispositivi
+ */
+#define BENCH_MAX_DEVICES 64
+
+
+//---DISPOSITIVO SIMULATO---
+struct BenchDevice {
+	int fd; //capo della socketpair del dispositivo
+	long nextID; //prossimo id da inviare
+	int inFlight; //messaggi non confermati
+	uint64_t sentAt[BENCH_WINDOW]; //istante di invio dei messaggi non confermati (indicizzato per id)
+	char buffer[4096]; //caratteri ricevuti non ancora elaborati
+	size_t length;
+};
+
+//messaggi ricevuti dal gateway
+static unsigned long receivedByGateway = 0;
+
+//handler del gateway
+static void onReceive(JGConnection &, JData &, long) {
+	receivedByGateway++;
+}
+
+//invia un messaggio dati dal dispositivo
+static void deviceSend(BenchDevice &device) {
+
+	char frame[128];
+
+	long id = device.nextID++;
+
+	int length = snprintf(frame, sizeof(frame), "<{\"val\":{\"TMP\":%ld,\"GSR\":42,\"TME\":36.5},\"id\":%ld,\"type\":\"data\"}>", 1480000000L + id, id);
+
+	device.sentAt[id % BENCH_WINDOW] = benchNanos();
+	device.inFlight++;
+
+	if (write(device.fd, frame, length) != length) {
+		device.inFlight--; //la socket è piena, il messaggio verrà reinviato con un nuovo id
+	}
+}
+
+//elabora gli ACK ricevuti dal dispositivo e restituisce il numero di conferme
+static int deviceReceive(BenchDevice &device, std::vector<uint64_t> &latencies) {
+
+	ssize_t n = read(device.fd, device.buffer + device.length, sizeof(device.buffer) - device.length);
+
+	if (n <= 0) {
+		return 0;
+	}
+
+	device.length += n;
+
+	int acks = 0;
+	size_t start = 0;
+
+	//cerco i messaggi completi
+	for (size_t i = 0; i < device.length; i++) {
+
+		if (device.buffer[i] != '>') {
+			continue;
+		}
+
+		device.buffer[i] = 0;
+
+		const char *id = strstr(device.buffer + start, "\"id\":");
+
+		if (id != NULL) {
+
+			long ackID = atol(id + 5);
+
+			latencies.push_back(benchNanos() - device.sentAt[ackID % BENCH_WINDOW]);
+			device.inFlight--;
+			acks++;
+		}
+
+		start = i + 1;
+	}
+
+	//sposto in testa i caratteri del messaggio incompleto
+	memmove(device.buffer, device.buffer + start, device.length - start);
+	device.length -= start;
+
+	return acks;
+}
+
+//esegue una misura con il numero di dispositivi indicato
+static void benchmark(int devices, int duration) {
+
+	JackGateway gateway(&onReceive, NULL, 60000); //il gateway non invia dati: il reinvio non interviene
+	std::vector<BenchDevice> simulated(devices);
+	std::vector<uint64_t> latencies;
+	std::atomic<bool> done(false);
+
+	//creo le socketpair
+	for (int i = 0; i < devices; i++) {
+
+		int fds[2];
+
+		socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+
+		gateway.addDevice(fds[0], "bench");
+
+		memset(&simulated[i], 0, sizeof(BenchDevice));
+		simulated[i].fd = fds[1];
+		simulated[i].nextID = 1;
+	}
+
+	receivedByGateway = 0;
+	unsigned long acks = 0;
+
+	//thread dei dispositivi
+	std::thread deviceThread([&]() {
+
+		std::vector<struct pollfd> fds(devices);
+
+		for (int i = 0; i < devices; i++) {
+			fds[i].fd = simulated[i].fd;
+			fds[i].events = POLLIN;
+		}
+
+		uint64_t end = benchNanos() + (uint64_t) duration * 1000000ULL;
+
+		while (benchNanos() < end) {
+
+			//riempio la finestra di ogni dispositivo
+			for (int i = 0; i < devices; i++) {
+				while (simulated[i].inFlight < BENCH_WINDOW) {
+					deviceSend(simulated[i]);
+				}
+			}
+
+			//attendo gli ACK
+			if (poll(fds.data(), devices, 10) <= 0) {
+				continue;
+			}
+
+			for (int i = 0; i < devices; i++) {
+				if (fds[i].revents & POLLIN) {
+					acks += deviceReceive(simulated[i], latencies);
+				}
+			}
+		}
+
+		done = true;
+	});
+
+	//loop del gateway
+	while (!done) {
+		gateway.runOnce(1);
+	}
+
+	deviceThread.join();
+
+	double seconds = duration / 1000.0;
+
+	printf("%8d %14.0f %12.1f %12.1f %12.1f\n", devices, acks / seconds,
+		benchPercentile(latencies, 50) / 1000.0, benchPercentile(latencies, 99) / 1000.0, benchPercentile(latencies, 100) / 1000.0);
+
+	//chiudo le socketpair
+	for (int i = 0; i < devices; i++) {
+		close(gateway.connection(i)->mmJTM->fd());
+		close(simulated[i].fd);
+	}
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	int duration = argc > 1 ? atoi(argv[1]) : BENCH_DURATION;
+	int maxDevices = argc > 2 ? atoi(argv[2]) : BENCH_MAX_DEVICES;
+
+	printf("%8s %14s %12s %12s %12s\n", "devices", "frames/s", "p50 (us)", "p99 (us)", "max (us)");
+
+	for (int devices = 1; devices <= maxDevices; devices *= 2) {
+		benchmark(devices, duration);
+	}
+
+	return 0;
+}
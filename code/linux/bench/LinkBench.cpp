@@ -0,0 +1,350 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LinkBench.cpp
+ * @brief Scenari di collegamento disturbato per Jack: goodput, latenza di consegna e overhead dei reinvii
+ *
+ * Ogni scenario simula 24 ore di letture del bracciale (una ogni 5 minuti) con i timer del firmware,
+ * tranne "backlog" in cui tutte le letture sono già in coda all'avvio (riconnessione dopo 24 ore senza
+ * collegamento): in questo caso la durata è il tempo necessario a svuotare il backlog. Il tempo è virtuale.
+ *
+ * Uso: link-bench [seme]
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include "../sim/JackScenario.h"
+#include "BenchUtils.h"
+
+
+//esegue lo scenario e stampa il risultato
+static void scenario(const ScenarioConfig &config) {
+
+	ScenarioResult result;
+
+	uint64_t start = benchNanos();
+
+	JackScenario::run(config, result);
+
+	uint64_t elapsed = benchNanos() - start;
+
+	printf("%-24s %5lu/%-5lu %5lu %9.0f %10.2f %9.0f %9.0f %9.0f %8.2f %9lu %8.0f\n", config.name,
+		result.delivered, config.readings, result.duplicates, result.duration / 1e6, JackScenario::goodput(result),
+		benchPercentile(result.latencies, 50) / 1000.0, benchPercentile(result.latencies, 90) / 1000.0, benchPercentile(result.latencies, 99) / 1000.0,
+		JackScenario::overhead(result), result.uplink.bytesSent, elapsed / 1e6);
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	uint64_t seed = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+
+	printf("%-24s %11s %5s %9s %10s %9s %9s %9s %8s %9s %8s\n", "scenario", "delivered", "dup", "time s", "goodput", "p50 ms", "p90 ms", "p99 ms", "retx", "tx bytes", "real ms");
+
+	//collegamento pulito a 9600 baud
+	ScenarioConfig config = JackScenario::defaults("clean 9600");
+	config.seed = seed;
+	config.uplink.baudrate = config.downlink.baudrate = 9600;
+	config.uplink.latency = config.downlink.latency = 20;
+	scenario(config);
+
+	//perdita del 10% in entrambe le direzioni
+	ScenarioConfig lossy = config;
+	lossy.name = "loss 10%";
+	lossy.uplink.lossRate = lossy.downlink.lossRate = 0.10;
+	scenario(lossy);
+
+	//perdita del 30% in entrambe le direzioni
+	ScenarioConfig veryLossy = config;
+	veryLossy.name = "loss 30%";
+	veryLossy.uplink.lossRate = veryLossy.downlink.lossRate = 0.30;
+	scenario(veryLossy);
+
+	//BLE (HM-10): pacchetti da 20 byte, 2% di perdita per pacchetto
+	ScenarioConfig ble = config;
+	ble.name = "ble mtu20 loss 2%/pkt";
+	ble.uplink.mtu = ble.downlink.mtu = 20;
+	ble.uplink.lossRate = ble.downlink.lossRate = 0.02;
+	scenario(ble);
+
+	//errori sui bit
+	ScenarioConfig noisy = config;
+	noisy.name = "ber 1e-4";
+	noisy.uplink.bitErrorRate = noisy.downlink.bitErrorRate = 1e-4;
+	scenario(noisy);
+
+	//duplicazione e riordino
+	ScenarioConfig shuffled = config;
+	shuffled.name = "dup 5% reorder 10%";
+	shuffled.uplink.duplicateRate = shuffled.downlink.duplicateRate = 0.05;
+	shuffled.uplink.reorderRate = shuffled.downlink.reorderRate = 0.10;
+	shuffled.uplink.reorderDelay = shuffled.downlink.reorderDelay = 3000;
+	scenario(shuffled);
+
+	//latenza elevata
+	ScenarioConfig slow = config;
+	slow.name = "latency 400+-200 ms";
+	slow.uplink.latency = slow.downlink.latency = 400;
+	slow.uplink.jitter = slow.downlink.jitter = 200;
+	scenario(slow);
+
+	//24 ore di letture già in coda (riconnessione dopo una lunga disconnessione), senza e con burst
+	ScenarioConfig backlog = config;
+	backlog.name = "backlog 288 no burst";
+	backlog.readingInterval = 0;
+	backlog.deviceBurst = 0;
+	scenario(backlog);
+
+	backlog.name = "backlog 288 burst";
+	backlog.deviceBurst = 1;
+	scenario(backlog);
+
+	//coda e perdita
+	ScenarioConfig lossyBacklog = lossy;
+	lossyBacklog.name = "backlog 288 loss 10% nb";
+	lossyBacklog.readingInterval = 0;
+	lossyBacklog.deviceBurst = 0;
+	scenario(lossyBacklog);
+
+	lossyBacklog.name = "backlog 288 loss 10%";
+	lossyBacklog.deviceBurst = 1;
+	scenario(lossyBacklog);
+
+	//BLE (HM-10): messaggi interi contro frammenti da un pacchetto, al crescere della perdita per pacchetto
+	printf("\n%-24s %11s %5s %9s %9s %9s %9s %11s %9s\n", "fragmentation", "delivered", "dup", "time s", "p50 ms", "p99 ms", "tx bytes", "retx B/rdg", "skipped");
+
+	static const double packetLoss[] = {0, 0.02, 0.05, 0.10, 0.20};
+
+	for (uint8_t fragmentation = 0; fragmentation <= 1; fragmentation++) {
+
+		ScenarioResult baseline;
+
+		for (size_t i = 0; i < sizeof(packetLoss) / sizeof(packetLoss[0]); i++) {
+
+			char name[32];
+			snprintf(name, sizeof(name), "%s loss %g%%/pkt", fragmentation ? "frag" : "whole", packetLoss[i] * 100);
+
+			ScenarioConfig packets = config;
+			packets.name = name;
+			packets.fragmentation = fragmentation;
+			packets.uplink.mtu = packets.downlink.mtu = 20;
+			packets.uplink.lossRate = packets.downlink.lossRate = packetLoss[i];
+
+			ScenarioResult result;
+			JackScenario::run(packets, result);
+
+			//lo scenario senza perdita è la baseline (ogni lettura trasmessa una volta)
+			if (i == 0) {
+				baseline = result;
+			}
+
+			printf("%-24s %5lu/%-5lu %5lu %9.0f %9.0f %9.0f %9lu %11.1f %9lu\n", name,
+				result.delivered, packets.readings, result.duplicates, result.duration / 1e6,
+				benchPercentile(result.latencies, 50) / 1000.0, benchPercentile(result.latencies, 99) / 1000.0,
+				result.uplink.bytesSent, JackScenario::retransmittedBytes(result, baseline), result.fragmentsSkipped);
+		}
+	}
+
+	//coda in burst a frammenti (più messaggi in riassemblaggio contemporaneamente)
+	ScenarioConfig fragmentedBacklog = config;
+	fragmentedBacklog.name = "frag backlog loss 10%";
+	fragmentedBacklog.readingInterval = 0;
+	fragmentedBacklog.fragmentation = 1;
+	fragmentedBacklog.uplink.mtu = fragmentedBacklog.downlink.mtu = 20;
+	fragmentedBacklog.uplink.lossRate = fragmentedBacklog.downlink.lossRate = 0.10;
+
+	ScenarioResult result;
+	JackScenario::run(fragmentedBacklog, result);
+
+	printf("%-24s %5lu/%-5lu %5lu %9.0f %9.0f %9.0f %9lu %11s %9lu\n", fragmentedBacklog.name,
+		result.delivered, fragmentedBacklog.readings, result.duplicates, result.duration / 1e6,
+		benchPercentile(result.latencies, 50) / 1000.0, benchPercentile(result.latencies, 99) / 1000.0,
+		result.uplink.bytesSent, "-", result.fragmentsSkipped);
+
+	//frammenti attraverso SoftwareSerialJack e l'HM-10 simulato: le intestazioni non devono contenere i delimitatori
+	//(288 letture usano tutte le JK_FRAGMENT_TAGS etichette più volte)
+	for (uint8_t lossy = 0; lossy <= 1; lossy++) {
+
+		ScenarioConfig framed = config;
+		framed.name = lossy ? "frag serial loss 10%" : "frag serial";
+		framed.fragmentation = 1;
+		framed.serialFraming = 1;
+		framed.uplink.mtu = framed.downlink.mtu = 20;
+		framed.uplink.lossRate = framed.downlink.lossRate = lossy ? 0.10 : 0;
+
+		JackScenario::run(framed, result);
+
+		printf("%-24s %5lu/%-5lu %5lu %9.0f %9.0f %9.0f %9lu %11s %9lu\n", framed.name,
+			result.delivered, framed.readings, result.duplicates, result.duration / 1e6,
+			benchPercentile(result.latencies, 50) / 1000.0, benchPercentile(result.latencies, 99) / 1000.0,
+			result.uplink.bytesSent, "-", result.fragmentsSkipped);
+	}
+
+	//errori sui bit: solo reinvii (ARQ) contro parità Reed-Solomon crescente, svuotando 24 ore di letture a 9600 baud
+	printf("\n%-24s %11s %7s %9s %10s %9s %9s %9s %7s\n", "fec (backlog)", "delivered", "altered", "time s", "goodput", "p99 ms", "tx bytes", "corrected", "failed");
+
+	static const double bitErrorRate[] = {0, 1e-4, 3e-4, 1e-3, 2e-3, 3e-3};
+	static const uint8_t fecParity[] = {0, 4, 8, 16};
+
+	ScenarioResult clean;
+
+	for (size_t i = 0; i < sizeof(bitErrorRate) / sizeof(bitErrorRate[0]); i++) {
+		for (size_t j = 0; j < sizeof(fecParity) / sizeof(fecParity[0]); j++) {
+
+			char name[32];
+
+			if (fecParity[j]) {
+				snprintf(name, sizeof(name), "ber %g rs %u", bitErrorRate[i], fecParity[j]);
+			} else {
+				snprintf(name, sizeof(name), "ber %g arq", bitErrorRate[i]);
+			}
+
+			ScenarioConfig coded = config;
+			coded.name = name;
+			coded.readingInterval = 0;
+			coded.fecParity = fecParity[j];
+			coded.uplink.bitErrorRate = coded.downlink.bitErrorRate = bitErrorRate[i];
+
+			ScenarioResult result;
+			JackScenario::run(coded, result);
+
+			//lo scenario senza errori e senza codice è la baseline dei byte utili
+			if (i == 0 && j == 0) {
+				clean = result;
+			}
+
+			printf("%-24s %5lu/%-5lu %7lu %9.0f %10.2f %9.0f %9lu %9lu %7lu\n", name,
+				result.delivered, coded.readings, result.altered, result.duration / 1e6, JackScenario::goodput(result, clean),
+				benchPercentile(result.latencies, 99) / 1000.0, result.uplink.bytesSent, result.fecCorrected, result.fecFailed);
+		}
+	}
+
+	//stream live a 5 Hz su un collegamento lento (1200 baud, perdita del 10%) insieme alle letture affidabili
+	//(senza -DJK_LIVE_SLOT=1 JK_QOS_LATEST viene inviato come JK_QOS_UNRELIABLE)
+	printf("\n%-24s %11s %9s %11s %9s %9s %9s %9s %9s\n", "live 5 Hz 1200 baud", "delivered", "p99 ms", "live", "merged", "age p50", "age p99", "age max", "tx bytes");
+
+	static const struct {
+		const char *name;
+		uint8_t qos;
+		long timer;
+	} live[] = {
+		{"reliable", JK_QOS_RELIABLE, 0},
+		{"unreliable", JK_QOS_UNRELIABLE, 0},
+		{"latest timer 0", JK_QOS_LATEST, 0},
+		{"latest timer 400", JK_QOS_LATEST, 400},
+		{"latest timer 500", JK_QOS_LATEST, 500},
+		{"latest timer 700", JK_QOS_LATEST, 700},
+	};
+
+	for (size_t i = 0; i < sizeof(live) / sizeof(live[0]); i++) {
+
+		ScenarioConfig streaming = config;
+		streaming.name = live[i].name;
+		streaming.readings = 12;
+		streaming.readingInterval = 5000;
+		streaming.uplink.baudrate = streaming.downlink.baudrate = 1200;
+		streaming.uplink.lossRate = streaming.downlink.lossRate = 0.10;
+		streaming.liveInterval = 200;
+		streaming.liveQos = live[i].qos;
+		streaming.liveTimer = live[i].timer;
+
+		ScenarioResult result;
+		JackScenario::run(streaming, result);
+
+		printf("%-24s %5lu/%-5lu %9.0f %5lu/%-5lu %9lu %9.0f %9.0f %9.0f %9lu\n", streaming.name,
+			result.delivered, streaming.readings, benchPercentile(result.latencies, 99) / 1000.0,
+			result.liveDelivered, result.liveSent, result.liveCoalesced,
+			benchPercentile(result.liveAges, 50) / 1000.0, benchPercentile(result.liveAges, 99) / 1000.0,
+			benchPercentile(result.liveAges, 100) / 1000.0, result.uplink.bytesSent);
+	}
+
+	//interruzione di 8 ore dopo 2 ore: letture senza scadenza contro letture che scadono nel buffer di invio
+	//(il bracciale perde le letture che non entrano nel buffer, come un bracciale senza coda propria; senza -DJK_TTL=1
+	//le letture non scadono)
+	printf("\n%-24s %11s %7s %7s %9s %9s %11s %9s\n", "ttl (outage 8 h)", "delivered", "dropped", "expired", "p50 ms", "p99 ms", "outage B", "tx bytes");
+
+	static const unsigned long messageTTL[] = {0, 3600000, 1800000, 900000};
+
+	for (size_t i = 0; i < sizeof(messageTTL) / sizeof(messageTTL[0]); i++) {
+
+		char name[32];
+
+		if (messageTTL[i]) {
+			snprintf(name, sizeof(name), "ttl %lu min", messageTTL[i] / 60000);
+		} else {
+			snprintf(name, sizeof(name), "no ttl");
+		}
+
+		ScenarioConfig expiring = config;
+		expiring.name = name;
+		expiring.outageStart = 2 * 3600000UL;
+		expiring.outageDuration = 8 * 3600000UL;
+		expiring.messageTTL = messageTTL[i];
+		expiring.dropWhenFull = 1;
+		expiring.linkDetection = 0; //reinvii continui, come prima della rilevazione del collegamento
+
+		ScenarioResult result;
+		JackScenario::run(expiring, result);
+
+		printf("%-24s %5lu/%-5lu %7lu %7lu %9.0f %9.0f %11lu %9lu\n", name,
+			result.delivered, expiring.readings, result.dropped, result.expired,
+			benchPercentile(result.latencies, 50) / 1000.0, benchPercentile(result.latencies, 99) / 1000.0,
+			result.outageBytes, result.uplink.bytesSent);
+	}
+
+	//interruzione di 8 ore dopo 2 ore: reinvii continui contro rilevazione del collegamento interrotto
+	printf("\n%-24s %11s %7s %11s %9s %9s %11s %9s\n", "link (outage 8 h)", "delivered", "dropped", "outage B", "probes", "p99 ms", "recovery ms", "tx bytes");
+
+	static const struct {
+		const char *name;
+		uint8_t detection;
+		long probe;
+	} link[] = {
+		{"always resend", 0, 0},
+		{"detect probe 60 s", 1, 60000},
+		{"detect probe 300 s", 1, 300000},
+	};
+
+	for (size_t i = 0; i < sizeof(link) / sizeof(link[0]); i++) {
+
+		ScenarioConfig outage = config;
+		outage.name = link[i].name;
+		outage.outageStart = 2 * 3600000UL;
+		outage.outageDuration = 8 * 3600000UL;
+		outage.dropWhenFull = 1;
+		outage.linkDetection = link[i].detection;
+		outage.deviceTimerProbe = link[i].probe;
+
+		ScenarioResult result;
+		JackScenario::run(outage, result);
+
+		printf("%-24s %5lu/%-5lu %7lu %11lu %9lu %9.0f %11.0f %9lu\n", outage.name,
+			result.delivered, outage.readings, result.dropped, result.outageBytes, result.probesSent,
+			benchPercentile(result.latencies, 99) / 1000.0, result.recovery / 1000.0, result.uplink.bytesSent);
+	}
+
+	return 0;
+}
@@ -0,0 +1,455 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file MemoryReport.cpp
+ * @brief Rapporto della memoria occupata da Jack, dal firmware e dal core Arduino nel caso peggiore per una configurazione dei buffer
+ *
+ * La configurazione è quella di compilazione (JConfig.h, ridefinibile con -DJK_MAX_MESSAGE_LENGTH=... ecc.).
+ * La colonna host riporta le dimensioni reali di questa build, la colonna avr la stima per l'ATmega
+ * (puntatori e size_t a 16 bit, double a 32 bit) calcolata sulla struttura delle classi.
+ *
+ * Lo stack comprende i buffer dei frame di Jack (non le variabili scalari e i registri salvati): per l'ATmega
+ * viene aggiunto MR_AVR_FRAME_OVERHEAD per ogni chiamata annidata. I buffer JSON stanno nel pool statico
+ * JArena: sullo stack restano solo i descrittori dei buffer.
+ *
+ * Alle stime di Jack si sommano le variabili globali del firmware (LeweFirmware.ino, dimensioni e funzioni uguali a
+ * quelle del firmware nelle costanti MR_*) e i buffer del core Arduino (seriale hardware con il debug, SoftwareSerial
+ * e Wire per il RTC), presenti solo sull'ATmega.
+ *
+ * Il programma termina con codice 1 se il caso peggiore stimato non lascia libera sull'ATmega328P (MR_AVR_RAM)
+ * almeno la riserva per gli interrupt e per le variabili locali del firmware (MR_AVR_STACK_RESERVE).
+ *
+ * Uso: memory-report
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <algorithm>
+
+//il firmware riduce il buffer di invio di Jack (LeweFirmware.ino): di default il rapporto usa la stessa configurazione
+#ifndef JK_BUFFER_SEND_SIZE
+#define JK_BUFFER_SEND_SIZE 2
+#define JK_BURST_THRESHOLD 2
+#define JK_BURST_WINDOW 2
+#endif
+
+#include <Jack.h>
+#include <SoftwareSerialJack.h>
+#include <LwEnergy.h>
+
+
+//---COSTANTI---
+/**
+ * @brief Byte di stack stimati per ogni chiamata sull'ATmega (indirizzo di ritorno, registri salvati, scalari)
+ */
+#define MR_AVR_FRAME_OVERHEAD 24
+/**
+ * @brief Byte occupati da malloc sull'ATmega per ogni blocco (dimensione del blocco)
+ */
+#define MR_AVR_MALLOC_OVERHEAD 2
+/**
+ * @brief RAM dell'ATmega328P (byte): il caso peggiore deve starci, il resto è per le variabili del firmware
+ */
+#ifndef MR_AVR_RAM
+#define MR_AVR_RAM 2048
+#endif
+/**
+ * @brief RAM da lasciare libera sull'ATmega (byte): interrupt e variabili locali del firmware fuori da Jack
+ */
+#ifndef MR_AVR_STACK_RESERVE
+#define MR_AVR_STACK_RESERVE 64
+#endif
+
+//FIRMWARE (uguali a LeweFirmware.ino)
+/**
+ * @brief Sensori del registro (SENSOR_COUNT)
+ */
+#ifndef MR_SENSOR_COUNT
+#define MR_SENSOR_COUNT 2
+#endif
+/**
+ * @brief Letture in attesa (BACKLOG_SIZE)
+ */
+#ifndef MR_BACKLOG_SIZE
+#define MR_BACKLOG_SIZE 8
+#endif
+/**
+ * @brief Riassunti in attesa (SUMMARY_BACKLOG_SIZE)
+ */
+#ifndef MR_SUMMARY_BACKLOG_SIZE
+#define MR_SUMMARY_BACKLOG_SIZE 6
+#endif
+/**
+ * @brief Risposte fasiche in attesa (EVENT_BACKLOG_SIZE)
+ */
+#ifndef MR_EVENT_BACKLOG_SIZE
+#define MR_EVENT_BACKLOG_SIZE 4
+#endif
+/**
+ * @brief Riassunti delle letture compilati nel firmware (SUMMARY_SUPPORT)
+ */
+#ifndef MR_SUMMARY_SUPPORT
+#define MR_SUMMARY_SUPPORT 0
+#endif
+/**
+ * @brief Risposte fasiche del GSR compilate nel firmware (EVENT_SUPPORT)
+ */
+#ifndef MR_EVENT_SUPPORT
+#define MR_EVENT_SUPPORT 0
+#endif
+/**
+ * @brief Sonno del modulo bluetooth compilato nel firmware (RADIO_SLEEP_SUPPORT)
+ */
+#ifndef MR_RADIO_SLEEP_SUPPORT
+#define MR_RADIO_SLEEP_SUPPORT 1
+#endif
+/**
+ * @brief Stima dei consumi compilata nel firmware (ENERGY_SUPPORT)
+ */
+#ifndef MR_ENERGY_SUPPORT
+#define MR_ENERGY_SUPPORT 0
+#endif
+/**
+ * @brief Debug su seriale (DEBUG definita: Serial in uso)
+ */
+#ifndef MR_DEBUG
+#define MR_DEBUG 0
+#endif
+/**
+ * @brief Byte di una chiave dei messaggi del firmware (3 caratteri e terminatore, in RAM sull'ATmega)
+ */
+#define MR_KEY_SIZE 4
+
+//CORE ARDUINO (ATmega328P)
+/**
+ * @brief Buffer di ricezione e di trasmissione della seriale hardware (SERIAL_RX_BUFFER_SIZE, SERIAL_TX_BUFFER_SIZE)
+ */
+#define MR_AVR_SERIAL_BUFFER 64
+/**
+ * @brief Buffer di ricezione di SoftwareSerial (_SS_MAX_RX_BUFF)
+ */
+#define MR_AVR_SOFTWARE_SERIAL_BUFFER 64
+/**
+ * @brief Buffer di Wire e di twi (BUFFER_LENGTH, TWI_BUFFER_LENGTH)
+ */
+#define MR_AVR_WIRE_BUFFER 32
+
+
+//---MODELLO AVR---
+//dimensioni dei tipi sull'ATmega
+#define MR_AVR_POINTER 2
+#define MR_AVR_SIZE_T 2
+#define MR_AVR_INT 2
+#define MR_AVR_LONG 4
+
+//JsonVariant: contenuto (long, float o puntatore) e tipo
+#define MR_AVR_JSON_VARIANT (MR_AVR_LONG + 1)
+
+//JSON_OBJECT_SIZE(n): lista (buffer e primo nodo) e nodi (successivo, chiave, valore)
+static size_t avrJsonObjectSize(size_t n) {
+	return 2 * MR_AVR_POINTER + n * (2 * MR_AVR_POINTER + MR_AVR_JSON_VARIANT);
+}
+
+//JArenaBuffer: blocco in prestito, tabella virtuale, buffer, capacità e occupazione (il blocco è nel pool)
+static size_t avrArenaBuffer() {
+	return 3 * MR_AVR_POINTER + 2 * MR_AVR_SIZE_T;
+}
+
+//JK_JSON_BUFFER_SIZE calcolato con le dimensioni dell'ATmega
+static size_t avrJsonBufferSize() {
+	return avrJsonObjectSize(3) + avrJsonObjectSize(JK_MAX_VALUES);
+}
+
+//JData: indicatore dell'oggetto nested, buffer, root e payload
+static size_t avrJData() {
+	return 1 + avrArenaBuffer() + 2 * MR_AVR_POINTER;
+}
+
+//JArena: blocchi, blocchi in uso, contatori
+static size_t avrArena() {
+	return JK_ARENA_BLOCKS * avrJsonBufferSize() + 3 + MR_AVR_LONG;
+}
+
+//JMessageSlot: id, lunghezza, inviato, ultimo invio, scadenza (JK_TTL) e messaggio
+static size_t avrMessageSlot() {
+	return MR_AVR_LONG + 2 + 1 + MR_AVR_LONG + JK_TTL * MR_AVR_LONG + JK_MAX_MESSAGE_LENGTH;
+}
+
+//stream senza conferma di BasicJack: id, indicatore e (con JK_LIVE_SLOT) timer, tempo, contatore e slot dell'ultimo valore
+static size_t avrLive() {
+	return 2 * MR_AVR_LONG + 1 + JK_LIVE_SLOT * (3 * MR_AVR_LONG + avrMessageSlot());
+}
+
+//scadenza dei messaggi di BasicJack: durata, ordine di scadenza, contatori e handler (nulla senza JK_TTL)
+static size_t avrExpiry() {
+	return JK_TTL ? MR_AVR_LONG + JK_BUFFER_SEND_SIZE + 1 + 2 * MR_AVR_LONG + MR_AVR_POINTER : 0;
+}
+
+//stato del collegamento di BasicJack: indicatori, slot del reinvio, timer, attesa, id e contatore delle verifiche
+static size_t avrLink() {
+	return 5 + 4 * MR_AVR_LONG;
+}
+
+//BasicJack: timer e tempi, mezzo di trasmissione, slot, indicatori, ultimo ACK, stream senza conferma, scadenza,
+//stato del collegamento, messaggi ricevuti scartati e handler
+static size_t avrJack() {
+	return 4 * MR_AVR_LONG + MR_AVR_POINTER + JK_BUFFER_SEND_SIZE * avrMessageSlot() + 4 + MR_AVR_LONG + avrLive() + avrExpiry() + avrLink() + MR_AVR_LONG + 4 * MR_AVR_POINTER;
+}
+
+//JTrace: buffer circolare (inizio, durata e fase), indici, contatori e massimi per fase (nulla se disattivata)
+static size_t avrTrace() {
+	return JK_TRACE ? JK_TRACE_SIZE * (2 * MR_AVR_LONG + 1) + 2 + 2 * JK_TRACE_PHASES * MR_AVR_LONG : 0;
+}
+
+//SoftwareSerialJack: stream, buffer e contatori
+static size_t avrSoftwareSerialJack() {
+	return 2 * MR_AVR_POINTER + 4 * MR_AVR_INT;
+}
+
+//stringhe costanti di Jack (sull'ATmega stanno in RAM): chiavi e tipi JSON, coda dell'ACK e della verifica, inizio dei messaggi di controllo
+static size_t jackStrings() {
+	return sizeof(JK_MESSAGE_ID) + sizeof(JK_MESSAGE_TYPE) + sizeof(JK_MESSAGE_PAYLOAD) + sizeof(JK_MESSAGE_TYPE_DATA) +
+		sizeof(JK_MESSAGE_TYPE_LIVE) + sizeof(JK_MESSAGE_TYPE_ACK) + sizeof(JK_MESSAGE_TYPE_PING) +
+		sizeof(",\"" JK_MESSAGE_TYPE "\":\"" JK_MESSAGE_TYPE_ACK "\"}") + sizeof(",\"" JK_MESSAGE_TYPE "\":\"" JK_MESSAGE_TYPE_PING "\"}") +
+		sizeof("{\"" JK_MESSAGE_ID "\":");
+}
+
+
+//---MODELLO FIRMWARE---
+//lwSensorState: ultima lettura, ultimo stream, accensione, acceso e valore (la descrizione lwSensor è nella flash)
+static size_t avrSensorState() {
+	return 3 * MR_AVR_LONG + 1 + 2;
+}
+
+//lwSettings: versione, intervallo, timer di Jack, burst, soglia e finestra dei riassunti, risposte, contesto, sonno e somma di controllo
+static size_t avrSettings() {
+	return 1 + 3 * MR_AVR_LONG + 2 + MR_AVR_LONG + 4;
+}
+
+//lwReading: timestamp, sensori letti e valori
+static size_t avrReading() {
+	return MR_AVR_LONG + 1 + 2 * MR_SENSOR_COUNT;
+}
+
+//LwSummary: inizio, fine, letture, GSR minimo e massimo, somma del GSR, temperatura minima e massima, somma delle temperature
+static size_t avrSummary() {
+	return 2 * MR_AVR_LONG + 2 + 2 + MR_AVR_LONG + 2 * 2 + MR_AVR_LONG;
+}
+
+//LwAggregator: finestra, inizio, riassunto corrente e completo, indicatore
+static size_t avrAggregator() {
+	return 2 * MR_AVR_LONG + 2 * avrSummary() + 1;
+}
+
+//LwPhasicEvent: inizio, linea di base, ampiezza, salita e recupero
+static size_t avrPhasicEvent() {
+	return MR_AVR_LONG + 4 * 2;
+}
+
+//LwPhasicDetector: soglia, rumore, indicatori, medie, minimo, risposta in corso e risposta chiusa
+static size_t avrPhasicDetector() {
+	return 11 * MR_AVR_LONG + 2 + avrPhasicEvent() + 1;
+}
+
+//LwRadio: seriale, periodo, finestra, orologio, indicatori, tempi e contatori; comandi AT (stringhe in RAM)
+static size_t avrRadio() {
+	return MR_AVR_POINTER + 11 * MR_AVR_LONG + 4 + sizeof("AT+NOTI1") + sizeof("AT+SLEEP") + sizeof("AT");
+}
+
+//LwEnergyCosts: correnti e cariche (copia in LwEnergy: la tabella del firmware è nella flash)
+static size_t avrEnergyCosts() {
+	return (7 + LW_ENERGY_SENSORS) * 2;
+}
+
+//LwEnergy: tabella dei costi, tempi, sensori, letture del RTC e totali del modulo bluetooth
+static size_t avrEnergy() {
+	return avrEnergyCosts() + 2 * MR_AVR_LONG + 2 * LW_ENERGY_SENSORS * MR_AVR_LONG + 1 + MR_AVR_LONG + 6 * MR_AVR_LONG;
+}
+
+//chiavi dei messaggi: letture, controllo e quelle delle funzioni compilate (riassunti, risposte, sonno, consumi, traccia)
+static size_t firmwareKeys() {
+	return (3 + 5 + (MR_SUMMARY_SUPPORT ? 7 : 0) + (MR_EVENT_SUPPORT ? 6 : 0) + (MR_RADIO_SLEEP_SUPPORT ? 1 : 0) +
+		(MR_ENERGY_SUPPORT ? 7 : 0) + (JK_TRACE ? 6 : 0)) * MR_KEY_SIZE;
+}
+
+
+//---MODELLO CORE ARDUINO---
+//Stream: tabella virtuale, errore di scrittura, timeout e inizio dell'attesa
+#define MR_AVR_STREAM (MR_AVR_POINTER + MR_AVR_INT + 2 * MR_AVR_LONG)
+
+//HardwareSerial (Serial, solo con il debug): stream, registri, indici e buffer
+static size_t avrHardwareSerial() {
+	return MR_DEBUG ? MR_AVR_STREAM + 6 * MR_AVR_POINTER + 5 + 2 * MR_AVR_SERIAL_BUFFER : 0;
+}
+
+//SoftwareSerial: stream, pin, registri e ritardi; buffer di ricezione, indici e istanza attiva (statici)
+static size_t avrSoftwareSerial() {
+	return MR_AVR_STREAM + 4 + 3 * MR_AVR_POINTER + 4 * MR_AVR_INT + 1 + MR_AVR_SOFTWARE_SERIAL_BUFFER + 2 + MR_AVR_POINTER;
+}
+
+//Wire (RTC): stream, buffer di TwoWire e di twi, indici, stato, timeout e handler
+static size_t avrWire() {
+	return MR_AVR_STREAM + 5 * MR_AVR_WIRE_BUFFER + 18 + MR_AVR_LONG + 4 * MR_AVR_POINTER;
+}
+
+//millis() (contatori del timer 0) e malloc (limiti dell'heap e lista dei blocchi liberi)
+static size_t avrCore() {
+	return 2 * MR_AVR_LONG + 1 + 4 * MR_AVR_POINTER + MR_AVR_SIZE_T;
+}
+
+
+//---STAMPA---
+
+//stampa una riga del rapporto
+static void row(const char *name, size_t host, size_t avr) {
+	printf("  %-42s %8zu %8zu\n", name, host, avr);
+}
+
+//stampa una riga presente solo sull'ATmega
+static void rowAvr(const char *name, size_t avr) {
+	printf("  %-42s %8s %8zu\n", name, "-", avr);
+}
+
+
+//---MAIN---
+int main() {
+
+	printf("configurazione: JK_MAX_MESSAGE_LENGTH=%d JK_BUFFER_SEND_SIZE=%d JK_MAX_VALUES=%d JK_ARENA_BLOCKS=%d SSJ_BUFFER_SIZE=%d JK_TTL=%d\n\n",
+		JK_MAX_MESSAGE_LENGTH, JK_BUFFER_SEND_SIZE, (int) JK_MAX_VALUES, (int) JK_ARENA_BLOCKS, (int) SSJ_BUFFER_SIZE, JK_TTL);
+
+	printf("  %-42s %8s %8s\n", "", "host", "avr");
+
+
+	//RAM statica (istanze globali)
+	size_t hostJack = sizeof(BasicJack<SoftwareSerialJack>);
+	size_t hostSlots = sizeof(JMessageSlot) * JK_BUFFER_SEND_SIZE;
+	size_t hostSSJ = sizeof(SoftwareSerialJack);
+	size_t hostSSJBuffer = SSJ_BUFFER_SIZE;
+	size_t hostArena = JK_ARENA_BLOCKS * ((JK_JSON_BUFFER_SIZE + alignof(double) - 1) / alignof(double) * alignof(double)) + 2 + sizeof(unsigned long);
+#if JK_TRACE
+	size_t hostTrace = JK_TRACE_SIZE * sizeof(JTraceRecord) + 2 + 2 * JK_TRACE_PHASES * sizeof(unsigned long);
+#else
+	size_t hostTrace = 0;
+#endif
+
+	size_t avrSlots = avrMessageSlot() * JK_BUFFER_SEND_SIZE;
+	size_t avrSSJBuffer = SSJ_BUFFER_SIZE + MR_AVR_MALLOC_OVERHEAD;
+
+	printf("RAM statica\n");
+	row("BasicJack<SoftwareSerialJack>", hostJack, avrJack());
+	row("  di cui buffer di invio", hostSlots, avrSlots);
+	row("  di cui slot live (JK_LIVE_SLOT)", JK_LIVE_SLOT * sizeof(JMessageSlot), JK_LIVE_SLOT * avrMessageSlot());
+	row("SoftwareSerialJack", hostSSJ, avrSoftwareSerialJack());
+	row("SoftwareSerialJack buffer (heap)", hostSSJBuffer, avrSSJBuffer);
+	row("pool JArena (buffer JSON)", hostArena, avrArena());
+	row("traccia JTrace (JK_TRACE)", hostTrace, avrTrace());
+	row("stringhe costanti (chiavi e tipi JSON)", jackStrings(), jackStrings());
+
+	size_t hostStatic = hostJack + hostSSJ + hostSSJBuffer + hostArena + hostTrace + jackStrings();
+	size_t avrStatic = avrJack() + avrSoftwareSerialJack() + avrSSJBuffer + avrArena() + avrTrace() + jackStrings();
+
+	row("totale", hostStatic, avrStatic);
+
+
+	//stack in ricezione: loop() -> execute() -> sendAck() / onReceive()
+	size_t hostReceive = JK_MAX_MESSAGE_LENGTH + sizeof(JArenaBuffer) + sizeof(JData) + JK_MAX_ACK_LENGTH;
+	size_t avrReceive = JK_MAX_MESSAGE_LENGTH + avrArenaBuffer() + avrJData() + JK_MAX_ACK_LENGTH + 3 * MR_AVR_FRAME_OVERHEAD;
+
+	printf("\nstack in ricezione (loop -> execute -> sendAck)\n");
+	row("buffer del messaggio", JK_MAX_MESSAGE_LENGTH, JK_MAX_MESSAGE_LENGTH);
+	row("buffer JSON (descrittore)", sizeof(JArenaBuffer), avrArenaBuffer());
+	row("JData del messaggio ricevuto", sizeof(JData), avrJData());
+	row("buffer dell'ACK", JK_MAX_ACK_LENGTH, JK_MAX_ACK_LENGTH);
+	row("totale", hostReceive, avrReceive);
+
+
+	//stack in invio: JData dell'utente -> send() -> printData() (i messaggi vengono serializzati negli slot del buffer di invio)
+	size_t hostSend = sizeof(JData);
+	size_t avrSend = avrJData() + 3 * MR_AVR_FRAME_OVERHEAD;
+
+	printf("\nstack in invio (JData -> send -> printData)\n");
+	row("JData del messaggio inviato", sizeof(JData), avrJData());
+	row("totale", hostSend, avrSend);
+
+
+	//caso peggiore: invio dall'handler onReceive (i due blocchi del pool in uso)
+	size_t hostNested = hostReceive + hostSend;
+	size_t avrNested = avrReceive + avrSend;
+
+	printf("\ncaso peggiore (invio da onReceive)\n");
+	row("stack", hostNested, avrNested);
+	row("RAM (statica + stack)", hostStatic + hostNested, avrStatic + avrNested);
+
+
+	//variabili globali del firmware (solo ATmega)
+	size_t avrSensors = MR_SENSOR_COUNT * avrSensorState();
+	size_t avrBacklog = MR_BACKLOG_SIZE * avrReading() + 2;
+	size_t avrSummaries = MR_SUMMARY_SUPPORT ? 1 + avrAggregator() + MR_SUMMARY_BACKLOG_SIZE * avrSummary() + 2 : 0;
+	size_t avrEvents = MR_EVENT_SUPPORT ? avrPhasicDetector() + MR_EVENT_BACKLOG_SIZE * avrPhasicEvent() + 2 : 0;
+	size_t avrRadioTotal = MR_RADIO_SLEEP_SUPPORT ? avrRadio() : 0;
+	size_t avrEnergyTotal = MR_ENERGY_SUPPORT ? avrEnergy() : 0;
+
+	printf("\nfirmware (LeweFirmware.ino: SUMMARY_SUPPORT=%d EVENT_SUPPORT=%d RADIO_SLEEP_SUPPORT=%d ENERGY_SUPPORT=%d DEBUG=%d)\n",
+		MR_SUMMARY_SUPPORT, MR_EVENT_SUPPORT, MR_RADIO_SLEEP_SUPPORT, MR_ENERGY_SUPPORT, MR_DEBUG);
+	rowAvr("stato dei sensori", avrSensors);
+	rowAvr("impostazioni e RTC", avrSettings() + 1);
+	rowAvr("letture in attesa (BACKLOG_SIZE)", avrBacklog);
+	rowAvr("riassunti (aggregatore e attesa)", avrSummaries);
+	rowAvr("risposte fasiche (rilevatore e attesa)", avrEvents);
+	rowAvr("sonno del modulo (LwRadio)", avrRadioTotal);
+	rowAvr("stima dei consumi (LwEnergy)", avrEnergyTotal);
+	rowAvr("chiavi dei messaggi", firmwareKeys());
+
+	size_t avrFirmware = avrSensors + avrSettings() + 1 + avrBacklog + avrSummaries + avrEvents + avrRadioTotal + avrEnergyTotal + firmwareKeys();
+
+	rowAvr("totale", avrFirmware);
+
+
+	//buffer del core Arduino (solo ATmega)
+	size_t avrCoreTotal = avrHardwareSerial() + avrSoftwareSerial() + avrWire() + avrCore();
+
+	printf("\ncore Arduino\n");
+	rowAvr("Serial (con DEBUG)", avrHardwareSerial());
+	rowAvr("SoftwareSerial (modulo bluetooth)", avrSoftwareSerial());
+	rowAvr("Wire e twi (RTC)", avrWire());
+	rowAvr("millis() e malloc", avrCore());
+	rowAvr("totale", avrCoreTotal);
+
+	printf("\nATmega (Jack + firmware + core)\n");
+	rowAvr("RAM", avrStatic + avrNested + avrFirmware + avrCoreTotal);
+
+	//il caso peggiore deve stare nella RAM dell'ATmega lasciando la riserva (la build di default non può superarla)
+	size_t avrTotal = avrStatic + avrNested + avrFirmware + avrCoreTotal;
+
+	if (avrTotal + MR_AVR_STACK_RESERVE > MR_AVR_RAM) {
+		printf("\nERRORE: il caso peggiore supera di %zu byte la RAM dell'ATmega (%d byte, %d di riserva)\n",
+			avrTotal + MR_AVR_STACK_RESERVE - MR_AVR_RAM, MR_AVR_RAM, MR_AVR_STACK_RESERVE);
+		return 1;
+	}
+
+	printf("\nRAM dell'ATmega libera (stack del firmware e interrupt): %zu byte su %d\n", MR_AVR_RAM - avrTotal, MR_AVR_RAM);
+
+	return 0;
+}
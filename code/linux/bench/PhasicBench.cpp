@@ -0,0 +1,474 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file PhasicBench.cpp
+ * @brief Verifica del rilevamento delle risposte fasiche del GSR (LwPhasicDetector) e byte inviati all'ora
+ *
+ * La traccia (letture sovracampionate del GSR in decimi di punto percentuale, come sampleGSR() del firmware) viene
+ * passata al rilevatore una lettura alla volta. Senza traccia ne viene generata una sintetica di BENCH_HOURS ore a
+ * BENCH_PERIOD millisecondi: linea di base che deriva lentamente, rumore, risposte (anche sovrapposte) e
+ * increspature sotto la soglia che non devono essere rilevate.
+ *
+ * Le risposte rilevate vengono confrontate con quelle attese (inizio entro BENCH_TOLERANCE millisecondi): la
+ * verifica fallisce se richiamo o precisione sono sotto BENCH_MIN_SCORE. I byte all'ora sono quelli dei messaggi
+ * dati serializzati da Jack con i delimitatori di SoftwareSerialJack (ACK inviati dal telefono a parte), per:
+ * - serie grezza: ogni lettura sovracampionata in un messaggio (TMP, GSR)
+ * - letture periodiche: una lettura (TMP, GSR, TME) ogni BENCH_SAMPLE_INTERVAL millisecondi
+ * - risposte: un messaggio per risposta (TMP, SCL, SCR, RSE, RCV)
+ * - risposte + contesto: risposte e letture periodiche
+ *
+ * Formato dei file (una riga per lettura o risposta, le righe che iniziano con # vengono ignorate):
+ * - traccia: millisecondi,lettura
+ * - risposte attese: millisecondi di inizio[,ampiezza]
+ *
+ * Uso: phasic-bench [-e risposte_attese] [-w traccia_generata] [-h ore] [traccia]
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <vector>
+#include <Jack.h>
+#include <LwPhasicDetector.h>
+#include "BenchUtils.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Durata di default della traccia sintetica (ore)
+ */
+#define BENCH_HOURS 24
+/**
+ * @brief Intervallo tra le letture sovracampionate (millisecondi, GSR_EVENT_PERIOD del firmware)
+ */
+#define BENCH_PERIOD 250
+/**
+ * @brief Intervallo tra le letture periodiche (millisecondi, INTERVAL_BETWEEN_DATA_COLLECT del firmware)
+ */
+#define BENCH_SAMPLE_INTERVAL 300000
+/**
+ * @brief Distanza massima tra l'inizio rilevato e quello atteso (millisecondi)
+ */
+#define BENCH_TOLERANCE 2000
+/**
+ * @brief Richiamo e precisione minimi perchè la verifica sia superata
+ */
+#define BENCH_MIN_SCORE 0.9
+/**
+ * @brief Timestamp della prima lettura
+ */
+#define BENCH_EPOCH 1480000000L
+
+//CHIAVI PER IL MESSAGGIO (uguali al firmware)
+#define TIMESTAMP_KEY "TMP"
+#define GSR_KEY "GSR"
+#define TEMPERATURE_KEY "TME"
+#define EVENT_BASELINE_KEY "SCL"
+#define EVENT_AMPLITUDE_KEY "SCR"
+#define EVENT_RISE_KEY "RSE"
+#define EVENT_RECOVERY_KEY "RCV"
+
+
+//---TIPI---
+//lettura della traccia
+struct BenchSample {
+	unsigned long time; //millisecondi
+	int16_t value; //decimi di punto percentuale
+};
+
+//risposta attesa
+struct BenchResponse {
+	unsigned long onset; //millisecondi
+	int16_t amplitude; //ampiezza (0 = non indicata)
+	uint8_t matched; //già associata a una risposta rilevata
+};
+
+
+//---TRACCIA SINTETICA---
+//numero casuale uniforme in [0, 1)
+static double uniform() {
+	return rand() / (RAND_MAX + 1.0);
+}
+
+//numero casuale normale (media 0, deviazione standard 1)
+static double gaussian() {
+	return sqrt(-2.0 * log(1.0 - uniform())) * cos(2.0 * M_PI * uniform());
+}
+
+//forma di una risposta: salita a coseno rialzato e recupero esponenziale
+static double response(double t, double rise, double tau) {
+
+	if (t < 0) {
+		return 0;
+	}
+
+	if (t < rise) {
+		return (1.0 - cos(M_PI * t / rise)) / 2.0;
+	}
+
+	return exp(-(t - rise) / tau);
+}
+
+//genera la traccia e le risposte attese
+static void generateTrace(double hours, std::vector<BenchSample> &trace, std::vector<BenchResponse> &expected) {
+
+	struct BenchShape {
+		double onset, amplitude, rise, tau;
+	};
+
+	std::vector<BenchShape> shapes;
+	unsigned long duration = (unsigned long) (hours * 3600000.0);
+
+	srand(1105);
+
+	//risposte: intervalli esponenziali (media 60 s, almeno 3 s), ogni 8 un'increspatura sotto la soglia
+	double next = 10000;
+
+	while (next < duration - 60000) {
+
+		BenchShape shape;
+
+		shape.onset = next;
+		shape.rise = 1000 + uniform() * 2000;
+		shape.tau = 2000 + uniform() * 4000;
+
+		if (rand() % 8 == 0) {
+			shape.amplitude = 1 + uniform() * 2;
+		} else {
+			shape.amplitude = 10 + uniform() * 50;
+
+			BenchResponse expectedResponse = { (unsigned long) shape.onset, (int16_t) lround(shape.amplitude), 0 };
+
+			expected.push_back(expectedResponse);
+		}
+
+		shapes.push_back(shape);
+
+		next += 3000 - 60000 * log(1.0 - uniform());
+	}
+
+	//letture
+	size_t first = 0;
+	double walk = 0;
+
+	for (unsigned long time = 0; time < duration; time += BENCH_PERIOD) {
+
+		walk += gaussian() * 0.05;
+
+		double value = 400 + 30 * sin(2 * M_PI * time / 10800000.0) + walk + gaussian() * 0.8;
+
+		//le risposte finite da più di 10 costanti di tempo non contano più
+		while (first < shapes.size() && time > shapes[first].onset + shapes[first].rise + 10 * shapes[first].tau) {
+			first++;
+		}
+
+		for (size_t i = first; i < shapes.size() && shapes[i].onset <= time; i++) {
+			value += shapes[i].amplitude * response(time - shapes[i].onset, shapes[i].rise, shapes[i].tau);
+		}
+
+		BenchSample sample = { time, (int16_t) lround(value) };
+
+		trace.push_back(sample);
+	}
+}
+
+
+//---FILE---
+//legge le righe numeriche di un file CSV (al massimo due colonne)
+static bool readColumns(const char *path, std::vector<std::pair<double, double> > &rows) {
+
+	FILE *file = fopen(path, "r");
+
+	if (file == NULL) {
+		return false;
+	}
+
+	char line[256];
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+
+		double first, second = 0;
+
+		if (line[0] == '#' || sscanf(line, "%lf,%lf", &first, &second) < 1) {
+			continue;
+		}
+
+		rows.push_back(std::make_pair(first, second));
+	}
+
+	fclose(file);
+
+	return true;
+}
+
+//scrive la traccia
+static bool writeTrace(const char *path, const std::vector<BenchSample> &trace, const std::vector<BenchResponse> &expected) {
+
+	FILE *file = fopen(path, "w");
+
+	if (file == NULL) {
+		return false;
+	}
+
+	fprintf(file, "# millisecondi,lettura (%zu risposte attese)\n", expected.size());
+
+	for (size_t i = 0; i < trace.size(); i++) {
+		fprintf(file, "%lu,%d\n", trace[i].time, trace[i].value);
+	}
+
+	return fclose(file) == 0;
+}
+
+
+//---BYTE INVIATI---
+//byte di un messaggio dati sul mezzo di trasmissione (delimitatori compresi) e del suo ACK
+static void countMessage(JData &message, long id, uint64_t &bytes, uint64_t &ackBytes) {
+
+	char buffer[JK_MAX_MESSAGE_LENGTH];
+
+	bytes += Jack::printData(message, id, buffer, JK_MAX_MESSAGE_LENGTH) + 2;
+	ackBytes += Jack::printAck(id, buffer, JK_MAX_ACK_LENGTH) + 2;
+}
+
+//messaggio di una lettura sovracampionata
+static void countRaw(const BenchSample &sample, uint64_t &bytes, uint64_t &ackBytes) {
+
+	JData message;
+	long timestamp = BENCH_EPOCH + sample.time / 1000;
+
+	message.add(TIMESTAMP_KEY, timestamp);
+	message.add(GSR_KEY, sample.value / 10.0);
+
+	countMessage(message, timestamp, bytes, ackBytes);
+}
+
+//messaggio di una lettura periodica
+static void countReading(const BenchSample &sample, uint64_t &bytes, uint64_t &ackBytes) {
+
+	JData message;
+	long timestamp = BENCH_EPOCH + sample.time / 1000;
+
+	message.add(TIMESTAMP_KEY, timestamp);
+	message.add(GSR_KEY, (long) (sample.value / 10));
+	message.add(TEMPERATURE_KEY, 32.5);
+
+	countMessage(message, timestamp, bytes, ackBytes);
+}
+
+//messaggio di una risposta
+static void countEvent(const LwPhasicEvent &event, uint64_t &bytes, uint64_t &ackBytes) {
+
+	JData message;
+	long timestamp = BENCH_EPOCH + event.onset / 1000;
+
+	message.add(TIMESTAMP_KEY, timestamp);
+	message.add(EVENT_BASELINE_KEY, event.baseline / 10.0);
+	message.add(EVENT_AMPLITUDE_KEY, event.amplitude / 10.0);
+	message.add(EVENT_RISE_KEY, (long) event.riseTime);
+	message.add(EVENT_RECOVERY_KEY, (long) event.recoveryTime);
+
+	countMessage(message, timestamp, bytes, ackBytes);
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	const char *expectedPath = NULL;
+	const char *outputPath = NULL;
+	double hours = BENCH_HOURS;
+	int opt;
+
+	//leggo le opzioni
+	while ((opt = getopt(argc, argv, "e:w:h:")) != -1) {
+
+		if (opt == 'e') {
+			expectedPath = optarg;
+		} else if (opt == 'w') {
+			outputPath = optarg;
+		} else if (opt == 'h') {
+			hours = atof(optarg) > 0 ? atof(optarg) : BENCH_HOURS;
+		} else {
+			fprintf(stderr, "uso: %s [-e risposte_attese] [-w traccia_generata] [-h ore] [traccia]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<BenchSample> trace;
+	std::vector<BenchResponse> expected;
+	uint8_t verify = 1;
+
+	if (optind < argc) {
+
+		//traccia registrata
+		std::vector<std::pair<double, double> > rows;
+
+		if (!readColumns(argv[optind], rows) || rows.size() < 2) {
+			fprintf(stderr, "%s: traccia non valida\n", argv[optind]);
+			return 1;
+		}
+
+		for (size_t i = 0; i < rows.size(); i++) {
+			BenchSample sample = { (unsigned long) rows[i].first, (int16_t) lround(rows[i].second) };
+			trace.push_back(sample);
+		}
+
+		//senza risposte attese la traccia viene solo riprodotta
+		verify = expectedPath != NULL;
+
+	} else {
+		generateTrace(hours, trace, expected);
+	}
+
+	if (expectedPath != NULL) {
+
+		std::vector<std::pair<double, double> > rows;
+
+		if (!readColumns(expectedPath, rows)) {
+			perror(expectedPath);
+			return 1;
+		}
+
+		expected.clear();
+
+		for (size_t i = 0; i < rows.size(); i++) {
+			BenchResponse expectedResponse = { (unsigned long) rows[i].first, (int16_t) lround(rows[i].second), 0 };
+			expected.push_back(expectedResponse);
+		}
+	}
+
+	if (outputPath != NULL && !writeTrace(outputPath, trace, expected)) {
+		perror(outputPath);
+		return 1;
+	}
+
+	//rilevamento
+	LwPhasicDetector detector;
+	std::vector<LwPhasicEvent> events;
+
+	uint64_t start = benchNanos();
+
+	for (size_t i = 0; i < trace.size(); i++) {
+		if (detector.add(trace[i].time, trace[i].value)) {
+			events.push_back(detector.get());
+		}
+	}
+
+	double nanosPerSample = (double) (benchNanos() - start) / trace.size();
+
+	//confronto con le risposte attese (la più vicina non ancora associata)
+	unsigned long hits = 0;
+	double onsetError = 0;
+	double amplitudeError = 0;
+	unsigned long amplitudes = 0;
+
+	for (size_t i = 0; i < events.size(); i++) {
+
+		BenchResponse *match = NULL;
+		unsigned long best = BENCH_TOLERANCE + 1;
+
+		for (size_t j = 0; j < expected.size(); j++) {
+
+			unsigned long distance = events[i].onset > expected[j].onset ? events[i].onset - expected[j].onset : expected[j].onset - events[i].onset;
+
+			if (!expected[j].matched && distance < best) {
+				best = distance;
+				match = &expected[j];
+			}
+		}
+
+		if (match == NULL) {
+			continue;
+		}
+
+		match->matched = 1;
+		hits++;
+		onsetError += best;
+
+		if (match->amplitude) {
+			amplitudeError += fabs(events[i].amplitude - match->amplitude) / match->amplitude;
+			amplitudes++;
+		}
+	}
+
+	//byte all'ora
+	double traceHours = (trace.back().time - trace.front().time + BENCH_PERIOD) / 3600000.0;
+	uint64_t rawBytes = 0, rawAcks = 0;
+	uint64_t readingBytes = 0, readingAcks = 0;
+	uint64_t eventBytes = 0, eventAcks = 0;
+	unsigned long readings = 0;
+	unsigned long lastReading = trace.front().time;
+
+	for (size_t i = 0; i < trace.size(); i++) {
+
+		countRaw(trace[i], rawBytes, rawAcks);
+
+		if (trace[i].time - lastReading >= BENCH_SAMPLE_INTERVAL) {
+			countReading(trace[i], readingBytes, readingAcks);
+			lastReading = trace[i].time;
+			readings++;
+		}
+	}
+
+	for (size_t i = 0; i < events.size(); i++) {
+		countEvent(events[i], eventBytes, eventAcks);
+	}
+
+	printf("traccia: %s, %zu letture in %.1f ore, %.1f ns/lettura, rilevatore: %zu B (host)\n\n", optind < argc ? argv[optind] : "sintetica",
+		trace.size(), traceHours, nanosPerSample, sizeof(LwPhasicDetector));
+
+	printf("risposte rilevate: %zu (%.1f/ora)\n", events.size(), events.size() / traceHours);
+
+	if (verify) {
+
+		double recall = expected.empty() ? 1.0 : (double) hits / expected.size();
+		double precision = events.empty() ? 1.0 : (double) hits / events.size();
+
+		printf("risposte attese: %zu, associate: %lu, mancate: %lu, in più: %lu\n", expected.size(), hits,
+			(unsigned long) (expected.size() - hits), (unsigned long) (events.size() - hits));
+		printf("richiamo: %.3f, precisione: %.3f, errore medio sull'inizio: %.0f ms, sull'ampiezza: %.1f%%\n\n", recall, precision,
+			hits ? onsetError / hits : 0.0, amplitudes ? 100.0 * amplitudeError / amplitudes : 0.0);
+
+		verify = recall >= BENCH_MIN_SCORE && precision >= BENCH_MIN_SCORE ? 1 : 2;
+	} else {
+		printf("\n");
+	}
+
+	printf("%-34s %12s %12s %12s %10s\n", "", "messaggi/h", "B/h", "B/h con ACK", "rispetto");
+	printf("%-34s %12.0f %12.0f %12.0f %9.1f%%\n", "serie grezza", trace.size() / traceHours, rawBytes / traceHours, (rawBytes + rawAcks) / traceHours, 100.0);
+	printf("%-34s %12.0f %12.0f %12.0f %9.1f%%\n", "letture periodiche", readings / traceHours, readingBytes / traceHours, (readingBytes + readingAcks) / traceHours, 100.0 * readingBytes / rawBytes);
+	printf("%-34s %12.0f %12.0f %12.0f %9.1f%%\n", "risposte", events.size() / traceHours, eventBytes / traceHours, (eventBytes + eventAcks) / traceHours, 100.0 * eventBytes / rawBytes);
+	printf("%-34s %12.0f %12.0f %12.0f %9.1f%%\n", "risposte + contesto", (events.size() + readings) / traceHours, (eventBytes + readingBytes) / traceHours,
+		(eventBytes + eventAcks + readingBytes + readingAcks) / traceHours, 100.0 * (eventBytes + readingBytes) / rawBytes);
+
+	if (verify == 2) {
+		printf("\nverifica NON superata (richiamo e precisione minimi: %.2f)\n", BENCH_MIN_SCORE);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,316 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file RadioBench.cpp
+ * @brief Sonno del modulo bluetooth tra le finestre di sincronizzazione (LwRadio): tempo da sveglio e latenze
+ *
+ * Il bracciale (BasicJack con SoftwareSerialJack e LwRadio) e il telefono (BasicJack con SoftwareSerialJack) sono
+ * collegati attraverso un HM-10 simulato (MockHM10) con l'orologio virtuale. Ogni scenario simula 24 ore con una
+ * lettura ogni 5 minuti (a metà tra due finestre, il caso peggiore per la latenza) e i timer del firmware.
+ * Scenari:
+ * - sempre acceso: sonno disabilitato, telefono sempre collegato (il comportamento senza LwRadio)
+ * - finestre: il telefono si collega all'inizio di ogni finestra (prevista dall'orologio) dopo la latenza di
+ *   collegamento e resta collegato finchè il bracciale chiude la finestra
+ * - finestre + telefono: come finestre, in più il telefono invia un messaggio in istanti casuali (in media ogni
+ *   RADIO_PHONE_INTERVAL) collegandosi subito: il modulo si sveglia per il traffico e conferma
+ * - telefono assente: come finestre, ma il telefono non si collega per 8 ore dopo le prime 2
+ * Riporta tempo da sveglio del modulo, risvegli (per il traffico), letture consegnate, latenza di consegna e
+ * latenza di conferma dei messaggi del telefono. Il bracciale non ha una coda di letture: quelle che non entrano nel
+ * buffer di invio vengono perse (telefono assente). Il tempo da sveglio contato da LwRadio (onTime()) deve
+ * coincidere con quello misurato dal modulo simulato.
+ *
+ * Uso: radio-bench [seme]
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <Jack.h>
+#include <SoftwareSerialJack.h>
+#include <LwRadio.h>
+#include "../sim/MockHM10.h"
+#include "../sim/VirtualClock.h"
+#include "BenchUtils.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Durata simulata (microsecondi)
+ */
+#define RADIO_DURATION (24ULL * 3600 * 1000000)
+/**
+ * @brief Passo della simulazione (microsecondi)
+ */
+#define RADIO_STEP 10000
+/**
+ * @brief Intervallo tra le letture (millisecondi, anche periodo delle finestre)
+ */
+#define RADIO_SAMPLE_INTERVAL 300000
+/**
+ * @brief Durata minima delle finestre (millisecondi)
+ */
+#define RADIO_WINDOW 3000
+/**
+ * @brief Timer di reinvio del firmware (millisecondi)
+ */
+#define RADIO_TIMER_SEND_MESSAGE 5000
+/**
+ * @brief Latenza di collegamento del telefono (millisecondi)
+ */
+#define RADIO_CONNECT_LATENCY 400
+/**
+ * @brief Intervallo medio tra i messaggi del telefono nello scenario finestre + telefono (millisecondi)
+ */
+#define RADIO_PHONE_INTERVAL 2700000
+/**
+ * @brief Timestamp del RTC all'avvio (secondi, non allineato al periodo)
+ */
+#define RADIO_START_TIMESTAMP 1480000123L
+
+
+//---SCENARI---
+struct RadioConfig {
+	const char *name; //nome
+	uint8_t sleep; //sonno abilitato
+	uint8_t phoneMessages; //il telefono invia messaggi in istanti casuali
+	uint64_t outageStart; //inizio dell'assenza del telefono (microsecondi, 0 nessuna assenza)
+	uint64_t outageLength; //durata dell'assenza del telefono (microsecondi)
+};
+
+struct RadioResult {
+	uint64_t awake; //microsecondi da sveglio (MockHM10)
+	unsigned long radioOnTime; //millisecondi da sveglio (LwRadio)
+	unsigned long wakeups; //finestre aperte
+	unsigned long trafficWakeups; //finestre aperte dal traffico
+	unsigned long connections; //collegamenti del telefono
+	unsigned long readings; //letture prodotte
+	unsigned long delivered; //letture consegnate al telefono
+	std::vector<double> latencies; //latenze di consegna (millisecondi)
+	unsigned long phoneSent; //messaggi del telefono
+	unsigned long phoneAcked; //messaggi del telefono confermati
+	std::vector<double> ackLatencies; //latenze di conferma dei messaggi del telefono (millisecondi)
+};
+
+
+//---HANDLER---
+static LwRadio *radio = NULL;
+static RadioResult *current = NULL;
+static long bandMessageID = 0;
+static long phoneMessageID = 0;
+static uint64_t phoneSentAt = 0;
+
+//bracciale: messaggio del telefono, conferma di una lettura (traffico)
+static void bandOnReceive(JData &, long) { radio->traffic(); }
+static void bandOnReceiveAck(long) { radio->traffic(); }
+static long bandGetMessageID() { return ++bandMessageID; }
+
+//telefono: lettura (TMP in millisecondi virtuali), conferma del proprio messaggio
+static void phoneOnReceive(JData &message, long) {
+
+	current->delivered++;
+	current->latencies.push_back(VirtualClock::now() / 1000.0 - message.get("TMP").as<long>());
+}
+
+static void phoneOnReceiveAck(long) {
+
+	current->phoneAcked++;
+	current->ackLatencies.push_back((VirtualClock::now() - phoneSentAt) / 1000.0);
+}
+
+static long phoneGetMessageID() { return ++phoneMessageID; }
+
+
+//---SIMULAZIONE---
+//istante (microsecondi virtuali) in cui inizia la prima finestra dopo l'istante indicato secondo il RTC
+static uint64_t nextWindow(uint64_t now) {
+
+	uint64_t period = RADIO_SAMPLE_INTERVAL * 1000ULL;
+	uint64_t clock = RADIO_START_TIMESTAMP * 1000000ULL + now;
+
+	return now + (period - clock % period);
+}
+
+//esegue lo scenario
+static void run(const RadioConfig &config, RadioResult &result) {
+
+	VirtualClock::install();
+
+	current = &result;
+	bandMessageID = 0;
+	phoneMessageID = 0;
+
+	//i mezzi di trasmissione eliminano gli stream nel distruttore
+	MockHM10 *module = new MockHM10();
+	MockHM10Phone *phoneStream = new MockHM10Phone(*module);
+
+	SoftwareSerialJack bandTM(*module);
+	SoftwareSerialJack phoneTM(*phoneStream);
+
+	BasicJack<SoftwareSerialJack> band(bandTM, &bandOnReceive, &bandOnReceiveAck, &bandGetMessageID, RADIO_TIMER_SEND_MESSAGE, 0);
+	BasicJack<SoftwareSerialJack> phone(phoneTM, &phoneOnReceive, &phoneOnReceiveAck, &phoneGetMessageID, RADIO_TIMER_SEND_MESSAGE, 0);
+
+	LwRadio bandRadio(*module, RADIO_SAMPLE_INTERVAL, RADIO_WINDOW);
+
+	radio = &bandRadio;
+
+	//le finestre sostituiscono la rilevazione del collegamento (come nel firmware)
+	band.setLinkDetectionEnabled(!config.sleep);
+	phone.setLinkDetectionEnabled(0);
+
+	bandRadio.setEnabled(config.sleep);
+	bandRadio.begin();
+	bandRadio.align(RADIO_START_TIMESTAMP);
+
+	band.start();
+	phone.start();
+
+	//prima lettura a metà tra due finestre
+	uint64_t nextReading = nextWindow(0) + RADIO_SAMPLE_INTERVAL * 500ULL;
+	uint64_t nextConnect = config.sleep ? nextWindow(0) + RADIO_CONNECT_LATENCY * 1000ULL : 0;
+	uint64_t nextMessage = config.phoneMessages ? (uint64_t) (rand() % (2 * RADIO_PHONE_INTERVAL)) * 1000ULL : RADIO_DURATION;
+	uint8_t awaitingAck = 0;
+
+	while (VirtualClock::now() < RADIO_DURATION) {
+
+		uint64_t now = VirtualClock::now();
+		uint8_t absent = config.outageLength && now >= config.outageStart && now < config.outageStart + config.outageLength;
+
+		//lettura (TMP: millisecondi virtuali, per la latenza di consegna)
+		if (now >= nextReading) {
+
+			JData message;
+
+			message.add("TMP", (long) (now / 1000));
+			message.add("GSR", (uint8_t) (result.readings % 100));
+
+			band.send(message);
+
+			result.readings++;
+			nextReading += RADIO_SAMPLE_INTERVAL * 1000ULL;
+		}
+
+		//il telefono si collega alla finestra prevista (o subito con il sonno disabilitato)
+		if (now >= nextConnect) {
+
+			if (!absent) {
+				module->connect();
+			}
+
+			nextConnect = config.sleep ? nextWindow(now) + RADIO_CONNECT_LATENCY * 1000ULL : now;
+		}
+
+		//messaggio del telefono: si collega (se serve) e lo invia
+		if (now >= nextMessage) {
+
+			JData message;
+
+			message.add("CFG", 1);
+
+			module->connect();
+
+			if (phone.send(message)) {
+				result.phoneSent++;
+				phoneSentAt = now;
+				awaitingAck = 1;
+			}
+
+			nextMessage = now + (uint64_t) (1 + rand() % (2 * RADIO_PHONE_INTERVAL)) * 1000ULL;
+		}
+
+		//il loop di Jack solo con il modulo sveglio
+		if (bandRadio.loop(band.pending())) {
+			band.loop();
+		}
+
+		module->update();
+
+		//il telefono scollegato non trasmette
+		if (module->connected() || awaitingAck) {
+			phone.loop();
+		}
+
+		awaitingAck = awaitingAck && phone.pending();
+
+		module->update();
+
+		VirtualClock::advance(RADIO_STEP);
+	}
+
+	result.awake = module->awakeTime();
+	result.radioOnTime = bandRadio.onTime();
+	result.wakeups = bandRadio.wakeups();
+	result.trafficWakeups = bandRadio.trafficWakeups();
+	result.connections = module->connections();
+
+	radio = NULL;
+	current = NULL;
+
+	VirtualClock::uninstall();
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	srand(argc > 1 ? atoi(argv[1]) : 1105);
+
+	const RadioConfig configs[] = {
+		{ "sempre acceso", 0, 0, 0, 0 },
+		{ "finestre", 1, 0, 0, 0 },
+		{ "finestre + telefono", 1, 1, 0, 0 },
+		{ "telefono assente 8 h", 1, 0, 2ULL * 3600 * 1000000, 8ULL * 3600 * 1000000 }
+	};
+
+	printf("periodo %d s, finestra minima %d ms, collegamento del telefono %d ms, 24 ore\n\n", RADIO_SAMPLE_INTERVAL / 1000, RADIO_WINDOW, RADIO_CONNECT_LATENCY);
+	printf("%-22s %9s %9s %9s %9s %11s %9s %9s %11s %9s %9s\n", "scenario", "acceso %", "acceso s", "risvegli", "traffico", "consegnate", "p50 s", "max s", "telefono", "ack p50", "ack max");
+
+	uint8_t consistent = 1;
+
+	for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+
+		RadioResult result = RadioResult();
+
+		run(configs[i], result);
+
+		//il tempo contato da LwRadio deve coincidere con quello del modulo
+		consistent &= result.radioOnTime == result.awake / 1000;
+
+		char phone[24];
+
+		snprintf(phone, sizeof(phone), "%lu/%lu", result.phoneAcked, result.phoneSent);
+
+		printf("%-22s %9.2f %9.0f %9lu %9lu %5lu/%-5lu %9.1f %9.1f %11s %9.0f %9.0f\n", configs[i].name,
+			100.0 * result.awake / RADIO_DURATION, result.awake / 1e6, result.wakeups, result.trafficWakeups,
+			result.delivered, result.readings,
+			result.latencies.empty() ? 0.0 : benchPercentile(result.latencies, 50) / 1000.0,
+			result.latencies.empty() ? 0.0 : benchPercentile(result.latencies, 100) / 1000.0,
+			phone, result.ackLatencies.empty() ? 0.0 : benchPercentile(result.ackLatencies, 50),
+			result.ackLatencies.empty() ? 0.0 : benchPercentile(result.ackLatencies, 100));
+	}
+
+	printf("\ntempo da sveglio di LwRadio uguale a quello del modulo: %s\n", consistent ? "sì" : "NO");
+
+	return consistent ? 0 : 1;
+}
@@ -0,0 +1,345 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file ReplayBench.cpp
+ * @brief Riproduzione di una cattura (WireCapture) attraverso il framing di SoftwareSerialJack e il loop di Jack
+ *
+ * I caratteri ricevuti della cattura vengono passati, blocco per blocco come sono stati letti, a SoftwareSerialJack
+ * tramite uno Stream in memoria; il loop di BasicJack preleva i messaggi, li elabora e invia gli ACK (scartati).
+ * I caratteri inviati della cattura vengono solo contati.
+ *
+ * Il mezzo di trasmissione viene avvolto in ReplayJack, che cronometra available() e receive() (framing) e send()
+ * (invio degli ACK): il tempo di parsing ed elaborazione dei messaggi è quello del loop meno framing e invio.
+ * Ogni cronometraggio costa una lettura del clock monotono (qualche decina di nanosecondi).
+ *
+ * Uso: replay-bench [-t] [-n ripetizioni] cattura
+ *  -t  rispetta i tempi registrati (altrimenti alla massima velocità)
+ *  -n  ripetizioni alla massima velocità (viene riportata la mediana)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <Jack.h>
+#include <SoftwareSerialJack.h>
+#include "../gateway/WireCapture.h"
+#include "BenchUtils.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Ripetizioni di default alla massima velocità
+ */
+#define BENCH_ROUNDS 5
+
+
+//---STREAM DELLA CATTURA---
+//restituisce i caratteri del blocco caricato e conta quelli scritti
+class ReplayStream : public Stream {
+
+	public:
+
+		ReplayStream() {
+			_data = NULL;
+			_length = 0;
+			_position = 0;
+			_written = 0;
+		}
+
+		//carica il blocco da leggere (resta nella mappatura della cattura)
+		void load(const char *data, size_t length) {
+			_data = data;
+			_length = length;
+			_position = 0;
+		}
+
+		int available() { return _length - _position; }
+		int read() { return _position < _length ? (uint8_t) _data[_position++] : -1; }
+		int peek() { return _position < _length ? (uint8_t) _data[_position] : -1; }
+		size_t write(uint8_t) { _written++; return 1; }
+
+		unsigned long long written() { return _written; }
+
+
+	private:
+
+		const char *_data; //blocco da leggere
+		size_t _length; //lunghezza del blocco
+		size_t _position; //posizione di lettura
+		unsigned long long _written; //caratteri scritti da Jack
+
+};
+
+
+//---MEZZO DI TRASMISSIONE CRONOMETRATO---
+//SoftwareSerialJack con il tempo speso in ogni fase
+class ReplayJack {
+
+	public:
+
+		ReplayJack(Stream &stream) : _ssj(stream) {
+			framingNanos = 0;
+			sendNanos = 0;
+			frames = 0;
+			dropped = 0;
+		}
+
+		size_t available() {
+
+			uint64_t start = benchNanos();
+			size_t length = _ssj.available();
+
+			framingNanos += benchNanos() - start;
+
+			return length;
+		}
+
+		size_t receive(char *buffer, size_t size) {
+
+			uint64_t start = benchNanos();
+			size_t length = _ssj.receive(buffer, size);
+
+			framingNanos += benchNanos() - start;
+
+			//messaggio prelevato o scartato dal framing (troncato o troppo lungo)
+			if (length) {
+				frames++;
+			} else {
+				dropped++;
+			}
+
+			return length;
+		}
+
+		void send(char *message, size_t length) {
+
+			uint64_t start = benchNanos();
+
+			_ssj.send(message, length);
+
+			sendNanos += benchNanos() - start;
+		}
+
+		static const size_t MTU = SoftwareSerialJack::MTU;
+
+		uint64_t framingNanos; //available() e receive()
+		uint64_t sendNanos; //send()
+		unsigned long frames; //messaggi prelevati
+		unsigned long dropped; //messaggi scartati dal framing
+
+
+	private:
+
+		SoftwareSerialJack _ssj;
+
+};
+
+
+//---HANDLER---
+static unsigned long received = 0;
+
+static void onReceive(JData &, long) { received++; }
+static void onReceiveAck(long) {}
+static long getMessageID() { return 0; }
+
+
+//---RIPRODUZIONE---
+struct ReplayResult {
+	unsigned long records; //blocchi ricevuti riprodotti
+	unsigned long long bytes; //caratteri ricevuti riprodotti
+	unsigned long long sentBytes; //caratteri inviati nella cattura (non riprodotti)
+	unsigned long frames; //messaggi prelevati dal framing
+	unsigned long dropped; //messaggi scartati dal framing
+	unsigned long rejected; //messaggi scartati da Jack
+	unsigned long delivered; //messaggi dati passati a onReceive
+	unsigned long long acks; //caratteri inviati da Jack (ACK)
+	uint64_t captureNanos; //lettura della cattura
+	uint64_t framingNanos; //framing
+	uint64_t parseNanos; //parsing ed elaborazione dei messaggi
+	uint64_t sendNanos; //invio degli ACK
+	uint64_t totalNanos; //tempo di elaborazione (attese escluse)
+	uint64_t maxLagNanos; //ritardo massimo rispetto ai tempi registrati (solo con -t)
+};
+
+//riproduce la cattura (timed: rispettando i tempi registrati)
+static void replay(WireCaptureReader &reader, uint8_t timed, ReplayResult &result) {
+
+	//il mezzo di trasmissione elimina lo stream nel distruttore
+	ReplayStream *stream = new ReplayStream();
+	ReplayJack mmJTM(*stream);
+	BasicJack<ReplayJack> jack(mmJTM, &onReceive, &onReceiveAck, &getMessageID, JK_TIMER_RESEND_MESSAGE, 0);
+
+	jack.start();
+
+	memset(&result, 0, sizeof(result));
+	received = 0;
+	reader.rewind();
+
+	WCRecord record;
+	uint64_t loopNanos = 0;
+	uint64_t replayStart = benchNanos();
+
+	while (true) {
+
+		uint64_t start = benchNanos();
+		uint8_t more = reader.next(record);
+
+		result.captureNanos += benchNanos() - start;
+
+		if (!more) {
+			break;
+		}
+
+		if (record.direction == WC_SENT) {
+			result.sentBytes += record.length;
+			continue;
+		}
+
+		//attendo l'istante in cui il blocco è stato ricevuto
+		if (timed) {
+
+			uint64_t due = replayStart + record.time * 1000ULL;
+			uint64_t now = benchNanos();
+
+			if (due > now) {
+				usleep((due - now) / 1000);
+			} else if (now - due > result.maxLagNanos) {
+				result.maxLagNanos = now - due;
+			}
+		}
+
+		stream->load(record.data, record.length);
+
+		result.records++;
+		result.bytes += record.length;
+
+		//elaboro il blocco finchè restano caratteri o messaggi completi
+		start = benchNanos();
+
+		while (stream->available() || mmJTM.available()) {
+			jack.loop();
+		}
+
+		loopNanos += benchNanos() - start;
+	}
+
+	result.frames = mmJTM.frames;
+	result.dropped = mmJTM.dropped;
+	result.rejected = jack.framesRejected();
+	result.delivered = received;
+	result.acks = stream->written();
+	result.framingNanos = mmJTM.framingNanos;
+	result.sendNanos = mmJTM.sendNanos;
+	result.parseNanos = loopNanos - mmJTM.framingNanos - mmJTM.sendNanos;
+	result.totalNanos = loopNanos + result.captureNanos;
+}
+
+//stampa una fase con il tempo per messaggio
+static void reportStage(const char *name, uint64_t nanos, const ReplayResult &result) {
+	printf("  %-30s %10.1f ms %10.1f ns/msg %6.1f%%\n", name, nanos / 1e6,
+		result.frames ? (double) nanos / result.frames : 0.0, result.totalNanos ? 100.0 * nanos / result.totalNanos : 0.0);
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	uint8_t timed = 0;
+	int rounds = BENCH_ROUNDS;
+	int opt;
+
+	//leggo le opzioni
+	while ((opt = getopt(argc, argv, "tn:")) != -1) {
+
+		if (opt == 't') {
+			timed = 1;
+		} else if (opt == 'n') {
+			rounds = atoi(optarg) > 0 ? atoi(optarg) : 1;
+		} else {
+			fprintf(stderr, "uso: %s [-t] [-n ripetizioni] cattura\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind >= argc) {
+		fprintf(stderr, "uso: %s [-t] [-n ripetizioni] cattura\n", argv[0]);
+		return 1;
+	}
+
+	WireCaptureReader reader(argv[optind]);
+
+	if (!reader.open()) {
+		fprintf(stderr, "%s: cattura non valida\n", argv[optind]);
+		return 1;
+	}
+
+	//con i tempi registrati la cattura viene riprodotta una sola volta
+	if (timed) {
+		rounds = 1;
+	}
+
+	std::vector<ReplayResult> results(rounds);
+	std::vector<double> totals;
+
+	for (int r = 0; r < rounds; r++) {
+		replay(reader, timed, results[r]);
+		totals.push_back((double) results[r].totalNanos);
+	}
+
+	//ripetizione mediana
+	double median = benchPercentile(totals, 50);
+	ReplayResult result = results[0];
+
+	for (int r = 0; r < rounds; r++) {
+		if ((double) results[r].totalNanos == median) {
+			result = results[r];
+		}
+	}
+
+	printf("cattura: %s, %zu B, %lu blocchi ricevuti (%llu B), %llu B inviati%s\n", argv[optind], reader.size(),
+		result.records, result.bytes, result.sentBytes, reader.truncated() ? ", ultimo record incompleto" : "");
+	printf("modalità: %s, ripetizioni: %d, SSJ_BUFFER_SIZE=%d, JK_MAX_MESSAGE_LENGTH=%d\n\n",
+		timed ? "tempi registrati" : "massima velocità", rounds, SSJ_BUFFER_SIZE, JK_MAX_MESSAGE_LENGTH);
+
+	printf("messaggi: %lu prelevati, %lu dati consegnati, %llu B di ACK inviati\n", result.frames, result.delivered, result.acks);
+	printf("scartati: %lu dal framing, %lu da Jack (JSON non valido o tipo sconosciuto)\n\n", result.dropped, result.rejected);
+
+	printf("throughput: %.0f messaggi/s, %.1f MB/s\n", result.frames / (result.totalNanos / 1e9), result.bytes / (result.totalNanos / 1e3));
+
+	if (timed) {
+		printf("ritardo massimo rispetto ai tempi registrati: %.3f ms\n", result.maxLagNanos / 1e6);
+	}
+
+	printf("\nfasi:\n");
+
+	reportStage("lettura della cattura", result.captureNanos, result);
+	reportStage("framing (SoftwareSerialJack)", result.framingNanos, result);
+	reportStage("parsing ed elaborazione", result.parseNanos, result);
+	reportStage("invio degli ACK", result.sendNanos, result);
+	reportStage("totale", result.totalNanos, result);
+
+	return 0;
+}
@@ -0,0 +1,224 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file SerializerBench.cpp
+ * @brief Benchmark della serializzazione dei messaggi Jack: cicli per messaggio dati e ACK
+ *
+ * Confronta la serializzazione precedente (measureLength() + malloc() + printTo() per i messaggi dati,
+ * StaticJsonBuffer + measureLength() + printTo() per gli ACK) con quella in un solo passaggio di Jack.
+ *
+ * Uso: serializer-bench [messaggi]
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <Jack.h>
+#include "BenchUtils.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Messaggi per ogni misura
+ */
+#define BENCH_BATCH 1000
+/**
+ * @brief Numero di default di messaggi
+ */
+#define BENCH_MESSAGES 1000000UL
+
+
+//---VARIABILI---
+static long nextID = 1480000000L;
+
+
+//---MEZZO DI TRASMISSIONE---
+//scarta i messaggi inviati
+class NullJack : public JTransmissionMethod {
+
+	public:
+
+		size_t receive(char *, size_t) { return 0; }
+		void send(char *message, size_t) { benchKeep(message[0]); }
+		size_t available() { return 0; }
+};
+
+
+//---MESSAGGIO---
+//espone la root del messaggio per la serializzazione precedente
+class BenchData : public JData {
+
+	public:
+
+		JsonObject *root() { return getRoot(); }
+};
+
+
+//---HANDLER---
+static void onReceive(JData &, long) {}
+static void onReceiveAck(long) {}
+static long getMessageID() { return nextID++; }
+
+
+//---SERIALIZZAZIONI---
+
+//messaggio dati: serializzazione precedente
+static size_t legacyData(BenchData &message, long id) {
+
+	JsonObject *root = message.root();
+
+	(*root)[JK_MESSAGE_ID] = id;
+	(*root)[JK_MESSAGE_TYPE] = JK_MESSAGE_TYPE_DATA;
+
+	size_t length = (*root).measureLength() +1;
+
+	char *buffer = (char *) malloc(length * sizeof(char));
+
+	(*root).printTo(buffer, length);
+
+	benchKeep(buffer[0]);
+	free(buffer);
+
+	return length - 1;
+}
+
+//messaggio dati: serializzazione in un solo passaggio
+static size_t singlePassData(JData &message, long id) {
+
+	char buffer[JK_MAX_MESSAGE_LENGTH];
+
+	size_t length = Jack::printData(message, id, buffer, JK_MAX_MESSAGE_LENGTH);
+
+	benchKeep(buffer[0]);
+
+	return length;
+}
+
+//messaggio ACK: serializzazione precedente
+static size_t legacyAck(long id) {
+
+	StaticJsonBuffer<100> jsonBuffer;
+
+	JsonObject& root = jsonBuffer.createObject();
+
+	root[JK_MESSAGE_ID] = id;
+	root[JK_MESSAGE_TYPE] = JK_MESSAGE_TYPE_ACK;
+
+	size_t length = root.measureLength() +1;
+
+	char buffer[length];
+
+	root.printTo(buffer, length);
+
+	benchKeep(buffer[0]);
+
+	return length - 1;
+}
+
+//messaggio ACK: serializzazione in un solo passaggio
+static size_t singlePassAck(long id) {
+
+	char buffer[JK_MAX_ACK_LENGTH];
+
+	size_t length = Jack::printAck(id, buffer, JK_MAX_ACK_LENGTH);
+
+	benchKeep(buffer[0]);
+
+	return length;
+}
+
+
+//---MISURA---
+
+//stampa mediana e percentile 99 dei cicli per messaggio
+static void report(const char *name, std::vector<double> &samples, size_t length) {
+	printf("%-28s %8zu %12.1f %12.1f\n", name, length, benchPercentile(samples, 50), benchPercentile(samples, 99));
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	unsigned long messages = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_MESSAGES;
+	unsigned long rounds = messages / BENCH_BATCH ? messages / BENCH_BATCH : 1;
+
+	//lettura del bracciale
+	BenchData message;
+
+	message.add("TMP", 1480000000L);
+	message.add("GSR", (uint8_t) 42);
+	message.add("TME", 36.5);
+
+	NullJack mmJTM;
+	Jack jack(mmJTM, &onReceive, &onReceiveAck, &getMessageID);
+
+	std::vector<double> legacyDataCycles, singlePassDataCycles, sendCycles, legacyAckCycles, singlePassAckCycles;
+	size_t dataLength = 0, ackLength = 0;
+
+	for (unsigned long r = 0; r < rounds; r++) {
+
+		uint64_t start = benchCycles();
+		for (int i = 0; i < BENCH_BATCH; i++) {
+			dataLength = legacyData(message, nextID++);
+		}
+		legacyDataCycles.push_back((double) (benchCycles() - start) / BENCH_BATCH);
+
+		start = benchCycles();
+		for (int i = 0; i < BENCH_BATCH; i++) {
+			dataLength = singlePassData(message, nextID++);
+		}
+		singlePassDataCycles.push_back((double) (benchCycles() - start) / BENCH_BATCH);
+
+		//Jack::send completo (ricerca dello slot compresa), il buffer viene svuotato quando è pieno
+		start = benchCycles();
+		for (int i = 0; i < BENCH_BATCH; i++) {
+			if (!jack.send(message)) {
+				jack.flushBufferSend();
+			}
+		}
+		sendCycles.push_back((double) (benchCycles() - start) / BENCH_BATCH);
+
+		start = benchCycles();
+		for (int i = 0; i < BENCH_BATCH; i++) {
+			ackLength = legacyAck(nextID++);
+		}
+		legacyAckCycles.push_back((double) (benchCycles() - start) / BENCH_BATCH);
+
+		start = benchCycles();
+		for (int i = 0; i < BENCH_BATCH; i++) {
+			ackLength = singlePassAck(nextID++);
+		}
+		singlePassAckCycles.push_back((double) (benchCycles() - start) / BENCH_BATCH);
+	}
+
+	printf("%-28s %8s %12s %12s\n", "serializer", "bytes", "p50 cyc/msg", "p99 cyc/msg");
+
+	report("data measure+malloc+print", legacyDataCycles, dataLength);
+	report("data single pass", singlePassDataCycles, dataLength);
+	report("data Jack::send (slot)", sendCycles, dataLength);
+	report("ack ArduinoJson", legacyAckCycles, ackLength);
+	report("ack single pass", singlePassAckCycles, ackLength);
+
+	return 0;
+}
@@ -0,0 +1,137 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file StoreBench.cpp
+ * @brief Benchmark dell'archivio delle letture: scrittura, ricerca per intervallo e sottocampionamento
+ *
+ * Le letture simulano BENCH_DEVICES bracciali che inviano una lettura ogni 5 minuti.
+ *
+ * Uso: store-bench cartella [letture]  (default 10^8 letture, ~0.9 GB su disco)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include "../store/ReadingStore.h"
+#include "BenchUtils.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Numero di bracciali simulati
+ */
+#define BENCH_DEVICES 64
+/**
+ * @brief Intervallo tra due letture dello stesso bracciale (secondi)
+ */
+#define BENCH_INTERVAL 300
+/**
+ * @brief Timestamp della prima lettura
+ */
+#define BENCH_START 1480000000U
+/**
+ * @brief Numero di default di letture
+ */
+#define BENCH_READINGS 100000000ULL
+/**
+ * @brief Numero di intervalli del sottocampionamento
+ */
+#define BENCH_BUCKETS 1000
+
+
+//somma dei valori letti (impedisce l'eliminazione della ricerca)
+static uint64_t checksum = 0;
+
+//funzione chiamata per ogni lettura trovata
+static void onReading(const RSReading &reading, void *) {
+	checksum += reading.gsr;
+}
+
+//stampa il risultato di una misura
+static void report(const char *name, uint64_t rows, uint64_t nanos) {
+	printf("%-34s %12llu rows %10.1f ms %10.1f Mrows/s\n", name, (unsigned long long) rows, nanos / 1e6, rows * 1e3 / nanos);
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	if (argc < 2) {
+		fprintf(stderr, "uso: %s cartella [letture]\n", argv[0]);
+		return 1;
+	}
+
+	uint64_t readings = argc > 2 ? strtoull(argv[2], NULL, 10) : BENCH_READINGS;
+
+	ReadingStore store(argv[1]);
+
+	if (!store.open()) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	//scrittura
+	uint64_t start = benchNanos();
+
+	for (uint64_t i = 0; i < readings; i++) {
+
+		uint32_t timestamp = BENCH_START + (uint32_t) (i / BENCH_DEVICES) * BENCH_INTERVAL;
+
+		store.append(i % BENCH_DEVICES, timestamp, (uint8_t) (i * 7 % 100), 30.0 + (i % 80) / 10.0);
+	}
+
+	store.sync();
+
+	report("ingest", readings, benchNanos() - start);
+
+	uint32_t last = BENCH_START + (uint32_t) ((store.count() - 1) / BENCH_DEVICES) * BENCH_INTERVAL;
+	uint32_t span = last - BENCH_START;
+
+	//ricerca dell'1% centrale
+	start = benchNanos();
+	uint64_t found = store.scan(BENCH_START + span / 2, BENCH_START + span / 2 + span / 100, RS_ALL_DEVICES, &onReading, NULL);
+	report("scan 1% range, all devices", found, benchNanos() - start);
+
+	//ricerca di un solo dispositivo su tutto l'archivio
+	start = benchNanos();
+	found = store.scan(BENCH_START, last, 7, &onReading, NULL);
+	report("scan full range, one device", found, benchNanos() - start);
+
+	//ricerca completa
+	start = benchNanos();
+	found = store.scan(BENCH_START, last, RS_ALL_DEVICES, &onReading, NULL);
+	report("scan full range, all devices", found, benchNanos() - start);
+
+	//sottocampionamento
+	RSBucket buckets[BENCH_BUCKETS];
+
+	start = benchNanos();
+	size_t used = store.downsample(BENCH_START, last, RS_ALL_DEVICES, span / BENCH_BUCKETS + 1, buckets, BENCH_BUCKETS);
+	report("downsample full range (1000 buckets)", store.count(), benchNanos() - start);
+
+	benchKeep(checksum);
+	benchKeep(used);
+
+	return 0;
+}
@@ -0,0 +1,206 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file TransportBench.cpp
+ * @brief Benchmark del collegamento tra Jack e il mezzo di trasmissione: interfaccia virtuale contro parametro del template
+ *
+ * Confronta Jack (JTransmissionAdapter<SoftwareSerialJack>, chiamate virtuali) e BasicJack<SoftwareSerialJack>
+ * (chiamate risolte a tempo di compilazione): cicli per messaggio del solo framing (available() + receive())
+ * e del messaggio completo (loop(): framing, parsing, ACK), e memoria occupata dalle istanze.
+ *
+ * Uso: transport-bench [messaggi]
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <Jack.h>
+#include <SoftwareSerialJack.h>
+#include "BenchUtils.h"
+
+
+//---COSTANTI---
+/**
+ * @brief Messaggi per ogni misura
+ */
+#define BENCH_BATCH 100
+/**
+ * @brief Numero di default di messaggi
+ */
+#define BENCH_MESSAGES 200000UL
+
+
+//---STREAM IN MEMORIA---
+//restituisce i caratteri caricati e scarta quelli scritti
+class MemoryStream : public Stream {
+
+	public:
+
+		MemoryStream() {
+			_position = 0;
+		}
+
+		//carica i messaggi da leggere
+		void load(const String &input) {
+			_input = input;
+			_position = 0;
+		}
+
+		int available() { return _input.size() - _position; }
+		int read() { return _position < _input.size() ? (uint8_t) _input[_position++] : -1; }
+		int peek() { return _position < _input.size() ? (uint8_t) _input[_position] : -1; }
+		size_t write(uint8_t c) { benchKeep(c); return 1; }
+
+
+	private:
+
+		String _input; //caratteri da leggere
+		size_t _position; //posizione di lettura
+
+};
+
+
+//---HANDLER---
+static void onReceive(JData &, long) {}
+static void onReceiveAck(long) {}
+static long getMessageID() { return 0; }
+
+
+//---MISURE---
+
+//preleva tutti i messaggi tramite l'interfaccia virtuale (la funzione non viene espansa: la chiamata resta virtuale)
+__attribute__((noinline)) static size_t framingVirtual(JTransmissionMethod *mmJTM, int messages) {
+
+	char buffer[JTransmissionMethod::MTU + 1];
+	size_t total = 0;
+
+	for (int i = 0; i < messages; i++) {
+		if (mmJTM->available()) {
+			total += mmJTM->receive(buffer, sizeof(buffer));
+		}
+	}
+
+	return total;
+}
+
+//preleva tutti i messaggi direttamente dal mezzo di trasmissione
+__attribute__((noinline)) static size_t framingTemplate(SoftwareSerialJack *mmJTM, int messages) {
+
+	char buffer[SoftwareSerialJack::MTU + 1];
+	size_t total = 0;
+
+	for (int i = 0; i < messages; i++) {
+		if (mmJTM->available()) {
+			total += mmJTM->receive(buffer, sizeof(buffer));
+		}
+	}
+
+	return total;
+}
+
+//esegue il loop di Jack finchè tutti i messaggi sono stati elaborati
+template <class J>
+static void execute(J &jack, int messages) {
+
+	for (int i = 0; i < messages; i++) {
+		jack.loop();
+	}
+}
+
+//stampa mediana e percentile 99 dei cicli per messaggio
+static void report(const char *name, std::vector<double> &samples) {
+	printf("%-34s %12.1f %12.1f\n", name, benchPercentile(samples, 50), benchPercentile(samples, 99));
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	unsigned long messages = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_MESSAGES;
+	unsigned long rounds = messages / BENCH_BATCH ? messages / BENCH_BATCH : 1;
+
+	//messaggi dati ricevuti dal telefono
+	String input;
+
+	for (int i = 0; i < BENCH_BATCH; i++) {
+
+		char frame[128];
+
+		snprintf(frame, sizeof(frame), "<{\"val\":{\"TMP\":%ld,\"GSR\":42,\"TME\":36.5},\"id\":%d,\"type\":\"data\"}>", 1480000000L + i, i + 1);
+
+		input += frame;
+	}
+
+	//i mezzi di trasmissione eliminano lo stream nel distruttore
+	MemoryStream *virtualStream = new MemoryStream();
+	MemoryStream *templateStream = new MemoryStream();
+
+	SoftwareSerialJack virtualSSJ(*virtualStream);
+	SoftwareSerialJack templateSSJ(*templateStream);
+
+	JTransmissionAdapter<SoftwareSerialJack> adapter(virtualSSJ);
+
+	Jack virtualJack(adapter, &onReceive, &onReceiveAck, &getMessageID, JK_TIMER_RESEND_MESSAGE, 0);
+	BasicJack<SoftwareSerialJack> templateJack(templateSSJ, &onReceive, &onReceiveAck, &getMessageID, JK_TIMER_RESEND_MESSAGE, 0);
+
+	virtualJack.start();
+	templateJack.start();
+
+	std::vector<double> framingVirtualCycles, framingTemplateCycles, loopVirtualCycles, loopTemplateCycles;
+
+	for (unsigned long r = 0; r < rounds; r++) {
+
+		virtualStream->load(input);
+		uint64_t start = benchCycles();
+		benchKeep(framingVirtual(&adapter, BENCH_BATCH));
+		framingVirtualCycles.push_back((double) (benchCycles() - start) / BENCH_BATCH);
+
+		templateStream->load(input);
+		start = benchCycles();
+		benchKeep(framingTemplate(&templateSSJ, BENCH_BATCH));
+		framingTemplateCycles.push_back((double) (benchCycles() - start) / BENCH_BATCH);
+
+		virtualStream->load(input);
+		start = benchCycles();
+		execute(virtualJack, BENCH_BATCH);
+		loopVirtualCycles.push_back((double) (benchCycles() - start) / BENCH_BATCH);
+
+		templateStream->load(input);
+		start = benchCycles();
+		execute(templateJack, BENCH_BATCH);
+		loopTemplateCycles.push_back((double) (benchCycles() - start) / BENCH_BATCH);
+	}
+
+	printf("%-34s %12s %12s\n", "path", "p50 cyc/msg", "p99 cyc/msg");
+
+	report("framing JTransmissionMethod (virt)", framingVirtualCycles);
+	report("framing SoftwareSerialJack (tmpl)", framingTemplateCycles);
+	report("loop Jack (virtual)", loopVirtualCycles);
+	report("loop BasicJack<SoftwareSerialJack>", loopTemplateCycles);
+
+	printf("\nRAM: Jack + adapter + SoftwareSerialJack %zu B, BasicJack<SoftwareSerialJack> + SoftwareSerialJack %zu B\n",
+		sizeof(Jack) + sizeof(adapter) + sizeof(SoftwareSerialJack), sizeof(BasicJack<SoftwareSerialJack>) + sizeof(SoftwareSerialJack));
+
+	return 0;
+}
@@ -0,0 +1,89 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file Arduino.cpp
+ * @brief Strato di compatibilità che permette di compilare le librerie Arduino (Jack, JData) su Linux
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <time.h>
+#include "Arduino.h"
+
+
+//---OROLOGIO DI SISTEMA---
+
+//restituisce i microsecondi del clock monotono del sistema
+static unsigned long monotonicMicros() {
+
+	struct timespec now;
+
+	//leggo il clock monotono
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (unsigned long) now.tv_sec * 1000000UL + now.tv_nsec / 1000;
+}
+
+//restituisce i millisecondi del clock monotono del sistema
+static unsigned long monotonicMillis() {
+	return monotonicMicros() / 1000;
+}
+
+//orologio correntemente in uso
+static unsigned long (*_millisSource)() = &monotonicMillis;
+static unsigned long (*_microsSource)() = &monotonicMicros;
+
+
+//---TEMPO---
+
+/**
+ * @brief Funzione che restituisce i millisecondi trascorsi secondo l'orologio in uso
+ *
+ * @return Millisecondi trascorsi
+ */
+unsigned long millis() {
+	return (*_millisSource)();
+}
+
+/**
+ * @brief Funzione che restituisce i microsecondi trascorsi secondo l'orologio in uso
+ *
+ * @return Microsecondi trascorsi
+ */
+unsigned long micros() {
+	return (*_microsSource)();
+}
+
+/**
+ * @brief Funzione che sostituisce l'orologio usato da millis() e micros()
+ *
+ * @param millisSource Funzione che restituisce i millisecondi (NULL per ripristinare l'orologio di sistema)
+ * @param microsSource Funzione che restituisce i microsecondi (NULL per ripristinare l'orologio di sistema)
+ */
+void setClockSource(unsigned long (*millisSource)(), unsigned long (*microsSource)()) {
+
+	//imposto l'orologio richiesto o ripristino quello di sistema
+	_millisSource = millisSource ? millisSource : &monotonicMillis;
+	_microsSource = microsSource ? microsSource : &monotonicMicros;
+}
@@ -0,0 +1,109 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file Arduino.h
+ * @brief Strato di compatibilità che permette di compilare le librerie Arduino (Jack, JData) su Linux
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef ARDUINO_COMPAT_H
+#define ARDUINO_COMPAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+
+//---TIPI---
+
+/**
+ * @brief Su Linux le stringhe Arduino sono sostituite da std::string (supportate nativamente da ArduinoJson)
+ */
+typedef std::string String;
+
+/**
+ * @brief Tipo byte di Arduino
+ */
+typedef uint8_t byte;
+
+/**
+ * @brief Macro per le stringhe in flash (su Linux non ha effetto)
+ */
+#define F(string) (string)
+
+
+//---TEMPO---
+
+//funzioni del tempo
+unsigned long millis(); //millisecondi dall'avvio
+unsigned long micros(); //microsecondi dall'avvio
+
+//permette di sostituire l'orologio (es. orologio virtuale del simulatore)
+void setClockSource(unsigned long (*millisSource)(), unsigned long (*microsSource)()); //imposta l'orologio usato da millis() e micros()
+
+
+//---STREAM---
+//versione ridotta della classe Stream di Arduino (usata dai mezzi di trasmissione basati su flussi di caratteri)
+class Stream {
+
+	public:
+
+		virtual ~Stream() {}
+
+		virtual int available() = 0; //numero di caratteri pronti per essere letti
+		virtual int read() = 0; //legge un carattere (-1 se non disponibile)
+		virtual int peek() = 0; //legge il prossimo carattere senza prelevarlo (-1 se non disponibile)
+		virtual size_t write(uint8_t c) = 0; //scrive un carattere
+
+		//scrive un buffer di caratteri
+		virtual size_t write(const uint8_t *buffer, size_t size) {
+
+			size_t n = 0;
+
+			//scrivo tutti i caratteri
+			while (size--) {
+				n += write(*buffer++);
+			}
+
+			return n;
+		}
+
+		//stampa un carattere
+		size_t print(char c) {
+			return write((uint8_t) c);
+		}
+
+		//stampa una stringa
+		size_t print(const char *s) {
+			return write((const uint8_t *) s, strlen(s));
+		}
+
+};
+
+
+#endif //ARDUINO_COMPAT_H
@@ -0,0 +1,57 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file SoftwareSerial.h
+ * @brief Strato di compatibilità: SoftwareSerial senza pin (permette di compilare SoftwareSerialJack su Linux)
+ *
+ * Su Linux SoftwareSerialJack va costruito a partire da uno Stream; la seriale software non riceve
+ * e scarta i caratteri scritti.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef SOFTWARESERIAL_COMPAT_H
+#define SOFTWARESERIAL_COMPAT_H
+
+#include <Arduino.h>
+
+
+//---SOFTWARE SERIAL---
+class SoftwareSerial : public Stream {
+
+	public:
+
+		SoftwareSerial(int, int) {} //costruttore (i pin vengono ignorati)
+
+		void begin(long) {} //avvia la seriale
+
+		int available() { return 0; } //non ci sono caratteri da leggere
+		int read() { return -1; } //nessun carattere disponibile
+		int peek() { return -1; } //nessun carattere disponibile
+		size_t write(uint8_t) { return 1; } //il carattere viene scartato
+
+};
+
+
+#endif //SOFTWARESERIAL_COMPAT_H
@@ -0,0 +1,561 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file AsyncJack.h
+ * @brief Invio con attesa della conferma tramite coroutine C++20 (solo Linux)
+ *
+ * Con BasicJack chi invia riceve solo l'id del messaggio e deve associarlo allo stato dell'applicazione
+ * nell'handler globale onReceiveAck. AsyncJack restituisce invece un awaitable:
+ *
+ *     JTask sendReading(AsyncJack<FileDescriptorJack> &jack, long timestamp) {
+ *         uint8_t result = co_await jack.sendAsync([&](JData &message) { message.add("TMP", timestamp); });
+ *         if (result == AJ_ACKED) ...
+ *     }
+ *
+ * La coroutine riprende con AJ_ACKED alla conferma, AJ_TIMEOUT se la conferma non arriva entro il timeout
+ * (il messaggio resta nel buffer di Jack e continua a essere reinviato), AJ_EXPIRED se Jack elimina il messaggio
+ * perchè è scaduto (messageTTL) e AJ_REJECTED se il messaggio non è stato accettato (buffer di invio pieno).
+ *
+ * Tutto avviene sul thread che chiama loop(): le coroutine riprendono dopo il loop di Jack, non dentro i suoi
+ * handler. Le attese sono al massimo JK_BUFFER_SEND_SIZE (una per messaggio nel buffer di invio) e stanno in
+ * una tabella fissa; l'unica allocazione per messaggio è il frame della coroutine JTask, preso da JFramePool.
+ *
+ * Il JData del messaggio tiene un blocco del pool JArena finchè non viene distrutto: va distrutto prima di
+ * co_await (la forma sendAsync(builder) costruisce e distrugge il messaggio dentro sendAsync).
+ *
+ * Richiede -std=c++20.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef ASYNCJACK_H
+#define ASYNCJACK_H
+
+#include <Arduino.h>
+#include <Jack.h>
+#include <time.h>
+#include <cstddef>
+#include <coroutine>
+#include <exception>
+#include <new>
+
+//---COSTANTI---
+/**
+ * @brief Dimensione di un blocco di JFramePool (frame più grandi vengono allocati sullo heap)
+ */
+#ifndef AJ_FRAME_SIZE
+#define AJ_FRAME_SIZE 256
+#endif
+/**
+ * @brief Numero di blocchi di JFramePool
+ */
+#ifndef AJ_FRAME_BLOCKS
+#define AJ_FRAME_BLOCKS 64
+#endif
+
+//risultati dell'attesa
+/**
+ * @brief Messaggio confermato dall'altro capo
+ */
+#define AJ_ACKED 0
+/**
+ * @brief Conferma non arrivata entro il timeout (il messaggio resta nel buffer di invio)
+ */
+#define AJ_TIMEOUT 1
+/**
+ * @brief Messaggio eliminato da Jack perchè scaduto (messageTTL)
+ */
+#define AJ_EXPIRED 2
+/**
+ * @brief Messaggio non accettato da Jack (buffer di invio pieno o messaggio troppo lungo)
+ */
+#define AJ_REJECTED 3
+
+
+//---JFRAME POOL---
+//blocchi per i frame delle coroutine JTask (solo metodi statici, non thread-safe)
+class JFramePool {
+
+	public:
+
+		static void *allocate(size_t size); //preleva un blocco (heap se il frame è troppo grande o i blocchi sono finiti)
+		static void release(void *frame); //restituisce il blocco
+
+		static size_t used(); //blocchi in uso
+		static unsigned long fallbacks(); //frame allocati sullo heap
+
+	private:
+
+		struct Block {
+			alignas(std::max_align_t) char data[AJ_FRAME_SIZE];
+		};
+
+		static inline Block _blocks[AJ_FRAME_BLOCKS]; //blocchi
+		static inline uint16_t _free[AJ_FRAME_BLOCKS]; //indici dei blocchi liberi (pila)
+		static inline size_t _freeCount = 0; //blocchi liberi
+		static inline uint8_t _initialized = 0;
+		static inline unsigned long _fallbacks = 0;
+};
+
+
+//---JTASK---
+//coroutine senza valore di ritorno che parte subito e si distrugge alla fine (frame da JFramePool)
+struct JTask {
+
+	struct promise_type {
+
+		JTask get_return_object() { return JTask(); }
+		std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+		std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+
+		static void *operator new(size_t size) { return JFramePool::allocate(size); }
+		static void operator delete(void *frame) { JFramePool::release(frame); }
+	};
+};
+
+
+template <class T>
+class AsyncJack;
+
+
+//---JSEND AWAITER---
+//attesa della conferma di un messaggio (restituita da AsyncJack::sendAsync)
+template <class T>
+class JSendAwaiter {
+
+	public:
+
+		JSendAwaiter(AsyncJack<T> *jack, long id, unsigned long timeout) : _jack(jack), _id(id), _timeout(timeout), _result(AJ_REJECTED) {}
+
+		bool await_ready() { return _id == 0; } //messaggio rifiutato: nessuna attesa
+		bool await_suspend(std::coroutine_handle<> handle) { return _jack->wait(this, handle); }
+		uint8_t await_resume() { return _result; }
+
+		long id() { return _id; } //id del messaggio (0 se rifiutato)
+
+	private:
+
+		friend class AsyncJack<T>;
+
+		AsyncJack<T> *_jack;
+		long _id;
+		unsigned long _timeout; //millisecondi (0 = nessun timeout)
+		uint8_t _result;
+};
+
+
+//---ATTESA---
+/**
+ * @brief Coroutine in attesa della conferma di un messaggio
+ */
+struct AJWait {
+	long id; //id del messaggio (0 = attesa libera)
+	unsigned long deadline; //scadenza del timeout (millis())
+	uint8_t timed; //indica se l'attesa ha un timeout
+	uint8_t result; //risultato (valido se completed)
+	uint8_t completed; //la coroutine va ripresa al prossimo loop
+	void *awaiter; //JSendAwaiter della coroutine
+	std::coroutine_handle<> handle; //coroutine da riprendere
+};
+
+
+//---ASYNC JACK---
+template <class T>
+class AsyncJack {
+
+	public:
+
+		//costruttori
+		AsyncJack(T &mmJTM, void (*onReceive)(JData &, long)); //costruttore con l'handler dei messaggi ricevuti
+		AsyncJack(T &mmJTM, void (*onReceive)(JData &, long), long timerSendMessage, long timerPolling); //costruttore con i timer
+
+		//polling
+		void start(); //avvia il polling
+		void stop(); //ferma il polling
+
+		//invio messaggi
+		JSendAwaiter<T> sendAsync(JData &message); //invia il messaggio e restituisce l'attesa della conferma
+		JSendAwaiter<T> sendAsync(JData &message, unsigned long timeout); //invia il messaggio con il timeout dell'attesa
+		template <class F> JSendAwaiter<T> sendAsync(F build); //costruisce il messaggio con build(JData &) e lo invia
+		template <class F> JSendAwaiter<T> sendAsync(F build, unsigned long timeout);
+
+		//loop
+		void loop(); //loop di Jack, timeout e ripresa delle coroutine
+
+		//istanza di Jack (per la configurazione, gli handler onReceiveAck e onExpire sono di AsyncJack)
+		BasicJack<T> &jack();
+
+		uint8_t waiting(); //coroutine in attesa
+
+
+	private:
+
+		friend class JSendAwaiter<T>;
+
+		uint8_t wait(JSendAwaiter<T> *awaiter, std::coroutine_handle<> handle); //registra l'attesa (0 se va ripresa subito)
+		void complete(long id, uint8_t result); //completa l'attesa del messaggio
+
+		//funzioni passate all'istanza di Jack (instradano gli eventi all'istanza corrente)
+		static void onReceiveAckDispatcher(long id);
+		static void onExpireDispatcher(long id);
+		static long getMessageIDDispatcher();
+
+		//istanza che sta eseguendo Jack (loop e invio sono a singolo thread)
+		static inline AsyncJack<T> *_current = NULL;
+
+		BasicJack<T> _jack; //istanza di Jack
+		long _lastMessageID; //ultimo id usato per i messaggi inviati
+
+		AJWait _waits[JK_BUFFER_SEND_SIZE]; //attese (una per messaggio nel buffer di invio)
+		uint8_t _waiting; //attese occupate
+		uint8_t _completed; //attese completate da riprendere
+
+};
+
+
+//---IMPLEMENTAZIONE---
+
+//---JFRAME POOL---
+
+/**
+ * @brief Metodo che preleva un blocco per il frame di una coroutine
+ *
+ * @param size Dimensione del frame
+ * @return Frame (sullo heap se è più grande di AJ_FRAME_SIZE o i blocchi sono finiti)
+ */
+inline void *JFramePool::allocate(size_t size) {
+
+	if (!_initialized) {
+
+		for (size_t i = 0; i < AJ_FRAME_BLOCKS; i++) {
+			_free[i] = AJ_FRAME_BLOCKS - 1 - i;
+		}
+
+		_freeCount = AJ_FRAME_BLOCKS;
+		_initialized = 1;
+	}
+
+	if (size > AJ_FRAME_SIZE || _freeCount == 0) {
+		_fallbacks++;
+		return ::operator new(size);
+	}
+
+	return _blocks[_free[--_freeCount]].data;
+}
+
+/**
+ * @brief Metodo che restituisce il blocco del frame
+ *
+ * @param frame Frame ottenuto con allocate()
+ */
+inline void JFramePool::release(void *frame) {
+
+	char *block = (char *) frame;
+
+	//frame sullo heap
+	if (block < _blocks[0].data || block >= _blocks[AJ_FRAME_BLOCKS - 1].data + AJ_FRAME_SIZE) {
+		::operator delete(frame);
+		return;
+	}
+
+	_free[_freeCount++] = (block - _blocks[0].data) / sizeof(Block);
+}
+
+/**
+ * @brief Metodo che restituisce i blocchi in uso
+ *
+ * @return Blocchi in uso
+ */
+inline size_t JFramePool::used() {
+	return _initialized ? AJ_FRAME_BLOCKS - _freeCount : 0;
+}
+
+/**
+ * @brief Metodo che restituisce i frame allocati sullo heap
+ *
+ * @return Frame sullo heap
+ */
+inline unsigned long JFramePool::fallbacks() {
+	return _fallbacks;
+}
+
+
+//---ASYNC JACK---
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ *
+ * @param mmJTM Mezzo di trasmissione
+ * @param onReceive Handler dei messaggi ricevuti
+ * @param timerSendMessage Tempo (ms) di reinvio dei messaggi non confermati
+ * @param timerPolling Tempo (ms) tra due polling del mezzo di trasmissione
+ */
+template <class T>
+AsyncJack<T>::AsyncJack(T &mmJTM, void (*onReceive)(JData &, long), long timerSendMessage, long timerPolling)
+	: _jack(mmJTM, onReceive, &onReceiveAckDispatcher, &getMessageIDDispatcher, timerSendMessage, timerPolling) {
+
+	_jack.setOnExpire(&onExpireDispatcher);
+
+	_lastMessageID = (long) time(NULL) * 1000;
+
+	for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE; i++) {
+		_waits[i].id = 0;
+	}
+
+	_waiting = 0;
+	_completed = 0;
+}
+
+/**
+ * @brief Costruttore della classe (timer di default di Jack)
+ *
+ * @param mmJTM Mezzo di trasmissione
+ * @param onReceive Handler dei messaggi ricevuti
+ */
+template <class T>
+AsyncJack<T>::AsyncJack(T &mmJTM, void (*onReceive)(JData &, long))
+	: AsyncJack(mmJTM, onReceive, JK_TIMER_RESEND_MESSAGE, JK_TIMER_POLLING) {}
+
+
+/**
+ * @brief Metodo che avvia il polling
+ */
+template <class T>
+void AsyncJack<T>::start() {
+	_jack.start();
+}
+
+/**
+ * @brief Metodo che ferma il polling
+ */
+template <class T>
+void AsyncJack<T>::stop() {
+	_jack.stop();
+}
+
+
+/**
+ * @brief Metodo che invia il messaggio e restituisce l'attesa della conferma (senza timeout)
+ *
+ * @param message Messaggio da inviare (va distrutto prima di co_await)
+ * @return Attesa della conferma
+ */
+template <class T>
+JSendAwaiter<T> AsyncJack<T>::sendAsync(JData &message) {
+	return sendAsync(message, 0);
+}
+
+/**
+ * @brief Metodo che invia il messaggio e restituisce l'attesa della conferma
+ *
+ * @param message Messaggio da inviare (va distrutto prima di co_await)
+ * @param timeout Attesa massima della conferma (millisecondi, 0 = nessun timeout)
+ * @return Attesa della conferma (AJ_REJECTED senza attesa se Jack non ha accettato il messaggio)
+ */
+template <class T>
+JSendAwaiter<T> AsyncJack<T>::sendAsync(JData &message, unsigned long timeout) {
+
+	//l'invio può eliminare i messaggi scaduti (handler onExpire)
+	_current = this;
+
+	return JSendAwaiter<T>(this, _jack.send(message), timeout);
+}
+
+/**
+ * @brief Metodo che costruisce il messaggio, lo invia e restituisce l'attesa della conferma (senza timeout)
+ *
+ * @param build Funzione che riceve il JData da riempire
+ * @return Attesa della conferma
+ */
+template <class T>
+template <class F>
+JSendAwaiter<T> AsyncJack<T>::sendAsync(F build) {
+	return sendAsync(build, 0);
+}
+
+/**
+ * @brief Metodo che costruisce il messaggio, lo invia e restituisce l'attesa della conferma
+ *
+ * Il JData viene distrutto prima dell'attesa (il blocco del pool JArena non resta occupato dalla coroutine).
+ *
+ * @param build Funzione che riceve il JData da riempire
+ * @param timeout Attesa massima della conferma (millisecondi, 0 = nessun timeout)
+ * @return Attesa della conferma
+ */
+template <class T>
+template <class F>
+JSendAwaiter<T> AsyncJack<T>::sendAsync(F build, unsigned long timeout) {
+
+	JData message;
+
+	build(message);
+
+	return sendAsync(message, timeout);
+}
+
+
+/**
+ * @brief Metodo che esegue il loop di Jack, i timeout e riprende le coroutine completate
+ */
+template <class T>
+void AsyncJack<T>::loop() {
+
+	_current = this;
+
+	_jack.loop();
+
+	//timeout (il messaggio resta nel buffer di Jack)
+	if (_waiting > _completed) {
+
+		unsigned long now = millis();
+
+		for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE; i++) {
+
+			AJWait &wait = _waits[i];
+
+			if (wait.id && !wait.completed && wait.timed && (long) (now - wait.deadline) >= 0) {
+				wait.result = AJ_TIMEOUT;
+				wait.completed = 1;
+				_completed++;
+			}
+		}
+	}
+
+	//riprendo le coroutine completate (possono inviare altri messaggi e registrare nuove attese)
+	for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE && _completed; i++) {
+
+		AJWait &wait = _waits[i];
+
+		if (wait.id && wait.completed) {
+
+			std::coroutine_handle<> handle = wait.handle;
+
+			((JSendAwaiter<T> *) wait.awaiter)->_result = wait.result;
+
+			wait.id = 0;
+			_waiting--;
+			_completed--;
+
+			handle.resume();
+		}
+	}
+}
+
+
+/**
+ * @brief Metodo che restituisce l'istanza di Jack
+ *
+ * Gli handler onReceiveAck, onExpire e la funzione degli id sono usati da AsyncJack e non vanno sostituiti.
+ *
+ * @return Istanza di Jack
+ */
+template <class T>
+BasicJack<T> &AsyncJack<T>::jack() {
+	return _jack;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di coroutine in attesa
+ *
+ * @return Coroutine in attesa (comprese quelle completate e non ancora riprese)
+ */
+template <class T>
+uint8_t AsyncJack<T>::waiting() {
+	return _waiting;
+}
+
+
+//---PRIVATE---
+
+//registra l'attesa della coroutine (il messaggio è nel buffer di invio, quindi c'è sempre un'attesa libera)
+template <class T>
+uint8_t AsyncJack<T>::wait(JSendAwaiter<T> *awaiter, std::coroutine_handle<> handle) {
+
+	for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE; i++) {
+
+		AJWait &wait = _waits[i];
+
+		if (wait.id == 0) {
+
+			wait.id = awaiter->_id;
+			wait.timed = awaiter->_timeout != 0;
+			wait.deadline = millis() + awaiter->_timeout;
+			wait.completed = 0;
+			wait.awaiter = awaiter;
+			wait.handle = handle;
+
+			_waiting++;
+
+			return 1;
+		}
+	}
+
+	//nessuna attesa libera (solo se un'attesa scaduta per timeout non è ancora stata ripresa)
+	awaiter->_result = AJ_REJECTED;
+
+	return 0;
+}
+
+//completa l'attesa del messaggio (la coroutine riprende alla fine del loop)
+template <class T>
+void AsyncJack<T>::complete(long id, uint8_t result) {
+
+	for (uint8_t i = 0; i < JK_BUFFER_SEND_SIZE; i++) {
+
+		AJWait &wait = _waits[i];
+
+		if (wait.id == id && !wait.completed) {
+			wait.result = result;
+			wait.completed = 1;
+			_completed++;
+			return;
+		}
+	}
+}
+
+
+//conferma ricevuta dall'istanza di Jack
+template <class T>
+void AsyncJack<T>::onReceiveAckDispatcher(long id) {
+	_current->complete(id, AJ_ACKED);
+}
+
+//messaggio scaduto nell'istanza di Jack
+template <class T>
+void AsyncJack<T>::onExpireDispatcher(long id) {
+	_current->complete(id, AJ_EXPIRED);
+}
+
+//id dei messaggi inviati
+template <class T>
+long AsyncJack<T>::getMessageIDDispatcher() {
+	return ++_current->_lastMessageID;
+}
+
+
+#endif //ASYNCJACK_H
@@ -0,0 +1,460 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file ConcurrentJack.h
+ * @brief Istanza di Jack condivisa da più thread (solo Linux)
+ *
+ * BasicJack non è thread-safe: send() e loop() condividono il buffer di invio. ConcurrentJack lascia l'istanza
+ * di Jack (mezzo di trasmissione, buffer di invio, reinvii) a un unico thread di I/O e la alimenta con una
+ * SendQueue: send() può essere chiamato da qualsiasi thread, serializza il messaggio sul thread chiamante
+ * direttamente nella cella della coda e non prende lock. Il thread di I/O sposta i messaggi dalla coda al
+ * buffer di invio di Jack (BasicJack::sendFrame()) quando ci sono slot liberi.
+ *
+ * Le conferme vengono passate a un thread separato che chiama l'handler onReceiveAck (un handler lento non
+ * ferma l'I/O); l'handler onReceive viene invece chiamato dal thread di I/O, perchè il JData ricevuto usa il
+ * pool JArena di quel thread.
+ *
+ * I thread che costruiscono un JData hanno bisogno di un proprio pool JArena: la build deve usare
+ * -DJK_ARENA_THREAD_LOCAL=1.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef CONCURRENTJACK_H
+#define CONCURRENTJACK_H
+
+#include <Arduino.h>
+#include <Jack.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "SendQueue.h"
+
+//---COSTANTI---
+/**
+ * @brief Attesa massima (millisecondi) del thread di I/O quando non ci sono messaggi da spostare né conferme
+ */
+#ifndef CJ_TIMER_TICK
+#define CJ_TIMER_TICK 1
+#endif
+
+static_assert(JK_ARENA_THREAD_LOCAL, "ConcurrentJack richiede un pool JArena per thread (-DJK_ARENA_THREAD_LOCAL=1)");
+
+
+//---CONCURRENT JACK---
+template <class T>
+class ConcurrentJack {
+
+	public:
+
+		//costruttori
+		ConcurrentJack(T &mmJTM, void (*onReceive)(JData &, long), void (*onReceiveAck)(long)); //costruttore con gli handler
+		ConcurrentJack(T &mmJTM, void (*onReceive)(JData &, long), void (*onReceiveAck)(long), long timerSendMessage, long timerPolling); //costruttore con i timer
+
+		//distruttore
+		~ConcurrentJack(); //ferma i thread
+
+		//thread
+		void start(); //avvia il thread di I/O e quello delle conferme
+		void stop(); //ferma i thread (i messaggi in coda restano in coda)
+
+		//invio messaggi (qualsiasi thread)
+		long send(JData &message); //accoda il messaggio (0 se la coda è piena o il messaggio è troppo lungo)
+		long send(JData &message, unsigned long ttl); //accoda il messaggio con la durata indicata (0 = durata di default di Jack)
+
+		//istanza di Jack (solo prima di start() o dall'handler onReceive, che gira sul thread di I/O)
+		BasicJack<T> &jack();
+
+		//contatori (qualsiasi thread)
+		size_t queued(); //messaggi in coda non ancora passati a Jack
+		unsigned long rejected(); //messaggi rifiutati perchè la coda era piena
+		unsigned long acksDispatched(); //conferme passate all'handler onReceiveAck
+
+
+	private:
+
+		//thread
+		void runIO(); //sposta i messaggi dalla coda a Jack ed esegue il loop di Jack
+		void runAcks(); //chiama l'handler onReceiveAck per le conferme ricevute
+		void wake(); //sveglia il thread di I/O se è in attesa
+
+		//funzioni passate all'istanza di Jack (chiamate dal thread di I/O)
+		static void onReceiveAckDispatcher(long id);
+		static long getMessageIDDispatcher();
+
+		//istanza servita dal thread di I/O corrente
+		static thread_local ConcurrentJack<T> *_current;
+
+		BasicJack<T> _jack; //istanza di Jack (usata solo dal thread di I/O dopo start())
+		SendQueue _queue; //messaggi serializzati dai produttori
+
+		std::atomic<long> _lastMessageID; //ultimo id assegnato
+		std::atomic<unsigned long> _rejected;
+		std::atomic<unsigned long> _acksDispatched;
+
+		std::atomic<uint8_t> _running; //indica se i thread sono in esecuzione
+		std::thread _ioThread;
+		std::thread _ackThread;
+
+		//attesa del thread di I/O
+		std::mutex _wakeMutex;
+		std::condition_variable _wakeCondition;
+		std::atomic<uint8_t> _sleeping; //indica se il thread di I/O è in attesa
+		uint8_t _progress; //il thread di I/O ha spostato messaggi o ricevuto conferme nell'ultima iterazione
+
+		//conferme in attesa dell'handler
+		std::mutex _ackMutex;
+		std::condition_variable _ackCondition;
+		std::deque<long> _acks;
+
+		//handler esterno
+		void (*_onReceiveAck)(long);
+
+};
+
+
+//---IMPLEMENTAZIONE---
+
+//---VARIABILI STATICHE---
+template <class T>
+thread_local ConcurrentJack<T> *ConcurrentJack<T>::_current = NULL;
+
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ *
+ * @param mmJTM Mezzo di trasmissione (usato solo dal thread di I/O)
+ * @param onReceive Handler dei messaggi ricevuti (chiamato dal thread di I/O)
+ * @param onReceiveAck Handler delle conferme (chiamato dal thread delle conferme)
+ * @param timerSendMessage Tempo (ms) di reinvio dei messaggi non confermati
+ * @param timerPolling Tempo (ms) tra due polling del mezzo di trasmissione
+ */
+template <class T>
+ConcurrentJack<T>::ConcurrentJack(T &mmJTM, void (*onReceive)(JData &, long), void (*onReceiveAck)(long), long timerSendMessage, long timerPolling)
+	: _jack(mmJTM, onReceive, &onReceiveAckDispatcher, &getMessageIDDispatcher, timerSendMessage, timerPolling) {
+
+	_lastMessageID.store((long) time(NULL) * 1000);
+	_rejected.store(0);
+	_acksDispatched.store(0);
+
+	_running.store(0);
+	_sleeping.store(0);
+	_progress = 0;
+
+	_onReceiveAck = onReceiveAck;
+}
+
+/**
+ * @brief Costruttore della classe (timer di default di Jack, polling ad ogni iterazione del thread di I/O)
+ *
+ * @param mmJTM Mezzo di trasmissione (usato solo dal thread di I/O)
+ * @param onReceive Handler dei messaggi ricevuti (chiamato dal thread di I/O)
+ * @param onReceiveAck Handler delle conferme (chiamato dal thread delle conferme)
+ */
+template <class T>
+ConcurrentJack<T>::ConcurrentJack(T &mmJTM, void (*onReceive)(JData &, long), void (*onReceiveAck)(long))
+	: ConcurrentJack(mmJTM, onReceive, onReceiveAck, JK_TIMER_RESEND_MESSAGE, 0) {}
+
+/**
+ * @brief Distruttore della classe
+ */
+template <class T>
+ConcurrentJack<T>::~ConcurrentJack() {
+	stop();
+}
+
+
+/**
+ * @brief Metodo che avvia il polling di Jack, il thread di I/O e quello delle conferme
+ */
+template <class T>
+void ConcurrentJack<T>::start() {
+
+	if (_running.load()) {
+		return;
+	}
+
+	_running.store(1);
+
+	_jack.start();
+
+	_ioThread = std::thread(&ConcurrentJack<T>::runIO, this);
+	_ackThread = std::thread(&ConcurrentJack<T>::runAcks, this);
+}
+
+/**
+ * @brief Metodo che ferma i thread (le conferme già ricevute vengono passate all'handler prima dell'arresto)
+ */
+template <class T>
+void ConcurrentJack<T>::stop() {
+
+	if (!_running.load()) {
+		return;
+	}
+
+	_running.store(0);
+
+	{
+		std::lock_guard<std::mutex> lock(_wakeMutex);
+		_wakeCondition.notify_one();
+	}
+
+	_ioThread.join();
+
+	{
+		std::lock_guard<std::mutex> lock(_ackMutex);
+		_ackCondition.notify_one();
+	}
+
+	_ackThread.join();
+
+	_jack.stop();
+}
+
+
+/**
+ * @brief Metodo che accoda il messaggio (durata di default di Jack)
+ *
+ * @param message Messaggio da inviare (serializzato sul thread chiamante)
+ * @return ID del messaggio (0 se la coda è piena o il messaggio supera JK_MAX_MESSAGE_LENGTH)
+ */
+template <class T>
+long ConcurrentJack<T>::send(JData &message) {
+	return send(message, 0);
+}
+
+/**
+ * @brief Metodo che accoda il messaggio con la durata indicata
+ *
+ * Il messaggio viene serializzato nella cella della coda con il suo id definitivo; la durata parte quando il
+ * thread di I/O lo inserisce nel buffer di invio di Jack.
+ *
+ * @param message Messaggio da inviare (serializzato sul thread chiamante)
+ * @param ttl Durata del messaggio nel buffer di invio (millisecondi, 0 = durata di default di Jack)
+ * @return ID del messaggio (0 se la coda è piena o il messaggio supera JK_MAX_MESSAGE_LENGTH)
+ */
+template <class T>
+long ConcurrentJack<T>::send(JData &message, unsigned long ttl) {
+
+	SQCell *cell = _queue.claim();
+
+	if (cell == NULL) {
+		_rejected.fetch_add(1, std::memory_order_relaxed);
+		return 0;
+	}
+
+	long id = _lastMessageID.fetch_add(1, std::memory_order_relaxed) + 1;
+
+	size_t length = JFrame::printData(message, id, cell->frame, JK_MAX_MESSAGE_LENGTH);
+
+	cell->id = id;
+	cell->length = length;
+	cell->ttl = ttl;
+
+	//la cella va pubblicata anche se il messaggio non è valido (il thread di I/O la scarta)
+	_queue.publish(cell);
+
+	wake();
+
+	return length ? id : 0;
+}
+
+
+/**
+ * @brief Metodo che restituisce l'istanza di Jack
+ *
+ * L'istanza non è thread-safe: va configurata prima di start() o dall'handler onReceive.
+ *
+ * @return Istanza di Jack
+ */
+template <class T>
+BasicJack<T> &ConcurrentJack<T>::jack() {
+	return _jack;
+}
+
+
+/**
+ * @brief Metodo che restituisce i messaggi in coda non ancora passati a Jack
+ *
+ * @return Messaggi in coda
+ */
+template <class T>
+size_t ConcurrentJack<T>::queued() {
+	return _queue.size();
+}
+
+/**
+ * @brief Metodo che restituisce i messaggi rifiutati perchè la coda era piena
+ *
+ * @return Messaggi rifiutati
+ */
+template <class T>
+unsigned long ConcurrentJack<T>::rejected() {
+	return _rejected.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Metodo che restituisce le conferme passate all'handler onReceiveAck
+ *
+ * @return Conferme passate all'handler
+ */
+template <class T>
+unsigned long ConcurrentJack<T>::acksDispatched() {
+	return _acksDispatched.load(std::memory_order_relaxed);
+}
+
+
+//---PRIVATE---
+
+//thread di I/O: unico thread che usa l'istanza di Jack e il mezzo di trasmissione
+template <class T>
+void ConcurrentJack<T>::runIO() {
+
+	_current = this;
+
+	while (_running.load(std::memory_order_relaxed)) {
+
+		_progress = 0;
+
+		//sposto i messaggi nel buffer di invio finchè ci sono slot liberi
+		SQCell *cell;
+
+		while ((cell = _queue.front()) != NULL) {
+
+			if (cell->length && !_jack.sendFrame(cell->id, cell->frame, cell->length, cell->ttl ? cell->ttl : _jack.messageTTL())) {
+				break; //buffer di invio pieno: il messaggio resta in coda
+			}
+
+			_queue.pop();
+
+			_progress = 1;
+		}
+
+		//ricezione, conferme e reinvii
+		_jack.loop();
+
+		if (_progress) {
+			continue;
+		}
+
+		//nessun lavoro: attendo un produttore o il prossimo tick (il mezzo di trasmissione non ha un file descriptor da attendere)
+		std::unique_lock<std::mutex> lock(_wakeMutex);
+
+		_sleeping.store(1);
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		//un produttore può aver pubblicato dopo l'ultimo controllo della coda
+		if (_queue.front() == NULL && _running.load()) {
+			_wakeCondition.wait_for(lock, std::chrono::milliseconds(CJ_TIMER_TICK));
+		}
+
+		_sleeping.store(0);
+	}
+
+	_current = NULL;
+}
+
+//thread delle conferme: chiama l'handler fuori dal lock (l'handler può essere lento)
+template <class T>
+void ConcurrentJack<T>::runAcks() {
+
+	std::deque<long> acks;
+
+	for (;;) {
+
+		{
+			std::unique_lock<std::mutex> lock(_ackMutex);
+
+			while (_acks.empty() && _running.load()) {
+				_ackCondition.wait(lock);
+			}
+
+			//fermato e nessuna conferma da passare
+			if (_acks.empty()) {
+				return;
+			}
+
+			acks.swap(_acks);
+		}
+
+		for (size_t i = 0; i < acks.size(); i++) {
+
+			if (_onReceiveAck) {
+				(*_onReceiveAck)(acks[i]);
+			}
+		}
+
+		_acksDispatched.fetch_add(acks.size(), std::memory_order_relaxed);
+
+		acks.clear();
+	}
+}
+
+//sveglia il thread di I/O (solo se è in attesa: il caso comune non prende il lock)
+template <class T>
+void ConcurrentJack<T>::wake() {
+
+	//la pubblicazione della cella deve essere visibile prima della lettura di _sleeping (vedi runIO)
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (_sleeping.load()) {
+		std::lock_guard<std::mutex> lock(_wakeMutex);
+		_wakeCondition.notify_one();
+	}
+}
+
+
+//conferma ricevuta dall'istanza di Jack (thread di I/O): la passo al thread delle conferme
+template <class T>
+void ConcurrentJack<T>::onReceiveAckDispatcher(long id) {
+
+	ConcurrentJack<T> *concurrent = _current;
+
+	concurrent->_progress = 1;
+
+	std::lock_guard<std::mutex> lock(concurrent->_ackMutex);
+
+	concurrent->_acks.push_back(id);
+
+	//il thread delle conferme attende solo quando le ha passate tutte
+	if (concurrent->_acks.size() == 1) {
+		concurrent->_ackCondition.notify_one();
+	}
+}
+
+//id dei messaggi inviati direttamente all'istanza di Jack (dall'handler onReceive)
+template <class T>
+long ConcurrentJack<T>::getMessageIDDispatcher() {
+	return _current->_lastMessageID.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+
+#endif //CONCURRENTJACK_H
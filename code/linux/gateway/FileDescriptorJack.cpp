@@ -0,0 +1,362 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file FileDescriptorJack.cpp
+ * @brief Mezzo di trasmissione per Jack basato su file descriptor non bloccanti (tty, pty, socket)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "FileDescriptorJack.h"
+#include "WireCapture.h"
+
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ *
+ * @param fd File descriptor da usare (viene impostato in modalità non bloccante)
+ * @param bufferSize La dimensione del buffer di ricezione
+ */
+FileDescriptorJack::FileDescriptorJack(int fd, size_t bufferSize) {
+
+	//salvo il file descriptor e lo rendo non bloccante
+	_fd = fd;
+	fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+
+	//inizializzo il buffer di ricezione
+	_buffer = (char *) malloc(bufferSize * sizeof(char));
+	_size = bufferSize;
+	_position = 0;
+	_length = 0;
+	_frames = 0;
+
+	//inizializzo il buffer di uscita
+	_output = (char *) malloc(FDJ_OUTPUT_BUFFER_SIZE * sizeof(char));
+	_outputLength = 0;
+
+	_closed = 0;
+
+	_capture = NULL;
+}
+
+/**
+ * @brief Costruttore della classe (ridotto)
+ *
+ * @param fd File descriptor da usare (viene impostato in modalità non bloccante)
+ */
+FileDescriptorJack::FileDescriptorJack(int fd): FileDescriptorJack(fd, FDJ_BUFFER_SIZE) {}
+
+
+//distruttore (il file descriptor è chiuso da chi lo ha aperto)
+FileDescriptorJack::~FileDescriptorJack() {
+
+	//libero i buffer
+	free(_buffer);
+	free(_output);
+}
+
+
+/**
+ * @brief Metodo per inviare un messaggio
+ *
+ * Il messaggio viene delimitato dai caratteri di inizio e fine; se il file descriptor non accetta
+ * altri dati quelli rimanenti vengono accodati e scritti da flush()
+ *
+ * @param message Messaggio da inviare
+ * @param length Lunghezza del messaggio da inviare
+ */
+void FileDescriptorJack::send(char *message, size_t length) { //invia il messaggio
+
+	//se il messaggio non può essere accodato lo scarto (verrà reinviato da Jack)
+	if (_outputLength + length + 2 > FDJ_OUTPUT_BUFFER_SIZE) {
+		return;
+	}
+
+	//accodo il messaggio delimitato
+	_output[_outputLength++] = FDJ_MESSAGE_START_CHARACTER;
+	memcpy(_output + _outputLength, message, length);
+	_outputLength += length;
+	_output[_outputLength++] = FDJ_MESSAGE_FINISH_CHARACTER;
+
+	//registro il messaggio delimitato
+	if (_capture != NULL) {
+		_capture->record(WC_SENT, _output + _outputLength - length - 2, length + 2);
+	}
+
+	//provo a scriverlo subito
+	flush();
+}
+
+
+/**
+ * @brief Metodo che legge i caratteri disponibili nel file descriptor
+ *
+ * @return Ritorna il numero di caratteri ricevuti e non ancora prelevati (0 se non ci sono messaggi completi)
+ */
+size_t FileDescriptorJack::available() {
+
+	char chunk[512];
+
+	//se il buffer è pieno e non contiene messaggi completi i dati non sono validi: li scarto
+	if (_length == _size && _frames == 0) {
+		_position = 0;
+		_length = 0;
+	}
+
+	//finchè ci sono caratteri in entrata e posizioni libere nel buffer
+	while (_size - _length > 0) {
+
+		//non leggo più caratteri di quanti ne possa contenere il buffer
+		size_t toRead = _size - _length < sizeof(chunk) ? _size - _length : sizeof(chunk);
+
+		ssize_t n = read(_fd, chunk, toRead);
+
+		//l'altro capo ha chiuso il file descriptor
+		if (n == 0) {
+			_closed = 1;
+			break;
+		}
+
+		//non ci sono altri caratteri (o errore)
+		if (n < 0) {
+
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				_closed = 1;
+			}
+
+			break;
+		}
+
+		//registro i caratteri così come sono stati letti
+		if (_capture != NULL) {
+			_capture->record(WC_RECEIVED, chunk, n);
+		}
+
+		//inserisco i caratteri nel buffer
+		for (ssize_t i = 0; i < n; i++) {
+			bufferPut(chunk[i]);
+		}
+	}
+
+	//restituisco la dimensione del buffer (0 se non ci sono messaggi completi)
+	return _frames ? _length : 0;
+}
+
+
+/**
+ * @brief Metodo che preleva il primo messaggio disponibile
+ *
+ * @param buffer Buffer in cui salvare il messaggio prelevato
+ * @param size La dimensione del buffer
+ *
+ * @return Ritorna la lunghezza del messaggio (0 se non c'è un messaggio valido)
+ */
+size_t FileDescriptorJack::receive(char *buffer, size_t size) {
+
+	size_t position = 0; //imposto la posizione all'interno del buffer di ritorno
+
+	//se non ci sono messaggi completi non prelevo nulla (il messaggio è ancora in arrivo)
+	if (_frames == 0 || size == 0) {
+		return 0;
+	}
+
+	//elimino tutti i caratteri finchè non trovo il carattere di inzio messaggio
+	while (_length && _buffer[_position] != FDJ_MESSAGE_START_CHARACTER) {
+		bufferGet();
+	}
+
+	//non è presente un messaggio
+	if (!_length) {
+		return 0;
+	}
+
+	//scarto il carattere di inizio
+	bufferGet();
+
+	//copio i caratteri fino al carattere di fine
+	while (_length) {
+
+		char c = bufferGet();
+
+		//messaggio terminato
+		if (c == FDJ_MESSAGE_FINISH_CHARACTER) {
+
+			//se il messaggio non sta nel buffer di ritorno non è valido
+			if (position >= size) {
+				buffer[0] = 0;
+				return 0;
+			}
+
+			buffer[position] = 0;
+
+			return position;
+		}
+
+		//inizio di un nuovo messaggio, quello corrente era troncato
+		if (c == FDJ_MESSAGE_START_CHARACTER) {
+			position = 0;
+			continue;
+		}
+
+		//inserisco il carattere (se c'è spazio)
+		if (position < size) {
+			buffer[position++] = c;
+		}
+	}
+
+	//messaggio non valido
+	buffer[0] = 0;
+
+	return 0;
+}
+
+
+/**
+ * @brief Metodo che restituisce il file descriptor
+ *
+ * @return Il file descriptor
+ */
+int FileDescriptorJack::fd() {
+	return _fd;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di messaggi completi (già letti dal file descriptor) nel buffer
+ *
+ * @return Il numero di messaggi completi
+ */
+size_t FileDescriptorJack::frames() {
+	return _frames;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di caratteri in attesa di essere scritti
+ *
+ * @return Il numero di caratteri in attesa
+ */
+size_t FileDescriptorJack::pendingOutput() {
+	return _outputLength;
+}
+
+/**
+ * @brief Metodo che scrive nel file descriptor i caratteri in attesa
+ *
+ * @return true se sono stati scritti tutti i caratteri
+ */
+bool FileDescriptorJack::flush() {
+
+	size_t written = 0;
+
+	//scrivo finchè il file descriptor accetta dati
+	while (written < _outputLength) {
+
+		ssize_t n = write(_fd, _output + written, _outputLength - written);
+
+		if (n < 0) {
+
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				_closed = 1;
+			}
+
+			break;
+		}
+
+		written += n;
+	}
+
+	//sposto in testa i dati non scritti
+	memmove(_output, _output + written, _outputLength - written);
+	_outputLength -= written;
+
+	return _outputLength == 0;
+}
+
+/**
+ * @brief Metodo che indica se il file descriptor è stato chiuso dall'altro capo
+ *
+ * @return true se il file descriptor è stato chiuso
+ */
+bool FileDescriptorJack::closed() {
+	return _closed;
+}
+
+/**
+ * @brief Metodo che imposta la cattura dei caratteri letti e scritti
+ *
+ * Vengono registrati i blocchi letti dal file descriptor (prima del framing) e i messaggi inviati con i
+ * delimitatori. La cattura non viene chiusa dal mezzo di trasmissione.
+ *
+ * @param capture Cattura aperta (NULL per disattivarla)
+ */
+void FileDescriptorJack::setCapture(WireCapture *capture) {
+	_capture = capture;
+}
+
+
+//---PRIVATE---
+
+//inserisce il dato nel buffer
+void FileDescriptorJack::bufferPut(char c) {
+
+	//se il buffer ha spazio disponibile
+	if (_length < _size) {
+
+		_buffer[(_position + _length++) % _size] = c; //salvo il dato
+
+		//conto i messaggi completi
+		if (c == FDJ_MESSAGE_FINISH_CHARACTER) {
+			_frames++;
+		}
+	}
+}
+
+//restituisce il dato alla posizione corrente
+char FileDescriptorJack::bufferGet() {
+
+	char c = _buffer[_position]; //recupero il dato memorizzato
+
+	//aggiorno la posizione di testa
+	_position = (_position + 1) % _size;
+	_length--;
+
+	//conto i messaggi completi
+	if (c == FDJ_MESSAGE_FINISH_CHARACTER) {
+		_frames--;
+	}
+
+	return c; //ritorno il dato salvato
+}
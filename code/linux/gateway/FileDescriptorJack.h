@@ -0,0 +1,112 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file FileDescriptorJack.h
+ * @brief Mezzo di trasmissione per Jack basato su file descriptor non bloccanti (tty, pty, socket)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef FILEDESCRIPTORJACK_H
+#define FILEDESCRIPTORJACK_H
+
+#include <Arduino.h>
+
+//---COSTANTI---
+/**
+ * @brief Indica il carattere deliminatore di inizio del messaggio (uguale a SoftwareSerialJack)
+ */
+#define FDJ_MESSAGE_START_CHARACTER '<' //carattere di inzio messaggio
+/**
+ * @brief Indica il carattere deliminatore di fine del messaggio (uguale a SoftwareSerialJack)
+ */
+#define FDJ_MESSAGE_FINISH_CHARACTER '>' //carattere di fine messaggio
+
+/**
+ * @brief Dimensione del buffer di ricezione
+ */
+#define FDJ_BUFFER_SIZE 4096
+/**
+ * @brief Dimensione massima dei dati in attesa di essere scritti nel file descriptor
+ */
+#define FDJ_OUTPUT_BUFFER_SIZE 65536
+
+
+class WireCapture;
+
+//mezzo di trasmissione di Jack (parametro del template di BasicJack)
+class FileDescriptorJack {
+
+	public:
+
+		FileDescriptorJack(int fd, size_t bufferSize); //costruttore con la scelta della dimensione del buffer
+		FileDescriptorJack(int fd); //costruttore
+		~FileDescriptorJack();
+
+		size_t receive(char *buffer, size_t size); //metodo che inserisce il messaggio in un buffer e restituisce la dimensione del messaggio
+		void send(char *message, size_t length); //invia il messaggio
+
+		size_t available(); //legge il file descriptor e restituisce i caratteri disponibili
+
+		//gestione del file descriptor
+		int fd(); //restituisce il file descriptor
+		size_t frames(); //numero di messaggi completi presenti nel buffer
+		size_t pendingOutput(); //numero di caratteri in attesa di essere scritti
+		bool flush(); //scrive i caratteri in attesa (true se sono stati scritti tutti)
+		bool closed(); //indica se il file descriptor è stato chiuso dall'altro capo
+
+		//cattura dei caratteri letti e scritti
+		void setCapture(WireCapture *capture); //imposta la cattura (NULL = nessuna cattura)
+
+		//costanti note a tempo di compilazione (usate da BasicJack)
+		static const size_t BUFFER_SIZE = FDJ_BUFFER_SIZE; //dimensione di default del buffer di ricezione
+		static const size_t MTU = FDJ_BUFFER_SIZE - 2; //lunghezza massima di un messaggio con il buffer di default (delimitatori esclusi)
+
+
+	private:
+
+		void bufferPut(char c); //inserisce il dato nel buffer
+		char bufferGet(); //restituisce il dato alla posizione corrente
+
+		int _fd; //file descriptor
+
+		//buffer circolare di ricezione
+		char *_buffer; //puntatore al buffer
+		size_t _size; //dimensione del buffer
+		size_t _position; //posizione di testa del buffer
+		size_t _length; //quantità di dati memorizzati nel buffer
+		size_t _frames; //numero di caratteri di fine messaggio presenti nel buffer
+
+		//buffer di uscita (usato quando il file descriptor non accetta altri dati)
+		char *_output; //dati in attesa
+		size_t _outputLength; //quantità di dati in attesa
+
+		uint8_t _closed; //indica se il file descriptor è stato chiuso
+
+		WireCapture *_capture; //cattura dei caratteri (NULL se disattivata)
+
+};
+
+
+#endif //FILEDESCRIPTORJACK_H
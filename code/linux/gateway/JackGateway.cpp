@@ -0,0 +1,376 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JackGateway.cpp
+ * @brief Gateway Linux che riceve i messaggi Jack da più bracciali contemporaneamente (epoll)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include "JackGateway.h"
+
+
+//---VARIABILI STATICHE---
+JackGateway *JackGateway::_currentGateway = NULL;
+JGConnection *JackGateway::_currentConnection = NULL;
+
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ *
+ * @param onReceive Handler evento di ricezione di un nuovo messaggio da un dispositivo
+ * @param onReceiveAck Handler evento di ricezione della conferma di un messaggio inviato ad un dispositivo
+ * @param timerSendMessage Timer che controlla il reinvio dei messaggi non confermati (millisecondi)
+ */
+JackGateway::JackGateway(void (*onReceive)(JGConnection &, JData &, long), void (*onReceiveAck)(JGConnection &, long), long timerSendMessage) {
+
+	//salvo i puntatori a funzioni
+	_onReceive = onReceive;
+	_onReceiveAck = onReceiveAck;
+	_onDisconnect = NULL;
+
+	//imposto il timer
+	_timerSendMessage = timerSendMessage;
+
+	//inizializzo le variabili
+	_epoll = epoll_create1(EPOLL_CLOEXEC);
+	_timeLastTick = 0;
+	_running = 0;
+	_devices = 0;
+}
+
+/**
+ * @brief Costruttore della classe (ridotto)
+ *
+ * @param onReceive Handler evento di ricezione di un nuovo messaggio da un dispositivo
+ * @param onReceiveAck Handler evento di ricezione della conferma di un messaggio inviato ad un dispositivo
+ */
+JackGateway::JackGateway(void (*onReceive)(JGConnection &, JData &, long), void (*onReceiveAck)(JGConnection &, long)): JackGateway(onReceive, onReceiveAck, JK_TIMER_RESEND_MESSAGE) {}
+
+
+/**
+ * @brief Distruttore della classe
+ */
+JackGateway::~JackGateway() {
+
+	//rimuovo tutti i dispositivi
+	for (size_t i = 0; i < _connections.size(); i++) {
+		removeDevice(i);
+	}
+
+	close(_epoll);
+}
+
+
+/**
+ * @brief Metodo che aggiunge un dispositivo al gateway
+ *
+ * @param fd File descriptor del dispositivo (tty, pty o socket)
+ * @param name Nome del dispositivo
+ *
+ * @return Indice del dispositivo (-1 in caso di errore)
+ */
+int JackGateway::addDevice(int fd, const char *name) {
+
+	//creo la connessione
+	JGConnection *connection = new JGConnection();
+
+	connection->device = _connections.size();
+	connection->name = name;
+	connection->mmJTM = new FileDescriptorJack(fd);
+	connection->jack = new BasicJack<FileDescriptorJack>(*connection->mmJTM, &onReceiveDispatcher, &onReceiveAckDispatcher, &getMessageIDDispatcher, _timerSendMessage, 0); //il polling è guidato da epoll
+	connection->lastMessageID = (long) time(NULL) * 1000;
+	connection->framesReceived = 0;
+	connection->acksReceived = 0;
+	connection->writeWatched = 0;
+
+	//registro il file descriptor in epoll
+	struct epoll_event event;
+	event.events = EPOLLIN | EPOLLRDHUP;
+	event.data.ptr = connection;
+
+	if (epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event) < 0) {
+
+		delete connection->jack;
+		delete connection->mmJTM;
+		delete connection;
+
+		return -1;
+	}
+
+	//avvio jack
+	connection->jack->start();
+
+	_connections.push_back(connection);
+	_devices++;
+
+	return connection->device;
+}
+
+/**
+ * @brief Metodo che rimuove un dispositivo dal gateway (il file descriptor non viene chiuso)
+ *
+ * @param device Indice del dispositivo
+ */
+void JackGateway::removeDevice(int device) {
+
+	JGConnection *connection = this->connection(device);
+
+	//il dispositivo non esiste
+	if (connection == NULL) {
+		return;
+	}
+
+	//rimuovo il file descriptor da epoll
+	epoll_ctl(_epoll, EPOLL_CTL_DEL, connection->mmJTM->fd(), NULL);
+
+	//elimino la connessione
+	_connections[device] = NULL;
+	_devices--;
+
+	delete connection->jack;
+	delete connection->mmJTM;
+	delete connection;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di dispositivi collegati
+ *
+ * @return Numero di dispositivi collegati
+ */
+size_t JackGateway::devices() {
+	return _devices;
+}
+
+/**
+ * @brief Metodo che restituisce la connessione di un dispositivo
+ *
+ * @param device Indice del dispositivo
+ * @return La connessione (NULL se il dispositivo non esiste)
+ */
+JGConnection *JackGateway::connection(int device) {
+
+	if (device < 0 || (size_t) device >= _connections.size()) {
+		return NULL;
+	}
+
+	return _connections[device];
+}
+
+/**
+ * @brief Metodo che imposta l'handler dell'evento di disconnessione di un dispositivo
+ *
+ * L'handler viene chiamato prima della rimozione del dispositivo (può chiudere il file descriptor)
+ *
+ * @param onDisconnect Handler evento di disconnessione
+ */
+void JackGateway::setOnDisconnect(void (*onDisconnect)(JGConnection &)) {
+	_onDisconnect = onDisconnect;
+}
+
+
+/**
+ * @brief Metodo che inserisce un messaggio nel buffer di invio del dispositivo
+ *
+ * @param device Indice del dispositivo
+ * @param message Messaggio da inviare
+ *
+ * @return ID del messaggio (0 se il dispositivo non esiste o il suo buffer di invio è pieno)
+ */
+long JackGateway::send(int device, JData &message) {
+
+	JGConnection *connection = this->connection(device);
+
+	//il dispositivo non esiste
+	if (connection == NULL) {
+		return 0;
+	}
+
+	//imposto la connessione corrente (usata per generare l'id del messaggio): send() può essere chiamato dagli
+	//handler durante serve(), per cui al ritorno ripristino la connessione precedente
+	JackGateway *previousGateway = _currentGateway;
+	JGConnection *previousConnection = _currentConnection;
+
+	_currentGateway = this;
+	_currentConnection = connection;
+
+	long id = connection->jack->send(message);
+
+	_currentGateway = previousGateway;
+	_currentConnection = previousConnection;
+
+	return id;
+}
+
+
+/**
+ * @brief Metodo che esegue un'iterazione del loop degli eventi
+ *
+ * @param timeout Tempo massimo di attesa degli eventi (millisecondi)
+ * @return Numero di eventi gestiti (-1 in caso di errore)
+ */
+int JackGateway::runOnce(int timeout) {
+
+	struct epoll_event events[JG_MAX_EVENTS];
+
+	//attendo gli eventi (al massimo fino al prossimo tick)
+	int n = epoll_wait(_epoll, events, JG_MAX_EVENTS, timeout < JG_TIMER_TICK ? timeout : JG_TIMER_TICK);
+
+	if (n < 0) {
+		return errno == EINTR ? 0 : -1;
+	}
+
+	//gestisco gli eventi
+	for (int i = 0; i < n; i++) {
+
+		JGConnection *connection = (JGConnection *) events[i].data.ptr;
+
+		//il dispositivo ha dati da scrivere
+		if (events[i].events & EPOLLOUT) {
+			connection->mmJTM->flush();
+		}
+
+		//il dispositivo ha inviato dati (o ha chiuso la connessione)
+		if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+			serve(connection);
+		}
+
+		//il dispositivo si è disconnesso
+		if (connection->mmJTM->closed()) {
+
+			if (_onDisconnect != NULL) {
+				(*_onDisconnect)(*connection);
+			}
+
+			removeDevice(connection->device);
+
+			continue;
+		}
+
+		watchWrite(connection);
+	}
+
+	//a intervalli regolari eseguo il loop di tutte le connessioni (reinvio dei messaggi non confermati)
+	if (millis() - _timeLastTick >= JG_TIMER_TICK) {
+
+		_timeLastTick = millis();
+
+		for (size_t i = 0; i < _connections.size(); i++) {
+
+			if (_connections[i] != NULL) {
+				serve(_connections[i]);
+				watchWrite(_connections[i]);
+			}
+		}
+	}
+
+	return n;
+}
+
+/**
+ * @brief Metodo che esegue il loop degli eventi fino alla chiamata di stop()
+ */
+void JackGateway::run() {
+
+	_running = 1;
+
+	while (_running && runOnce(JG_TIMER_TICK) >= 0)
+		;
+}
+
+/**
+ * @brief Metodo che ferma il loop degli eventi
+ */
+void JackGateway::stop() {
+	_running = 0;
+}
+
+
+//---PRIVATE---
+
+//esegue il loop di Jack della connessione finchè ci sono messaggi completi
+void JackGateway::serve(JGConnection *connection) {
+
+	//imposto la connessione corrente per gli handler
+	_currentGateway = this;
+	_currentConnection = connection;
+
+	//il primo loop legge il file descriptor, i successivi elaborano i messaggi rimasti
+	do {
+		connection->jack->loop();
+	} while (connection->mmJTM->frames());
+
+	_currentConnection = NULL;
+}
+
+//aggiorna l'interesse in scrittura di epoll in base ai dati in attesa
+void JackGateway::watchWrite(JGConnection *connection) {
+
+	uint8_t pending = connection->mmJTM->pendingOutput() > 0;
+
+	//l'interesse è già corretto
+	if (pending == connection->writeWatched) {
+		return;
+	}
+
+	struct epoll_event event;
+	event.events = EPOLLIN | EPOLLRDHUP | (pending ? (uint32_t) EPOLLOUT : 0);
+	event.data.ptr = connection;
+
+	epoll_ctl(_epoll, EPOLL_CTL_MOD, connection->mmJTM->fd(), &event);
+
+	connection->writeWatched = pending;
+}
+
+
+//---DISPATCHER---
+
+//instrada il messaggio ricevuto all'handler del gateway
+void JackGateway::onReceiveDispatcher(JData &message, long id) {
+
+	_currentConnection->framesReceived++;
+
+	(*_currentGateway->_onReceive)(*_currentConnection, message, id);
+}
+
+//instrada la conferma ricevuta all'handler del gateway
+void JackGateway::onReceiveAckDispatcher(long id) {
+
+	_currentConnection->acksReceived++;
+
+	if (_currentGateway->_onReceiveAck != NULL) {
+		(*_currentGateway->_onReceiveAck)(*_currentConnection, id);
+	}
+}
+
+//genera l'id univoco dei messaggi inviati alla connessione corrente
+long JackGateway::getMessageIDDispatcher() {
+	return ++_currentConnection->lastMessageID;
+}
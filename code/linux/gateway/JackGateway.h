@@ -0,0 +1,127 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JackGateway.h
+ * @brief Gateway Linux che riceve i messaggi Jack da più bracciali contemporaneamente (epoll)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef JACKGATEWAY_H
+#define JACKGATEWAY_H
+
+#include <Arduino.h>
+#include <Jack.h>
+#include <vector>
+#include "FileDescriptorJack.h"
+
+//---COSTANTI---
+/**
+ * @brief Intervallo massimo (millisecondi) tra due esecuzioni del loop di Jack di ogni connessione
+ */
+#define JG_TIMER_TICK 100
+/**
+ * @brief Numero massimo di eventi prelevati da epoll per ogni iterazione
+ */
+#define JG_MAX_EVENTS 64
+
+
+//---CONNESSIONE---
+/**
+ * @brief Stato di un bracciale collegato al gateway (ogni connessione ha la sua istanza di Jack)
+ */
+struct JGConnection {
+	int device; //indice del dispositivo
+	String name; //nome del dispositivo (es. percorso della tty)
+	FileDescriptorJack *mmJTM; //mezzo di trasmissione
+	BasicJack<FileDescriptorJack> *jack; //istanza di Jack della connessione (mezzo di trasmissione noto a tempo di compilazione)
+	long lastMessageID; //ultimo id usato per i messaggi inviati
+	unsigned long framesReceived; //messaggi dati ricevuti
+	unsigned long acksReceived; //conferme ricevute
+	uint8_t writeWatched; //indica se epoll controlla la scrittura
+};
+
+
+//---JACK GATEWAY---
+class JackGateway {
+
+	public:
+
+		//costruttori
+		JackGateway(void (*onReceive)(JGConnection &, JData &, long), void (*onReceiveAck)(JGConnection &, long)); //costruttore con gli handler
+		JackGateway(void (*onReceive)(JGConnection &, JData &, long), void (*onReceiveAck)(JGConnection &, long), long timerSendMessage); //costruttore con il timer di reinvio
+
+		//distruttore
+		~JackGateway();
+
+		//gestione dei dispositivi
+		int addDevice(int fd, const char *name); //aggiunge un dispositivo e ne restituisce l'indice
+		void removeDevice(int device); //rimuove un dispositivo (il file descriptor non viene chiuso)
+		size_t devices(); //numero di dispositivi collegati
+		JGConnection *connection(int device); //restituisce la connessione del dispositivo
+
+		//handler di disconnessione
+		void setOnDisconnect(void (*onDisconnect)(JGConnection &)); //imposta l'handler di disconnessione
+
+		//invio messaggi
+		long send(int device, JData &message); //invia il messaggio al dispositivo
+
+		//loop
+		int runOnce(int timeout); //esegue un'iterazione del loop degli eventi
+		void run(); //esegue il loop degli eventi fino a stop()
+		void stop(); //ferma il loop degli eventi
+
+
+	private:
+
+		//gestione degli eventi della connessione
+		void serve(JGConnection *connection); //esegue il loop di Jack della connessione
+		void watchWrite(JGConnection *connection); //aggiorna l'interesse in scrittura di epoll
+
+		//funzioni passate alle istanze di Jack (instradano gli eventi alla connessione corrente)
+		static void onReceiveDispatcher(JData &message, long id);
+		static void onReceiveAckDispatcher(long id);
+		static long getMessageIDDispatcher();
+
+		//connessione attualmente servita (il loop è a singolo thread)
+		static JackGateway *_currentGateway;
+		static JGConnection *_currentConnection;
+
+		int _epoll; //file descriptor di epoll
+		long _timerSendMessage; //tempo (ms) da attendere prima di reinviare i messaggi non confermati
+		unsigned long _timeLastTick; //ultima esecuzione del loop di tutte le connessioni
+		volatile uint8_t _running; //indica se il loop è in esecuzione
+
+		std::vector<JGConnection *> _connections; //connessioni (indicizzate per dispositivo)
+		size_t _devices; //numero di dispositivi collegati
+
+		//puntatori a funzioni esterne
+		void (*_onReceive)(JGConnection &, JData &, long);
+		void (*_onReceiveAck)(JGConnection &, long);
+		void (*_onDisconnect)(JGConnection &);
+
+};
+
+
+#endif //JACKGATEWAY_H
@@ -0,0 +1,278 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LeweGateway.cpp
+ * @brief Demone Linux che raccoglie le letture di più bracciali Lewe collegati come tty (seriale o bridge BLE)
+ *
+ * Uso: lewe-gateway [-b baudrate] [-s archivio] [-c cartella] /dev/ttyUSB0 /dev/ttyUSB1 ...
+ *
+ * Le letture ricevute vengono stampate su stdout nel formato CSV: dispositivo,id,TMP,GSR,TME
+ * oppure, se è indicata la cartella dell'archivio, memorizzate nei segmenti di ReadingStore
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+#include "JackGateway.h"
+#include "WireCapture.h"
+#include "../store/ReadingStore.h"
+
+
+//---COSTANTI---
+
+//CHIAVI PER IL MESSAGGIO (uguali al firmware)
+/**
+ * @brief Chiave per il messaggio Jack (Timespamp)
+ */
+#define TIMESTAMP_KEY "TMP" //chiave per timestamp (TiMetamP)
+/**
+ * @brief Chiave per il messaggio Jack (GSR)
+ */
+#define GSR_KEY "GSR" //chiave per gsr (GSR)
+/**
+ * @brief Chiave per il messaggio Jack (Temperatura)
+ */
+#define TEMPERATURE_KEY "TME" //chiave per temperatura (TeMperaturE)
+
+/**
+ * @brief Baudrate di default delle tty (uguale a quello del modulo HM-10)
+ */
+#define DEFAULT_BAUDRATE 9600
+
+
+//---VARIABILI---
+/**
+ * @brief Istanza del gateway
+ */
+JackGateway *gateway;
+/**
+ * @brief Archivio delle letture (NULL se le letture vengono stampate)
+ */
+ReadingStore *store = NULL;
+/**
+ * @brief Cartella delle catture delle tty (NULL se le tty non vengono catturate)
+ */
+const char *captureDirectory = NULL;
+/**
+ * @brief Catture delle tty (una per dispositivo)
+ */
+std::vector<WireCapture *> captures;
+
+
+//---HANDLER GATEWAY---
+/**
+ * @brief Handler dell'evento di ricezione di un nuovo messaggio da un bracciale
+ *
+ * @param connection Connessione del bracciale
+ * @param message Messaggio ricevuto
+ * @param id ID del messaggio ricevuto
+ */
+void onReceive(JGConnection &connection, JData &message, long id) {
+
+	//solo le letture (risposte fasiche, consumi e traccia non contengono nessun sensore)
+	if (!message.containsKey(GSR_KEY) && !message.containsKey(TEMPERATURE_KEY)) {
+		return;
+	}
+
+	//memorizzo la lettura nell'archivio
+	if (store != NULL) {
+		store->append(connection.device, message);
+		return;
+	}
+
+	long timestamp = message.get(TIMESTAMP_KEY);
+	int gsr = message.get(GSR_KEY);
+	double temperature = message.get(TEMPERATURE_KEY);
+
+	printf("%s,%ld,%ld,%d,%.1f\n", connection.name.c_str(), id, timestamp, gsr, temperature);
+	fflush(stdout);
+}
+
+/**
+ * @brief Handler dell'evento di disconnessione di un bracciale
+ *
+ * @param connection Connessione del bracciale
+ */
+void onDisconnect(JGConnection &connection) {
+
+	fprintf(stderr, "%s: disconnesso\n", connection.name.c_str());
+
+	//chiudo la tty
+	close(connection.mmJTM->fd());
+}
+
+/**
+ * @brief Handler dei segnali di terminazione
+ */
+void onSignal(int signal) {
+
+	//SIGINT e SIGTERM fermano il gateway allo stesso modo
+	(void) signal;
+
+	gateway->stop();
+}
+
+
+//---TTY---
+/**
+ * @brief Funzione che converte il baudrate nella costante di termios
+ */
+speed_t baudrateToSpeed(long baudrate) {
+
+	switch (baudrate) {
+		case 1200: return B1200;
+		case 2400: return B2400;
+		case 4800: return B4800;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		default: return B9600;
+	}
+}
+
+/**
+ * @brief Funzione che apre e configura una tty in modalità raw
+ *
+ * @param path Percorso della tty
+ * @param baudrate Baudrate della tty
+ *
+ * @return File descriptor della tty (-1 in caso di errore)
+ */
+int openTTY(const char *path, long baudrate) {
+
+	int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+
+	if (fd < 0) {
+		return -1;
+	}
+
+	struct termios options;
+
+	//se non è una tty (es. pipe o socket) la uso così com'è
+	if (tcgetattr(fd, &options) == 0) {
+
+		//modalità raw 8N1
+		cfmakeraw(&options);
+		cfsetispeed(&options, baudrateToSpeed(baudrate));
+		cfsetospeed(&options, baudrateToSpeed(baudrate));
+		options.c_cflag |= CLOCAL | CREAD;
+
+		tcsetattr(fd, TCSANOW, &options);
+	}
+
+	return fd;
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	long baudrate = DEFAULT_BAUDRATE;
+	int opt;
+
+	//leggo le opzioni
+	while ((opt = getopt(argc, argv, "b:s:c:")) != -1) {
+
+		if (opt == 'b') {
+			baudrate = atol(optarg);
+		} else if (opt == 's') {
+			store = new ReadingStore(optarg);
+		} else if (opt == 'c') {
+			captureDirectory = optarg;
+		} else {
+			fprintf(stderr, "uso: %s [-b baudrate] [-s archivio] [-c cartella] tty...\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind >= argc) {
+		fprintf(stderr, "uso: %s [-b baudrate] [-s archivio] [-c cartella] tty...\n", argv[0]);
+		return 1;
+	}
+
+	//apro l'archivio
+	if (store != NULL && !store->open()) {
+		perror("archivio");
+		return 1;
+	}
+
+	//creo il gateway
+	gateway = new JackGateway(&onReceive, NULL);
+	gateway->setOnDisconnect(&onDisconnect);
+
+	//apro le tty
+	for (int i = optind; i < argc; i++) {
+
+		int fd = openTTY(argv[i], baudrate);
+		int device;
+
+		if (fd < 0 || (device = gateway->addDevice(fd, argv[i])) < 0) {
+			perror(argv[i]);
+			continue;
+		}
+
+		//catturo i caratteri della tty in cartella/<dispositivo>.lwcap
+		if (captureDirectory != NULL) {
+
+			char name[32];
+
+			snprintf(name, sizeof(name), "/%d.lwcap", device);
+
+			String path = String(captureDirectory) + name;
+			WireCapture *capture = new WireCapture(path.c_str());
+
+			if (!capture->open()) {
+				perror(path.c_str());
+				delete capture;
+				continue;
+			}
+
+			gateway->connection(device)->mmJTM->setCapture(capture);
+			captures.push_back(capture);
+		}
+	}
+
+	//gestisco i segnali di terminazione
+	signal(SIGINT, &onSignal);
+	signal(SIGTERM, &onSignal);
+
+	//eseguo il loop degli eventi
+	gateway->run();
+
+	delete gateway;
+	delete store;
+
+	//chiudo le catture
+	for (size_t i = 0; i < captures.size(); i++) {
+		delete captures[i];
+	}
+
+	return 0;
+}
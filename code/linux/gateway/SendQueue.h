@@ -0,0 +1,203 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file SendQueue.h
+ * @brief Coda limitata senza lock con più produttori e un consumatore per i messaggi già serializzati
+ *
+ * Ogni cella ha un numero di sequenza: un produttore prenota la cella con una compare-and-swap sull'indice
+ * di inserimento, ci serializza il messaggio e la pubblica aggiornando la sequenza; il consumatore legge le
+ * celle pubblicate in ordine di prenotazione. Nessun produttore attende gli altri (la coda piena restituisce
+ * NULL); il consumatore attende solo la pubblicazione della cella in testa.
+ *
+ * La coda non alloca memoria: le celle sono SQ_CAPACITY (potenza di due).
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef SENDQUEUE_H
+#define SENDQUEUE_H
+
+#include <Arduino.h>
+#include <JConfig.h>
+#include <atomic>
+
+//---COSTANTI---
+/**
+ * @brief Numero di celle della coda (potenza di due)
+ */
+#ifndef SQ_CAPACITY
+#define SQ_CAPACITY 1024
+#endif
+/**
+ * @brief Dimensione della linea di cache (separa gli indici di produttori e consumatore)
+ */
+#define SQ_CACHE_LINE 64
+
+static_assert((SQ_CAPACITY & (SQ_CAPACITY - 1)) == 0, "SQ_CAPACITY deve essere una potenza di due");
+
+
+//---CELLA---
+/**
+ * @brief Messaggio in coda (serializzato dal produttore)
+ */
+struct SQCell {
+	std::atomic<size_t> sequence; //sequenza: posizione se libera, posizione + 1 se pubblicata
+	size_t position; //posizione prenotata dal produttore
+	long id; //id del messaggio
+	unsigned long ttl; //durata del messaggio (millisecondi, 0 = non scade)
+	uint16_t length; //lunghezza del messaggio (0 = messaggio non valido, viene scartato)
+	char frame[JK_MAX_MESSAGE_LENGTH]; //messaggio serializzato
+};
+
+
+//---SEND QUEUE---
+class SendQueue {
+
+	public:
+
+		SendQueue(); //costruttore
+
+		//produttori (qualsiasi thread)
+		SQCell *claim(); //prenota una cella (NULL se la coda è piena)
+		void publish(SQCell *cell); //rende la cella visibile al consumatore
+
+		//consumatore (un solo thread)
+		SQCell *front(); //cella pubblicata in testa (NULL se la coda è vuota o la testa non è ancora pubblicata)
+		void pop(); //libera la cella in testa
+
+		size_t size(); //celle prenotate e non ancora liberate (approssimato se ci sono produttori attivi)
+
+
+	private:
+
+		SQCell _cells[SQ_CAPACITY]; //celle
+
+		alignas(SQ_CACHE_LINE) std::atomic<size_t> _enqueue; //prossima posizione da prenotare
+		alignas(SQ_CACHE_LINE) std::atomic<size_t> _dequeue; //posizione della testa (scritta solo dal consumatore)
+
+};
+
+
+//---IMPLEMENTAZIONE---
+
+/**
+ * @brief Costruttore della classe
+ */
+inline SendQueue::SendQueue() {
+
+	for (size_t i = 0; i < SQ_CAPACITY; i++) {
+		_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	_enqueue.store(0, std::memory_order_relaxed);
+	_dequeue.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Metodo che prenota una cella (la cella va sempre pubblicata, anche se il messaggio non è valido)
+ *
+ * @return Cella prenotata (NULL se la coda è piena)
+ */
+inline SQCell *SendQueue::claim() {
+
+	size_t position = _enqueue.load(std::memory_order_relaxed);
+
+	for (;;) {
+
+		SQCell *cell = &_cells[position & (SQ_CAPACITY - 1)];
+
+		intptr_t difference = (intptr_t) cell->sequence.load(std::memory_order_acquire) - (intptr_t) position;
+
+		//cella libera: la prenoto se nessun altro produttore l'ha presa nel frattempo
+		if (difference == 0) {
+
+			if (_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				cell->position = position;
+				return cell;
+			}
+
+		//la cella non è ancora stata liberata dal consumatore: coda piena
+		} else if (difference < 0) {
+
+			return NULL;
+
+		//un altro produttore ha prenotato la cella
+		} else {
+
+			position = _enqueue.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+/**
+ * @brief Metodo che pubblica la cella prenotata
+ *
+ * @param cell Cella ottenuta con claim()
+ */
+inline void SendQueue::publish(SQCell *cell) {
+	cell->sequence.store(cell->position + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Metodo che restituisce la cella in testa se è già stata pubblicata
+ *
+ * @return Cella in testa (NULL se non c'è)
+ */
+inline SQCell *SendQueue::front() {
+
+	size_t position = _dequeue.load(std::memory_order_relaxed);
+
+	SQCell *cell = &_cells[position & (SQ_CAPACITY - 1)];
+
+	if (cell->sequence.load(std::memory_order_acquire) != position + 1) {
+		return NULL;
+	}
+
+	return cell;
+}
+
+/**
+ * @brief Metodo che libera la cella in testa (da chiamare dopo front())
+ */
+inline void SendQueue::pop() {
+
+	size_t position = _dequeue.load(std::memory_order_relaxed);
+
+	//la cella torna disponibile al giro successivo
+	_cells[position & (SQ_CAPACITY - 1)].sequence.store(position + SQ_CAPACITY, std::memory_order_release);
+
+	_dequeue.store(position + 1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Metodo che restituisce il numero di celle in uso
+ *
+ * @return Celle prenotate e non ancora liberate
+ */
+inline size_t SendQueue::size() {
+	return _enqueue.load(std::memory_order_relaxed) - _dequeue.load(std::memory_order_relaxed);
+}
+
+
+#endif //SENDQUEUE_H
@@ -0,0 +1,341 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file WireCapture.cpp
+ * @brief Cattura dei caratteri scambiati su un mezzo di trasmissione (file compatto con i tempi di arrivo)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "WireCapture.h"
+
+
+//---WIRE CAPTURE---
+
+/**
+ * @brief Costruttore della classe (il file viene creato da open())
+ *
+ * @param path Percorso del file della cattura
+ */
+WireCapture::WireCapture(const char *path) {
+
+	_path = path;
+	_file = NULL;
+	_timeLast = 0;
+	_records = 0;
+	_bytes = 0;
+}
+
+//distruttore
+WireCapture::~WireCapture() {
+	close();
+}
+
+
+/**
+ * @brief Metodo che crea il file della cattura (sovrascrive quello esistente) e scrive l'intestazione
+ *
+ * @return true se il file è stato creato
+ */
+bool WireCapture::open() {
+
+	_file = fopen(_path.c_str(), "wbe");
+
+	if (_file == NULL) {
+		return false;
+	}
+
+	struct timespec now;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	WCHeader header;
+
+	memcpy(header.magic, WC_MAGIC, sizeof(header.magic));
+	header.start = (uint64_t) now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+
+	//il primo record parte dall'inizio della cattura
+	_timeLast = micros();
+	_records = 0;
+	_bytes = fwrite(&header, 1, sizeof(header), _file);
+
+	return _bytes == sizeof(header);
+}
+
+/**
+ * @brief Metodo che scrive i record bufferizzati e chiude il file
+ */
+void WireCapture::close() {
+
+	if (_file != NULL) {
+		fclose(_file);
+		_file = NULL;
+	}
+}
+
+
+/**
+ * @brief Metodo che registra un blocco di caratteri letto o scritto dal mezzo di trasmissione
+ *
+ * @param direction Direzione dei caratteri (WC_RECEIVED o WC_SENT)
+ * @param data Caratteri
+ * @param length Numero di caratteri
+ */
+void WireCapture::record(uint8_t direction, const char *data, size_t length) {
+
+	if (_file == NULL || length == 0) {
+		return;
+	}
+
+	unsigned long now = micros();
+
+	//tempo dal record precedente e lunghezza con la direzione
+	putVarint((unsigned long) (now - _timeLast));
+	putVarint(((uint64_t) length << 1) | (direction & 1));
+
+	_bytes += fwrite(data, 1, length, _file);
+	_timeLast = now;
+	_records++;
+}
+
+/**
+ * @brief Metodo che scrive nel file i record bufferizzati
+ *
+ * @return true se la scrittura è riuscita
+ */
+bool WireCapture::flush() {
+	return _file != NULL && fflush(_file) == 0;
+}
+
+
+/**
+ * @brief Metodo che restituisce il numero di record scritti
+ *
+ * @return Record scritti
+ */
+unsigned long WireCapture::records() {
+	return _records;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di byte scritti (intestazione compresa)
+ *
+ * @return Byte scritti
+ */
+unsigned long long WireCapture::bytes() {
+	return _bytes;
+}
+
+
+//scrive un varint (7 bit per byte, little-endian)
+void WireCapture::putVarint(uint64_t value) {
+
+	uint8_t encoded[10];
+	size_t length = 0;
+
+	while (value >= 0x80) {
+		encoded[length++] = (uint8_t) (value | 0x80);
+		value >>= 7;
+	}
+
+	encoded[length++] = (uint8_t) value;
+
+	_bytes += fwrite(encoded, 1, length, _file);
+}
+
+
+//---WIRE CAPTURE READER---
+
+/**
+ * @brief Costruttore della classe (il file viene mappato da open())
+ *
+ * @param path Percorso del file della cattura
+ */
+WireCaptureReader::WireCaptureReader(const char *path) {
+
+	_path = path;
+	_base = NULL;
+	_size = 0;
+	_position = 0;
+	_time = 0;
+	_truncated = 0;
+}
+
+//distruttore
+WireCaptureReader::~WireCaptureReader() {
+
+	if (_base != NULL) {
+		munmap((void *) _base, _size);
+	}
+}
+
+
+/**
+ * @brief Metodo che mappa in memoria il file della cattura e ne verifica l'intestazione
+ *
+ * @return true se il file è una cattura valida
+ */
+bool WireCaptureReader::open() {
+
+	int fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat info;
+
+	if (fstat(fd, &info) < 0 || (size_t) info.st_size < sizeof(WCHeader)) {
+		::close(fd);
+		return false;
+	}
+
+	void *base = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	//la mappatura resta valida dopo la chiusura del file
+	::close(fd);
+
+	if (base == MAP_FAILED) {
+		return false;
+	}
+
+	_base = (const char *) base;
+	_size = info.st_size;
+
+	//lettura sequenziale
+	madvise(base, _size, MADV_SEQUENTIAL);
+
+	if (memcmp(_base, WC_MAGIC, sizeof(((WCHeader *) NULL)->magic)) != 0) {
+		return false;
+	}
+
+	rewind();
+
+	return true;
+}
+
+
+/**
+ * @brief Metodo che legge il record successivo
+ *
+ * I caratteri del record restano nella mappatura del file (validi finchè il lettore esiste).
+ *
+ * @param record Record letto
+ *
+ * @return true se è stato letto un record (false alla fine della cattura o su un record incompleto)
+ */
+bool WireCaptureReader::next(WCRecord &record) {
+
+	if (_base == NULL || _position >= _size) {
+		return false;
+	}
+
+	uint64_t delta, header;
+
+	//record incompleto (es. cattura interrotta durante la scrittura)
+	if (!getVarint(delta) || !getVarint(header) || (header >> 1) > _size - _position) {
+		_truncated = 1;
+		_position = _size;
+		return false;
+	}
+
+	_time += delta;
+
+	record.time = _time;
+	record.direction = header & 1;
+	record.length = header >> 1;
+	record.data = _base + _position;
+
+	_position += record.length;
+
+	return true;
+}
+
+/**
+ * @brief Metodo che riporta la lettura al primo record
+ */
+void WireCaptureReader::rewind() {
+
+	_position = sizeof(WCHeader);
+	_time = 0;
+	_truncated = 0;
+}
+
+
+/**
+ * @brief Metodo che restituisce l'inizio della cattura
+ *
+ * @return Microsecondi dall'epoch
+ */
+uint64_t WireCaptureReader::start() {
+
+	WCHeader header;
+
+	memcpy(&header, _base, sizeof(header));
+
+	return header.start;
+}
+
+/**
+ * @brief Metodo che restituisce la dimensione del file della cattura
+ *
+ * @return Dimensione in byte
+ */
+size_t WireCaptureReader::size() {
+	return _size;
+}
+
+/**
+ * @brief Metodo che indica se la lettura si è fermata su un record incompleto
+ *
+ * @return true se l'ultimo record è incompleto
+ */
+bool WireCaptureReader::truncated() {
+	return _truncated;
+}
+
+
+//legge un varint (false se il file finisce prima dell'ultimo byte)
+bool WireCaptureReader::getVarint(uint64_t &value) {
+
+	value = 0;
+
+	for (int shift = 0; shift < 64 && _position < _size; shift += 7) {
+
+		uint8_t c = (uint8_t) _base[_position++];
+
+		value |= (uint64_t) (c & 0x7F) << shift;
+
+		if (!(c & 0x80)) {
+			return true;
+		}
+	}
+
+	return false;
+}
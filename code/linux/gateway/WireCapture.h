@@ -0,0 +1,147 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file WireCapture.h
+ * @brief Cattura dei caratteri scambiati su un mezzo di trasmissione (file compatto con i tempi di arrivo)
+ *
+ * Il file è formato da un'intestazione (WCHeader) seguita da un record per ogni blocco di caratteri letto o
+ * scritto dal mezzo di trasmissione:
+ * - microsecondi trascorsi dal record precedente (varint)
+ * - lunghezza del blocco << 1 | direzione (varint, WC_RECEIVED o WC_SENT)
+ * - caratteri del blocco
+ *
+ * I varint sono in little-endian, 7 bit per byte (il bit alto indica che segue un altro byte): un blocco di
+ * meno di 64 caratteri arrivato entro 16 ms occupa 3 byte oltre ai caratteri.
+ * Le catture vengono lette da WireCaptureReader (file mappato in memoria).
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef WIRECAPTURE_H
+#define WIRECAPTURE_H
+
+#include <Arduino.h>
+#include <stdio.h>
+
+//---COSTANTI---
+/**
+ * @brief Identificativo del formato delle catture
+ */
+#define WC_MAGIC "LWCAP001"
+/**
+ * @brief Caratteri ricevuti dal mezzo di trasmissione
+ */
+#define WC_RECEIVED 0
+/**
+ * @brief Caratteri inviati dal mezzo di trasmissione
+ */
+#define WC_SENT 1
+
+
+//---TIPI---
+/**
+ * @brief Intestazione della cattura (all'inizio del file)
+ */
+struct WCHeader {
+	char magic[8]; //identificativo del formato
+	uint64_t start; //inizio della cattura (microsecondi dall'epoch)
+};
+
+/**
+ * @brief Blocco di caratteri della cattura
+ */
+struct WCRecord {
+	uint64_t time; //microsecondi dall'inizio della cattura
+	uint8_t direction; //direzione (WC_RECEIVED o WC_SENT)
+	size_t length; //numero di caratteri
+	const char *data; //caratteri (nella mappatura del file)
+};
+
+
+//---WIRE CAPTURE---
+//scrittura della cattura (i record vengono bufferizzati da stdio)
+class WireCapture {
+
+	public:
+
+		WireCapture(const char *path); //costruttore
+		~WireCapture(); //distruttore (chiude il file)
+
+		bool open(); //crea il file e scrive l'intestazione
+		void close(); //scrive i record bufferizzati e chiude il file
+
+		void record(uint8_t direction, const char *data, size_t length); //registra un blocco di caratteri
+		bool flush(); //scrive i record bufferizzati
+
+		unsigned long records(); //record scritti
+		unsigned long long bytes(); //byte scritti (intestazione compresa)
+
+
+	private:
+
+		void putVarint(uint64_t value); //scrive un varint
+
+		String _path; //percorso del file
+		FILE *_file; //file della cattura (NULL se chiuso)
+		uint64_t _timeLast; //istante dell'ultimo record (microsecondi del clock monotono)
+		unsigned long _records; //record scritti
+		unsigned long long _bytes; //byte scritti
+
+};
+
+
+//---WIRE CAPTURE READER---
+//lettura sequenziale della cattura
+class WireCaptureReader {
+
+	public:
+
+		WireCaptureReader(const char *path); //costruttore
+		~WireCaptureReader(); //distruttore (rimuove la mappatura)
+
+		bool open(); //mappa il file e verifica l'intestazione
+
+		bool next(WCRecord &record); //legge il record successivo (false alla fine o se il record è troncato)
+		void rewind(); //torna al primo record
+
+		uint64_t start(); //inizio della cattura (microsecondi dall'epoch)
+		size_t size(); //dimensione del file
+		bool truncated(); //indica se la lettura si è fermata su un record incompleto
+
+
+	private:
+
+		bool getVarint(uint64_t &value); //legge un varint
+
+		String _path; //percorso del file
+		const char *_base; //inizio della mappatura (NULL se non aperto)
+		size_t _size; //dimensione della mappatura
+		size_t _position; //posizione di lettura
+		uint64_t _time; //tempo dell'ultimo record letto
+		uint8_t _truncated; //la lettura si è fermata su un record incompleto
+
+};
+
+
+#endif //WIRECAPTURE_H
@@ -0,0 +1,281 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file ImpairedJack.cpp
+ * @brief Mezzo di trasmissione che simula un collegamento disturbato (deterministico, su orologio virtuale)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <algorithm>
+#include "ImpairedJack.h"
+
+
+//---VARIABILI STATICHE---
+const ImpairmentProfile ImpairedJack::CLEAN = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ *
+ * @param mmJTM Mezzo di trasmissione avvolto (riceve i messaggi sopravvissuti ai disturbi)
+ * @param profile Disturbi del collegamento
+ * @param seed Seme del generatore pseudocasuale
+ */
+ImpairedJack::ImpairedJack(JTransmissionMethod &mmJTM, const ImpairmentProfile &profile, uint64_t seed) {
+
+	_mmJTM = &mmJTM;
+	_profile = profile;
+
+	//il generatore non può partire da 0
+	_state = seed ? seed : 0x9E3779B97F4A7C15ULL;
+
+	_busyUntil = 0;
+	_sequence = 0;
+
+	resetStats();
+}
+
+
+/**
+ * @brief Metodo che preleva il primo messaggio dal mezzo avvolto
+ *
+ * @param buffer Buffer in cui salvare il messaggio
+ * @param size Dimensione del buffer
+ *
+ * @return Lunghezza del messaggio
+ */
+size_t ImpairedJack::receive(char *buffer, size_t size) {
+	return _mmJTM->receive(buffer, size);
+}
+
+/**
+ * @brief Metodo che invia il messaggio attraverso il collegamento disturbato
+ *
+ * @param message Messaggio da inviare
+ * @param length Lunghezza del messaggio
+ */
+void ImpairedJack::send(char *message, size_t length) {
+
+	uint64_t extraDelay = 0;
+
+	//riordino: il messaggio viene ritardato e scavalcato dai successivi
+	if (uniform() < _profile.reorderRate) {
+		extraDelay = (uint64_t) _profile.reorderDelay * 1000;
+		_stats.framesReordered++;
+	}
+
+	transmit(message, length, extraDelay);
+
+	//duplicazione: la seconda copia occupa di nuovo il collegamento
+	if (uniform() < _profile.duplicateRate) {
+		transmit(message, length, 0);
+		_stats.framesDuplicated++;
+	}
+}
+
+/**
+ * @brief Metodo che consegna i messaggi arrivati e restituisce i caratteri disponibili nel mezzo avvolto
+ *
+ * @return Caratteri disponibili
+ */
+size_t ImpairedJack::available() {
+
+	pump();
+
+	return _mmJTM->available();
+}
+
+
+/**
+ * @brief Metodo che consegna al mezzo avvolto i messaggi arrivati entro l'istante virtuale corrente
+ */
+void ImpairedJack::pump() {
+
+	uint64_t now = VirtualClock::now();
+
+	while (!_flights.empty() && _flights.front().deliverAt <= now) {
+
+		//estraggo il messaggio con la consegna più vicina
+		std::pop_heap(_flights.begin(), _flights.end(), &later);
+
+		Flight flight = _flights.back();
+		_flights.pop_back();
+
+		_mmJTM->send((char *) flight.message.c_str(), flight.message.size());
+
+		_stats.framesDelivered++;
+	}
+}
+
+/**
+ * @brief Metodo che restituisce l'istante della prossima consegna
+ *
+ * @return Istante della prossima consegna (UINT64_MAX se non ci sono messaggi in volo)
+ */
+uint64_t ImpairedJack::nextDelivery() {
+	return _flights.empty() ? UINT64_MAX : _flights.front().deliverAt;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di messaggi in volo
+ *
+ * @return Messaggi in volo
+ */
+size_t ImpairedJack::inFlight() {
+	return _flights.size();
+}
+
+
+/**
+ * @brief Metodo che cambia i disturbi del collegamento (i messaggi in volo non vengono modificati)
+ *
+ * @param profile Nuovi disturbi
+ */
+void ImpairedJack::setProfile(const ImpairmentProfile &profile) {
+	_profile = profile;
+}
+
+/**
+ * @brief Metodo che restituisce i disturbi correnti
+ *
+ * @return Disturbi del collegamento
+ */
+const ImpairmentProfile &ImpairedJack::profile() {
+	return _profile;
+}
+
+
+/**
+ * @brief Metodo che restituisce i contatori del collegamento
+ *
+ * @return Contatori
+ */
+const ImpairmentStats &ImpairedJack::stats() {
+	return _stats;
+}
+
+/**
+ * @brief Metodo che azzera i contatori
+ */
+void ImpairedJack::resetStats() {
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+
+//---PRIVATE---
+
+//la consegna di a è successiva a quella di b
+bool ImpairedJack::later(const Flight &a, const Flight &b) {
+	return a.deliverAt > b.deliverAt || (a.deliverAt == b.deliverAt && a.sequence > b.sequence);
+}
+
+//simula la trasmissione di una copia del messaggio
+void ImpairedJack::transmit(const char *message, size_t length, uint64_t extraDelay) {
+
+	uint64_t now = VirtualClock::now();
+
+	//byte sul collegamento (compresi i delimitatori del mezzo di trasmissione)
+	size_t wireBytes = length + 2;
+	size_t packets = _profile.mtu ? (wireBytes + _profile.mtu - 1) / _profile.mtu : 1;
+
+	//il messaggio occupa il collegamento dopo quelli già in trasmissione
+	uint64_t start = std::max(now, _busyUntil);
+	uint64_t duration = _profile.baudrate ? (uint64_t) wireBytes * 10 * 1000000ULL / _profile.baudrate : 0;
+
+	_busyUntil = start + duration;
+
+	_stats.framesSent++;
+	_stats.packetsSent += packets;
+	_stats.bytesSent += wireBytes;
+
+	//perdita: basta un pacchetto perso per perdere il messaggio
+	uint8_t lost = _profile.down;
+
+	for (size_t i = 0; i < packets; i++) {
+		if (uniform() < _profile.lossRate) {
+			lost = 1;
+		}
+	}
+
+	if (lost) {
+		_stats.framesLost++;
+		return;
+	}
+
+	Flight flight;
+	flight.message.assign(message, length);
+
+	//corruzione: la distanza tra due bit errati ha distribuzione geometrica
+	if (_profile.bitErrorRate > 0) {
+
+		uint64_t bits = (uint64_t) length * 8;
+		uint64_t position = 0;
+		uint8_t corrupted = 0;
+
+		for (;;) {
+
+			position += (uint64_t) (log(1.0 - uniform()) / log(1.0 - _profile.bitErrorRate));
+
+			if (position >= bits) {
+				break;
+			}
+
+			flight.message[position / 8] ^= (char) (1 << (position % 8));
+
+			_stats.bitErrors++;
+			corrupted = 1;
+
+			position++;
+		}
+
+		if (corrupted) {
+			_stats.framesCorrupted++;
+		}
+	}
+
+	//istante di consegna
+	flight.deliverAt = _busyUntil + (uint64_t) _profile.latency * 1000 + (uint64_t) (uniform() * _profile.jitter * 1000) + extraDelay;
+	flight.sequence = _sequence++;
+
+	_flights.push_back(flight);
+	std::push_heap(_flights.begin(), _flights.end(), &later);
+}
+
+//numero pseudocasuale (xorshift64*)
+uint64_t ImpairedJack::random() {
+
+	_state ^= _state >> 12;
+	_state ^= _state << 25;
+	_state ^= _state >> 27;
+
+	return _state * 0x2545F4914F6CDD1DULL;
+}
+
+//numero pseudocasuale in [0, 1)
+double ImpairedJack::uniform() {
+	return (random() >> 11) * (1.0 / 9007199254740992.0);
+}
@@ -0,0 +1,134 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file ImpairedJack.h
+ * @brief Mezzo di trasmissione che simula un collegamento disturbato (deterministico, su orologio virtuale)
+ *
+ * Avvolge un altro mezzo di trasmissione: i messaggi inviati subiscono perdita, duplicazione, riordino,
+ * corruzione dei byte, frammentazione in pacchetti, limite di banda e latenza configurabili, e vengono
+ * consegnati al mezzo avvolto all'istante virtuale calcolato. Ricezione e caratteri disponibili sono
+ * quelli del mezzo avvolto. Tutte le scelte casuali derivano dal seme: lo stesso scenario dà sempre lo stesso risultato.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef IMPAIREDJACK_H
+#define IMPAIREDJACK_H
+
+#include <Arduino.h>
+#include <JTransmissionMethod.h>
+#include <vector>
+#include "VirtualClock.h"
+
+
+//---TIPI---
+/**
+ * @brief Disturbi del collegamento
+ */
+struct ImpairmentProfile {
+	double lossRate; //probabilità di perdere ogni pacchetto
+	double duplicateRate; //probabilità di consegnare due volte il messaggio
+	double reorderRate; //probabilità di ritardare il messaggio (scavalcato dai successivi)
+	uint32_t reorderDelay; //ritardo dei messaggi riordinati (millisecondi)
+	double bitErrorRate; //probabilità di errore di ogni bit
+	uint16_t mtu; //byte per pacchetto (0 = il messaggio è un unico pacchetto)
+	uint32_t baudrate; //velocità del collegamento (bit/s, 10 bit per byte; 0 = illimitata)
+	uint32_t latency; //latenza (millisecondi)
+	uint32_t jitter; //variazione massima della latenza (millisecondi)
+	uint8_t down; //collegamento interrotto (tutti i pacchetti vengono persi)
+};
+
+/**
+ * @brief Contatori del collegamento
+ */
+struct ImpairmentStats {
+	unsigned long framesSent; //messaggi inviati
+	unsigned long framesDelivered; //messaggi consegnati al mezzo avvolto
+	unsigned long framesLost; //messaggi persi (almeno un pacchetto perso)
+	unsigned long framesDuplicated; //messaggi duplicati
+	unsigned long framesReordered; //messaggi ritardati
+	unsigned long framesCorrupted; //messaggi con almeno un bit errato
+	unsigned long packetsSent; //pacchetti inviati
+	unsigned long bytesSent; //byte trasmessi (compresi i delimitatori)
+	unsigned long bitErrors; //bit errati
+};
+
+
+//---IMPAIRED JACK---
+class ImpairedJack : public JTransmissionMethod {
+
+	public:
+
+		ImpairedJack(JTransmissionMethod &mmJTM, const ImpairmentProfile &profile, uint64_t seed); //costruttore
+
+		size_t receive(char *buffer, size_t size); //preleva il messaggio dal mezzo avvolto
+		void send(char *message, size_t length); //invia il messaggio attraverso il collegamento disturbato
+
+		size_t available(); //consegna i messaggi arrivati e restituisce i caratteri disponibili nel mezzo avvolto
+
+		//simulazione
+		void pump(); //consegna al mezzo avvolto i messaggi arrivati entro l'istante corrente
+		uint64_t nextDelivery(); //istante della prossima consegna (UINT64_MAX se non ci sono messaggi in volo)
+		size_t inFlight(); //messaggi in volo
+
+		//configurazione
+		void setProfile(const ImpairmentProfile &profile); //cambia i disturbi (es. interruzione del collegamento)
+		const ImpairmentProfile &profile(); //disturbi correnti
+
+		//contatori
+		const ImpairmentStats &stats(); //contatori del collegamento
+		void resetStats(); //azzera i contatori
+
+		static const ImpairmentProfile CLEAN; //collegamento senza disturbi
+
+
+	private:
+
+		//messaggio in volo
+		struct Flight {
+			uint64_t deliverAt; //istante di consegna
+			unsigned long sequence; //ordine di invio (a parità di istante)
+			String message; //contenuto (eventualmente corrotto)
+		};
+
+		//confronto per la coda con priorità (la prima consegna in testa)
+		static bool later(const Flight &a, const Flight &b);
+
+		void transmit(const char *message, size_t length, uint64_t extraDelay); //simula la trasmissione di una copia del messaggio
+		uint64_t random(); //numero pseudocasuale (xorshift64*)
+		double uniform(); //numero pseudocasuale in [0, 1)
+
+		JTransmissionMethod *_mmJTM; //mezzo avvolto
+		ImpairmentProfile _profile; //disturbi
+		ImpairmentStats _stats; //contatori
+
+		uint64_t _state; //stato del generatore pseudocasuale
+		uint64_t _busyUntil; //istante in cui il collegamento termina la trasmissione corrente
+		unsigned long _sequence; //contatore dei messaggi inviati
+		std::vector<Flight> _flights; //messaggi in volo (heap)
+
+};
+
+
+#endif //IMPAIREDJACK_H
@@ -0,0 +1,501 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JackScenario.cpp
+ * @brief Scenario simulato tra un bracciale e un telefono collegati da un collegamento disturbato
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <algorithm>
+#include "JackScenario.h"
+
+
+//---COSTANTI INTERNE---
+//timer del firmware (LeweFirmware.ino)
+#define JS_DEVICE_TIMER_SEND_MESSAGE 5000
+#define JS_DEVICE_TIMER_POLLING 1000
+#define JS_DEVICE_READING_INTERVAL 300000
+
+//timer dell'applicazione Android (valori di default di Jack)
+#define JS_PHONE_TIMER_SEND_MESSAGE 1000
+#define JS_PHONE_TIMER_POLLING 500
+
+//timestamp della prima lettura
+#define JS_START_TIMESTAMP 1480000000L
+
+//valore GSR della lettura con l'id indicato (gli id partono da 1)
+#define JS_EXPECTED_GSR(id) (((id) - 1) * 7 % 100)
+
+//id dei campioni live inviati con JK_QOS_RELIABLE (distinti da quelli delle letture)
+#define JS_LIVE_ID_BASE 100000000L
+
+
+//---VARIABILI STATICHE---
+ScenarioResult *JackScenario::_result = NULL;
+std::vector<uint64_t> JackScenario::_sentAt;
+std::vector<uint8_t> JackScenario::_received;
+long JackScenario::_nextID = 0;
+std::vector<uint64_t> JackScenario::_liveSentAt;
+std::vector<uint8_t> JackScenario::_liveReceived;
+uint8_t JackScenario::_sendingLive = 0;
+uint64_t JackScenario::_outageEnd = 0;
+
+
+//---PUBLIC---
+
+/**
+ * @brief Metodo che restituisce la configurazione di default (collegamento pulito, timer del firmware e dell'applicazione)
+ *
+ * @param name Nome dello scenario
+ * @return Configurazione dello scenario
+ */
+ScenarioConfig JackScenario::defaults(const char *name) {
+
+	ScenarioConfig config;
+
+	config.name = name;
+	config.uplink = ImpairedJack::CLEAN;
+	config.downlink = ImpairedJack::CLEAN;
+	config.seed = 1;
+	config.readings = 288; //24 ore di letture
+	config.readingInterval = JS_DEVICE_READING_INTERVAL;
+	config.deviceTimerSendMessage = JS_DEVICE_TIMER_SEND_MESSAGE;
+	config.deviceTimerPolling = JS_DEVICE_TIMER_POLLING;
+	config.phoneTimerSendMessage = JS_PHONE_TIMER_SEND_MESSAGE;
+	config.phoneTimerPolling = JS_PHONE_TIMER_POLLING;
+	config.deviceBurst = 1;
+	config.fragmentation = 0;
+	config.fecParity = 0;
+	config.serialFraming = 0;
+	config.liveInterval = 0;
+	config.liveQos = JK_QOS_LATEST;
+	config.liveTimer = JK_TIMER_LIVE;
+	config.outageStart = 0;
+	config.outageDuration = 0;
+	config.messageTTL = 0;
+	config.dropWhenFull = 0;
+	config.linkDetection = 1;
+	config.deviceTimerProbe = JK_TIMER_PROBE;
+	config.drainTimeout = 3600000;
+
+	return config;
+}
+
+/**
+ * @brief Metodo che esegue lo scenario
+ *
+ * @param config Configurazione dello scenario
+ * @param result Risultato dello scenario
+ */
+void JackScenario::run(const ScenarioConfig &config, ScenarioResult &result) {
+
+	VirtualClock::install();
+
+	//collegamento: bracciale -> disturbi -> loopback <-> loopback <- disturbi <- telefono
+	LoopbackJack deviceEnd, phoneEnd;
+	deviceEnd.connect(phoneEnd);
+
+	//oppure con i delimitatori dei messaggi: bracciale -> disturbi -> SoftwareSerialJack -> HM-10 -> SoftwareSerialJack
+	//<- disturbi <- telefono (i mezzi di trasmissione eliminano gli stream nel distruttore)
+	MockHM10 *module = new MockHM10();
+	module->connect();
+
+	SoftwareSerialJack deviceSerial(*module);
+	SoftwareSerialJack phoneSerial(*new MockHM10Phone(*module));
+
+	JTransmissionAdapter<SoftwareSerialJack> deviceFramed(deviceSerial);
+	JTransmissionAdapter<SoftwareSerialJack> phoneFramed(phoneSerial);
+
+	JTransmissionMethod &deviceWire = config.serialFraming ? (JTransmissionMethod &) deviceFramed : deviceEnd;
+	JTransmissionMethod &phoneWire = config.serialFraming ? (JTransmissionMethod &) phoneFramed : phoneEnd;
+
+	ImpairedJack uplink(deviceWire, config.uplink, config.seed);
+	ImpairedJack downlink(phoneWire, config.downlink, config.seed * 31 + 7);
+
+	//codice correttore: bracciale -> parità -> disturbi -> ... <- disturbi <- parità <- telefono
+	JFecAdapter<JTransmissionMethod> deviceFec(uplink, config.fecParity);
+	JFecAdapter<JTransmissionMethod> phoneFec(downlink, config.fecParity);
+
+	JTransmissionAdapter<JFecAdapter<JTransmissionMethod> > deviceCoded(deviceFec);
+	JTransmissionAdapter<JFecAdapter<JTransmissionMethod> > phoneCoded(phoneFec);
+
+	JTransmissionMethod &deviceRadio = config.fecParity ? (JTransmissionMethod &) deviceCoded : (JTransmissionMethod &) uplink;
+	JTransmissionMethod &phoneRadio = config.fecParity ? (JTransmissionMethod &) phoneCoded : (JTransmissionMethod &) downlink;
+
+	//frammentazione: bracciale -> frammenti -> (parità) -> disturbi -> ... <- disturbi <- (parità) <- frammenti <- telefono
+	//(il telefono riceve i burst del bracciale: riassembla fino a JK_BURST_WINDOW messaggi insieme)
+	JFragmentAdapter<JTransmissionMethod> deviceFragments(deviceRadio);
+	JFragmentAdapter<JTransmissionMethod, JK_BURST_WINDOW> phoneFragments(phoneRadio);
+
+	JTransmissionAdapter<JFragmentAdapter<JTransmissionMethod> > deviceFragmented(deviceFragments);
+	JTransmissionAdapter<JFragmentAdapter<JTransmissionMethod, JK_BURST_WINDOW> > phoneFragmented(phoneFragments);
+
+	JTransmissionMethod &deviceLink = config.fragmentation ? (JTransmissionMethod &) deviceFragmented : deviceRadio;
+	JTransmissionMethod &phoneLink = config.fragmentation ? (JTransmissionMethod &) phoneFragmented : phoneRadio;
+
+	Jack device(deviceLink, &deviceOnReceive, &deviceOnReceiveAck, &deviceGetMessageID, config.deviceTimerSendMessage, config.deviceTimerPolling);
+	Jack phone(phoneLink, &phoneOnReceive, &phoneOnReceiveAck, &phoneGetMessageID, config.phoneTimerSendMessage, config.phoneTimerPolling);
+
+	//inizializzo il risultato
+	result.sent = 0;
+	result.delivered = 0;
+	result.altered = 0;
+	result.duplicates = 0;
+	result.acked = 0;
+	result.dropped = 0;
+	result.expired = 0;
+	result.outageBytes = 0;
+	result.probesSent = 0;
+	result.recovery = 0;
+	result.duration = 0;
+	result.latencies.clear();
+	result.fragmentsSent = 0;
+	result.fragmentsSkipped = 0;
+	result.fecCorrected = 0;
+	result.fecFailed = 0;
+	result.liveSent = 0;
+	result.liveDelivered = 0;
+	result.liveCoalesced = 0;
+	result.liveAges.clear();
+
+	_result = &result;
+	_sentAt.assign(config.readings + 1, 0);
+	_received.assign(config.readings + 1, 0);
+	_nextID = 0;
+	_liveSentAt.clear();
+	_liveReceived.clear();
+	_sendingLive = 0;
+
+	device.setBurstEnabled(config.deviceBurst);
+	device.setTimerLive(config.liveTimer);
+	device.setMessageTTL(config.messageTTL);
+	device.setOnExpire(&deviceOnExpire);
+	device.setLinkDetectionEnabled(config.linkDetection);
+	device.setTimerProbe(config.deviceTimerProbe);
+	phone.setOnReceiveLive(&phoneOnReceiveLive);
+
+	device.start();
+	phone.start();
+
+	uint64_t nextReading = 0;
+	uint64_t nextSample = 0;
+
+	//interruzione del collegamento
+	uint64_t outageStart = (uint64_t) config.outageStart * 1000;
+	uint64_t outageEnd = outageStart + (uint64_t) config.outageDuration * 1000;
+	uint8_t outage = 0;
+	unsigned long bytesBeforeOutage = 0;
+
+	_outageEnd = config.outageDuration ? outageEnd : 0;
+	uint64_t deadline = (uint64_t) config.readings * config.readingInterval * 1000 + (uint64_t) config.drainTimeout * 1000;
+
+	//eseguo finchè tutte le letture sono state confermate, perse o scadute (o scade il tempo)
+	while (result.acked + result.dropped + result.expired < config.readings && VirtualClock::now() < deadline) {
+
+		//inizio e fine dell'interruzione
+		if (config.outageDuration && !outage && VirtualClock::now() >= outageStart && VirtualClock::now() < outageEnd) {
+
+			ImpairmentProfile down = config.uplink;
+			down.down = 1;
+			uplink.setProfile(down);
+
+			down = config.downlink;
+			down.down = 1;
+			downlink.setProfile(down);
+
+			outage = 1;
+			bytesBeforeOutage = uplink.stats().bytesSent;
+
+		} else if (outage && VirtualClock::now() >= outageEnd) {
+
+			uplink.setProfile(config.uplink);
+			downlink.setProfile(config.downlink);
+
+			outage = 0;
+			result.outageBytes = uplink.stats().bytesSent - bytesBeforeOutage;
+		}
+
+		//il bracciale preleva una nuova lettura
+		if (result.sent + result.dropped < config.readings && VirtualClock::now() >= nextReading) {
+
+			JData message;
+
+			message.add("TMP", JS_START_TIMESTAMP + (long) (VirtualClock::now() / 1000000));
+			message.add("GSR", (uint8_t) (result.sent * 7 % 100)); //verificato dal telefono (JS_EXPECTED_GSR)
+			message.add("TME", 36.5);
+
+			//se il buffer di invio è pieno il bracciale riprova al passo successivo (o perde la lettura)
+			if (device.send(message)) {
+				nextReading += (uint64_t) config.readingInterval * 1000;
+			} else if (config.dropWhenFull) {
+				result.dropped++;
+				nextReading += (uint64_t) config.readingInterval * 1000;
+			}
+		}
+
+		//il bracciale preleva un nuovo campione dello stream live (il campione contiene il suo indice)
+		if (config.liveInterval && VirtualClock::now() >= nextSample) {
+
+			JData message;
+
+			message.add("SMP", (long) _liveSentAt.size());
+
+			_liveSentAt.push_back(VirtualClock::now());
+			_liveReceived.push_back(0);
+
+			//con JK_QOS_RELIABLE il campione occupa uno slot del buffer di invio (scartato se è pieno)
+			_sendingLive = 1;
+			device.send(message, config.liveQos);
+			_sendingLive = 0;
+
+			result.liveSent++;
+			nextSample += (uint64_t) config.liveInterval * 1000;
+		}
+
+		//consegno i messaggi arrivati ed eseguo i loop
+		uplink.pump();
+		downlink.pump();
+
+		device.loop();
+		phone.loop();
+
+		//avanzo fino al prossimo evento (al massimo di un passo)
+		uint64_t next = VirtualClock::now() + JS_TICK;
+
+		next = std::min(next, uplink.nextDelivery());
+		next = std::min(next, downlink.nextDelivery());
+
+		if (result.sent + result.dropped < config.readings && nextReading > VirtualClock::now()) {
+			next = std::min(next, nextReading);
+		}
+
+		if (config.liveInterval && nextSample > VirtualClock::now()) {
+			next = std::min(next, nextSample);
+		}
+
+		if (config.outageDuration && outageStart > VirtualClock::now()) {
+			next = std::min(next, outageStart);
+		}
+
+		VirtualClock::advanceTo(next > VirtualClock::now() ? next : VirtualClock::now() + 1);
+	}
+
+	//lo scenario è terminato durante l'interruzione
+	if (outage) {
+		result.outageBytes = uplink.stats().bytesSent - bytesBeforeOutage;
+	}
+
+	result.duration = VirtualClock::now();
+	result.uplink = uplink.stats();
+	result.downlink = downlink.stats();
+	result.fragmentsSent = deviceFragments.fragmentsSent();
+	result.fragmentsSkipped = deviceFragments.fragmentsSkipped();
+	result.fecCorrected = deviceFec.framesCorrected() + phoneFec.framesCorrected();
+	result.fecFailed = deviceFec.framesFailed() + phoneFec.framesFailed();
+	result.liveCoalesced = device.liveCoalesced();
+	result.probesSent = device.probesSent();
+
+	_result = NULL;
+
+	VirtualClock::uninstall();
+}
+
+/**
+ * @brief Metodo che restituisce i byte delle letture consegnate al secondo (delimitatori compresi)
+ *
+ * @param result Risultato dello scenario
+ * @return Goodput (byte/s)
+ */
+double JackScenario::goodput(const ScenarioResult &result) {
+
+	if (result.duration == 0 || result.uplink.framesSent == 0) {
+		return 0;
+	}
+
+	double frameBytes = (double) result.uplink.bytesSent / result.uplink.framesSent;
+
+	return result.delivered * frameBytes / (result.duration / 1e6);
+}
+
+/**
+ * @brief Metodo che restituisce i byte utili consegnati al secondo
+ *
+ * I byte utili di una lettura sono quelli trasmessi nello stesso scenario senza disturbi, reinvii e codice
+ * (baseline): a differenza di goodput(result) la parità e le ritrasmissioni non vengono contate.
+ *
+ * @param result Risultato dello scenario
+ * @param baseline Risultato dello scenario senza disturbi e senza codice
+ * @return Goodput (byte/s)
+ */
+double JackScenario::goodput(const ScenarioResult &result, const ScenarioResult &baseline) {
+
+	if (result.duration == 0 || baseline.delivered == 0) {
+		return 0;
+	}
+
+	double readingBytes = (double) baseline.uplink.bytesSent / baseline.delivered;
+
+	return result.delivered * readingBytes / (result.duration / 1e6);
+}
+
+/**
+ * @brief Metodo che restituisce i messaggi dati trasmessi in più per ogni lettura consegnata
+ *
+ * @param result Risultato dello scenario
+ * @return Overhead dei reinvii (0 = ogni lettura è stata trasmessa una sola volta)
+ */
+double JackScenario::overhead(const ScenarioResult &result) {
+
+	if (result.delivered == 0) {
+		return 0;
+	}
+
+	return (double) (result.uplink.framesSent - result.delivered) / result.delivered;
+}
+
+/**
+ * @brief Metodo che restituisce i byte trasmessi in più dal bracciale per ogni lettura consegnata
+ *
+ * I byte in più sono quelli trasmessi oltre a quelli dello stesso scenario senza disturbi (baseline), in cui
+ * ogni lettura viene trasmessa una sola volta.
+ *
+ * @param result Risultato dello scenario
+ * @param baseline Risultato dello stesso scenario senza disturbi
+ * @return Byte ritrasmessi per lettura consegnata
+ */
+double JackScenario::retransmittedBytes(const ScenarioResult &result, const ScenarioResult &baseline) {
+
+	if (result.delivered == 0 || baseline.delivered == 0) {
+		return 0;
+	}
+
+	double expected = (double) baseline.uplink.bytesSent / baseline.delivered * result.delivered;
+
+	return (result.uplink.bytesSent - expected) / result.delivered;
+}
+
+
+//---PRIVATE---
+
+//il bracciale non riceve messaggi dati
+void JackScenario::deviceOnReceive(JData &, long) {}
+
+//il bracciale riceve la conferma di una lettura (o di un campione live affidabile)
+void JackScenario::deviceOnReceiveAck(long id) {
+
+	if (id >= JS_LIVE_ID_BASE) {
+		return;
+	}
+
+	//prima conferma dopo l'interruzione
+	if (_outageEnd && VirtualClock::now() >= _outageEnd && _result->recovery == 0) {
+		_result->recovery = VirtualClock::now() - _outageEnd;
+	}
+
+	_result->acked++;
+}
+
+//una lettura è scaduta nel buffer di invio del bracciale
+void JackScenario::deviceOnExpire(long id) {
+
+	if (id >= JS_LIVE_ID_BASE) {
+		return;
+	}
+
+	_result->expired++;
+}
+
+//id delle letture del bracciale (progressivo, usato per misurare la latenza)
+long JackScenario::deviceGetMessageID() {
+
+	//campione live inviato con JK_QOS_RELIABLE: non è una lettura
+	if (_sendingLive) {
+		return JS_LIVE_ID_BASE + (long) _liveSentAt.size();
+	}
+
+	long id = ++_nextID;
+
+	if ((size_t) id < _sentAt.size()) {
+		_sentAt[id] = VirtualClock::now();
+	}
+
+	_result->sent++;
+
+	return id;
+}
+
+//il telefono riceve una lettura
+void JackScenario::phoneOnReceive(JData &message, long id) {
+
+	//campione live inviato con JK_QOS_RELIABLE
+	if (id >= JS_LIVE_ID_BASE) {
+		phoneOnReceiveLive(message, id);
+		return;
+	}
+
+	if (id <= 0 || (size_t) id >= _received.size()) {
+		return;
+	}
+
+	//lettura già ricevuta (la conferma precedente è andata persa)
+	if (_received[id]) {
+		_result->duplicates++;
+		return;
+	}
+
+	_received[id] = 1;
+	_result->delivered++;
+
+	//lettura alterata da errori non rilevati
+	long gsr = message.get("GSR");
+	double temperature = message.get("TME");
+
+	if (gsr != JS_EXPECTED_GSR(id) || temperature != 36.5) {
+		_result->altered++;
+	}
+	_result->latencies.push_back(VirtualClock::now() - _sentAt[id]);
+}
+
+//il telefono riceve un campione dello stream live (età = tempo trascorso da quando il bracciale l'ha prodotto)
+void JackScenario::phoneOnReceiveLive(JData &message, long) {
+
+	long sample = message.get("SMP");
+
+	if (sample < 0 || (size_t) sample >= _liveReceived.size() || _liveReceived[sample]) {
+		return;
+	}
+
+	_liveReceived[sample] = 1;
+	_result->liveDelivered++;
+	_result->liveAges.push_back(VirtualClock::now() - _liveSentAt[sample]);
+}
+
+//il telefono non invia messaggi dati
+void JackScenario::phoneOnReceiveAck(long) {}
+
+//il telefono non invia messaggi dati
+long JackScenario::phoneGetMessageID() {
+	return 0;
+}
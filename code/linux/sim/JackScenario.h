@@ -0,0 +1,152 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file JackScenario.h
+ * @brief Scenario simulato tra un bracciale e un telefono collegati da un collegamento disturbato
+ *
+ * Il bracciale invia le letture (TMP, GSR, TME) con i timer del firmware, il telefono le conferma con i timer
+ * dell'applicazione Android. Il tempo è virtuale: l'intero scenario viene eseguito senza attese reali.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef JACKSCENARIO_H
+#define JACKSCENARIO_H
+
+#include <Arduino.h>
+#include <Jack.h>
+#include <JFragmentAdapter.h>
+#include <JFecAdapter.h>
+#include <SoftwareSerialJack.h>
+#include <vector>
+#include "ImpairedJack.h"
+#include "LoopbackJack.h"
+#include "MockHM10.h"
+#include "VirtualClock.h"
+
+//---COSTANTI---
+/**
+ * @brief Passo della simulazione (microsecondi)
+ */
+#define JS_TICK 10000
+
+
+//---TIPI---
+/**
+ * @brief Configurazione dello scenario
+ */
+struct ScenarioConfig {
+	const char *name; //nome dello scenario
+	ImpairmentProfile uplink; //disturbi bracciale -> telefono
+	ImpairmentProfile downlink; //disturbi telefono -> bracciale
+	uint64_t seed; //seme dei generatori pseudocasuali
+	unsigned long readings; //letture inviate dal bracciale
+	unsigned long readingInterval; //intervallo tra due letture (millisecondi)
+	long deviceTimerSendMessage; //timer di reinvio del bracciale (millisecondi)
+	long deviceTimerPolling; //timer di polling del bracciale (millisecondi)
+	long phoneTimerSendMessage; //timer di reinvio del telefono (millisecondi)
+	long phoneTimerPolling; //timer di polling del telefono (millisecondi)
+	uint8_t deviceBurst; //modalità burst del bracciale (invio del backlog a piena velocità)
+	uint8_t fragmentation; //frammentazione dei messaggi in pacchetti (JFragmentAdapter su entrambi i capi)
+	uint8_t fecParity; //byte di parità Reed-Solomon per messaggio (JFecAdapter su entrambi i capi, 0 = nessun codice)
+	uint8_t serialFraming; //collegamento attraverso SoftwareSerialJack e un HM-10 simulato (messaggi delimitati da '<' e '>')
+	unsigned long liveInterval; //intervallo tra due campioni dello stream live del bracciale (millisecondi, 0 = nessuno stream)
+	uint8_t liveQos; //qualità del servizio dello stream live (JK_QOS_*)
+	long liveTimer; //tempo minimo tra due invii dell'ultimo valore (JK_QOS_LATEST, millisecondi)
+	unsigned long outageStart; //inizio dell'interruzione del collegamento (millisecondi)
+	unsigned long outageDuration; //durata dell'interruzione del collegamento (millisecondi, 0 = nessuna interruzione)
+	unsigned long messageTTL; //durata delle letture nel buffer di invio del bracciale (millisecondi, 0 = non scadono)
+	uint8_t dropWhenFull; //la lettura viene persa se il buffer di invio è pieno (altrimenti il bracciale riprova)
+	uint8_t linkDetection; //rilevazione del collegamento interrotto del bracciale (solo verifiche invece dei reinvii)
+	long deviceTimerProbe; //tempo tra due verifiche del collegamento interrotto del bracciale (millisecondi)
+	unsigned long drainTimeout; //tempo massimo di attesa delle conferme dopo l'ultima lettura (millisecondi)
+};
+
+/**
+ * @brief Risultato dello scenario
+ */
+struct ScenarioResult {
+	unsigned long sent; //letture inviate
+	unsigned long delivered; //letture consegnate (senza duplicati)
+	unsigned long altered; //letture consegnate con valori diversi da quelli inviati
+	unsigned long duplicates; //letture consegnate più volte
+	unsigned long acked; //letture confermate al bracciale
+	unsigned long dropped; //letture perse perchè il buffer di invio era pieno
+	unsigned long expired; //letture scadute nel buffer di invio prima della conferma
+	unsigned long outageBytes; //byte trasmessi dal bracciale durante l'interruzione
+	unsigned long probesSent; //verifiche del collegamento inviate dal bracciale
+	uint64_t recovery; //tempo dalla fine dell'interruzione alla prima conferma (microsecondi, 0 = nessuna interruzione)
+	uint64_t duration; //durata dello scenario (microsecondi virtuali)
+	std::vector<uint64_t> latencies; //latenza di consegna di ogni lettura (microsecondi)
+	ImpairmentStats uplink; //contatori bracciale -> telefono
+	ImpairmentStats downlink; //contatori telefono -> bracciale
+	unsigned long fragmentsSent; //frammenti trasmessi dal bracciale
+	unsigned long fragmentsSkipped; //frammenti non ritrasmessi dal bracciale perchè già confermati
+	unsigned long fecCorrected; //messaggi corretti dal codice (entrambi i capi)
+	unsigned long fecFailed; //messaggi scartati perchè non correggibili (entrambi i capi)
+	unsigned long liveSent; //campioni dello stream live prodotti dal bracciale
+	unsigned long liveDelivered; //campioni dello stream live consegnati (senza duplicati)
+	unsigned long liveCoalesced; //campioni sostituiti da uno più recente prima dell'invio
+	std::vector<uint64_t> liveAges; //età di ogni campione alla consegna (microsecondi)
+};
+
+
+//---JACK SCENARIO---
+class JackScenario {
+
+	public:
+
+		static ScenarioConfig defaults(const char *name); //configurazione con i timer del firmware e dell'applicazione
+		static void run(const ScenarioConfig &config, ScenarioResult &result); //esegue lo scenario
+
+		static double goodput(const ScenarioResult &result); //byte delle letture consegnate al secondo
+		static double goodput(const ScenarioResult &result, const ScenarioResult &baseline); //byte utili (senza codice e reinvii) al secondo
+		static double overhead(const ScenarioResult &result); //messaggi dati trasmessi in più per ogni lettura consegnata (0 = nessun reinvio)
+		static double retransmittedBytes(const ScenarioResult &result, const ScenarioResult &baseline); //byte ritrasmessi per lettura consegnata
+
+	private:
+
+		//handler delle istanze di Jack
+		static void deviceOnReceive(JData &message, long id);
+		static void deviceOnReceiveAck(long id);
+		static void deviceOnExpire(long id);
+		static long deviceGetMessageID();
+		static void phoneOnReceive(JData &message, long id);
+		static void phoneOnReceiveLive(JData &message, long id);
+		static void phoneOnReceiveAck(long id);
+		static long phoneGetMessageID();
+
+		//stato dello scenario in esecuzione
+		static ScenarioResult *_result;
+		static std::vector<uint64_t> _sentAt;
+		static std::vector<uint8_t> _received;
+		static long _nextID;
+		static std::vector<uint64_t> _liveSentAt;
+		static std::vector<uint8_t> _liveReceived;
+		static uint8_t _sendingLive;
+		static uint64_t _outageEnd;
+};
+
+
+#endif //JACKSCENARIO_H
@@ -0,0 +1,111 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LoopbackJack.cpp
+ * @brief Mezzo di trasmissione in memoria: i messaggi inviati da un capo vengono ricevuti dall'altro
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include "LoopbackJack.h"
+
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ */
+LoopbackJack::LoopbackJack() {
+	_peer = NULL;
+}
+
+/**
+ * @brief Metodo che collega i due capi
+ *
+ * @param peer L'altro capo
+ */
+void LoopbackJack::connect(LoopbackJack &peer) {
+
+	_peer = &peer;
+	peer._peer = this;
+}
+
+/**
+ * @brief Metodo che preleva il primo messaggio ricevuto
+ *
+ * @param buffer Buffer in cui salvare il messaggio
+ * @param size Dimensione del buffer
+ *
+ * @return Lunghezza del messaggio (0 se non ci sono messaggi o il buffer è troppo piccolo)
+ */
+size_t LoopbackJack::receive(char *buffer, size_t size) {
+
+	if (_inbox.empty() || size == 0) {
+		return 0;
+	}
+
+	String message = _inbox.front();
+	_inbox.pop_front();
+
+	//il messaggio non sta nel buffer
+	if (message.size() >= size) {
+		buffer[0] = 0;
+		return 0;
+	}
+
+	memcpy(buffer, message.c_str(), message.size() + 1);
+
+	return message.size();
+}
+
+/**
+ * @brief Metodo che consegna il messaggio all'altro capo
+ *
+ * @param message Messaggio da inviare
+ * @param length Lunghezza del messaggio
+ */
+void LoopbackJack::send(char *message, size_t length) {
+
+	if (_peer != NULL) {
+		_peer->_inbox.push_back(String(message, length));
+	}
+}
+
+/**
+ * @brief Metodo che restituisce la lunghezza del primo messaggio ricevuto
+ *
+ * @return Lunghezza del messaggio (0 se non ci sono messaggi)
+ */
+size_t LoopbackJack::available() {
+	return _inbox.empty() ? 0 : _inbox.front().size();
+}
+
+/**
+ * @brief Metodo che restituisce il numero di messaggi ricevuti non ancora prelevati
+ *
+ * @return Numero di messaggi
+ */
+size_t LoopbackJack::pending() {
+	return _inbox.size();
+}
@@ -0,0 +1,63 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LoopbackJack.h
+ * @brief Mezzo di trasmissione in memoria: i messaggi inviati da un capo vengono ricevuti dall'altro
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef LOOPBACKJACK_H
+#define LOOPBACKJACK_H
+
+#include <Arduino.h>
+#include <JTransmissionMethod.h>
+#include <deque>
+
+
+class LoopbackJack : public JTransmissionMethod {
+
+	public:
+
+		LoopbackJack(); //costruttore
+
+		void connect(LoopbackJack &peer); //collega i due capi
+
+		size_t receive(char *buffer, size_t size); //preleva il primo messaggio ricevuto
+		void send(char *message, size_t length); //consegna il messaggio all'altro capo
+
+		size_t available(); //lunghezza del primo messaggio ricevuto (0 se non ci sono messaggi)
+
+		size_t pending(); //numero di messaggi ricevuti non ancora prelevati
+
+
+	private:
+
+		LoopbackJack *_peer; //altro capo
+		std::deque<String> _inbox; //messaggi ricevuti
+
+};
+
+
+#endif //LOOPBACKJACK_H
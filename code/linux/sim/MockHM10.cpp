@@ -0,0 +1,370 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file MockHM10.cpp
+ * @brief Modulo bluetooth HM-10 simulato: comandi AT, sonno, sveglia e collegamento del telefono (orologio virtuale)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include "MockHM10.h"
+#include "VirtualClock.h"
+
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe (modulo sveglio, telefono scollegato)
+ */
+MockHM10::MockHM10() {
+
+	_asleep = 0;
+	_connected = 0;
+	_notify = 0;
+	_inFrame = 0;
+	_wakeCount = 0;
+
+	_awakeSince = VirtualClock::now();
+	_awakeTime = 0;
+	_wakeups = 0;
+	_connections = 0;
+	_commands = 0;
+}
+
+
+/**
+ * @brief Metodo che restituisce i caratteri pronti per il microcontrollore
+ *
+ * @return Numero di caratteri (risposte del modulo e caratteri inviati dal telefono)
+ */
+int MockHM10::available() {
+	return _toMcu.size();
+}
+
+/**
+ * @brief Metodo che preleva un carattere per il microcontrollore
+ *
+ * @return Carattere (-1 se non disponibile)
+ */
+int MockHM10::read() {
+
+	if (_toMcu.empty()) {
+		return -1;
+	}
+
+	uint8_t c = _toMcu.front();
+	_toMcu.pop_front();
+
+	return c;
+}
+
+/**
+ * @brief Metodo che legge il prossimo carattere per il microcontrollore senza prelevarlo
+ *
+ * @return Carattere (-1 se non disponibile)
+ */
+int MockHM10::peek() {
+
+	if (_toMcu.empty()) {
+		return -1;
+	}
+
+	return _toMcu.front();
+}
+
+/**
+ * @brief Metodo che riceve un carattere dal microcontrollore
+ *
+ * @param c Carattere
+ *
+ * @return 1 (il carattere viene sempre accettato, anche se ignorato)
+ */
+size_t MockHM10::write(uint8_t c) {
+
+	//addormentato: conto i caratteri della stringa di sveglia
+	if (_asleep) {
+
+		if (++_wakeCount >= MOCK_HM10_WAKE_LENGTH) {
+
+			setAsleep(0);
+			reply("OK+WAKE");
+		}
+
+		return 1;
+	}
+
+	//caratteri dei messaggi Jack: al telefono se è collegato
+	if (c == '<') {
+		_inFrame = 1;
+	}
+
+	if (_inFrame) {
+
+		if (_connected) {
+			_toPhone.push_back(c);
+		}
+
+		if (c == '>') {
+			_inFrame = 0;
+		}
+
+	//caratteri fuori dai messaggi: comando AT
+	} else {
+		_command += (char) c;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Metodo che esegue i comandi AT ricevuti (da chiamare dopo ogni loop del microcontrollore)
+ */
+void MockHM10::update() {
+
+	if (_command.empty()) {
+		return;
+	}
+
+	String command = _command;
+
+	_command.clear();
+
+	if (command == "AT") {
+
+		_commands++;
+
+		//con il telefono collegato AT chiude la connessione
+		if (_connected) {
+
+			_connected = 0;
+			reply("OK+LOST");
+
+		} else {
+			reply("OK");
+		}
+
+	} else if (command == "AT+SLEEP") {
+
+		_commands++;
+
+		reply("OK+SLEEP");
+		setAsleep(1);
+
+	} else if (command == "AT+NOTI1") {
+
+		_commands++;
+		_notify = 1;
+
+		reply("OK+Set:1");
+	}
+
+	//altri caratteri (es. il resto della stringa di sveglia): ignorati
+}
+
+
+/**
+ * @brief Metodo che collega il telefono
+ *
+ * Il modulo addormentato resta visibile: il collegamento lo sveglia.
+ *
+ * @return 1 se il telefono è collegato, 0 se era già collegato
+ */
+uint8_t MockHM10::connect() {
+
+	if (_connected) {
+		return 0;
+	}
+
+	if (_asleep) {
+		setAsleep(0);
+	}
+
+	_connected = 1;
+	_connections++;
+
+	if (_notify) {
+		reply("OK+CONN");
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Metodo che scollega il telefono
+ */
+void MockHM10::disconnect() {
+
+	if (!_connected) {
+		return;
+	}
+
+	_connected = 0;
+
+	if (_notify) {
+		reply("OK+LOST");
+	}
+}
+
+/**
+ * @brief Metodo che indica se il telefono è collegato
+ *
+ * @return 1 se collegato, 0 altrimenti
+ */
+uint8_t MockHM10::connected() {
+	return _connected;
+}
+
+/**
+ * @brief Metodo che riceve un carattere dal telefono
+ *
+ * @param c Carattere
+ *
+ * @return 1 se il carattere è stato consegnato al microcontrollore, 0 se il telefono non è collegato
+ */
+size_t MockHM10::phoneSend(uint8_t c) {
+
+	if (!_connected) {
+		return 0;
+	}
+
+	_toMcu.push_back(c);
+
+	return 1;
+}
+
+/**
+ * @brief Metodo che restituisce i caratteri pronti per il telefono
+ *
+ * @return Numero di caratteri
+ */
+int MockHM10::phoneAvailable() {
+	return _toPhone.size();
+}
+
+/**
+ * @brief Metodo che preleva un carattere per il telefono
+ *
+ * @return Carattere (-1 se non disponibile)
+ */
+int MockHM10::phoneRead() {
+
+	if (_toPhone.empty()) {
+		return -1;
+	}
+
+	uint8_t c = _toPhone.front();
+	_toPhone.pop_front();
+
+	return c;
+}
+
+/**
+ * @brief Metodo che legge il prossimo carattere per il telefono senza prelevarlo
+ *
+ * @return Carattere (-1 se non disponibile)
+ */
+int MockHM10::phonePeek() {
+
+	if (_toPhone.empty()) {
+		return -1;
+	}
+
+	return _toPhone.front();
+}
+
+
+/**
+ * @brief Metodo che indica se il modulo è addormentato
+ *
+ * @return 1 se addormentato, 0 altrimenti
+ */
+uint8_t MockHM10::asleep() {
+	return _asleep;
+}
+
+/**
+ * @brief Metodo che restituisce il tempo passato da sveglio
+ *
+ * @return Microsecondi da sveglio
+ */
+uint64_t MockHM10::awakeTime() {
+	return _asleep ? _awakeTime : _awakeTime + (VirtualClock::now() - _awakeSince);
+}
+
+/**
+ * @brief Metodo che restituisce i risvegli
+ *
+ * @return Numero di risvegli (stringa di sveglia o collegamento del telefono)
+ */
+unsigned long MockHM10::wakeups() {
+	return _wakeups;
+}
+
+/**
+ * @brief Metodo che restituisce i collegamenti del telefono
+ *
+ * @return Numero di collegamenti
+ */
+unsigned long MockHM10::connections() {
+	return _connections;
+}
+
+/**
+ * @brief Metodo che restituisce i comandi AT eseguiti
+ *
+ * @return Numero di comandi
+ */
+unsigned long MockHM10::commands() {
+	return _commands;
+}
+
+
+//---PRIVATE---
+
+//risposta del modulo al microcontrollore
+void MockHM10::reply(const char *text) {
+
+	while (*text) {
+		_toMcu.push_back((uint8_t) *text++);
+	}
+}
+
+//addormenta/sveglia il modulo e aggiorna il tempo da sveglio
+void MockHM10::setAsleep(uint8_t asleep) {
+
+	if (asleep == _asleep) {
+		return;
+	}
+
+	if (asleep) {
+		_awakeTime += VirtualClock::now() - _awakeSince;
+	} else {
+		_awakeSince = VirtualClock::now();
+		_wakeups++;
+	}
+
+	_asleep = asleep;
+	_wakeCount = 0;
+	_inFrame = 0;
+}
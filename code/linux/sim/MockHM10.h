@@ -0,0 +1,133 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file MockHM10.h
+ * @brief Modulo bluetooth HM-10 simulato: comandi AT, sonno, sveglia e collegamento del telefono (orologio virtuale)
+ *
+ * Lato microcontrollore è uno Stream (da passare a SoftwareSerialJack e LwRadio). I caratteri dentro i delimitatori
+ * dei messaggi Jack ('<' ... '>') vengono consegnati al telefono se è collegato; gli altri formano i comandi AT,
+ * eseguiti da update() (il modulo reale li riconosce dalla pausa dopo l'ultimo carattere):
+ * - AT: risponde OK (OK+LOST se il telefono era collegato: la connessione viene chiusa)
+ * - AT+SLEEP: risponde OK+SLEEP e si addormenta
+ * - AT+NOTI1: risponde OK+Set:1 e notifica collegamento (OK+CONN) e scollegamento (OK+LOST)
+ * Addormentato il modulo ignora i caratteri, ma si sveglia con una stringa di più di 80 caratteri (risponde OK+WAKE)
+ * o quando il telefono si collega (resta visibile). Il tempo da sveglio viene misurato con l'orologio virtuale.
+ *
+ * Lato telefono MockHM10Phone è lo Stream dei caratteri scambiati attraverso il collegamento.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef MOCKHM10_H
+#define MOCKHM10_H
+
+#include <Arduino.h>
+#include <deque>
+
+
+//---COSTANTI---
+/**
+ * @brief Lunghezza minima della stringa che sveglia il modulo
+ */
+#define MOCK_HM10_WAKE_LENGTH 81
+
+
+//---MOCK HM-10---
+class MockHM10 : public Stream {
+
+	public:
+
+		MockHM10(); //costruttore (modulo sveglio, telefono scollegato)
+
+		//lato microcontrollore
+		int available();
+		int read();
+		int peek();
+		size_t write(uint8_t c);
+
+		void update(); //esegue i comandi AT ricevuti
+
+		//lato telefono
+		uint8_t connect(); //collega il telefono (sveglia il modulo se dorme)
+		void disconnect(); //scollega il telefono
+		uint8_t connected(); //telefono collegato
+		size_t phoneSend(uint8_t c); //carattere inviato dal telefono (perso se non è collegato)
+		int phoneAvailable(); //caratteri ricevuti dal telefono
+		int phoneRead(); //preleva un carattere ricevuto dal telefono
+		int phonePeek(); //legge il prossimo carattere per il telefono senza prelevarlo
+
+		//stato e contatori
+		uint8_t asleep(); //modulo addormentato
+		uint64_t awakeTime(); //microsecondi da sveglio
+		unsigned long wakeups(); //risvegli (stringa di sveglia o collegamento)
+		unsigned long connections(); //collegamenti del telefono
+		unsigned long commands(); //comandi AT eseguiti
+
+
+	private:
+
+		void reply(const char *text); //risposta del modulo al microcontrollore
+		void setAsleep(uint8_t asleep); //addormenta/sveglia il modulo
+
+		uint8_t _asleep; //modulo addormentato
+		uint8_t _connected; //telefono collegato
+		uint8_t _notify; //notifica di collegamento e scollegamento (AT+NOTI1)
+		uint8_t _inFrame; //dentro un messaggio Jack
+		unsigned int _wakeCount; //caratteri ricevuti da addormentato
+		String _command; //comando AT in ricezione
+
+		std::deque<uint8_t> _toMcu; //caratteri per il microcontrollore
+		std::deque<uint8_t> _toPhone; //caratteri per il telefono
+
+		uint64_t _awakeSince; //ultimo risveglio (microsecondi)
+		uint64_t _awakeTime; //microsecondi da sveglio (risvegli precedenti)
+		unsigned long _wakeups; //risvegli
+		unsigned long _connections; //collegamenti
+		unsigned long _commands; //comandi AT eseguiti
+
+};
+
+
+//---MOCK HM-10 LATO TELEFONO---
+//Stream dei caratteri del telefono (può essere eliminato da SoftwareSerialJack, non elimina il modulo)
+class MockHM10Phone : public Stream {
+
+	public:
+
+		MockHM10Phone(MockHM10 &module) : _module(&module) {}
+
+		int available() { return _module->phoneAvailable(); }
+		int read() { return _module->phoneRead(); }
+		int peek() { return _module->phonePeek(); }
+		size_t write(uint8_t c) { return _module->phoneSend(c); }
+
+
+	private:
+
+		MockHM10 *_module; //modulo simulato
+
+};
+
+
+#endif //MOCKHM10_H
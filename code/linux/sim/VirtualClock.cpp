@@ -0,0 +1,98 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file VirtualClock.cpp
+ * @brief Orologio virtuale per le simulazioni (sostituisce millis() e micros() dello strato di compatibilità)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include "VirtualClock.h"
+
+
+//---VARIABILI STATICHE---
+uint64_t VirtualClock::_now = 0;
+
+
+//---PUBLIC---
+
+/**
+ * @brief Metodo che sostituisce l'orologio di sistema con quello virtuale (il tempo riparte da 0)
+ */
+void VirtualClock::install() {
+
+	_now = 0;
+
+	setClockSource(&millisSource, &microsSource);
+}
+
+/**
+ * @brief Metodo che ripristina l'orologio di sistema
+ */
+void VirtualClock::uninstall() {
+	setClockSource(NULL, NULL);
+}
+
+/**
+ * @brief Metodo che fa avanzare il tempo virtuale
+ *
+ * @param micros Microsecondi da aggiungere
+ */
+void VirtualClock::advance(uint64_t micros) {
+	_now += micros;
+}
+
+/**
+ * @brief Metodo che porta il tempo virtuale all'istante indicato (se è nel futuro)
+ *
+ * @param micros Istante (microsecondi)
+ */
+void VirtualClock::advanceTo(uint64_t micros) {
+
+	if (micros > _now) {
+		_now = micros;
+	}
+}
+
+/**
+ * @brief Metodo che restituisce l'istante corrente
+ *
+ * @return Istante corrente (microsecondi)
+ */
+uint64_t VirtualClock::now() {
+	return _now;
+}
+
+
+//---PRIVATE---
+
+//millisecondi del tempo virtuale
+unsigned long VirtualClock::millisSource() {
+	return (unsigned long) (_now / 1000);
+}
+
+//microsecondi del tempo virtuale
+unsigned long VirtualClock::microsSource() {
+	return (unsigned long) _now;
+}
@@ -0,0 +1,60 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file VirtualClock.h
+ * @brief Orologio virtuale per le simulazioni (sostituisce millis() e micros() dello strato di compatibilità)
+ *
+ * Il tempo avanza solo quando viene chiamato advance(): scenari di ore o giorni vengono eseguiti in millisecondi.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef VIRTUALCLOCK_H
+#define VIRTUALCLOCK_H
+
+#include <Arduino.h>
+
+
+//---VIRTUAL CLOCK---
+class VirtualClock {
+
+	public:
+
+		static void install(); //sostituisce l'orologio di sistema con quello virtuale (riparte da 0)
+		static void uninstall(); //ripristina l'orologio di sistema
+
+		static void advance(uint64_t micros); //fa avanzare il tempo virtuale
+		static void advanceTo(uint64_t micros); //porta il tempo virtuale all'istante indicato (se è nel futuro)
+		static uint64_t now(); //istante corrente (microsecondi)
+
+	private:
+
+		static unsigned long millisSource(); //funzione passata a setClockSource()
+		static unsigned long microsSource(); //funzione passata a setClockSource()
+
+		static uint64_t _now; //istante corrente (microsecondi)
+};
+
+
+#endif //VIRTUALCLOCK_H
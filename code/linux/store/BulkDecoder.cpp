@@ -0,0 +1,689 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file BulkDecoder.cpp
+ * @brief Decodifica in blocco dei log del traffico Jack (file mappati in memoria, più thread)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <ArduinoJson.h>
+#include <Jack.h>
+#include "BulkDecoder.h"
+#include "../gateway/WireCapture.h"
+
+
+//---COSTANTI INTERNE---
+//delimitatori dei messaggi (uguali a SoftwareSerialJack e FileDescriptorJack)
+#define BD_MESSAGE_START_CHARACTER '<'
+#define BD_MESSAGE_FINISH_CHARACTER '>'
+
+//inizio dei messaggi dati e di controllo
+#define BD_DATA_PREFIX "{\"" JK_MESSAGE_PAYLOAD "\":{"
+#define BD_CONTROL_PREFIX "{\"" JK_MESSAGE_ID "\":"
+
+//lunghezza di una stringa costante
+#define BD_LENGTH(s) (sizeof(s) - 1)
+
+
+//---FUNZIONI INTERNE---
+
+//somma i contatori
+static void addStats(BDStats &total, const BDStats &stats) {
+	total.bytes += stats.bytes;
+	total.frames += stats.frames;
+	total.readings += stats.readings;
+	total.fastPath += stats.fastPath;
+	total.control += stats.control;
+	total.rejected += stats.rejected;
+	total.skipped += stats.skipped;
+	total.oversized += stats.oversized;
+	total.truncated += stats.truncated;
+}
+
+//conta i caratteri di inizio nell'intervallo
+static uint64_t countStarts(const char *p, const char *end) {
+
+	uint64_t count = 0;
+
+	while (p < end && (p = (const char *) memchr(p, BD_MESSAGE_START_CHARACTER, end - p)) != NULL) {
+		count++;
+		p++;
+	}
+
+	return count;
+}
+
+//verifica che la stringa costante si trovi alla posizione indicata e la salta
+static inline uint8_t match(const char *&p, const char *end, const char *text, size_t length) {
+
+	if ((size_t) (end - p) < length || memcmp(p, text, length) != 0) {
+		return 0;
+	}
+
+	p += length;
+
+	return 1;
+}
+
+//legge un intero (con segno) e lo salta
+static inline uint8_t parseInteger(const char *&p, const char *end, long &value) {
+
+	uint8_t negative = p < end && *p == '-';
+
+	if (negative) {
+		p++;
+	}
+
+	const char *start = p;
+	unsigned long result = 0;
+
+	while (p < end && *p >= '0' && *p <= '9') {
+		result = result * 10 + (*p++ - '0');
+	}
+
+	//nessuna cifra o numero troppo lungo
+	if (p == start || p - start > 18) {
+		return 0;
+	}
+
+	value = negative ? -(long) result : (long) result;
+
+	return 1;
+}
+
+//legge un numero decimale (con segno, senza esponente) e lo salta
+static inline uint8_t parseDecimal(const char *&p, const char *end, double &value) {
+
+	static const double scale[] = {1.0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+	uint8_t negative = p < end && *p == '-';
+	long integer;
+
+	if (!parseInteger(p, end, integer)) {
+		return 0;
+	}
+
+	value = integer;
+
+	//parte decimale
+	if (p < end && *p == '.') {
+
+		const char *start = ++p;
+		long fraction = 0;
+
+		while (p < end && *p >= '0' && *p <= '9' && p - start < 9) {
+			fraction = fraction * 10 + (*p++ - '0');
+		}
+
+		if (p == start || (p < end && *p >= '0' && *p <= '9')) {
+			return 0;
+		}
+
+		double decimals = fraction / scale[p - start];
+
+		value += negative ? -decimals : decimals;
+	}
+
+	//esponente: lo lascio al parser generico
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		return 0;
+	}
+
+	return 1;
+}
+
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ *
+ * @param threads Numero di thread di decodifica (almeno 1)
+ */
+BulkDecoder::BulkDecoder(int threads) {
+
+	_threads = threads > 0 ? threads : 1;
+	_fastPath = 1;
+}
+
+/**
+ * @brief Costruttore della classe (un thread per core)
+ */
+BulkDecoder::BulkDecoder(): BulkDecoder(std::thread::hardware_concurrency()) {}
+
+//distruttore
+BulkDecoder::~BulkDecoder() {
+
+	for (size_t i = 0; i < _files.size(); i++) {
+
+		if (_files[i]->mapping != NULL) {
+			munmap(_files[i]->mapping, _files[i]->mappingSize);
+		}
+
+		delete _files[i];
+	}
+}
+
+
+/**
+ * @brief Metodo che aggiunge un file da decodificare
+ *
+ * Il file viene mappato in memoria. Delle catture WireCapture vengono usati solo i caratteri ricevuti, copiati in
+ * memoria nell'ordine di arrivo; gli altri file vengono decodificati così come sono.
+ *
+ * @param path Percorso del file
+ * @param device Dispositivo a cui attribuire le letture
+ *
+ * @return true se il file è stato aggiunto
+ */
+bool BulkDecoder::addFile(const char *path, uint16_t device) {
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat info;
+
+	if (fstat(fd, &info) < 0) {
+		close(fd);
+		return false;
+	}
+
+	BDFile *file = new BDFile();
+
+	file->base = NULL;
+	file->size = 0;
+	file->mapping = NULL;
+	file->mappingSize = info.st_size;
+	file->device = device;
+
+	//file vuoto: nessuna mappatura
+	if (info.st_size > 0) {
+
+		void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (mapping == MAP_FAILED) {
+			close(fd);
+			delete file;
+			return false;
+		}
+
+		//ogni blocco viene letto in sequenza
+		madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+
+		file->mapping = mapping;
+		file->base = (const char *) mapping;
+		file->size = info.st_size;
+	}
+
+	close(fd);
+
+	//cattura: estraggo i caratteri ricevuti
+	if (file->size >= BD_LENGTH(WC_MAGIC) && memcmp(file->base, WC_MAGIC, BD_LENGTH(WC_MAGIC)) == 0) {
+
+		WireCaptureReader reader(path);
+		WCRecord record;
+
+		if (!reader.open()) {
+			munmap(file->mapping, file->mappingSize);
+			delete file;
+			return false;
+		}
+
+		while (reader.next(record)) {
+			if (record.direction == WC_RECEIVED) {
+				file->received.insert(file->received.end(), record.data, record.data + record.length);
+			}
+		}
+
+		file->base = file->received.data();
+		file->size = file->received.size();
+	}
+
+	_files.push_back(file);
+
+	return true;
+}
+
+/**
+ * @brief Metodo che restituisce il numero di file da decodificare
+ *
+ * @return Numero di file
+ */
+size_t BulkDecoder::files() {
+	return _files.size();
+}
+
+/**
+ * @brief Metodo che restituisce il numero di caratteri da decodificare
+ *
+ * @return Caratteri di tutti i file (delle catture solo quelli ricevuti)
+ */
+uint64_t BulkDecoder::bytes() {
+
+	uint64_t total = 0;
+
+	for (size_t i = 0; i < _files.size(); i++) {
+		total += _files[i]->size;
+	}
+
+	return total;
+}
+
+
+/**
+ * @brief Metodo che abilita o disabilita il parser specializzato (tutti i messaggi passano da ArduinoJson)
+ *
+ * @param enabled 1 per abilitarlo, 0 per disabilitarlo
+ */
+void BulkDecoder::setFastPath(uint8_t enabled) {
+	_fastPath = enabled;
+}
+
+
+/**
+ * @brief Metodo che decodifica i file
+ *
+ * I blocchi vengono decodificati dai thread in parallelo e le letture passate a onReading sul thread chiamante,
+ * nell'ordine dei file e, all'interno di ogni file, nell'ordine di arrivo. I thread non decodificano più di
+ * BD_PENDING_PER_THREAD blocchi ciascuno oltre l'ultimo restituito.
+ *
+ * @param onReading Funzione chiamata per ogni lettura (NULL per ottenere solo i contatori)
+ * @param context Parametro passato a onReading
+ *
+ * @return Contatori della decodifica
+ */
+BDStats BulkDecoder::decode(void (*onReading)(const RSReading &, void *), void *context) {
+
+	std::vector<BDTask> tasks;
+
+	//divido i file in blocchi
+	for (size_t i = 0; i < _files.size(); i++) {
+		for (size_t offset = 0; offset < _files[i]->size; offset += BD_CHUNK_SIZE) {
+
+			BDTask task;
+
+			task.file = i;
+			task.offset = offset;
+			memset(&task.stats, 0, sizeof(task.stats));
+			task.done = 0;
+
+			tasks.push_back(task);
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	size_t next = 0; //prossimo blocco da decodificare
+	size_t delivered = 0; //blocchi restituiti
+	size_t window = (size_t) _threads * BD_PENDING_PER_THREAD;
+
+	//thread di decodifica
+	std::vector<std::thread> threads;
+
+	for (int t = 0; t < _threads; t++) {
+		threads.push_back(std::thread([&]() {
+			while (true) {
+
+				size_t index;
+
+				//prendo il prossimo blocco (se non sono troppo avanti rispetto alle letture restituite)
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+
+					changed.wait(lock, [&]() { return next >= tasks.size() || next < delivered + window; });
+
+					if (next >= tasks.size()) {
+						return;
+					}
+
+					index = next++;
+				}
+
+				BDTask &task = tasks[index];
+				BDFile *file = _files[task.file];
+				size_t limit = file->size - task.offset < BD_CHUNK_SIZE ? file->size - task.offset : BD_CHUNK_SIZE;
+
+				decodeBlock(file->base + task.offset, file->size - task.offset, limit, file->device, _fastPath, task.readings, task.stats);
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					task.done = 1;
+				}
+
+				changed.notify_all();
+			}
+		}));
+	}
+
+	BDStats total;
+
+	memset(&total, 0, sizeof(total));
+
+	//restituisco le letture in ordine
+	for (size_t i = 0; i < tasks.size(); i++) {
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&]() { return tasks[i].done; });
+		}
+
+		if (onReading != NULL) {
+			for (size_t r = 0; r < tasks[i].readings.size(); r++) {
+				(*onReading)(tasks[i].readings[r], context);
+			}
+		}
+
+		addStats(total, tasks[i].stats);
+
+		//libero le letture del blocco
+		std::vector<RSReading>().swap(tasks[i].readings);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			delivered++;
+		}
+
+		changed.notify_all();
+	}
+
+	for (size_t t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+
+	return total;
+}
+
+
+/**
+ * @brief Metodo che decodifica i messaggi di un blocco
+ *
+ * Vengono decodificati i messaggi il cui carattere di inizio si trova nei primi limit caratteri; l'ultimo può
+ * terminare oltre limit (entro length). I caratteri fuori dai messaggi vengono ignorati.
+ *
+ * @param data Inizio del blocco
+ * @param length Caratteri disponibili da data (fino alla fine del file)
+ * @param limit Dimensione del blocco
+ * @param device Dispositivo a cui attribuire le letture
+ * @param fastPath Indica se usare il parser specializzato
+ * @param readings Letture decodificate (vengono aggiunte in fondo)
+ * @param stats Contatori (vengono incrementati)
+ */
+void BulkDecoder::decodeBlock(const char *data, size_t length, size_t limit, uint16_t device, uint8_t fastPath, std::vector<RSReading> &readings, BDStats &stats) {
+
+	const char *end = data + length;
+	const char *blockEnd = data + limit;
+	const char *p = (const char *) memchr(data, BD_MESSAGE_START_CHARACTER, limit);
+
+	stats.bytes += limit;
+
+	while (p != NULL && p < blockEnd) {
+
+		//fine del messaggio
+		const char *finish = (const char *) memchr(p + 1, BD_MESSAGE_FINISH_CHARACTER, end - p - 1);
+
+		//ultimo messaggio incompleto
+		if (finish == NULL) {
+			break;
+		}
+
+		//il messaggio inizia dall'ultimo carattere di inizio (quelli precedenti erano troncati)
+		const char *start = (const char *) memrchr(p, BD_MESSAGE_START_CHARACTER, finish - p);
+
+		//i caratteri di inizio precedenti (nel blocco) erano di messaggi troncati
+		stats.truncated += countStarts(p, start < blockEnd ? start : blockEnd);
+
+		//il messaggio appartiene al blocco successivo
+		if (start >= blockEnd) {
+			break;
+		}
+
+		size_t frameLength = finish - start - 1;
+
+		stats.frames++;
+
+		if (frameLength > BD_MAX_FRAME_LENGTH) {
+
+			stats.oversized++;
+
+		} else {
+
+			RSReading reading;
+			uint8_t fast;
+
+			switch (decodeFrame(start + 1, frameLength, fastPath, reading, fast)) {
+
+				case BD_READING:
+					reading.device = device;
+					readings.push_back(reading);
+					stats.readings++;
+					stats.fastPath += fast;
+					break;
+
+				case BD_CONTROL:
+					stats.control++;
+					break;
+
+				case BD_SKIPPED:
+					stats.skipped++;
+					break;
+
+				default:
+					stats.rejected++;
+			}
+		}
+
+		//prossimo messaggio
+		p = (const char *) memchr(finish + 1, BD_MESSAGE_START_CHARACTER, end - finish - 1);
+	}
+}
+
+/**
+ * @brief Metodo che decodifica un messaggio (senza delimitatori)
+ *
+ * @param frame Messaggio
+ * @param length Lunghezza del messaggio
+ * @param fastPath Indica se provare il parser specializzato
+ * @param reading Lettura decodificata (se il risultato è BD_READING; device non viene impostato)
+ * @param fast Indica se la lettura è stata decodificata dal parser specializzato
+ *
+ * @return BD_READING, BD_CONTROL, BD_SKIPPED o BD_REJECTED
+ */
+uint8_t BulkDecoder::decodeFrame(const char *frame, size_t length, uint8_t fastPath, RSReading &reading, uint8_t &fast) {
+
+	fast = 0;
+
+	if (fastPath) {
+
+		if (parseReading(frame, length, reading)) {
+			fast = 1;
+			return BD_READING;
+		}
+
+		if (parseControl(frame, length)) {
+			return BD_CONTROL;
+		}
+	}
+
+	return parseJson(frame, length, reading);
+}
+
+
+//---PRIVATE---
+
+//parser specializzato per {"val":{"TMP":..,"GSR":..,"TME":..},"id":..,"type":"data"|"live"} (1 se il messaggio ha lo schema)
+uint8_t BulkDecoder::parseReading(const char *frame, size_t length, RSReading &reading) {
+
+	const char *p = frame;
+	const char *end = frame + length;
+
+	if (!match(p, end, BD_DATA_PREFIX, BD_LENGTH(BD_DATA_PREFIX))) {
+		return 0;
+	}
+
+	uint8_t found = 0;
+	long integer;
+	double decimal;
+
+	//valori (chiavi di 3 caratteri in qualsiasi ordine)
+	for (int i = 0; i < 3; i++) {
+
+		if (i && !match(p, end, ",", 1)) {
+			return 0;
+		}
+
+		if (end - p < 6 || p[0] != '"' || p[4] != '"' || p[5] != ':') {
+			return 0;
+		}
+
+		const char *key = p + 1;
+
+		p += 6;
+
+		if (memcmp(key, RS_TIMESTAMP_KEY, 3) == 0 && !(found & 1)) {
+
+			if (!parseInteger(p, end, integer)) {
+				return 0;
+			}
+
+			reading.timestamp = (uint32_t) integer;
+			found |= 1;
+
+		} else if (memcmp(key, RS_GSR_KEY, 3) == 0 && !(found & 2)) {
+
+			if (!parseInteger(p, end, integer)) {
+				return 0;
+			}
+
+			reading.gsr = (uint8_t) integer;
+			found |= 2;
+
+		} else if (memcmp(key, RS_TEMPERATURE_KEY, 3) == 0 && !(found & 4)) {
+
+			if (!parseDecimal(p, end, decimal)) {
+				return 0;
+			}
+
+			reading.temperature = (float) decimal;
+			found |= 4;
+
+		} else {
+			return 0;
+		}
+	}
+
+	//id e tipo
+	if (!match(p, end, "},\"" JK_MESSAGE_ID "\":", BD_LENGTH("},\"" JK_MESSAGE_ID "\":")) || !parseInteger(p, end, integer) ||
+		!match(p, end, ",\"" JK_MESSAGE_TYPE "\":\"", BD_LENGTH(",\"" JK_MESSAGE_TYPE "\":\""))) {
+		return 0;
+	}
+
+	if (!match(p, end, JK_MESSAGE_TYPE_DATA, BD_LENGTH(JK_MESSAGE_TYPE_DATA)) && !match(p, end, JK_MESSAGE_TYPE_LIVE, BD_LENGTH(JK_MESSAGE_TYPE_LIVE))) {
+		return 0;
+	}
+
+	return match(p, end, "\"}", 2) && p == end;
+}
+
+//riconosce {"id":..,"type":"ack"|"ping"} (1 se il messaggio è di controllo)
+uint8_t BulkDecoder::parseControl(const char *frame, size_t length) {
+
+	const char *p = frame;
+	const char *end = frame + length;
+	long id;
+
+	if (!match(p, end, BD_CONTROL_PREFIX, BD_LENGTH(BD_CONTROL_PREFIX)) || !parseInteger(p, end, id) ||
+		!match(p, end, ",\"" JK_MESSAGE_TYPE "\":\"", BD_LENGTH(",\"" JK_MESSAGE_TYPE "\":\""))) {
+		return 0;
+	}
+
+	if (!match(p, end, JK_MESSAGE_TYPE_ACK, BD_LENGTH(JK_MESSAGE_TYPE_ACK)) && !match(p, end, JK_MESSAGE_TYPE_PING, BD_LENGTH(JK_MESSAGE_TYPE_PING))) {
+		return 0;
+	}
+
+	return match(p, end, "\"}", 2) && p == end;
+}
+
+//parser generico: stesse regole di Jack per il tipo e di ReadingStore::append() per i valori
+uint8_t BulkDecoder::parseJson(const char *frame, size_t length, RSReading &reading) {
+
+	//ArduinoJson modifica il messaggio durante il parsing
+	char json[BD_MAX_FRAME_LENGTH + 1];
+
+	memcpy(json, frame, length);
+	json[length] = 0;
+
+	DynamicJsonBuffer buffer;
+	JsonObject &root = buffer.parseObject(json);
+
+	if (!root.success()) {
+		return BD_REJECTED;
+	}
+
+	const char *type = root[JK_MESSAGE_TYPE];
+
+	if (type == NULL) {
+		return BD_REJECTED;
+	}
+
+	if (strcmp(type, JK_MESSAGE_TYPE_ACK) == 0 || strcmp(type, JK_MESSAGE_TYPE_PING) == 0) {
+		return BD_CONTROL;
+	}
+
+	if (strcmp(type, JK_MESSAGE_TYPE_DATA) != 0 && strcmp(type, JK_MESSAGE_TYPE_LIVE) != 0) {
+		return BD_REJECTED;
+	}
+
+	JsonObject &values = root[JK_MESSAGE_PAYLOAD].asObject();
+
+	if (!values.success()) {
+		return BD_REJECTED;
+	}
+
+	//risposte fasiche, consumi e traccia non contengono nessun sensore
+	if (!values.containsKey(RS_GSR_KEY) && !values.containsKey(RS_TEMPERATURE_KEY)) {
+		return BD_SKIPPED;
+	}
+
+	unsigned long timestamp = values[RS_TIMESTAMP_KEY];
+	uint8_t gsr = values[RS_GSR_KEY];
+	double temperature = values[RS_TEMPERATURE_KEY];
+
+	reading.timestamp = (uint32_t) timestamp;
+	reading.gsr = gsr;
+	reading.temperature = (float) temperature;
+
+	return BD_READING;
+}
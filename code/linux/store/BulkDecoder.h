@@ -0,0 +1,162 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file BulkDecoder.h
+ * @brief Decodifica in blocco dei log del traffico Jack (file mappati in memoria, più thread)
+ *
+ * I log sono i caratteri ricevuti dal gateway così come sono arrivati (file grezzi o catture WireCapture, di cui
+ * vengono usati i caratteri ricevuti). Ogni file viene diviso in blocchi di BD_CHUNK_SIZE byte decodificati da un
+ * gruppo di thread; le letture vengono restituite nell'ordine dei file e dei blocchi.
+ *
+ * I delimitatori dei messaggi vengono cercati con memchr/memrchr (vettorizzate dalla libc): un messaggio va
+ * dall'ultimo '<' prima di un '>' al '>' stesso, come in FileDescriptorJack (un '<' senza '>' indica un messaggio
+ * troncato). Un blocco decodifica i messaggi il cui '<' cade al suo interno, anche se il '>' è nel blocco successivo.
+ *
+ * I messaggi dati con lo schema del bracciale ({"val":{"TMP":..,"GSR":..,"TME":..},"id":..,"type":"data"}, chiavi
+ * in qualsiasi ordine) vengono decodificati da un parser specializzato senza allocazioni; gli altri passano da
+ * ArduinoJson con le stesse regole di ReadingStore::append() (chiavi mancanti = 0).
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef BULKDECODER_H
+#define BULKDECODER_H
+
+#include <Arduino.h>
+#include <vector>
+#include "ReadingStore.h"
+
+//---COSTANTI---
+/**
+ * @brief Dimensione dei blocchi in cui vengono divisi i file
+ */
+#ifndef BD_CHUNK_SIZE
+#define BD_CHUNK_SIZE (4 * 1024 * 1024)
+#endif
+/**
+ * @brief Lunghezza massima di un messaggio (i messaggi più lunghi vengono scartati)
+ */
+#define BD_MAX_FRAME_LENGTH 1024
+/**
+ * @brief Blocchi decodificati e non ancora restituiti per ogni thread (limita la memoria usata)
+ */
+#define BD_PENDING_PER_THREAD 4
+
+//esito della decodifica di un messaggio
+/**
+ * @brief Messaggio con una lettura
+ */
+#define BD_READING 0
+/**
+ * @brief Messaggio di controllo (ACK o verifica del collegamento)
+ */
+#define BD_CONTROL 1
+/**
+ * @brief Messaggio non valido (JSON non valido, senza tipo, di tipo sconosciuto o senza valori)
+ */
+#define BD_REJECTED 2
+/**
+ * @brief Messaggio di dati senza lettura (risposte fasiche, consumi e traccia del firmware)
+ */
+#define BD_SKIPPED 3
+
+
+//---TIPI---
+/**
+ * @brief Contatori della decodifica
+ */
+struct BDStats {
+	uint64_t bytes; //caratteri decodificati
+	uint64_t frames; //messaggi trovati
+	uint64_t readings; //letture decodificate
+	uint64_t fastPath; //letture decodificate dal parser specializzato
+	uint64_t control; //messaggi di controllo (ACK e verifiche)
+	uint64_t rejected; //messaggi non validi
+	uint64_t skipped; //messaggi di dati senza lettura
+	uint64_t oversized; //messaggi più lunghi di BD_MAX_FRAME_LENGTH
+	uint64_t truncated; //messaggi troncati (seguiti da un altro inizio prima della fine)
+};
+
+
+//---BULK DECODER---
+class BulkDecoder {
+
+	public:
+
+		//costruttori
+		BulkDecoder(int threads); //costruttore con il numero di thread
+		BulkDecoder(); //costruttore (un thread per core)
+
+		//distruttore
+		~BulkDecoder();
+
+		//file da decodificare
+		bool addFile(const char *path, uint16_t device); //aggiunge un file (le letture vengono attribuite al dispositivo)
+		size_t files(); //numero di file
+		uint64_t bytes(); //caratteri da decodificare
+
+		//opzioni
+		void setFastPath(uint8_t enabled); //abilita/disabilita il parser specializzato (abilitato di default)
+
+		//decodifica
+		BDStats decode(void (*onReading)(const RSReading &, void *), void *context); //decodifica i file e passa le letture in ordine
+
+		//decodifica di un singolo blocco e di un singolo messaggio (senza thread)
+		static void decodeBlock(const char *data, size_t length, size_t limit, uint16_t device, uint8_t fastPath, std::vector<RSReading> &readings, BDStats &stats);
+		static uint8_t decodeFrame(const char *frame, size_t length, uint8_t fastPath, RSReading &reading, uint8_t &fast);
+
+
+	private:
+
+		//file mappato in memoria
+		struct BDFile {
+			const char *base; //caratteri da decodificare
+			size_t size; //numero di caratteri
+			void *mapping; //mappatura del file (NULL se il file è vuoto)
+			size_t mappingSize; //dimensione della mappatura
+			std::vector<char> received; //caratteri ricevuti (solo per le catture)
+			uint16_t device; //dispositivo
+		};
+
+		//blocco di un file
+		struct BDTask {
+			size_t file; //indice del file
+			size_t offset; //inizio del blocco
+			std::vector<RSReading> readings; //letture decodificate
+			BDStats stats; //contatori del blocco
+			uint8_t done; //blocco decodificato
+		};
+
+		static uint8_t parseReading(const char *frame, size_t length, RSReading &reading); //parser specializzato
+		static uint8_t parseControl(const char *frame, size_t length); //riconosce ACK e verifiche
+		static uint8_t parseJson(const char *frame, size_t length, RSReading &reading); //parser generico (ArduinoJson)
+
+		int _threads; //numero di thread
+		uint8_t _fastPath; //parser specializzato abilitato
+		std::vector<BDFile *> _files; //file da decodificare
+
+};
+
+
+#endif //BULKDECODER_H
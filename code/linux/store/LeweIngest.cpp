@@ -0,0 +1,118 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file LeweIngest.cpp
+ * @brief Importazione nell'archivio delle letture contenute nei log del traffico Jack (BulkDecoder)
+ *
+ * Uso: lewe-ingest [-j thread] [-d dispositivo] archivio log...
+ *
+ * Le letture di ogni log vengono attribuite al dispositivo indicato con -d (default 0) più l'indice del log nella
+ * riga di comando, come fa il gateway con le tty. Senza -j viene usato un thread per core.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "BulkDecoder.h"
+#include "ReadingStore.h"
+
+
+//---HANDLER---
+/**
+ * @brief Aggiunge la lettura decodificata all'archivio
+ *
+ * @param reading Lettura decodificata
+ * @param context Archivio
+ */
+void onReading(const RSReading &reading, void *context) {
+	((ReadingStore *) context)->append(reading.device, reading.timestamp, reading.gsr, reading.temperature);
+}
+
+
+//---MAIN---
+int main(int argc, char **argv) {
+
+	int threads = 0;
+	int firstDevice = 0;
+	int opt;
+
+	//leggo le opzioni
+	while ((opt = getopt(argc, argv, "j:d:")) != -1) {
+
+		if (opt == 'j') {
+			threads = atoi(optarg);
+		} else if (opt == 'd') {
+			firstDevice = atoi(optarg);
+		} else {
+			fprintf(stderr, "uso: %s [-j thread] [-d dispositivo] archivio log...\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind + 1 >= argc) {
+		fprintf(stderr, "uso: %s [-j thread] [-d dispositivo] archivio log...\n", argv[0]);
+		return 1;
+	}
+
+	//apro l'archivio
+	ReadingStore store(argv[optind]);
+
+	if (!store.open()) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	BulkDecoder *decoder = threads > 0 ? new BulkDecoder(threads) : new BulkDecoder();
+
+	//aggiungo i log
+	for (int i = optind + 1; i < argc; i++) {
+		if (!decoder->addFile(argv[i], firstDevice + (i - optind - 1))) {
+			perror(argv[i]);
+		}
+	}
+
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	BDStats stats = decoder->decode(&onReading, &store);
+
+	store.sync();
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	fprintf(stderr, "%zu log, %.1f MB in %.2f s (%.1f MB/s)\n", decoder->files(), stats.bytes / 1048576.0, seconds, stats.bytes / 1048576.0 / seconds);
+	fprintf(stderr, "letture: %llu, messaggi di controllo: %llu, senza lettura: %llu, non validi: %llu, troppo lunghi: %llu, troncati: %llu\n",
+		(unsigned long long) stats.readings, (unsigned long long) stats.control, (unsigned long long) stats.skipped, (unsigned long long) stats.rejected,
+		(unsigned long long) stats.oversized, (unsigned long long) stats.truncated);
+
+	delete decoder;
+
+	return 0;
+}
@@ -0,0 +1,503 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file ReadingStore.cpp
+ * @brief Archivio append-only delle letture ricevute (segmenti colonnari mappati in memoria)
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#include <stdio.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include "ReadingStore.h"
+
+
+//---COSTANTI INTERNE---
+//allineamento delle regioni del segmento
+#define RS_PAGE_SIZE 4096
+
+//allinea la dimensione alla pagina
+static size_t pageAlign(size_t size) {
+	return (size + RS_PAGE_SIZE - 1) / RS_PAGE_SIZE * RS_PAGE_SIZE;
+}
+
+
+//---PUBLIC---
+
+/**
+ * @brief Costruttore della classe
+ *
+ * @param directory Cartella in cui memorizzare i segmenti
+ * @param segmentCapacity Numero di letture di ogni segmento (multiplo di RS_INDEX_STRIDE)
+ */
+ReadingStore::ReadingStore(const char *directory, uint32_t segmentCapacity) {
+
+	_directory = directory;
+
+	//la capacità deve essere un multiplo del passo dell'indice
+	_segmentCapacity = (segmentCapacity + RS_INDEX_STRIDE - 1) / RS_INDEX_STRIDE * RS_INDEX_STRIDE;
+}
+
+/**
+ * @brief Costruttore della classe (ridotto)
+ *
+ * @param directory Cartella in cui memorizzare i segmenti
+ */
+ReadingStore::ReadingStore(const char *directory): ReadingStore(directory, RS_SEGMENT_CAPACITY) {}
+
+
+/**
+ * @brief Distruttore della classe (le letture confermate vengono scritte su disco)
+ */
+ReadingStore::~ReadingStore() {
+
+	for (size_t i = 0; i < _segments.size(); i++) {
+		closeSegment(_segments[i]);
+	}
+}
+
+
+/**
+ * @brief Metodo che apre l'archivio (se la cartella non esiste viene creata)
+ *
+ * @return true se l'archivio è stato aperto
+ */
+bool ReadingStore::open() {
+
+	//creo la cartella (se esiste già non è un errore)
+	mkdir(_directory.c_str(), 0755);
+
+	DIR *directory = opendir(_directory.c_str());
+
+	if (directory == NULL) {
+		return false;
+	}
+
+	//elenco i segmenti esistenti
+	std::vector<String> names;
+	struct dirent *entry;
+
+	while ((entry = readdir(directory)) != NULL) {
+
+		unsigned int number;
+
+		if (sscanf(entry->d_name, "segment-%u.lws", &number) == 1) {
+			names.push_back(entry->d_name);
+		}
+	}
+
+	closedir(directory);
+
+	//i nomi hanno il numero a lunghezza fissa: l'ordine alfabetico è quello di creazione
+	std::sort(names.begin(), names.end());
+
+	for (size_t i = 0; i < names.size(); i++) {
+
+		if (!openSegment((_directory + "/" + names[i]).c_str(), false)) {
+			return false;
+		}
+	}
+
+	//se non ci sono segmenti ne creo uno
+	if (_segments.empty()) {
+		return addSegment();
+	}
+
+	return true;
+}
+
+
+/**
+ * @brief Metodo che aggiunge una lettura all'archivio
+ *
+ * @param device Dispositivo che ha inviato la lettura
+ * @param timestamp Timestamp unix della lettura
+ * @param gsr Lettura GSR
+ * @param temperature Temperatura (gradi Celsius)
+ *
+ * @return true se la lettura è stata memorizzata
+ */
+bool ReadingStore::append(uint16_t device, uint32_t timestamp, uint8_t gsr, double temperature) {
+
+	RSSegment *segment = &_segments.back();
+
+	//se il segmento è pieno ne creo uno nuovo
+	if (segment->header->count == segment->header->capacity) {
+
+		if (!addSegment()) {
+			return false;
+		}
+
+		segment = &_segments.back();
+	}
+
+	uint32_t row = segment->header->count;
+
+	//scrivo le colonne
+	segment->timestamps[row] = timestamp;
+	segment->devices[row] = device;
+	segment->gsr[row] = gsr;
+	segment->temperatures[row] = (int16_t) lround(temperature * 10);
+
+	//aggiorno l'indice sparso del blocco
+	RSIndexEntry &entry = segment->index[row / RS_INDEX_STRIDE];
+
+	if (row % RS_INDEX_STRIDE == 0) {
+		entry.minTimestamp = timestamp;
+		entry.maxTimestamp = timestamp;
+	} else {
+		entry.minTimestamp = std::min(entry.minTimestamp, timestamp);
+		entry.maxTimestamp = std::max(entry.maxTimestamp, timestamp);
+	}
+
+	//aggiorno l'intervallo del segmento
+	if (row == 0) {
+		segment->header->minTimestamp = timestamp;
+		segment->header->maxTimestamp = timestamp;
+	} else {
+		segment->header->minTimestamp = std::min(segment->header->minTimestamp, timestamp);
+		segment->header->maxTimestamp = std::max(segment->header->maxTimestamp, timestamp);
+	}
+
+	//confermo la lettura (il contatore è scritto dopo i dati)
+	__atomic_store_n(&segment->header->count, row + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/**
+ * @brief Metodo che aggiunge la lettura contenuta in un messaggio Jack (da chiamare dall'handler onReceive)
+ *
+ * @param device Dispositivo che ha inviato il messaggio
+ * @param message Messaggio ricevuto
+ *
+ * @return true se la lettura è stata memorizzata (false per i messaggi senza sensori: risposte fasiche, consumi e traccia)
+ */
+bool ReadingStore::append(uint16_t device, JData &message) {
+
+	if (!message.containsKey(RS_GSR_KEY) && !message.containsKey(RS_TEMPERATURE_KEY)) {
+		return false;
+	}
+
+	unsigned long timestamp = message.get(RS_TIMESTAMP_KEY);
+	uint8_t gsr = message.get(RS_GSR_KEY);
+	double temperature = message.get(RS_TEMPERATURE_KEY);
+
+	return append(device, (uint32_t) timestamp, gsr, temperature);
+}
+
+/**
+ * @brief Metodo che scrive su disco le letture confermate
+ */
+void ReadingStore::sync() {
+
+	for (size_t i = 0; i < _segments.size(); i++) {
+		msync(_segments[i].base, _segments[i].size, MS_ASYNC);
+	}
+}
+
+
+/**
+ * @brief Metodo che restituisce il numero di letture memorizzate
+ *
+ * @return Numero di letture
+ */
+uint64_t ReadingStore::count() {
+
+	uint64_t count = 0;
+
+	for (size_t i = 0; i < _segments.size(); i++) {
+		count += _segments[i].header->count;
+	}
+
+	return count;
+}
+
+/**
+ * @brief Metodo che restituisce le letture con timestamp compreso nell'intervallo [from, to]
+ *
+ * @param from Inizio dell'intervallo
+ * @param to Fine dell'intervallo (compresa)
+ * @param device Dispositivo (RS_ALL_DEVICES per tutti i dispositivi)
+ * @param onReading Funzione chiamata per ogni lettura trovata
+ * @param context Puntatore passato alla funzione
+ *
+ * @return Numero di letture trovate
+ */
+uint64_t ReadingStore::scan(uint32_t from, uint32_t to, uint16_t device, void (*onReading)(const RSReading &, void *), void *context) {
+
+	uint64_t found = 0;
+	RSReading reading;
+
+	for (size_t s = 0; s < _segments.size(); s++) {
+
+		RSSegment &segment = _segments[s];
+		uint32_t count = __atomic_load_n(&segment.header->count, __ATOMIC_ACQUIRE);
+
+		//il segmento non interseca l'intervallo
+		if (count == 0 || segment.header->maxTimestamp < from || segment.header->minTimestamp > to) {
+			continue;
+		}
+
+		//scorro i blocchi dell'indice
+		for (uint32_t block = 0; block * RS_INDEX_STRIDE < count; block++) {
+
+			//il blocco non interseca l'intervallo
+			if (segment.index[block].maxTimestamp < from || segment.index[block].minTimestamp > to) {
+				continue;
+			}
+
+			uint32_t end = std::min(count, (block + 1) * RS_INDEX_STRIDE);
+
+			for (uint32_t row = block * RS_INDEX_STRIDE; row < end; row++) {
+
+				uint32_t timestamp = segment.timestamps[row];
+
+				if (timestamp < from || timestamp > to || (device != RS_ALL_DEVICES && segment.devices[row] != device)) {
+					continue;
+				}
+
+				reading.timestamp = timestamp;
+				reading.device = segment.devices[row];
+				reading.gsr = segment.gsr[row];
+				reading.temperature = segment.temperatures[row] / 10.0f;
+
+				(*onReading)(reading, context);
+
+				found++;
+			}
+		}
+	}
+
+	return found;
+}
+
+/**
+ * @brief Metodo che riepiloga (min/max/media) le letture dell'intervallo [from, to] in intervalli di durata fissa
+ *
+ * @param from Inizio dell'intervallo
+ * @param to Fine dell'intervallo (compresa)
+ * @param device Dispositivo (RS_ALL_DEVICES per tutti i dispositivi)
+ * @param interval Durata di ogni intervallo di riepilogo (secondi)
+ * @param buckets Array in cui salvare i riepiloghi
+ * @param size Dimensione dell'array
+ *
+ * @return Numero di riepiloghi scritti nell'array
+ */
+size_t ReadingStore::downsample(uint32_t from, uint32_t to, uint16_t device, uint32_t interval, RSBucket *buckets, size_t size) {
+
+	if (interval == 0 || size == 0 || to < from) {
+		return 0;
+	}
+
+	//numero di intervalli richiesti
+	size_t used = std::min((size_t) ((to - from) / interval + 1), size);
+
+	//limito la ricerca agli intervalli che entrano nell'array
+	if ((uint64_t) from + (uint64_t) used * interval - 1 < to) {
+		to = from + used * interval - 1;
+	}
+
+	//somme per il calcolo delle medie
+	std::vector<double> gsrSum(used, 0.0);
+	std::vector<double> temperatureSum(used, 0.0);
+
+	//inizializzo i riepiloghi
+	for (size_t i = 0; i < used; i++) {
+		buckets[i].start = from + i * interval;
+		buckets[i].count = 0;
+		buckets[i].gsrMin = 0xFF;
+		buckets[i].gsrMax = 0;
+		buckets[i].temperatureMin = 0x7FFF;
+		buckets[i].temperatureMax = -0x8000;
+	}
+
+	//i valori minimi e massimi sono accumulati in decimi di grado
+	for (size_t s = 0; s < _segments.size(); s++) {
+
+		RSSegment &segment = _segments[s];
+		uint32_t count = __atomic_load_n(&segment.header->count, __ATOMIC_ACQUIRE);
+
+		if (count == 0 || segment.header->maxTimestamp < from || segment.header->minTimestamp > to) {
+			continue;
+		}
+
+		for (uint32_t block = 0; block * RS_INDEX_STRIDE < count; block++) {
+
+			if (segment.index[block].maxTimestamp < from || segment.index[block].minTimestamp > to) {
+				continue;
+			}
+
+			uint32_t end = std::min(count, (block + 1) * RS_INDEX_STRIDE);
+
+			for (uint32_t row = block * RS_INDEX_STRIDE; row < end; row++) {
+
+				uint32_t timestamp = segment.timestamps[row];
+
+				if (timestamp < from || timestamp > to || (device != RS_ALL_DEVICES && segment.devices[row] != device)) {
+					continue;
+				}
+
+				size_t i = (timestamp - from) / interval;
+				uint8_t gsr = segment.gsr[row];
+				int16_t temperature = segment.temperatures[row];
+
+				buckets[i].count++;
+				buckets[i].gsrMin = std::min(buckets[i].gsrMin, gsr);
+				buckets[i].gsrMax = std::max(buckets[i].gsrMax, gsr);
+				buckets[i].temperatureMin = std::min(buckets[i].temperatureMin, (float) temperature);
+				buckets[i].temperatureMax = std::max(buckets[i].temperatureMax, (float) temperature);
+				gsrSum[i] += gsr;
+				temperatureSum[i] += temperature;
+			}
+		}
+	}
+
+	//calcolo le medie e converto le temperature in gradi
+	for (size_t i = 0; i < used; i++) {
+
+		if (buckets[i].count == 0) {
+			buckets[i].gsrMin = buckets[i].gsrMax = 0;
+			buckets[i].gsrMean = buckets[i].temperatureMin = buckets[i].temperatureMax = buckets[i].temperatureMean = 0;
+			continue;
+		}
+
+		buckets[i].gsrMean = gsrSum[i] / buckets[i].count;
+		buckets[i].temperatureMean = temperatureSum[i] / buckets[i].count / 10.0;
+		buckets[i].temperatureMin /= 10.0f;
+		buckets[i].temperatureMax /= 10.0f;
+	}
+
+	return used;
+}
+
+
+//---PRIVATE---
+
+//calcola la posizione delle regioni del segmento (se è mappato) e restituisce la dimensione del file
+size_t ReadingStore::layout(RSSegment &segment, uint32_t capacity) {
+
+	size_t header = 0; //la prima pagina contiene l'intestazione
+	size_t index = header + RS_PAGE_SIZE;
+	size_t timestamps = index + pageAlign((capacity / RS_INDEX_STRIDE) * sizeof(RSIndexEntry));
+	size_t devices = timestamps + pageAlign(capacity * sizeof(uint32_t));
+	size_t gsr = devices + pageAlign(capacity * sizeof(uint16_t));
+	size_t temperatures = gsr + pageAlign(capacity * sizeof(uint8_t));
+	size_t size = temperatures + pageAlign(capacity * sizeof(int16_t));
+
+	//imposto i puntatori alle regioni
+	if (segment.base != NULL) {
+		segment.header = (RSSegmentHeader *) (segment.base + header);
+		segment.index = (RSIndexEntry *) (segment.base + index);
+		segment.timestamps = (uint32_t *) (segment.base + timestamps);
+		segment.devices = (uint16_t *) (segment.base + devices);
+		segment.gsr = (uint8_t *) (segment.base + gsr);
+		segment.temperatures = (int16_t *) (segment.base + temperatures);
+	}
+
+	return size;
+}
+
+//apre (o crea) un segmento e lo aggiunge alla lista
+bool ReadingStore::openSegment(const char *path, bool create) {
+
+	RSSegment segment;
+
+	segment.fd = ::open(path, O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0644);
+
+	if (segment.fd < 0) {
+		return false;
+	}
+
+	uint32_t capacity = _segmentCapacity;
+
+	//un segmento esistente mantiene la sua capacità
+	if (!create) {
+
+		RSSegmentHeader header;
+
+		if (pread(segment.fd, &header, sizeof(header), 0) != sizeof(header) || memcmp(header.magic, RS_MAGIC, sizeof(header.magic)) != 0) {
+			::close(segment.fd);
+			return false;
+		}
+
+		capacity = header.capacity;
+	}
+
+	//calcolo la dimensione del file
+	segment.base = NULL;
+	segment.size = layout(segment, capacity);
+
+	//il file nuovo viene esteso alla dimensione finale (i blocchi sono allocati alla prima scrittura)
+	if (create && ftruncate(segment.fd, segment.size) < 0) {
+		::close(segment.fd);
+		return false;
+	}
+
+	segment.base = (char *) mmap(NULL, segment.size, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+
+	if (segment.base == MAP_FAILED) {
+		::close(segment.fd);
+		return false;
+	}
+
+	layout(segment, capacity);
+
+	//inizializzo l'intestazione del nuovo segmento
+	if (create) {
+		memcpy(segment.header->magic, RS_MAGIC, sizeof(segment.header->magic));
+		segment.header->capacity = capacity;
+		segment.header->stride = RS_INDEX_STRIDE;
+		segment.header->count = 0;
+		segment.header->minTimestamp = 0;
+		segment.header->maxTimestamp = 0;
+	}
+
+	_segments.push_back(segment);
+
+	return true;
+}
+
+//chiude un segmento
+void ReadingStore::closeSegment(RSSegment &segment) {
+
+	msync(segment.base, segment.size, MS_SYNC);
+	munmap(segment.base, segment.size);
+	::close(segment.fd);
+}
+
+//crea un nuovo segmento in cui scrivere
+bool ReadingStore::addSegment() {
+
+	char name[32];
+
+	snprintf(name, sizeof(name), "/segment-%06u.lws", (unsigned int) _segments.size());
+
+	return openSegment((_directory + name).c_str(), true);
+}
@@ -0,0 +1,181 @@
+/*
+   Copyright 2016 Alessandro Pasqualini
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   @author         Alessandro Pasqualini <alessandro.pasqualini.1105@gmail.com>
+   @url            https://github.com/alessandro1105
+*/
+
+/**
+ * @file ReadingStore.h
+ * @brief Archivio append-only delle letture ricevute (segmenti colonnari mappati in memoria)
+ *
+ * Ogni segmento è un file di capacità fissa diviso in:
+ * - intestazione (numero di letture confermate, intervallo dei timestamp)
+ * - indice sparso: timestamp minimo e massimo di ogni blocco di RS_INDEX_STRIDE letture
+ * - colonne: timestamp (uint32), dispositivo (uint16), GSR (uint8), temperatura in decimi di grado (int16)
+ *
+ * Le letture vengono scritte direttamente nella mappatura e confermate aggiornando il contatore
+ * nell'intestazione; le ricerche per intervallo saltano i blocchi il cui indice non interseca l'intervallo.
+ *
+ * @author Alessandro Pasqualini (<alessandro.pasqualini.1105@gmail.com>)
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2016-2017 Alessandro Pasqualini
+ * @copyright Apache License, Version 2.0
+ */
+
+#ifndef READINGSTORE_H
+#define READINGSTORE_H
+
+#include <Arduino.h>
+#include <JData.h>
+#include <vector>
+
+//---COSTANTI---
+/**
+ * @brief Numero di letture di ogni segmento
+ */
+#define RS_SEGMENT_CAPACITY 16777216
+/**
+ * @brief Numero di letture coperte da ogni voce dell'indice sparso
+ */
+#define RS_INDEX_STRIDE 4096
+/**
+ * @brief Identificativo del formato dei segmenti
+ */
+#define RS_MAGIC "LWSEG001"
+
+//CHIAVI PER IL MESSAGGIO (uguali al firmware)
+/**
+ * @brief Chiave per il messaggio Jack (Timespamp)
+ */
+#define RS_TIMESTAMP_KEY "TMP"
+/**
+ * @brief Chiave per il messaggio Jack (GSR)
+ */
+#define RS_GSR_KEY "GSR"
+/**
+ * @brief Chiave per il messaggio Jack (Temperatura)
+ */
+#define RS_TEMPERATURE_KEY "TME"
+
+/**
+ * @brief Indica che la ricerca riguarda tutti i dispositivi
+ */
+#define RS_ALL_DEVICES 0xFFFF
+
+
+//---TIPI---
+/**
+ * @brief Lettura memorizzata nell'archivio
+ */
+struct RSReading {
+	uint32_t timestamp; //timestamp unix della lettura
+	uint16_t device; //dispositivo che ha inviato la lettura
+	uint8_t gsr; //lettura GSR (percentuale)
+	float temperature; //temperatura (gradi Celsius)
+};
+
+/**
+ * @brief Riepilogo delle letture di un intervallo di tempo (sottocampionamento)
+ */
+struct RSBucket {
+	uint32_t start; //inizio dell'intervallo
+	uint32_t count; //numero di letture
+	uint8_t gsrMin; //GSR minimo
+	uint8_t gsrMax; //GSR massimo
+	float gsrMean; //GSR medio
+	float temperatureMin; //temperatura minima
+	float temperatureMax; //temperatura massima
+	float temperatureMean; //temperatura media
+};
+
+/**
+ * @brief Intestazione di un segmento (all'inizio del file)
+ */
+struct RSSegmentHeader {
+	char magic[8]; //identificativo del formato
+	uint32_t capacity; //numero massimo di letture
+	uint32_t stride; //letture per voce dell'indice
+	volatile uint32_t count; //letture confermate (scritto per ultimo)
+	uint32_t minTimestamp; //timestamp minimo
+	uint32_t maxTimestamp; //timestamp massimo
+};
+
+/**
+ * @brief Voce dell'indice sparso
+ */
+struct RSIndexEntry {
+	uint32_t minTimestamp; //timestamp minimo del blocco
+	uint32_t maxTimestamp; //timestamp massimo del blocco
+};
+
+/**
+ * @brief Segmento mappato in memoria
+ */
+struct RSSegment {
+	int fd; //file del segmento
+	size_t size; //dimensione della mappatura
+	char *base; //inizio della mappatura
+	RSSegmentHeader *header; //intestazione
+	RSIndexEntry *index; //indice sparso
+	uint32_t *timestamps; //colonna dei timestamp
+	uint16_t *devices; //colonna dei dispositivi
+	uint8_t *gsr; //colonna GSR
+	int16_t *temperatures; //colonna delle temperature (decimi di grado)
+};
+
+
+//---READING STORE---
+class ReadingStore {
+
+	public:
+
+		//costruttori
+		ReadingStore(const char *directory, uint32_t segmentCapacity); //costruttore con la capacità dei segmenti
+		ReadingStore(const char *directory); //costruttore
+
+		//distruttore
+		~ReadingStore();
+
+		//apertura
+		bool open(); //apre (o crea) l'archivio
+
+		//scrittura
+		bool append(uint16_t device, uint32_t timestamp, uint8_t gsr, double temperature); //aggiunge una lettura
+		bool append(uint16_t device, JData &message); //aggiunge la lettura contenuta in un messaggio Jack
+		void sync(); //scrive su disco le letture confermate
+
+		//lettura
+		uint64_t count(); //numero di letture memorizzate
+		uint64_t scan(uint32_t from, uint32_t to, uint16_t device, void (*onReading)(const RSReading &, void *), void *context); //letture nell'intervallo [from, to]
+		size_t downsample(uint32_t from, uint32_t to, uint16_t device, uint32_t interval, RSBucket *buckets, size_t size); //riepilogo delle letture per intervalli
+
+
+	private:
+
+		bool openSegment(const char *path, bool create); //apre (o crea) un segmento
+		void closeSegment(RSSegment &segment); //chiude un segmento
+		bool addSegment(); //crea un nuovo segmento in cui scrivere
+		size_t layout(RSSegment &segment, uint32_t capacity); //calcola la posizione delle colonne e restituisce la dimensione del file
+
+		String _directory; //cartella dei segmenti
+		uint32_t _segmentCapacity; //letture per segmento
+		std::vector<RSSegment> _segments; //segmenti aperti (l'ultimo è quello in scrittura)
+
+};
+
+
+#endif //READINGSTORE_H